@@ -0,0 +1,304 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef _BDD_H_
+#define _BDD_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace bdd
+{
+
+class BDD;
+class BDDManager;
+
+/// Index of a node shifted left by one whose least significant bit
+/// is set if and only if the edge is complemented
+typedef uint32_t Edge;
+
+/// Node in a BDDManager's node pool
+
+/// The high edge of every node is regular (i.e. not complemented),
+/// which makes complement edges canonical. Nodes are never freed
+/// while reference_counter is nonzero; nodes only referenced by
+/// other nodes are reclaimed by BDDManager::gc().
+class BDDnode
+{
+private:
+  friend class BDD;
+  friend class BDDManager;
+
+  // equals BDDManager::free_var() if the node is on the free list
+  unsigned var;
+  Edge low;
+  Edge high;
+
+  // next node in the unique table's bucket or the free list
+  uint32_t next;
+
+  // number of BDD objects that refer to this node
+  unsigned reference_counter;
+
+  bool is_marked;
+
+  BDDnode(unsigned var_, Edge low_, Edge high_)
+  : var(var_),
+    low(low_),
+    high(high_),
+    next(0),
+    reference_counter(0),
+    is_marked(false) {}
+
+  void add_reference()
+  {
+    ++reference_counter;
+  }
+
+  void remove_reference();
+};
+
+/// Reference-counted handle of a Boolean function
+
+/// The BDDManager that created it must outlive the handle. Two BDD
+/// objects of the same manager represent the same function if and
+/// only if their id() values are equal.
+class BDD
+{
+private:
+  friend class BDDManager;
+
+  BDDManager* m_mgr;
+  Edge m_edge;
+
+  BDD(BDDManager* mgr, Edge edge);
+
+  BDDnode& node() const;
+
+public:
+  BDD()
+  : m_mgr(nullptr),
+    m_edge(0) {}
+
+  BDD(const BDD& other);
+  BDD(BDD&& other);
+
+  ~BDD()
+  {
+    clear();
+  }
+
+  BDD& operator=(const BDD& other);
+  BDD& operator=(BDD&& other);
+
+  /// Drop the reference, if any
+  void clear();
+
+  /// Has this handle been default-constructed or cleared?
+  bool is_null() const
+  {
+    return m_mgr == nullptr;
+  }
+
+  BDDManager* manager() const
+  {
+    return m_mgr;
+  }
+
+  /// Canonical identifier of the function within its manager
+  Edge id() const
+  {
+    return m_edge;
+  }
+
+  bool is_constant() const;
+  bool is_true() const;
+  bool is_false() const;
+
+  /// Top variable, or a number greater than every variable
+  /// if the function is constant
+  unsigned var() const;
+
+  /// Cofactors with respect to var()
+  BDD low() const;
+  BDD high() const;
+
+  BDD operator!() const;
+  BDD operator&(const BDD& other) const;
+  BDD operator|(const BDD& other) const;
+  BDD operator^(const BDD& other) const;
+
+  /// Logical equivalence, not a test for equality
+  BDD operator==(const BDD& other) const;
+};
+
+/// If-then-else, i.e. (f & g) | (!f & h)
+BDD ite(const BDD& f, const BDD& g, const BDD& h);
+
+/// Unique table, computed cache and node pool of reduced ordered BDDs
+
+/// Variables are ordered by the time they were made, the first one
+/// being at the root. Every Boolean operator is implemented by a
+/// memoized recursion whose results are kept in a direct-mapped,
+/// lossy computed cache. Nodes are allocated from a pool; unreachable
+/// nodes are collected by a mark-and-sweep garbage collector that
+/// runs between (never during) operations whenever the pool grows
+/// past a threshold.
+class BDDManager
+{
+public:
+  struct Stats
+  {
+    // nodes in the pool, including the terminal
+    size_t nodes;
+    size_t peak_nodes;
+    unsigned long long created_nodes;
+    unsigned long long unique_lookups;
+    unsigned long long unique_hits;
+    unsigned long long cache_lookups;
+    unsigned long long cache_hits;
+    unsigned gc_runs;
+    unsigned long long collected_nodes;
+  };
+
+private:
+  friend class BDD;
+  friend class BDDnode;
+
+  enum Op : uint32_t
+  {
+    AND_OP = 1,
+    XOR_OP,
+    ITE_OP
+  };
+
+  struct CacheEntry
+  {
+    uint32_t op;
+    Edge f;
+    Edge g;
+    Edge h;
+    Edge result;
+  };
+
+  static constexpr Edge s_true_edge = 0;
+  static constexpr Edge s_false_edge = 1;
+
+  std::vector<BDDnode> m_nodes;
+  std::vector<std::string> m_var_table;
+
+  // head of each bucket's chain, zero if the bucket is empty
+  std::vector<uint32_t> m_unique_table;
+
+  std::vector<CacheEntry> m_cache;
+
+  // zero if the free list is empty
+  uint32_t m_free_list;
+  size_t m_free_size;
+
+  size_t m_gc_threshold;
+  Stats m_stats;
+
+  static constexpr unsigned free_var()
+  {
+    return static_cast<unsigned>(-1);
+  }
+
+  static constexpr unsigned terminal_var()
+  {
+    return static_cast<unsigned>(-2);
+  }
+
+  static uint32_t index(Edge edge)
+  {
+    return edge >> 1;
+  }
+
+  static bool is_complemented(Edge edge)
+  {
+    return edge & 1U;
+  }
+
+  unsigned top_var(Edge edge) const
+  {
+    return m_nodes[index(edge)].var;
+  }
+
+  void cofactors(Edge edge, unsigned var, Edge& low, Edge& high) const;
+
+  size_t bucket(unsigned var, Edge low, Edge high) const;
+  void resize_unique_table(size_t size);
+  Edge mk_edge(unsigned var, Edge low, Edge high);
+
+  static size_t cache_hash(Op op, Edge f, Edge g, Edge h);
+  CacheEntry& cache_entry(Op op, Edge f, Edge g, Edge h);
+
+  Edge and_rec(Edge f, Edge g);
+  Edge xor_rec(Edge f, Edge g);
+  Edge ite_rec(Edge f, Edge g, Edge h);
+
+  // collect garbage if the pool has outgrown m_gc_threshold
+  void maybe_gc();
+
+  void check_manager(const BDD& x) const;
+
+public:
+  /// Reserve space for the given number of nodes
+  BDDManager(size_t initial_nodes = 1 << 14);
+
+  BDDManager(const BDDManager&) = delete;
+  BDDManager& operator=(const BDDManager&) = delete;
+
+  BDD True();
+  BDD False();
+
+  /// Introduce a new variable below all existing ones
+  BDD make_var(const std::string& label = std::string());
+
+  /// BDD of a variable returned by make_var()
+  BDD var(unsigned var);
+
+  size_t number_of_vars() const
+  {
+    return m_var_table.size();
+  }
+
+  const std::string& label(unsigned var) const;
+
+  /// Node whose cofactors with respect to var are low and high
+
+  /// \pre: var is above the top variables of low and high
+  BDD mk(unsigned var, const BDD& low, const BDD& high);
+
+  BDD ite(const BDD& f, const BDD& g, const BDD& h);
+
+  /// Number of satisfying assignments over all number_of_vars()
+  /// variables, so 2^number_of_vars() for True()
+  double sat_count(const BDD& f) const;
+
+  /// Number of satisfying assignments over the given number of variables
+
+  /// \pre: the support of f has at most vars variables
+  double sat_count(const BDD& f, size_t vars) const;
+
+  /// Number of nodes in the DAG of f, including the terminal
+  size_t node_count(const BDD& f) const;
+
+  /// Variables on which f depends, in ascending order
+  std::vector<unsigned> support(const BDD& f) const;
+
+  /// Reclaim every node that is unreachable from a BDD object
+  void gc();
+
+  const Stats& stats() const
+  {
+    return m_stats;
+  }
+};
+
+}
+
+#endif
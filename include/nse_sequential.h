@@ -2014,7 +2014,12 @@ public:
 
 
 /// Non-chronological symbolic execution
-class BacktrackDfsChecker : public Checker
+
+/// The backend must implement check_assumptions() with unsat cores,
+/// e.g. smt::Z3Solver, smt::MsatSolver, smt::CVC4Solver or, only if
+/// _BV_THEORY_ is defined, smt::StpSolver.
+template<class BackendSolver>
+class BasicBacktrackDfsChecker : public Checker
 {
 public:
   typedef std::chrono::milliseconds ElapsedTime;
@@ -2043,7 +2048,7 @@ public:
 private:
   typedef smt::NonReentrantTimer<ElapsedTime> Timer;
 
-  smt::Z3Solver m_solver;
+  BackendSolver m_solver;
   Dfs m_dfs;
   Stats m_stats;
 
@@ -2204,7 +2209,7 @@ protected:
 
 public:
 
-  BacktrackDfsChecker()
+  BasicBacktrackDfsChecker()
   : Checker(),
 #ifdef _BV_THEORY_
     m_solver(smt::QF_ABV_LOGIC),
@@ -2378,6 +2383,8 @@ public:
   }
 };
 
+typedef BasicBacktrackDfsChecker<smt::Z3Solver> BacktrackDfsChecker;
+
 /// Non-chronological symbolic execution
 extern BacktrackDfsChecker& backtrack_dfs_checker();
 
@@ -7,6 +7,11 @@
 
 #include <tuple>
 #include <array>
+#include <iosfwd>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -15,6 +20,7 @@
 #include <memory>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <cassert>
 #include <stdexcept>
 #include <type_traits>
@@ -22,6 +28,12 @@
 // Perfect sharing of syntactically equivalent expressions
 #define ENABLE_HASH_CONS
 
+// Allocate expressions from size-segregated free lists
+#define ENABLE_EXPR_POOL
+
+// Allow expressions to be created and deleted by concurrent threads
+#define ENABLE_CONCURRENCY
+
 namespace smt
 {
 
@@ -364,6 +376,40 @@ enum Opcode : unsigned char
   GEQ   // >=
 };
 
+struct Opcodes
+{
+  /// Number of Opcode enum values
+  static constexpr size_t size = GEQ + 1;
+
+  // index must be an Opcode enum value
+  static constexpr const char* const names[size] =
+  {
+    "lnot",
+    "not",
+    "sub",
+    "add",
+    "mul",
+    "and",
+    "or",
+    "xor",
+    "lshl",
+    "lshr",
+    "land",
+    "lor",
+    "imp",
+    "eql",
+    "quo",
+    "rem",
+    "lss",
+    "gtr",
+    "neq",
+    "leq",
+    "geq"
+  };
+
+  Opcodes() = delete;
+};
+
 #define SMT_TERM_DECL(name) \
   class name;               \
 
@@ -395,6 +441,12 @@ enum Error : unsigned {
   // Unsupported SMT-LIB feature
   UNSUPPORT_ERROR,
 
+  // File could not be opened, read, written or mapped
+  IO_ERROR,
+
+  // Data is corrupt or was written by an incompatible version
+  FORMAT_ERROR,
+
   /// Bitwise mask to clear any internal error flags
   ERROR_MASK = 0xFFU
 };
@@ -428,10 +480,12 @@ static inline size_t hash_rotl(const size_t value, const int shift)
   return (value << shift) | (value >> (sizeof(value)*8 - shift));
 }
 
-// courtesy of Daniel Kroening, see CPROVER source file util/irep.cpp
+// Based on CPROVER's util/irep.cpp, but h1 is first multiplied by an odd
+// constant. Without it, the hash of a deep chain such as ((x && b) || b)...
+// cycles through at most 128 values since rotations and XOR are linear.
 static inline size_t hash_combine(const size_t h1, const size_t h2)
 {
-  return hash_rotl(h1, 7)^h2;
+  return hash_rotl(h1 * static_cast<size_t>(0x9e3779b97f4a7c15ULL), 7)^h2;
 }
 
 class Sort {
@@ -484,6 +538,16 @@ private:
       m_is_bv     << 0 ) * 50331653;
   }
 
+  // structural equality of composite sorts, e.g. loaded from a Snapshot
+  bool is_equal_sorts(const Sort& other) const
+  {
+    for (size_t i = 0; i < m_sorts_size; ++i)
+      if (*m_sorts[i] != *other.m_sorts[i])
+        return false;
+
+    return true;
+  }
+
   constexpr unsigned check_sorts_index(size_t index) const
   {
     return index >= m_sorts_size ?
@@ -528,6 +592,26 @@ public:
     m_sorts{sorts},
     m_sorts_size(N) {}
 
+  /// Composite sort whose sorts are only known at runtime
+
+  /// \pre: sorts must outlive this sort
+  constexpr Sort(
+    const Sort* const * sorts,
+    size_t sorts_size,
+    bool is_func,
+    bool is_array)
+  : m_is_bool(false),
+    m_is_int(false),
+    m_is_real(false),
+    m_is_bv(false),
+    m_is_signed(false),
+    m_bv_size(0),
+    m_is_array(is_array),
+    m_is_func(is_func),
+    m_is_tuple(false),
+    m_sorts(sorts),
+    m_sorts_size(sorts_size) {}
+
   Sort(const Sort&) = delete;
 
   constexpr Sort(Sort&& other)
@@ -580,8 +664,8 @@ public:
       m_is_func    == other.m_is_func   &&
       m_is_array   == other.m_is_array  &&
       m_is_tuple   == other.m_is_tuple  &&
-      m_sorts      == other.m_sorts     &&
-      m_sorts_size == other.m_sorts_size;
+      m_sorts_size == other.m_sorts_size &&
+      (m_sorts == other.m_sorts || is_equal_sorts(other));
   }
 
   bool operator!=(const Sort& other) const
@@ -741,6 +825,72 @@ namespace internal {
 // Return dynamically allocated sort, use at own risk
 const Sort& bv_sort(bool is_signed, size_t size);
 
+// Return dynamically allocated array sort, use at own risk
+const Sort& array_sort(const Sort& domain, const Sort& range);
+
+// Return dynamically allocated function sort whose last sort is the
+// range, use at own risk
+const Sort& func_sort(const std::vector<const Sort*>& sorts);
+
+namespace internal
+{
+  /// Table of symbols that consist of a prefix and a counter
+
+  /// Every distinct pair of prefix address and counter is interned as a
+  /// compact identifier, starting from zero, so that a backend can name
+  /// constants with integer symbols (e.g. Z3_mk_int_symbol()) instead
+  /// of building a string for each one. A Symbols object is not
+  /// synchronized.
+  ///
+  /// Backends share one global table, see global_intern(), so that an
+  /// identifier means the same declaration in every solver. Backends
+  /// intern a declaration when they first encode it, so the global table
+  /// only grows with the declarations that have been encoded. It is never
+  /// freed.
+  class Symbols
+  {
+  public:
+    typedef uint32_t Id;
+
+  private:
+    // distinct prefix addresses, there are usually only a few
+    std::vector<const char*> m_prefixes;
+
+    // index of the prefix in the upper and counter in the lower half
+    std::unordered_map<uint64_t, Id> m_ids;
+
+    // inverse of m_ids
+    std::vector<uint64_t> m_keys;
+
+  public:
+    Symbols()
+    : m_prefixes(),
+      m_ids(),
+      m_keys() {}
+
+    Symbols(const Symbols&) = delete;
+
+    /// Identifier of the symbol, interned on its first occurrence
+    Id intern(const char* const prefix, const unsigned counter);
+
+    /// Prefix followed by the counter of an interned symbol
+    std::string name(const Id id) const;
+
+    /// Number of interned symbols
+    size_t size() const
+    {
+      return m_keys.size();
+    }
+
+    /// Identifier of the symbol in the global table, which is
+    /// synchronized if ENABLE_CONCURRENCY is defined
+    static Id global_intern(const char* const prefix, const unsigned counter);
+
+    /// Name of a symbol in the global table
+    static std::string global_name(const Id id);
+  };
+}
+
 class UnsafeDecl
 {
 private:
@@ -764,6 +914,9 @@ public:
 
   /// Allocate sort statically!
 
+  /// The declaration never equals one with a prefix, even if the
+  /// symbol() of both is the same string.
+  ///
   /// \pre: name must be nonempty
   UnsafeDecl(
     std::string&& symbol_name,
@@ -776,11 +929,12 @@ public:
     assert(!m_symbol.empty());
   }
 
+  // symbols with a prefix are not copied, they are rebuilt on demand
   UnsafeDecl(const UnsafeDecl& other)
   : m_prefix(other.m_prefix),
     m_counter(other.m_counter),
     m_sort(other.m_sort),
-    m_symbol(other.m_symbol) {}
+    m_symbol(other.m_prefix == nullptr ? other.m_symbol : std::string()) {}
 
   UnsafeDecl(UnsafeDecl&& other)
   : m_prefix(other.m_prefix),
@@ -800,6 +954,7 @@ public:
     return m_counter;
   }
 
+  /// String that is built on demand, e.g. for printing
   const std::string& symbol() const
   {
     if (m_symbol.empty())
@@ -889,6 +1044,7 @@ class SharedExpr;
 typedef std::vector<SharedExpr> SharedExprs;
 
 class Expr;
+typedef std::vector<const Expr*> ExprPtrs;
 
 namespace internal
 {
@@ -1134,15 +1290,178 @@ public:
 
 typedef Terms<Bool> Bools;
 
+class Simplifier;
+
+/// Log-linear histogram of unsigned 64-bit samples, e.g. latencies
+
+/// Every power of two is split into eight equally wide buckets, so the
+/// relative error of quantile() is at most 12.5%. Recording a sample
+/// takes constant time and never allocates memory.
+class Histogram
+{
+private:
+  static constexpr unsigned s_sub_bucket_bits = 3;
+  static constexpr uint64_t s_sub_buckets = 1U << s_sub_bucket_bits;
+
+  // samples less than s_sub_buckets have a bucket of their own
+  static constexpr size_t s_buckets =
+    s_sub_buckets * (64 - s_sub_bucket_bits + 1);
+
+  std::array<uint64_t, s_buckets> m_buckets;
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_min;
+  uint64_t m_max;
+
+  static size_t bucket(uint64_t value);
+
+  // largest value in the given bucket
+  static uint64_t bucket_max(size_t bucket);
+
+public:
+  Histogram()
+  : m_buckets(),
+    m_count(0),
+    m_sum(0),
+    m_min(std::numeric_limits<uint64_t>::max()),
+    m_max(0) {}
+
+  void record(uint64_t value)
+  {
+    ++m_buckets[bucket(value)];
+    ++m_count;
+    m_sum += value;
+
+    if (value < m_min)
+      m_min = value;
+
+    if (m_max < value)
+      m_max = value;
+  }
+
+  /// Number of samples
+  uint64_t count() const
+  {
+    return m_count;
+  }
+
+  /// Sum of all samples
+  uint64_t sum() const
+  {
+    return m_sum;
+  }
+
+  /// Smallest sample, or zero if there are none
+  uint64_t min() const
+  {
+    return m_count == 0 ? 0 : m_min;
+  }
+
+  /// Largest sample, or zero if there are none
+  uint64_t max() const
+  {
+    return m_max;
+  }
+
+  /// Upper bound of the q-quantile of the samples, e.g. q = 0.99
+
+  /// \pre: 0 <= q <= 1
+  /// \returns zero if there are no samples
+  uint64_t quantile(double q) const;
+
+  void clear();
+
+  /// Write count, sum, min, max, p50, p90, p99 and p999 as a JSON object
+  void write_json(std::ostream& out) const;
+};
+
+/// Thread-safe request to stop the checks of one or more solvers
+
+/// Once cancel() has been called, every running check() of a solver
+/// that uses the token is interrupted, see Solver::interrupt(), and
+/// every later check() returns unknown without calling the backend,
+/// until reset() is called. A backend may ignore an interrupt that
+/// arrives just before its check starts, so cancel() repeats it until
+/// all running checks have returned.
+///
+/// \see_also Solver::set_cancellation_token()
+class CancellationToken
+{
+private:
+  friend class Solver;
+
+  std::mutex m_mutex;
+  std::atomic<bool> m_is_cancelled;
+
+  // solvers whose check is running, guarded by m_mutex
+  std::vector<Solver*> m_solvers;
+
+  // signals that a solver has been removed from m_solvers
+  std::condition_variable m_detached_cond;
+
+  // attaches a solver to the token for the duration of a check
+  class Scope
+  {
+  private:
+    CancellationToken* const m_token;
+    Solver& m_solver;
+    bool m_is_attached;
+
+  public:
+    /// token may be nullptr
+    Scope(CancellationToken* const token, Solver& solver);
+    ~Scope();
+
+    /// Was the token cancelled before the check started?
+    bool is_cancelled() const
+    {
+      return m_token != nullptr && !m_is_attached;
+    }
+  };
+
+public:
+  CancellationToken()
+  : m_mutex(),
+    m_is_cancelled(false),
+    m_solvers(),
+    m_detached_cond() {}
+
+  CancellationToken(const CancellationToken&) = delete;
+
+  /// Interrupt running checks, wait until those of solvers that can
+  /// be interrupted have returned, and make future checks return unknown
+
+  /// Checks of other solvers, see Solver::is_interruptible(), keep
+  /// running after cancel() has returned.
+  void cancel();
+
+  bool is_cancelled() const
+  {
+    return m_is_cancelled.load();
+  }
+
+  /// Allow future checks to run again
+  void reset()
+  {
+    m_is_cancelled.store(false);
+  }
+};
+
 /// Abstract base class of an SMT/SAT solver
 
 /// Memory management:
 ///
-///   Let \c s be a Solver implementation and \c expr be an Expr.
-///   When \c expr is deleted (i.e. its destructor is invoked),
-///   \c s.notify_delete(expr) is called at which point every
-///   Solver subclass should free any solver-specific memory
-///   associated with \c expr without throwing an exception.
+///   Solver subclasses should keep solver-specific data about
+///   expressions in an internal::ExprSideTable. Solvers are not
+///   notified when expressions are deleted; instead, the side table
+///   recognizes entries of deleted expressions by their generation.
+///
+/// Concurrency:
+///
+///   If ENABLE_CONCURRENCY is defined, expressions may be created
+///   and deleted by any number of threads, but each Solver object
+///   must only be used by one thread at a time. The exceptions are
+///   interrupt() and the CancellationToken of the solver.
 ///
 /// Optional features:
 ///
@@ -1174,6 +1493,38 @@ public:
 
     /// Total time it has taken up to now to compute SAT or UNSAT
     ElapsedTime check_elapsed_time;
+
+    /// Number of encoded expressions, indexed by their Opcode
+
+    /// Like the other counters, these also count an expression whenever
+    /// it is encoded again as the argument of another expression.
+    std::array<uint64_t, Opcodes::size> unary_opcodes;
+    std::array<uint64_t, Opcodes::size> binary_opcodes;
+    std::array<uint64_t, Opcodes::size> nary_opcodes;
+
+    /// Results of check() and check_assumptions()
+    uint64_t sat_checks;
+    uint64_t unsat_checks;
+    uint64_t unknown_checks;
+
+    /// Unknown results of checks that reached the timeout
+    uint64_t timeout_checks;
+
+    /// Microseconds taken by each check() and check_assumptions()
+    Histogram check_latencies;
+
+    /// Number of assertions and assumptions at each check() and
+    /// check_assumptions(), irrespective of their size
+    Histogram check_formulas;
+
+    /// Number of DAG nodes in the assertions and assumptions at each
+    /// check() and check_assumptions(). A node shared by several of
+    /// them is counted once, for the first one that encoded it. It is
+    /// zero for solvers that pass assertions on as a whole.
+    Histogram check_dag_nodes;
+
+    /// Write all statistics as a single JSON object
+    void write_json(std::ostream& out) const;
   };
 
 private:
@@ -1182,13 +1533,40 @@ private:
   Stats m_stats;
   bool m_is_timer_on;
 
+  /// optional, not owned by the solver
+  Simplifier* m_simplifier;
+
+  /// zero if there is no time limit, see set_timeout()
+  ElapsedTime m_timeout;
+
+  /// optional, not owned by the solver
+  CancellationToken* m_cancellation_token;
+
+  /// is encode_dag() being called by an Expr::__encode() function?
+  bool m_is_encoding_dag;
+
+  /// reused by encode_dag(), paired with whether args are encoded
+  std::vector<std::pair<const Expr*, bool>> m_dag_stack;
+  ExprPtrs m_dag_args;
+
+  /// number of expressions encoded by encode_dag() so far
+  uint64_t m_dag_nodes;
+
   /// interpreted as logical conjunction
   Bools m_assertions;
 
+  /// DAG nodes encoded by the first i + 1 assertions at index i
+  std::vector<uint64_t> m_assertion_dag_nodes;
+
   /// for incremental solvers, i.e. push() and pop()
   typedef std::vector<unsigned> AssertionStack;
   AssertionStack m_assertion_stack;
 
+  /// unique identifier of every level of m_assertion_stack and of the
+  /// bottom level, see scope()
+  std::vector<uint64_t> m_scope_ids;
+  uint64_t m_last_scope_id;
+
 #define SMT_ENCODE_BUILTIN_LITERAL(type)                                       \
 private:                                                                       \
   virtual Error __encode_literal(                                              \
@@ -1226,6 +1604,23 @@ private:
   template<Opcode opcode>
   friend class internal::EncodeDispatch;
 
+  // increment the statistics of an encoded expression
+  void count_unary(Opcode opcode);
+  void count_binary(Opcode opcode);
+  void count_nary(Opcode opcode, size_t size);
+
+  typedef std::chrono::steady_clock CheckClock;
+
+  // pass condition on to __unsafe_add() and count its new DAG nodes
+  void add_assertion(const SharedExpr& condition);
+
+  // increment the statistics of check() and check_assumptions()
+  CheckResult count_check(
+    const CheckResult result,
+    const CheckClock::time_point start,
+    const size_t formulas,
+    const uint64_t dag_nodes);
+
   virtual Error __encode_constant(
     const Expr* const expr,
     const UnsafeDecl& decl) = 0;
@@ -1379,7 +1774,12 @@ private:
     const unsigned high,
     const unsigned low) = 0;
 
-  virtual void __notify_delete(const Expr* const) = 0;
+  /// Can expr be encoded without encoding its subexpressions first?
+
+  /// Subclasses that cache encoded expressions should return whether
+  /// expr is in the cache. Subclasses that always encode subexpressions
+  /// themselves should return true, which makes encode_dag() recursive.
+  virtual bool __is_encoded(const Expr* const expr) const = 0;
 
   virtual void __reset() = 0;
   virtual void __push() = 0;
@@ -1393,25 +1793,75 @@ private:
     const SharedExprs& assumptions,
     SharedExprs& unsat_core) = 0;
 
+  /// Make a running check() return unknown, see interrupt()
+
+  /// Must be thread-safe. By default, nothing is done so that check()
+  /// runs to completion.
+  virtual void __interrupt() {}
+
+  /// Does __interrupt() stop a running check? By default, false.
+  virtual bool __is_interruptible() const
+  {
+    return false;
+  }
+
+  /// Limit the time of subsequent checks, see set_timeout()
+
+  /// Subclasses map the timeout to the native resource limit of their
+  /// backend. By default, it is ignored.
+  virtual void __set_timeout(const ElapsedTime timeout) {}
+
 protected:
-  /// Registers solver
   Solver();
-
-  /// Registers solver
   Solver(Logic);
 
-public:
-  /// Unregisters solver
-  virtual ~Solver();
+  /// Level of push() and pop() at which backend assertions are added
+  struct Scope
+  {
+    size_t level;
+    uint64_t id;
+  };
+
+  /// Current scope, which is different after every push() and reset()
 
-  /// notifies solver that the given expression is being deleted
+  /// Subclasses can remember the scope in which they have added an
+  /// auxiliary assertion to the backend, e.g. the definition of an
+  /// activation literal, so that they can tell with is_live() whether
+  /// pop() or reset() has removed it since.
+  Scope scope() const
+  {
+    return {m_scope_ids.size() - 1, m_scope_ids.back()};
+  }
+
+  /// Are the backend assertions that were added in the scope still there?
+  bool is_live(const Scope& scope) const
+  {
+    return scope.level < m_scope_ids.size() &&
+      m_scope_ids[scope.level] == scope.id;
+  }
+
+  /// Has the CancellationToken of this solver been cancelled?
 
-  /// Frees any solver-specific resources associated with \c expr
-  void notify_delete(const Expr* const expr)
+  /// Subclasses whose backend polls for termination can call this
+  /// function in addition to handling __interrupt().
+  bool is_cancelled() const
   {
-    __notify_delete(expr);
+    return m_cancellation_token != nullptr &&
+      m_cancellation_token->is_cancelled();
   }
 
+public:
+  virtual ~Solver();
+
+  /// Encode expr after all its subexpressions that are not yet encoded
+
+  /// Subexpressions are visited in post-order with an explicit stack,
+  /// so the native stack does not grow with the depth of the DAG, and
+  /// every subexpression is encoded at most once. When an expression's
+  /// Expr::__encode() function encodes its arguments, they are therefore
+  /// already in the cache of the Solver subclass.
+  Error encode_dag(const Expr* const expr);
+
   const Bools& assertions() const
   {
     return m_assertions;
@@ -1486,6 +1936,16 @@ public:
 
   void pop();
 
+  /// Rewrite conditions before they are added to the solver
+
+  /// The simplifier is not owned by the solver and must outlive it,
+  /// or be unset by passing nullptr. Assertions are recorded after
+  /// they have been rewritten.
+  void set_simplifier(Simplifier* const simplifier)
+  {
+    m_simplifier = simplifier;
+  }
+
   void add(const Bool& condition);
   void add(Bool&& condition);
 
@@ -1515,14 +1975,58 @@ public:
   /// is set to assumptions[j], the return value is 1 and assumptions[i] is
   /// disregarded.
   ///
-  /// Caution: this function is incompatible with the incremental push() and
-  /// pop() interface!
-  ///
-  /// \pre: assertion stack is empty
+  /// This function may be called at any level of push() and pop(). The
+  /// assumptions are not added to the assertions, so they only hold for
+  /// this check.
   ///
   /// \returns number of assumptions written to the end of unsat_core
   std::pair<CheckResult, Bools::SizeType> check_assumptions(
     const Bools& assumptions, Bools& unsat_core);
+
+  /// Ask a check() or check_assumptions() on another thread to stop
+
+  /// The interrupted check returns unknown as soon as the backend
+  /// notices the request. It is safe to call this function while no
+  /// check is running, but a check that starts concurrently may or may
+  /// not be interrupted. Backends that cannot be interrupted ignore it.
+  void interrupt()
+  {
+    __interrupt();
+  }
+
+  /// Can interrupt() stop a running check?
+
+  /// If not, interrupt() is ignored and every check runs to completion,
+  /// so CancellationToken::cancel() does not wait for it.
+  bool is_interruptible() const
+  {
+    return __is_interruptible();
+  }
+
+  /// Make every subsequent check() return unknown after the timeout
+
+  /// A zero timeout, which is the default, means that there is no time
+  /// limit. How precisely the timeout is enforced depends on the backend.
+  /// Checks that reach it are counted in Stats::timeout_checks.
+  void set_timeout(const ElapsedTime timeout)
+  {
+    m_timeout = timeout;
+    __set_timeout(timeout);
+  }
+
+  ElapsedTime timeout() const
+  {
+    return m_timeout;
+  }
+
+  /// Let another thread cancel the checks of this solver
+
+  /// The token is not owned by the solver and must outlive it, or be
+  /// unset by passing nullptr. It may be shared by several solvers.
+  void set_cancellation_token(CancellationToken* const token)
+  {
+    m_cancellation_token = token;
+  }
 };
 
 /// RAII for Solver::push and Solver::pop()
@@ -1544,69 +2048,544 @@ public:
   }
 };
 
-class Expr
+namespace internal
 {
-#ifdef ENABLE_HASH_CONS
-public:
-  /// Hash value
-  typedef size_t Hash;
-#endif
+  /// Base of solvers that pass assertions on to other solvers
 
-private:
-  friend class Solver;
-  friend class SharedExpr;
+  /// A decorator implements the non-encoding member functions of Solver,
+  /// such as __add() and __check(), in terms of other solvers. It never
+  /// encodes an expression itself.
+  class DecoratorSolver : public Solver
+  {
+  private:
+    // assertions are passed on as a whole, so no expression is ever
+    // encoded, and literals fall back on Solver's UNSUPPORT_ERROR
+    virtual Error __encode_constant(
+      const Expr* const expr,
+      const UnsafeDecl& decl) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  // allow Solver implementations to manage memory
-  typedef std::unordered_set<uintptr_t> SolverPtrs;
-  static SolverPtrs s_solver_ptrs;
+    virtual Error __encode_func_app(
+      const Expr* const expr,
+      const UnsafeDecl& func_decl,
+      const size_t arity,
+      const SharedExpr* const args) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  static void register_solver(Solver* s_ptr)
-  {
-    bool ok = std::get<1>(s_solver_ptrs.insert(reinterpret_cast<uintptr_t>(s_ptr)));
-    assert(ok);
-  }
+    virtual Error __encode_const_array(
+      const Expr* const expr,
+      const SharedExpr& init) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  static void unregister_solver(Solver* s_ptr)
-  {
-    SolverPtrs::size_type count = s_solver_ptrs.erase(reinterpret_cast<uintptr_t>(s_ptr));
-    assert(count == 1);
-  }
+    virtual Error __encode_array_select(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  const ExprKind m_expr_kind;
-  const Sort& m_sort;
+    virtual Error __encode_array_store(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index,
+      const SharedExpr& value) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-#ifdef ENABLE_HASH_CONS
-  const size_t m_hash;
-#endif
+#define SMT_DECORATOR_ENCODE_UNARY(name)                                       \
+    virtual Error __encode_unary_##name(                                       \
+      const Expr* const expr,                                                  \
+      const SharedExpr& arg) override                                          \
+    {                                                                          \
+      return UNSUPPORT_ERROR;                                                  \
+    }                                                                          \
+
+#define SMT_DECORATOR_ENCODE_BINARY(name)                                      \
+    virtual Error __encode_binary_##name(                                      \
+      const Expr* const expr,                                                  \
+      const SharedExpr& larg,                                                  \
+      const SharedExpr& rarg) override                                         \
+    {                                                                          \
+      return UNSUPPORT_ERROR;                                                  \
+    }                                                                          \
+
+SMT_DECORATOR_ENCODE_UNARY(lnot)
+SMT_DECORATOR_ENCODE_UNARY(not)
+SMT_DECORATOR_ENCODE_UNARY(sub)
+
+SMT_DECORATOR_ENCODE_BINARY(sub)
+SMT_DECORATOR_ENCODE_BINARY(and)
+SMT_DECORATOR_ENCODE_BINARY(or)
+SMT_DECORATOR_ENCODE_BINARY(xor)
+SMT_DECORATOR_ENCODE_BINARY(lshl)
+SMT_DECORATOR_ENCODE_BINARY(lshr)
+SMT_DECORATOR_ENCODE_BINARY(land)
+SMT_DECORATOR_ENCODE_BINARY(lor)
+SMT_DECORATOR_ENCODE_BINARY(imp)
+SMT_DECORATOR_ENCODE_BINARY(eql)
+SMT_DECORATOR_ENCODE_BINARY(add)
+SMT_DECORATOR_ENCODE_BINARY(mul)
+SMT_DECORATOR_ENCODE_BINARY(quo)
+SMT_DECORATOR_ENCODE_BINARY(rem)
+SMT_DECORATOR_ENCODE_BINARY(lss)
+SMT_DECORATOR_ENCODE_BINARY(gtr)
+SMT_DECORATOR_ENCODE_BINARY(neq)
+SMT_DECORATOR_ENCODE_BINARY(leq)
+SMT_DECORATOR_ENCODE_BINARY(geq)
+
+    virtual Error __encode_nary(
+      const Expr* const expr,
+      Opcode opcode,
+      const SharedExprs& args) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  // modified by SharedExpr
-  unsigned ref_counter;
+    virtual Error __encode_bv_zero_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-  virtual Error __encode(Solver&) const = 0;
+    virtual Error __encode_bv_sign_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-protected:
-  // Allocate sort statically!
-  Expr(
-    ExprKind expr_kind,
-    const Sort& sort)
-  : m_expr_kind(expr_kind),
-    m_sort(sort),
-#ifdef ENABLE_HASH_CONS
-    m_hash(0),
-#endif
-    ref_counter(0)
-  {
-    ++Expr::s_counter;
-  }
+    virtual Error __encode_bv_extract(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned high,
+      const unsigned low) override
+    {
+      return UNSUPPORT_ERROR;
+    }
 
-#ifdef ENABLE_HASH_CONS
-  // Allocate sort statically!
-  Expr(
-    ExprKind expr_kind,
-    const Sort& sort,
+    virtual bool __is_encoded(const Expr* const expr) const override
+    {
+      return true;
+    }
+
+  protected:
+    DecoratorSolver()
+    : Solver()
+    {
+    }
+  };
+}
+
+namespace internal
+{
+#ifdef ENABLE_CONCURRENCY
+  /// Busy-waiting lock for very short critical sections
+
+  /// A zero-initialized SpinLock is unlocked and its destructor is
+  /// trivial, so it can be used by objects with static storage duration
+  /// regardless of the order in which these are initialized or destructed.
+  class SpinLock
+  {
+  private:
+    std::atomic<bool> m_is_locked;
+
+  public:
+    void lock() noexcept
+    {
+      while (m_is_locked.exchange(true, std::memory_order_acquire))
+        while (m_is_locked.load(std::memory_order_relaxed))
+          std::this_thread::yield();
+    }
+
+    void unlock() noexcept
+    {
+      m_is_locked.store(false, std::memory_order_release);
+    }
+  };
+
+  typedef std::mutex ExprMutex;
+#else
+  class SpinLock
+  {
+  public:
+    void lock() noexcept {}
+    void unlock() noexcept {}
+  };
+
+  typedef SpinLock ExprMutex;
+#endif
+}
+
+#ifdef ENABLE_EXPR_POOL
+namespace internal
+{
+  /// Size-segregated memory pool for expression nodes
+
+  /// Every block size is rounded up to a multiple of s_granularity bytes
+  /// and served by its own size class. A size class carves blocks out of
+  /// chunks of s_chunk_size bytes and threads freed blocks onto an
+  /// intrusive LIFO free list, so that nodes created close together in
+  /// time also tend to be close together in memory.
+  ///
+  /// Blocks larger than s_max_block_size bytes bypass the pool.
+  ///
+  /// Chunks are never returned to the operating system. This makes it
+  /// safe to delete expressions that have static storage duration.
+  ///
+  /// Each size class is protected by its own SpinLock.
+  class ExprPool
+  {
+  public:
+    static constexpr size_t s_granularity = 16;
+    static constexpr size_t s_max_block_size = 256;
+    static constexpr size_t s_chunk_size = 64 * 1024;
+    static constexpr size_t s_size_classes = s_max_block_size / s_granularity;
+
+    struct Stats
+    {
+      /// Number of chunks obtained from operator new
+      size_t chunks;
+
+      /// Total number of bytes in those chunks
+      size_t reserved_bytes;
+
+      /// Number of blocks that are currently allocated
+      size_t live_blocks;
+
+      /// Total number of bytes in currently allocated blocks
+      size_t live_bytes;
+
+      /// Number of allocations served by a size class so far
+      uint64_t allocations;
+
+      /// Number of allocations that bypassed the pool so far
+      uint64_t oversized_allocations;
+
+      /// Fraction of reserved bytes in currently allocated blocks
+      double occupancy() const
+      {
+        return reserved_bytes == 0 ? 0.0 :
+          static_cast<double>(live_bytes) / reserved_bytes;
+      }
+    };
+
+  private:
+    struct FreeBlock
+    {
+      FreeBlock* next;
+    };
+
+    struct SizeClass
+    {
+      SpinLock lock;
+      FreeBlock* free_list;
+
+      // unused tail of the most recently reserved chunk
+      char* bump_begin;
+      char* bump_end;
+
+      size_t chunks;
+      size_t live_blocks;
+      uint64_t allocations;
+    };
+
+    // zero-initialized at compile-time and never destructed
+    static SizeClass s_pool[s_size_classes];
+    static std::atomic<uint64_t> s_oversized_allocations;
+
+    static constexpr size_t size_class_index(size_t size)
+    {
+      return (size + s_granularity - 1) / s_granularity - 1;
+    }
+
+    // reserve a new chunk and return its first block
+    static void* refill(SizeClass& size_class, size_t block_size);
+
+    static void add_stats(
+      SizeClass& size_class,
+      size_t block_size,
+      Stats& stats);
+
+  public:
+    ExprPool() = delete;
+
+    static void* allocate(size_t size)
+    {
+      if (size == 0 || s_max_block_size < size)
+      {
+        ++s_oversized_allocations;
+        return ::operator new(size);
+      }
+
+      SizeClass& size_class = s_pool[size_class_index(size)];
+      std::lock_guard<SpinLock> lock(size_class.lock);
+      ++size_class.allocations;
+      ++size_class.live_blocks;
+
+      FreeBlock* const block = size_class.free_list;
+      if (block != nullptr)
+      {
+        size_class.free_list = block->next;
+        return block;
+      }
+
+      const size_t block_size = (size_class_index(size) + 1) * s_granularity;
+      if (size_class.bump_begin != size_class.bump_end)
+      {
+        void* const ptr = size_class.bump_begin;
+        size_class.bump_begin += block_size;
+        return ptr;
+      }
+
+      return refill(size_class, block_size);
+    }
+
+    /// \pre: ptr was returned by allocate(size)
+    static void deallocate(void* ptr, size_t size) noexcept
+    {
+      if (ptr == nullptr)
+        return;
+
+      if (size == 0 || s_max_block_size < size)
+      {
+        ::operator delete(ptr);
+        return;
+      }
+
+      SizeClass& size_class = s_pool[size_class_index(size)];
+      std::lock_guard<SpinLock> lock(size_class.lock);
+      assert(0 < size_class.live_blocks);
+      --size_class.live_blocks;
+
+      FreeBlock* const block = static_cast<FreeBlock*>(ptr);
+      block->next = size_class.free_list;
+      size_class.free_list = block;
+    }
+
+    /// Statistics summed over all size classes
+    static Stats stats();
+
+    /// Statistics of the size class that serves blocks of the given size
+
+    /// \pre: 0 < size <= s_max_block_size
+    static Stats stats(size_t size);
+  };
+}
+#endif
+
+namespace internal
+{
+  /// Identifier of an expression
+
+  /// While an expression is alive, no other expression has the same
+  /// index. Indexes are dense because those of deleted expressions are
+  /// reused, but every reuse increments the generation of the index.
+  struct ExprId
+  {
+    uint32_t index;
+
+    /// never zero
+    uint32_t generation;
+  };
+
+  /// Allocator of expression identifiers
+
+  /// Freed indexes are reused in LIFO order. The allocator's state is
+  /// zero-initialized at compile-time and never destructed, so that
+  /// expressions with static storage duration can be safely deleted.
+  class ExprIds
+  {
+  private:
+    struct Slot
+    {
+      uint32_t generation;
+
+      // one plus the index of the next free slot, or zero
+      uint32_t next_free;
+    };
+
+    static SpinLock s_lock;
+    static Slot* s_slots;
+    static uint32_t s_size;
+    static uint32_t s_capacity;
+
+    // one plus the index of the most recently freed slot, or zero
+    static uint32_t s_free_head;
+
+    static void grow();
+
+  public:
+    static ExprId acquire()
+    {
+      std::lock_guard<SpinLock> lock(s_lock);
+
+      uint32_t index;
+      if (s_free_head != 0)
+      {
+        index = s_free_head - 1;
+        s_free_head = s_slots[index].next_free;
+      }
+      else
+      {
+        if (s_size == s_capacity)
+          grow();
+
+        index = s_size++;
+        s_slots[index].generation = 1;
+      }
+
+      return {index, s_slots[index].generation};
+    }
+
+    static void release(const ExprId id) noexcept
+    {
+      std::lock_guard<SpinLock> lock(s_lock);
+
+      Slot& slot = s_slots[id.index];
+      assert(slot.generation == id.generation);
+
+      // on overflow, skip zero that marks unused side table entries
+      if (++slot.generation == 0)
+        slot.generation = 1;
+
+      slot.next_free = s_free_head;
+      s_free_head = id.index + 1;
+    }
+
+    /// One plus the largest index that has ever been acquired
+    static uint32_t size()
+    {
+      std::lock_guard<SpinLock> lock(s_lock);
+      return s_size;
+    }
+
+    /// Generation of the live or next expression with the index
+
+    /// \pre: index < size()
+    static uint32_t generation(const uint32_t index)
+    {
+      std::lock_guard<SpinLock> lock(s_lock);
+      return s_slots[index].generation;
+    }
+  };
+}
+
+#ifdef ENABLE_HASH_CONS
+namespace internal
+{
+  template<typename T>
+  class ExprTable;
+
+  template<typename T>
+  class ExprStore;
+}
+#endif
+
+class Expr
+{
+#ifdef ENABLE_HASH_CONS
+public:
+  /// Hash value
+  typedef size_t Hash;
+#endif
+
+private:
+  friend class Solver;
+  friend class SharedExpr;
+
+#ifdef ENABLE_HASH_CONS
+  template<typename T>
+  friend class internal::ExprTable;
+
+  template<typename T>
+  friend class internal::ExprStore;
+#endif
+
+#ifdef ENABLE_CONCURRENCY
+  typedef std::atomic<unsigned> RefCounter;
+#else
+  typedef unsigned RefCounter;
+#endif
+
+  const ExprKind m_expr_kind;
+
+  const Sort& m_sort;
+  const internal::ExprId m_id;
+
+#ifdef ENABLE_HASH_CONS
+  const size_t m_hash;
+#endif
+
+  // modified by SharedExpr
+  RefCounter ref_counter;
+
+  virtual Error __encode(Solver&) const = 0;
+
+  // append direct subexpressions from left to right
+  virtual void __push_args(ExprPtrs&) const {}
+
+#ifdef ENABLE_HASH_CONS
+  // Increments the reference counter unless it is zero, in which case
+  // the expression is about to be deleted by another thread
+  bool try_inc_ref() noexcept
+  {
+#ifdef ENABLE_CONCURRENCY
+    unsigned n = ref_counter.load(std::memory_order_relaxed);
+    do
+    {
+      if (n == 0)
+        return false;
+    }
+    while (!ref_counter.compare_exchange_weak(n, n + 1,
+      std::memory_order_relaxed));
+
+    return true;
+#else
+    if (ref_counter == 0)
+      return false;
+
+    ++ref_counter;
+    return true;
+#endif
+  }
+#endif
+
+protected:
+  // Allocate sort statically!
+  Expr(
+    ExprKind expr_kind,
+    const Sort& sort)
+  : m_expr_kind(expr_kind),
+    m_sort(sort),
+    m_id(internal::ExprIds::acquire()),
+#ifdef ENABLE_HASH_CONS
+    m_hash(0),
+#endif
+    ref_counter(0)
+  {
+    ++Expr::s_counter;
+  }
+
+#ifdef ENABLE_HASH_CONS
+  // Allocate sort statically!
+  Expr(
+    ExprKind expr_kind,
+    const Sort& sort,
     size_t hash)
   : m_expr_kind(expr_kind),
     m_sort(sort),
+    m_id(internal::ExprIds::acquire()),
     m_hash(hash),
     ref_counter(0)
   {
@@ -1615,7 +2594,23 @@ protected:
 #endif
 
 public:
+#ifdef ENABLE_CONCURRENCY
+  static std::atomic<unsigned> s_counter;
+#else
   static unsigned s_counter;
+#endif
+
+#ifdef ENABLE_EXPR_POOL
+  static void* operator new(size_t size)
+  {
+    return internal::ExprPool::allocate(size);
+  }
+
+  static void operator delete(void* ptr, size_t size) noexcept
+  {
+    internal::ExprPool::deallocate(ptr, size);
+  }
+#endif
 
   Expr(const Expr&) = delete;
 
@@ -1625,8 +2620,7 @@ public:
 
     assert(ref_counter == 0);
 
-    for (uintptr_t s_ptr : s_solver_ptrs)
-      reinterpret_cast<Solver*>(s_ptr)->notify_delete(this);
+    internal::ExprIds::release(m_id);
   }
 
   ExprKind expr_kind() const
@@ -1639,6 +2633,12 @@ public:
     return m_sort;
   }
 
+  /// \internal Identifier for solver-specific side tables
+  internal::ExprId id() const
+  {
+    return m_id;
+  }
+
 #ifdef ENABLE_HASH_CONS
   /// \internal Weak hash value or zero if expression is not hash-consed
 
@@ -1650,12 +2650,138 @@ public:
   }
 #endif
 
+  /// Encode expression and all its subexpressions
+
+  /// \see Solver::encode_dag(const Expr* const)
   Error encode(Solver& solver) const
   {
-    return __encode(solver);
+    return solver.encode_dag(this);
   }
 };
 
+namespace internal
+{
+  /// Solver-specific values of expressions
+
+  /// Values are stored in a vector indexed by ExprId::index. Each entry
+  /// also records the generation of the expression it belongs to, so an
+  /// entry that is left behind by a deleted expression is never mistaken
+  /// for that of a new expression with the same index. Thus, solvers
+  /// need not be notified when expressions are deleted.
+  ///
+  /// Entries of deleted expressions keep their value until a new
+  /// expression with the same index is inserted, sweep() is called or
+  /// the table is cleared. Since indexes are reused, a table has at most
+  /// ExprIds::size() entries, i.e. the largest number of expressions
+  /// that have been alive at the same time. Values that hold resources,
+  /// such as reference-counted ASTs, should still be swept from time to
+  /// time because a deleted expression's index may not be reused soon.
+  template<typename T>
+  class ExprSideTable
+  {
+  private:
+    struct Entry
+    {
+      // zero if the entry has never been inserted
+      uint32_t generation;
+      T value;
+    };
+
+    std::vector<Entry> m_entries;
+    size_t m_size;
+
+  public:
+    ExprSideTable()
+    : m_entries(),
+      m_size(0) {}
+
+    /// Number of insertions since the table has been last cleared
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    /// Value associated with expr, or nullptr if none
+    const T* find(const Expr* const expr) const
+    {
+      const ExprId id = expr->id();
+      if (id.index >= m_entries.size())
+        return nullptr;
+
+      const Entry& entry = m_entries[id.index];
+      if (entry.generation != id.generation)
+        return nullptr;
+
+      return &entry.value;
+    }
+
+    T* find(const Expr* const expr)
+    {
+      return const_cast<T*>(
+        static_cast<const ExprSideTable&>(*this).find(expr));
+    }
+
+    /// Associate value with expr
+
+    /// \pre: find(expr) == nullptr
+    /// \return value of a deleted expression whose entry is replaced,
+    ///   or T() if there is none
+    T insert(const Expr* const expr, T value)
+    {
+      const ExprId id = expr->id();
+      if (id.index >= m_entries.size())
+        m_entries.resize(id.index + 1, Entry{0, T()});
+
+      Entry& entry = m_entries[id.index];
+      assert(entry.generation != id.generation);
+
+      entry.generation = id.generation;
+      std::swap(entry.value, value);
+      ++m_size;
+      return value;
+    }
+
+    /// Call f on every value, including those of deleted expressions
+    template<typename F>
+    void for_each(F f) const
+    {
+      for (const Entry& entry : m_entries)
+        if (entry.generation != 0)
+          f(entry.value);
+    }
+
+    /// Remove the entries of deleted expressions, calling f on each value
+
+    /// Takes time linear in the number of entries.
+    ///
+    /// \return number of removed entries
+    template<typename F>
+    size_t sweep(F f)
+    {
+      size_t n = 0;
+      for (size_t index = 0; index < m_entries.size(); ++index)
+      {
+        Entry& entry = m_entries[index];
+        if (entry.generation == 0 ||
+            entry.generation == ExprIds::generation(index))
+          continue;
+
+        f(entry.value);
+        entry = Entry{0, T()};
+        ++n;
+      }
+
+      return n;
+    }
+
+    void clear()
+    {
+      m_entries.clear();
+      m_size = 0;
+    }
+  };
+}
+
 namespace internal
 {
   template<typename T>
@@ -1673,14 +2799,24 @@ private:
   void inc() const noexcept
   {
     if (m_ptr != nullptr)
+#ifdef ENABLE_CONCURRENCY
+      m_ptr->ref_counter.fetch_add(1, std::memory_order_relaxed);
+#else
       ++m_ptr->ref_counter;
+#endif
   }
 
   void dec() const noexcept
   {
     assert(m_ptr == nullptr || 0 < m_ptr->ref_counter);
 
+#ifdef ENABLE_CONCURRENCY
+    // the deleting thread must see all writes of other owners
+    if (m_ptr != nullptr &&
+        m_ptr->ref_counter.fetch_sub(1, std::memory_order_acq_rel) == 1)
+#else
     if (m_ptr != nullptr && --m_ptr->ref_counter == 0)
+#endif
       delete m_ptr;
   }
 
@@ -1701,6 +2837,16 @@ protected:
     inc();
   }
 
+  struct Adopt {};
+
+  // takes over a reference that has already been counted
+  SharedExpr(Expr* const ptr, Adopt) noexcept
+  : m_ptr(ptr)
+  {
+    assert(m_ptr != nullptr);
+    assert(0 < m_ptr->ref_counter);
+  }
+
 public:
   SharedExpr() noexcept
   : m_ptr(nullptr) {}
@@ -1817,6 +2963,9 @@ protected:
   MakeSharedExpr(Expr* const ptr) noexcept
   : SharedExpr(ptr) {}
 
+  MakeSharedExpr(Expr* const ptr, Adopt adopt) noexcept
+  : SharedExpr(ptr, adopt) {}
+
 public:
   // maintainer note: always use RVO instead of copy or move!
   MakeSharedExpr() = delete;
@@ -1827,12 +2976,89 @@ public:
 #ifdef ENABLE_HASH_CONS
 namespace internal
 {
-  /// Hash table that contains expressions of type T
-
-  /// It is safe for an expression store to have static storage duration.
+  /// Hash table of expressions of type T
+
+  /// The table uses open addressing with linear probing and Robin Hood
+  /// insertion: an entry that is closer to its home slot gives way to
+  /// one that is further away from its own. This bounds the variance of
+  /// probe lengths and lets unsuccessful lookups, the common case when
+  /// a new expression is created, stop at the first entry that is closer
+  /// to its home slot than the key would be. Each slot stores the hash
+  /// inline, so most mismatches are rejected without touching T.
+  ///
+  /// The capacity is a power of two that doubles whenever the load factor
+  /// would exceed 3/4 and is never shrunk, so that alternately creating
+  /// and deleting expressions does not cause repeated rehashing. Growing
+  /// reuses the stored hashes and never calls T's member functions.
+  ///
+  /// An ExprTable is not synchronized, see ExprStore.
   template<typename T>
-  class ExprStore
+  class ExprTable
   {
+  public:
+    /// Counters that show how well hash keys are distributed
+    struct Stats
+    {
+      /// Number of expressions in the table
+      size_t size;
+
+      /// Number of slots in the table
+      size_t capacity;
+
+      /// Number of calls to find() so far
+      uint64_t lookups;
+
+      /// Number of find() calls that returned an expression
+      uint64_t hits;
+
+      /// Number of slots inspected by all find() calls so far
+      uint64_t probes;
+
+      /// Number of times the table has doubled its capacity
+      uint64_t grows;
+
+      /// Sum of the distances of all entries from their home slot
+      uint64_t total_displacement;
+
+      /// Largest distance of an entry from its home slot
+      size_t max_displacement;
+
+      Stats& operator+=(const Stats& other)
+      {
+        size += other.size;
+        capacity += other.capacity;
+        lookups += other.lookups;
+        hits += other.hits;
+        probes += other.probes;
+        grows += other.grows;
+        total_displacement += other.total_displacement;
+        if (max_displacement < other.max_displacement)
+          max_displacement = other.max_displacement;
+
+        return *this;
+      }
+
+      double load_factor() const
+      {
+        return capacity == 0 ? 0.0 :
+          static_cast<double>(size) / capacity;
+      }
+
+      /// Mean number of slots inspected by a lookup
+      double average_probe_length() const
+      {
+        return lookups == 0 ? 0.0 :
+          static_cast<double>(probes) / lookups;
+      }
+
+      /// Mean distance of an entry from its home slot
+      double average_displacement() const
+      {
+        return size == 0 ? 0.0 :
+          static_cast<double>(total_displacement) / size;
+      }
+    };
+
   private:
     // maintainer note: it is tempting to use std::unordered_set.
     // For one, we would not be able to store T objects in sets
@@ -1841,54 +3067,315 @@ namespace internal
     // More importantly, sets are ill-suited here because we cannot
     // erase an element from the set as the element is being destructed
     // since this would require calling its is_equal() function on
-    // an object that is undergoing destruction.
-    typedef std::unordered_multimap<Expr::Hash, T* const> Multimap;
-    Multimap m_multimap;
+    // an object that is undergoing destruction. This is why erase()
+    // locates entries by their address instead.
+    struct Entry
+    {
+      Expr::Hash hash;
+
+      // nullptr if and only if slot is empty
+      T* ptr;
+    };
+
+    static constexpr size_t s_initial_capacity = 16;
+
+    std::vector<Entry> m_entries;
+    size_t m_mask;
+    unsigned m_shift;
+    size_t m_size;
+
+    // mutable because lookups are logically const
+    mutable uint64_t m_lookups;
+    mutable uint64_t m_hits;
+    mutable uint64_t m_probes;
+    uint64_t m_grows;
+
+    // Fibonacci hashing lets all bits of a hash_combine() result
+    // contribute to the slot index, whereas masking would only use
+    // its low-order bits
+    size_t home(const Expr::Hash hash) const
+    {
+      return static_cast<size_t>(
+        (hash * static_cast<Expr::Hash>(11400714819323198485ULL)) >> m_shift);
+    }
+
+    size_t displacement(const size_t i, const Expr::Hash hash) const
+    {
+      return (i - home(hash)) & m_mask;
+    }
+
+    void insert(Entry entry)
+    {
+      size_t i = home(entry.hash);
+      for (size_t dist = 0;; ++dist, i = (i + 1) & m_mask)
+      {
+        Entry& slot = m_entries[i];
+        if (slot.ptr == nullptr)
+        {
+          slot = entry;
+          return;
+        }
+
+        // take from the rich, give to the poor
+        const size_t slot_dist = displacement(i, slot.hash);
+        if (slot_dist < dist)
+        {
+          std::swap(slot, entry);
+          dist = slot_dist;
+        }
+      }
+    }
+
+    void grow()
+    {
+      const size_t capacity = m_entries.empty() ?
+        s_initial_capacity : 2 * m_entries.size();
+
+      std::vector<Entry> entries(capacity, Entry{0, nullptr});
+      entries.swap(m_entries);
+      m_mask = capacity - 1;
+      m_shift = sizeof(Expr::Hash) * 8;
+      for (size_t c = capacity; c != 1; c >>= 1)
+        --m_shift;
+
+      for (const Entry& entry : entries)
+        if (entry.ptr != nullptr)
+          insert(entry);
+
+      ++m_grows;
+    }
+
+  public:
+    ExprTable()
+    : m_entries(),
+      m_mask(0),
+      m_shift(0),
+      m_size(0),
+      m_lookups(0),
+      m_hits(0),
+      m_probes(0),
+      m_grows(0) {}
+
+    ExprTable(const ExprTable&) = delete;
+
+    // maintainer note: it is this destructor that makes
+    // static storage duration of expression stores safe
+    ~ExprTable()
+    {
+      for (const Entry& entry : m_entries)
+        if (entry.ptr != nullptr)
+          entry.ptr->release_from_store();
+
+      m_entries.clear();
+      m_size = 0;
+    }
+
+    size_t size() const
+    {
+      return m_size;
+    }
+
+    /// Return the expression that has the given hash and is equal
+    /// to an expression constructed from args, or nullptr if none
+
+    /// The returned expression's reference counter has been incremented.
+    /// Expressions whose reference counter is zero are being deleted and
+    /// therefore skipped.
+    template<class... Args>
+    T* find(const Expr::Hash hash, const Args&... args) const
+    {
+      ++m_lookups;
+      if (m_size == 0)
+        return nullptr;
+
+      size_t i = home(hash);
+      for (size_t dist = 0;; ++dist, i = (i + 1) & m_mask)
+      {
+        ++m_probes;
+        const Entry& slot = m_entries[i];
+        if (slot.ptr == nullptr)
+          return nullptr;
+
+        if (slot.hash == hash && slot.ptr->is_equal(args...) &&
+            slot.ptr->try_inc_ref())
+        {
+          ++m_hits;
+          return slot.ptr;
+        }
+
+        // any equal expression would have displaced this slot
+        if (displacement(i, slot.hash) < dist)
+          return nullptr;
+      }
+    }
+
+    /// \pre: ptr->hash() == hash
+    void insert(const Expr::Hash hash, T* const ptr)
+    {
+      if (4 * (m_size + 1) > 3 * m_entries.size())
+        grow();
+
+      insert(Entry{hash, ptr});
+      ++m_size;
+    }
+
+    /// Remove expression from store without calling any of its
+    /// member functions except Expr::hash()
+
+    /// \pre: ptr has been inserted and not yet been erased
+    void erase(const T* const ptr)
+    {
+      assert(0 < m_size);
+
+      size_t i = home(ptr->hash());
+      while (m_entries[i].ptr != ptr)
+      {
+        assert(m_entries[i].ptr != nullptr && "Failed to delete expression");
+        i = (i + 1) & m_mask;
+      }
+
+      // backward shift deletion avoids tombstones
+      for (size_t j = (i + 1) & m_mask;
+           m_entries[j].ptr != nullptr && displacement(j, m_entries[j].hash) != 0;
+           i = j, j = (j + 1) & m_mask)
+        m_entries[i] = m_entries[j];
+
+      m_entries[i] = Entry{0, nullptr};
+      --m_size;
+    }
+
+    Stats stats() const
+    {
+      Stats stats = {0};
+      stats.size = m_size;
+      stats.capacity = m_entries.size();
+      stats.lookups = m_lookups;
+      stats.hits = m_hits;
+      stats.probes = m_probes;
+      stats.grows = m_grows;
+
+      for (size_t i = 0; i < m_entries.size(); ++i)
+      {
+        if (m_entries[i].ptr == nullptr)
+          continue;
+
+        const size_t dist = displacement(i, m_entries[i].hash);
+        stats.total_displacement += dist;
+        if (stats.max_displacement < dist)
+          stats.max_displacement = dist;
+      }
+
+      return stats;
+    }
+  };
+
+  template<typename T>
+  constexpr size_t ExprTable<T>::s_initial_capacity;
 
+  /// Set of all expressions of type T
+
+  /// Expressions are partitioned into shards according to their hash,
+  /// each an ExprTable protected by its own mutex. Thus, threads that
+  /// create or delete expressions of the same type rarely contend for
+  /// the same lock.
+  ///
+  /// It is safe for an expression store to have static storage duration.
+  template<typename T>
+  class ExprStore
+  {
   public:
-    typedef typename Multimap::iterator Iterator;
-    typedef typename Multimap::const_iterator ConstIterator;
+    typedef typename ExprTable<T>::Stats Stats;
 
-    ExprStore()
-    : m_multimap() {}
+#ifdef ENABLE_CONCURRENCY
+    static constexpr size_t s_shards = 16;
+#else
+    static constexpr size_t s_shards = 1;
+#endif
 
-    // maintainer note: it is this destructor that makes
-    // static storage duration of expression stores safe
-    ~ExprStore()
+  private:
+    struct Shard
     {
-      for (typename Multimap::value_type& pair : m_multimap)
-        pair.second->release_from_store();
+      mutable ExprMutex mutex;
+      ExprTable<T> table;
+    };
 
-      m_multimap.clear();
+    std::array<Shard, s_shards> m_shards;
+
+    // uses a different multiplier than ExprTable so that the shard
+    // of an expression is independent of its slot within the shard
+    Shard& shard(const Expr::Hash hash)
+    {
+      return m_shards[((hash * static_cast<Expr::Hash>(0xff51afd7ed558ccdULL))
+        >> (sizeof(Expr::Hash) * 4)) % s_shards];
     }
 
-    /// Return all expressions that have the given hash key
-    ConstIterator find(const Expr::Hash hash) const
+    ExprStore()
+    : m_shards() {}
+
+  public:
+    ExprStore(const ExprStore&) = delete;
+
+    /// Unique expression store for all expressions of type T
+    static ExprStore& instance()
     {
-      return m_multimap.find(hash);
+      static ExprStore s_expr_store;
+      return s_expr_store;
     }
 
-    ConstIterator cend() const
+    size_t size() const
     {
-      return m_multimap.cend();
+      size_t size = 0;
+      for (const Shard& shard : m_shards)
+      {
+        std::lock_guard<ExprMutex> lock(shard.mutex);
+        size += shard.table.size();
+      }
+      return size;
     }
 
-    /// Add expression T to store
+    /// Return the expression that is equal to one constructed from
+    /// args, creating it if necessary; reference counter is incremented
 
     /// The newly added T expression removes itself from this
     /// expression store when T's destructor is called.
     template<class... Args>
-    Iterator emplace(const Expr::Hash hash, Args&&... args)
+    T* acquire(const Expr::Hash hash, Args&&... args)
+    {
+      Shard& s = shard(hash);
+      std::lock_guard<ExprMutex> lock(s.mutex);
+
+      T* ptr = s.table.find(hash, args...);
+      if (ptr != nullptr)
+        return ptr;
+
+      ptr = new T(this, hash, std::forward<Args>(args)...);
+      static_cast<Expr*>(ptr)->ref_counter = 1;
+      s.table.insert(hash, ptr);
+      return ptr;
+    }
+
+    void erase(const T* const ptr)
     {
-      return m_multimap.emplace(hash,
-        new T(this, hash, std::forward<Args>(args)...));
+      Shard& s = shard(ptr->hash());
+      std::lock_guard<ExprMutex> lock(s.mutex);
+      s.table.erase(ptr);
     }
 
-    void erase(const ConstIterator citer)
+    /// Statistics summed over all shards
+    Stats stats() const
     {
-      m_multimap.erase(citer);
+      Stats stats = {0};
+      for (const Shard& shard : m_shards)
+      {
+        std::lock_guard<ExprMutex> lock(shard.mutex);
+        stats += shard.table.stats();
+      }
+      return stats;
     }
   };
+
+  template<typename T>
+  constexpr size_t ExprStore<T>::s_shards;
 }
 
 /// Hash consing
@@ -1896,29 +3383,11 @@ template<typename T, class... Args>
 MakeSharedExpr make_shared_expr(Args&&... args)
 {
   // unique hash table for expressions of type T
-  static internal::ExprStore<T> s_expr_multimap;
+  internal::ExprStore<T>& expr_store = internal::ExprStore<T>::instance();
 
   const Expr::Hash hash = T::hash_args(args...);
-  {
-    typename internal::ExprStore<T>::ConstIterator citer =
-      s_expr_multimap.find(hash);
-
-    for (const typename internal::ExprStore<T>::ConstIterator
-         cend = s_expr_multimap.cend();
-
-         citer != cend;
-         ++citer)
-    {
-      T* const expr_ptr = citer->second;
-      if (expr_ptr->is_equal(args...))
-        return {expr_ptr};
-    }
-  }
-
-  typename internal::ExprStore<T>::Iterator iter =
-    s_expr_multimap.emplace(hash, std::forward<Args>(args)...);
-
-  return {iter->second};
+  return {expr_store.acquire(hash, std::forward<Args>(args)...),
+    MakeSharedExpr::Adopt()};
 }
 
 #else
@@ -2118,7 +3587,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.conjunctions++;
       return solver->__encode_binary_land(expr, larg, rarg);
     }
   };
@@ -2140,7 +3608,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.disjunctions++;
       return solver->__encode_binary_lor(expr, larg, rarg);
     }
   };
@@ -2162,7 +3629,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.implications++;
       return solver->__encode_binary_imp(expr, larg, rarg);
     }
   };
@@ -2184,7 +3650,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.equalities++;
       return solver->__encode_binary_eql(expr, larg, rarg);
     }
   };
@@ -2290,7 +3755,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.inequalities++;
       return solver->__encode_binary_lss(expr, larg, rarg);
     }
   };
@@ -2312,7 +3776,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.inequalities++;
       return solver->__encode_binary_gtr(expr, larg, rarg);
     }
   };
@@ -2334,7 +3797,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.disequalities++;
       return solver->__encode_binary_neq(expr, larg, rarg);
     }
   };
@@ -2356,7 +3818,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.inequalities++;
       return solver->__encode_binary_leq(expr, larg, rarg);
     }
   };
@@ -2378,7 +3839,6 @@ namespace internal
       const SharedExpr& larg,
       const SharedExpr& rarg)
     {
-      solver->m_stats.inequalities++;
       return solver->__encode_binary_geq(expr, larg, rarg);
     }
   };
@@ -2393,7 +3853,7 @@ Error Solver::encode_unary(
 
   assert(!arg.is_null());
 
-  m_stats.unary_ops++;
+  count_unary(opcode);
   return internal::EncodeDispatch<opcode>::encode_unary(this, expr, arg);
 }
 
@@ -2409,11 +3869,72 @@ Error Solver::encode_binary(
   assert(!rarg.is_null());
   assert(larg.sort() == rarg.sort());
 
-  m_stats.binary_ops++;
+  count_binary(opcode);
   return internal::EncodeDispatch<opcode>::encode_binary(
     this, expr, larg, rarg);
 }
 
+inline void Solver::count_unary(Opcode opcode)
+{
+  m_stats.unary_ops++;
+  m_stats.unary_opcodes[opcode]++;
+}
+
+inline void Solver::count_binary(Opcode opcode)
+{
+  m_stats.binary_ops++;
+  m_stats.binary_opcodes[opcode]++;
+  switch (opcode)
+  {
+  case LAND:
+    m_stats.conjunctions++;
+    break;
+  case LOR:
+    m_stats.disjunctions++;
+    break;
+  case IMP:
+    m_stats.implications++;
+    break;
+  case EQL:
+    m_stats.equalities++;
+    break;
+  case NEQ:
+    m_stats.disequalities++;
+    break;
+  case LSS:
+  case GTR:
+  case LEQ:
+  case GEQ:
+    m_stats.inequalities++;
+    break;
+  default:
+    break;
+  }
+}
+
+inline void Solver::count_nary(Opcode opcode, size_t size)
+{
+  m_stats.nary_ops++;
+  m_stats.nary_opcodes[opcode]++;
+  switch (opcode)
+  {
+  case EQL:
+    m_stats.equalities += size;
+    break;
+  case NEQ:
+    m_stats.disequalities += size;
+    break;
+  case LAND:
+    m_stats.conjunctions += size;
+    break;
+  case LOR:
+    m_stats.disjunctions += size;
+    break;
+  default:
+    break;
+  }
+}
+
 namespace internal
 {
   /// Shared and well-sorted SMT expression
@@ -2748,26 +4269,7 @@ namespace internal
       if (m_expr_store_ptr == nullptr)
         return;
 
-      ExprStore<T>& expr_store = *m_expr_store_ptr;
-      typename internal::ExprStore<T>::ConstIterator citer =
-        expr_store.find(derived->hash());
-
-      for (const typename internal::ExprStore<T>::ConstIterator
-           cend = expr_store.cend();
-
-           citer != cend;
-           ++citer)
-      {
-        T* const expr_ptr = citer->second;
-        if (derived->is_equal(*expr_ptr))
-        {
-          expr_store.erase(citer);
-          goto OK;
-        }
-      }
-
-      assert(false && "Failed to delete expression");
-    OK: ;
+      m_expr_store_ptr->erase(derived);
     }
 
   public:
@@ -2913,6 +4415,11 @@ private:
     return solver.encode_bv_zero_extend(this, m_bv, m_ext);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_bv.ref());
+  }
+
   void check_obj() const
   {
     assert(Expr::sort().is_bv());
@@ -2933,7 +4440,7 @@ public:
     const SharedExpr& bv,
     unsigned ext)
   {
-    size_t h = hash_combine(sort.hash(), bv.hash());
+    size_t h = hash_combine(bv.hash(), sort.hash());
     h = hash_combine(ext * 402653189, h);
     return h;
   }
@@ -2998,6 +4505,11 @@ private:
     return solver.encode_bv_sign_extend(this, m_bv, m_ext);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_bv.ref());
+  }
+
   void check_obj() const
   {
     assert(Expr::sort().is_bv());
@@ -3018,7 +4530,7 @@ public:
     const SharedExpr& bv,
     unsigned ext)
   {
-    size_t h = hash_combine(sort.hash(), bv.hash());
+    size_t h = hash_combine(bv.hash(), sort.hash());
     h = hash_combine(ext * 402653189, h);
     return h;
   }
@@ -3084,6 +4596,11 @@ private:
     return solver.encode_bv_extract(this, m_bv, m_high, m_low);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_bv.ref());
+  }
+
   void check_obj() const
   {
     assert(m_high > m_low);
@@ -3102,7 +4619,7 @@ public:
     unsigned high,
     unsigned low)
   {
-    size_t h = hash_combine(sort.hash(), bv.hash());
+    size_t h = hash_combine(bv.hash(), sort.hash());
     h = hash_combine(high * 402653189, h);
     h = hash_combine(low * 402653189, h);
     return h;
@@ -3278,6 +4795,12 @@ private:
     return solver.encode_func_app(this, m_func_decl, arity, m_args.data());
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    for (const SharedExpr& arg : m_args)
+      args.push_back(&arg.ref());
+  }
+
 public:
 #ifdef ENABLE_HASH_CONS
   typedef internal::ExprDeleter<FuncAppExpr<arity>> Deleter;
@@ -3516,6 +5039,11 @@ private:
     return solver.encode_unary<opcode>(this, m_operand);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_operand.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_operand.is_null());
@@ -3529,7 +5057,8 @@ public:
     const Sort& sort,
     const SharedExpr& operand)
   {
-    return hash_combine(sort.hash(), operand.hash());
+    // the operand is mixed so that (-(-x)) and x differ in their hash
+    return hash_combine(operand.hash(), sort.hash());
   }
 
   /// \internal
@@ -3619,6 +5148,12 @@ private:
     return solver.encode_binary<opcode>(this, m_loperand, m_roperand);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_loperand.ref());
+    args.push_back(&m_roperand.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_loperand.is_null());
@@ -3739,18 +5274,23 @@ private:
     return solver.encode_nary(this, opcode, m_operands);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    for (const SharedExpr& operand : m_operands)
+      args.push_back(&operand.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_operands.empty());
   }
 
-protected:
+public:
   const SharedExprs& operands() const
   {
     return m_operands;
   }
 
-public:
 #ifdef ENABLE_HASH_CONS
   typedef internal::ExprDeleter<NaryExpr<opcode>> Deleter;
 
@@ -3875,6 +5415,11 @@ private:
     return solver.encode_const_array(this, m_init);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_init.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_init.is_null());
@@ -3950,6 +5495,12 @@ private:
     return solver.encode_array_select(this, m_array, m_index);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_array.ref());
+    args.push_back(&m_index.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_array.is_null());
@@ -4036,6 +5587,13 @@ private:
     return solver.encode_array_store(this, m_array, m_index, m_value);
   }
 
+  virtual void __push_args(ExprPtrs& args) const override
+  {
+    args.push_back(&m_array.ref());
+    args.push_back(&m_index.ref());
+    args.push_back(&m_value.ref());
+  }
+
   void check_obj() const
   {
     assert(!m_array.is_null());
@@ -4140,6 +5698,36 @@ SharedExpr store(
   const SharedExpr& index,
   const SharedExpr& value);
 
+namespace internal
+{
+  /// Expressions whose operator is only known at runtime, e.g. when parsing
+
+  /// \returns null if opcode is not supported by expressions of that kind
+  SharedExpr make_unary(
+    Opcode opcode,
+    const Sort& sort,
+    const SharedExpr& arg);
+
+  SharedExpr make_binary(
+    Opcode opcode,
+    const Sort& sort,
+    const SharedExpr& larg,
+    const SharedExpr& rarg);
+
+  SharedExpr make_nary(
+    Opcode opcode,
+    const Sort& sort,
+    SharedExprs&& args);
+
+  /// Function application whose arity is only known at runtime
+
+  /// \returns null unless 0 < arity <= 8
+  SharedExpr make_func_app(
+    const UnsafeDecl& func_decl,
+    const SharedExpr* const args,
+    const size_t arity);
+}
+
 template<typename Domain, typename Range>
 Array<Domain, Range> store(
   const Array<Domain, Range>& array,
@@ -4175,6 +5763,310 @@ struct Identity<LAND, Bool>
   static Bool term;
 };
 
+template<>
+struct Identity<LOR, Bool>
+{
+  static Bool term;
+};
+
+/// Memoized rewriting of expressions before they are added to a Solver
+
+/// The rewrite rules are constant folding of Boolean, bit vector and
+/// (within the range of long long) integer operations, identity and
+/// absorbing elements of logical connectives (see Identity) and of
+/// arithmetic and bitwise operators, flattening of nested conjunctions
+/// and disjunctions, double negation removal, and relations between
+/// syntactically equal terms.
+///
+/// Simplifier is a Solver so that it can reuse encode_dag(): each
+/// subexpression is rewritten at most once after its arguments, and the
+/// result is kept in a side table until clear() is called, or sweep()
+/// once the subexpression has been deleted. Rewritten
+/// subexpressions are shared unless ENABLE_HASH_CONS is undefined.
+///
+/// Arguments of function applications are not rewritten because an
+/// application cannot be rebuilt without knowing its arity statically.
+///
+/// \see Solver::set_simplifier(Simplifier*)
+class Simplifier : private Solver
+{
+public:
+  /// Number of times each rewrite rule has been applied
+  struct Stats
+  {
+    unsigned constant_folds;
+    unsigned identities;
+    unsigned absorptions;
+    unsigned flattenings;
+    unsigned double_negations;
+    unsigned trivial_relations;
+  };
+
+private:
+  struct Rewrite
+  {
+    /// nullptr if the expression is rewritten to itself
+    SharedExpr expr;
+
+    /// is the rewritten expression a literal whose value is known?
+    bool is_value;
+
+    /// \see to_value(const Sort&, const T, uint64_t&)
+    uint64_t value;
+  };
+
+  typedef internal::ExprSideTable<Rewrite> RewriteTable;
+
+  RewriteTable m_rewrite_table;
+  Stats m_rule_stats;
+
+  /// Canonical value of a literal, if its sort supports constant folding
+
+  /// Bool values are zero or one, bit vector values are truncated to
+  /// the bit width of the sort, and integer values are in two's
+  /// complement. Bit vectors wider than 64 bits are not supported.
+  template<typename T>
+  static bool to_value(const Sort& sort, const T literal, uint64_t& value)
+  {
+    if (sort.is_bool())
+    {
+      value = literal ? 1 : 0;
+      return true;
+    }
+
+    if (sort.is_bv() && sort.bv_size() <= 64)
+    {
+      value = truncate(sort, static_cast<uint64_t>(literal));
+      return true;
+    }
+
+    if (sort.is_int())
+    {
+      if (std::is_unsigned<T>::value && static_cast<uint64_t>(literal) >
+          static_cast<uint64_t>(std::numeric_limits<long long>::max()))
+        return false;
+
+      value = static_cast<uint64_t>(static_cast<long long>(literal));
+      return true;
+    }
+
+    return false;
+  }
+
+  static uint64_t truncate(const Sort& sort, const uint64_t value);
+  static long long to_signed(const Sort& sort, const uint64_t value);
+  static SharedExpr make_literal(const Sort& sort, const uint64_t value);
+
+  static bool fold_unary(
+    Opcode opcode,
+    const Sort& sort,
+    const uint64_t arg,
+    uint64_t& value);
+
+  static bool fold_binary(
+    Opcode opcode,
+    const Sort& sort,
+    const uint64_t larg,
+    const uint64_t rarg,
+    uint64_t& value);
+
+  /// Rewrite of an argument that has already been rewritten
+  Rewrite rewrite(const SharedExpr& arg) const;
+
+  Error unchanged(const Expr* const expr);
+  Error replace(const Expr* const expr, const Rewrite& rewrite);
+  Error replace(const Expr* const expr, SharedExpr&& rewrite);
+  Error fold(const Expr* const expr, const uint64_t value);
+
+  template<Opcode opcode>
+  Error rewrite_unary(
+    const Expr* const expr,
+    const SharedExpr& arg);
+
+  template<Opcode opcode>
+  Error rewrite_binary(
+    const Expr* const expr,
+    const SharedExpr& larg,
+    const SharedExpr& rarg);
+
+  template<Opcode opcode>
+  Error rewrite_nary(
+    const Expr* const expr,
+    const SharedExprs& args);
+
+  /// \pre: opcode is LAND or LOR
+  template<Opcode opcode>
+  Error rewrite_connective(
+    const Expr* const expr,
+    const SharedExprs& args);
+
+  template<typename T>
+  Error rewrite_literal(const Expr* const expr, const T literal)
+  {
+    Rewrite rewrite{SharedExpr(), false, 0};
+    rewrite.is_value = to_value(expr->sort(), literal, rewrite.value);
+    m_rewrite_table.insert(expr, std::move(rewrite));
+    return OK;
+  }
+
+#define SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(type)                             \
+  virtual Error __encode_literal(                                              \
+    const Expr* const expr,                                                    \
+    type literal) override                                                     \
+  {                                                                            \
+    return rewrite_literal(expr, literal);                                     \
+  }                                                                            \
+
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(bool)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(char)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(short)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(int)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(long)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(long long)
+SMT_SIMPLIFIER_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+  virtual Error __encode_constant(
+    const Expr* const expr,
+    const UnsafeDecl& decl) override;
+
+  virtual Error __encode_func_app(
+    const Expr* const expr,
+    const UnsafeDecl& func_decl,
+    const size_t arity,
+    const SharedExpr* const args) override;
+
+  virtual Error __encode_const_array(
+    const Expr* const expr,
+    const SharedExpr& init) override;
+
+  virtual Error __encode_array_select(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index) override;
+
+  virtual Error __encode_array_store(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index,
+    const SharedExpr& value) override;
+
+#define SMT_SIMPLIFIER_ENCODE_UNARY(name)                                      \
+  virtual Error __encode_unary_##name(                                         \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg) override;                                           \
+
+#define SMT_SIMPLIFIER_ENCODE_BINARY(name)                                     \
+  virtual Error __encode_binary_##name(                                        \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg) override;                                          \
+
+SMT_SIMPLIFIER_ENCODE_UNARY(lnot)
+SMT_SIMPLIFIER_ENCODE_UNARY(not)
+SMT_SIMPLIFIER_ENCODE_UNARY(sub)
+
+SMT_SIMPLIFIER_ENCODE_BINARY(sub)
+SMT_SIMPLIFIER_ENCODE_BINARY(and)
+SMT_SIMPLIFIER_ENCODE_BINARY(or)
+SMT_SIMPLIFIER_ENCODE_BINARY(xor)
+SMT_SIMPLIFIER_ENCODE_BINARY(lshl)
+SMT_SIMPLIFIER_ENCODE_BINARY(lshr)
+SMT_SIMPLIFIER_ENCODE_BINARY(land)
+SMT_SIMPLIFIER_ENCODE_BINARY(lor)
+SMT_SIMPLIFIER_ENCODE_BINARY(imp)
+SMT_SIMPLIFIER_ENCODE_BINARY(eql)
+SMT_SIMPLIFIER_ENCODE_BINARY(add)
+SMT_SIMPLIFIER_ENCODE_BINARY(mul)
+SMT_SIMPLIFIER_ENCODE_BINARY(quo)
+SMT_SIMPLIFIER_ENCODE_BINARY(rem)
+SMT_SIMPLIFIER_ENCODE_BINARY(lss)
+SMT_SIMPLIFIER_ENCODE_BINARY(gtr)
+SMT_SIMPLIFIER_ENCODE_BINARY(neq)
+SMT_SIMPLIFIER_ENCODE_BINARY(leq)
+SMT_SIMPLIFIER_ENCODE_BINARY(geq)
+
+  virtual Error __encode_nary(
+    const Expr* const expr,
+    Opcode opcode,
+    const SharedExprs& args) override;
+
+  virtual Error __encode_bv_zero_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_sign_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_extract(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned high,
+    const unsigned low) override;
+
+  virtual bool __is_encoded(const Expr* const expr) const override
+  {
+    return m_rewrite_table.find(expr) != nullptr;
+  }
+
+  // a simplifier cannot decide formulas
+  virtual void __reset() override {}
+  virtual void __push() override {}
+  virtual void __pop() override {}
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+public:
+  Simplifier();
+
+  /// Logically equivalent expression that is not larger than expr
+  SharedExpr simplify(const SharedExpr& expr);
+
+  Bool simplify(const Bool& expr)
+  {
+    return static_cast<Bool>(simplify(static_cast<SharedExpr>(expr)));
+  }
+
+  const Stats& stats() const
+  {
+    return m_rule_stats;
+  }
+
+  /// Forget all rewritten expressions, but keep the statistics
+  void clear()
+  {
+    m_rewrite_table.clear();
+  }
+
+  /// Forget the rewrites of deleted expressions
+
+  /// Rewrites hold references to the rewritten expressions, which are
+  /// otherwise kept alive until the index of the deleted expression is
+  /// reused.
+  ///
+  /// \return number of forgotten rewrites
+  size_t sweep()
+  {
+    return m_rewrite_table.sweep([](const Rewrite&) {});
+  }
+};
+
 }
 
 #define SMT_BUILTIN_UNARY_OP(op, opcode)                                       \
@@ -0,0 +1,332 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_BDD_H_
+#define __SMT_BDD_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "smt.h"
+#include "bdd.h"
+
+namespace smt
+{
+
+/// Propositional solver for the Boolean skeleton of formulas
+
+/// Every assertion is encoded as a BDD whose variables are the Boolean
+/// constants and, as in DeduceSolver, an abstraction of every other
+/// Boolean atom, e.g. `x < 3` for an integer `x`. The conjunction of
+/// assertions is kept as a BDD per push() level, so check() is a
+/// constant-time terminal test and pop() simply drops a BDD handle.
+///
+/// Bit vector constants with at most max_exact_width() bits can be
+/// encoded exactly with one BDD variable per bit. Then atoms over them
+/// that are built from bitwise operators, addition, subtraction,
+/// multiplication, casts and comparisons are not abstracted.
+///
+/// The result of check() is unsat if the Boolean skeleton is
+/// unsatisfiable. It is sat only if no abstracted atom occurs in the
+/// assertions; otherwise, it is unknown.
+class BddSolver : public Solver
+{
+public:
+  /// Variable and its truth value
+  typedef std::pair<unsigned, bool> CubeLiteral;
+
+  /// Conjunction of literals in ascending order of their variables
+  typedef std::vector<CubeLiteral> Cube;
+
+private:
+  /// Bits of an expression, least significant bit first, or a single
+  /// BDD for a Boolean expression; no bits if the expression is opaque,
+  /// i.e. it is not Boolean and cannot be encoded exactly
+  typedef std::vector<bdd::BDD> Bits;
+
+  struct Level
+  {
+    // conjunction of the assertions up to and including this level
+    bdd::BDD conjunction;
+
+    // has no assertion up to and including this level been abstracted?
+    bool is_exact;
+  };
+
+  // must outlive every BDD object of the other members
+  std::unique_ptr<bdd::BDDManager> m_manager;
+
+  unsigned m_max_exact_width;
+
+  // whether a BDD variable is an abstracted atom
+  std::vector<bool> m_is_atom;
+
+  // first BDD variable of the constant or atom of each BDD variable;
+  // the bits of a bit vector constant are consecutive variables
+  std::vector<unsigned> m_first_vars;
+
+  // bits of constants keyed by their symbol
+  std::unordered_map<std::string, Bits> m_constant_table;
+
+  typedef internal::ExprSideTable<Bits> BitsTable;
+  BitsTable m_bits_table;
+
+  // result of the last encoded expression
+  Bits m_bits;
+
+  // the bottom level is never popped
+  std::vector<Level> m_levels;
+
+  void init_manager();
+
+  bdd::BDD new_var(const std::string& label, bool is_atom);
+
+  // circuits on bit vectors of equal width
+  Bits mk_not(const Bits& a);
+  Bits mk_and(const Bits& a, const Bits& b);
+  Bits mk_or(const Bits& a, const Bits& b);
+  Bits mk_xor(const Bits& a, const Bits& b);
+  Bits mk_add(const Bits& a, const Bits& b, bdd::BDD carry);
+  Bits mk_neg(const Bits& a);
+  Bits mk_mul(const Bits& a, const Bits& b);
+  bdd::BDD mk_eq(const Bits& a, const Bits& b);
+  bdd::BDD mk_lt(const Bits& a, const Bits& b, bool is_signed);
+
+  // \return has m_bits been set to the cached bits of expr?
+  bool find_bits(const Expr* const expr);
+
+  // \pre: not find_bits(expr)
+  void cache_bits(const Expr* const expr);
+
+  // Fresh variable for a Boolean expression that cannot be encoded
+  // exactly; m_bits is set to the variable.
+  //
+  // \pre: expr->sort().is_bool()
+  Error abstract_atom(const Expr* const expr);
+
+  // Abstracts a Boolean expr, otherwise marks expr as opaque;
+  // opaque subexpressions make their enclosing atoms abstract
+  Error encode_opaque(const Expr* const expr);
+
+  bool has_atom(const bdd::BDD& f) const;
+
+  template<class F>
+  Error encode_unary(
+    const Expr* const expr,
+    const SharedExpr& arg,
+    F f);
+
+  template<class F>
+  Error encode_binary(
+    const Expr* const expr,
+    const SharedExpr& larg,
+    const SharedExpr& rarg,
+    F f);
+
+  // like encode_binary() but abstracts expr if an argument is opaque
+  template<class F>
+  Error encode_relation(
+    const Expr* const expr,
+    const SharedExpr& larg,
+    const SharedExpr& rarg,
+    F f);
+
+  Error encode_bits_literal(
+    const Expr* const expr,
+    unsigned long long literal);
+
+#define SMT_BDD_ENCODE_BUILTIN_LITERAL(type)                                   \
+  virtual Error __encode_literal(                                              \
+    const Expr* const expr,                                                    \
+    type literal) override                                                     \
+  {                                                                            \
+    return encode_bits_literal(expr,                                           \
+      static_cast<unsigned long long>(literal));                               \
+  }                                                                            \
+
+SMT_BDD_ENCODE_BUILTIN_LITERAL(bool)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(char)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(short)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(int)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(long)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(long long)
+SMT_BDD_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+  virtual Error __encode_constant(
+    const Expr* const expr,
+    const UnsafeDecl& decl) override;
+
+  virtual Error __encode_func_app(
+    const Expr* const expr,
+    const UnsafeDecl& func_decl,
+    const size_t arity,
+    const SharedExpr* const args) override;
+
+  virtual Error __encode_const_array(
+    const Expr* const expr,
+    const SharedExpr& init) override
+  {
+    if (find_bits(expr))
+      return OK;
+
+    return encode_opaque(expr);
+  }
+
+  virtual Error __encode_array_select(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index) override;
+
+  virtual Error __encode_array_store(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index,
+    const SharedExpr& value) override
+  {
+    if (find_bits(expr))
+      return OK;
+
+    return encode_opaque(expr);
+  }
+
+#define SMT_BDD_ENCODE_UNARY(name)                                             \
+  virtual Error __encode_unary_##name(                                         \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg) override;                                           \
+
+#define SMT_BDD_ENCODE_BINARY(name)                                            \
+  virtual Error __encode_binary_##name(                                        \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg) override;                                          \
+
+SMT_BDD_ENCODE_UNARY(lnot)
+SMT_BDD_ENCODE_UNARY(not)
+SMT_BDD_ENCODE_UNARY(sub)
+
+SMT_BDD_ENCODE_BINARY(sub)
+SMT_BDD_ENCODE_BINARY(and)
+SMT_BDD_ENCODE_BINARY(or)
+SMT_BDD_ENCODE_BINARY(xor)
+SMT_BDD_ENCODE_BINARY(lshl)
+SMT_BDD_ENCODE_BINARY(lshr)
+SMT_BDD_ENCODE_BINARY(land)
+SMT_BDD_ENCODE_BINARY(lor)
+SMT_BDD_ENCODE_BINARY(imp)
+SMT_BDD_ENCODE_BINARY(eql)
+SMT_BDD_ENCODE_BINARY(add)
+SMT_BDD_ENCODE_BINARY(mul)
+SMT_BDD_ENCODE_BINARY(quo)
+SMT_BDD_ENCODE_BINARY(rem)
+SMT_BDD_ENCODE_BINARY(lss)
+SMT_BDD_ENCODE_BINARY(gtr)
+SMT_BDD_ENCODE_BINARY(neq)
+SMT_BDD_ENCODE_BINARY(leq)
+SMT_BDD_ENCODE_BINARY(geq)
+
+  virtual Error __encode_nary(
+    const Expr* const expr,
+    Opcode opcode,
+    const SharedExprs& args) override;
+
+  virtual Error __encode_bv_zero_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_sign_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_extract(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned high,
+    const unsigned low) override;
+
+  virtual bool __is_encoded(const Expr* const expr) const override
+  {
+    return m_bits_table.find(expr) != nullptr;
+  }
+
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+public:
+  BddSolver();
+  BddSolver(Logic logic);
+
+  BddSolver(const BddSolver&) = delete;
+
+  /// Bit vector constants with more bits are abstracted
+  unsigned max_exact_width() const
+  {
+    return m_max_exact_width;
+  }
+
+  /// Encode bit vector constants of at most width bits exactly
+
+  /// The default is zero, i.e. every atom over bit vectors is
+  /// abstracted. Only expressions encoded after the call are affected.
+  void set_max_exact_width(unsigned width)
+  {
+    m_max_exact_width = width;
+  }
+
+  /// Number of satisfying assignments of the conjunction of assertions
+  /// over the BDD variables on which it depends, where the bits of a bit
+  /// vector constant are counted together, i.e. all or none of them
+
+  /// The count is independent of the expressions that have been encoded
+  /// before, e.g. by popped assertions.
+  double model_count() const;
+
+  /// Call f with each of a set of pairwise disjoint cubes whose
+  /// disjunction is equivalent to the conjunction of assertions
+  /// until f returns false
+  void enumerate_cubes(const std::function<bool(const Cube&)>& f) const;
+
+  /// Boolean constant, bit of a bit vector constant, e.g. `x[3]`, or
+  /// abstracted atom, e.g. `atom!0`
+  const std::string& label(unsigned var) const
+  {
+    return m_manager->label(var);
+  }
+
+  bool is_atom(unsigned var) const
+  {
+    return m_is_atom.at(var);
+  }
+
+  const bdd::BDDManager::Stats& bdd_stats() const
+  {
+    return m_manager->stats();
+  }
+};
+
+}
+
+#endif
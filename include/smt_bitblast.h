@@ -0,0 +1,299 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_BITBLAST_H_
+#define __SMT_BITBLAST_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "smt.h"
+#include "smt_sat.h"
+
+namespace smt
+{
+
+/// Self-contained solver for Boolean and bit vector formulas
+
+/// Every bit of an encoded expression is a literal in an and-inverter
+/// graph (AIG). Its nodes are structurally hashed, so the same gate is
+/// only built once, and each node is a variable of an in-tree CDCL
+/// SatSolver whose Tseitin clauses are added as soon as the node is
+/// created. Encoded expressions and declarations are cached across
+/// checks until reset().
+///
+/// Assertions inside push() are guarded by an activation literal per
+/// level, which pop() disables for good, so the SAT solver and its
+/// learnt clauses are kept across push() and pop(). check_assumptions()
+/// maps the failed assumptions of the SAT solver to an unsat core.
+///
+/// Only the Boolean and bit vector sorts are supported; integers, reals,
+/// arrays and uninterpreted functions yield UNSUPPORT_ERROR.
+class BitBlastSolver : public Solver
+{
+private:
+  typedef SatSolver::Lit Lit;
+
+  /// Literals of an expression, least significant bit first
+  typedef std::vector<Lit> Bits;
+
+  typedef std::chrono::steady_clock DeadlineClock;
+
+  std::unique_ptr<SatSolver> m_sat_solver;
+
+  // AND gates keyed by their two inputs in ascending order
+  std::unordered_map<uint64_t, Lit> m_and_table;
+
+  // bits of constants keyed by their symbol
+  std::unordered_map<std::string, Bits> m_constant_table;
+
+  typedef internal::ExprSideTable<Bits> BitsTable;
+  BitsTable m_bits_table;
+
+  // result of the last encoded expression
+  Bits m_bits;
+
+  // one per push() that has not been popped
+  std::vector<Lit> m_activations;
+
+  std::atomic<bool> m_is_interrupted;
+
+  // only meaningful while checking with a nonzero timeout()
+  DeadlineClock::time_point m_deadline;
+
+  // polled by the SAT solver
+  static bool is_terminated(void* const user_data);
+
+  void start_check();
+
+  void init_sat_solver();
+
+  static constexpr Lit true_lit()
+  {
+    return SatSolver::lit(0);
+  }
+
+  static constexpr Lit false_lit()
+  {
+    return SatSolver::lit(0, true);
+  }
+
+  // gates of the AIG
+  Lit mk_and(Lit a, Lit b);
+  Lit mk_or(Lit a, Lit b);
+  Lit mk_xor(Lit a, Lit b);
+  Lit mk_ite(Lit c, Lit t, Lit e);
+
+  // circuits on bit vectors of equal width
+  Bits mk_not(const Bits& a);
+  Bits mk_and(const Bits& a, const Bits& b);
+  Bits mk_or(const Bits& a, const Bits& b);
+  Bits mk_xor(const Bits& a, const Bits& b);
+  Bits mk_ite(Lit c, const Bits& t, const Bits& e);
+  Bits mk_add(const Bits& a, const Bits& b, Lit carry = false_lit());
+  Bits mk_neg(const Bits& a);
+  Bits mk_sub(const Bits& a, const Bits& b);
+  Bits mk_mul(const Bits& a, const Bits& b);
+  Bits mk_shl(const Bits& a, const Bits& b);
+  Bits mk_lshr(const Bits& a, const Bits& b);
+  void mk_udivrem(const Bits& a, const Bits& b, Bits& q, Bits& r);
+  Bits mk_abs(const Bits& a);
+  Bits mk_div(const Bits& a, const Bits& b, bool is_signed);
+  Bits mk_rem(const Bits& a, const Bits& b, bool is_signed);
+  Lit mk_eq(const Bits& a, const Bits& b);
+  Lit mk_ult(const Bits& a, const Bits& b);
+  Lit mk_lt(const Bits& a, const Bits& b, bool is_signed);
+
+  // \return has m_bits been set to the cached bits of expr?
+  bool find_bits(const Expr* const expr);
+
+  // \pre: not find_bits(expr)
+  void cache_bits(const Expr* const expr);
+
+  template<class F>
+  Error blast_unary(
+    const Expr* const expr,
+    const SharedExpr& arg,
+    F f);
+
+  template<class F>
+  Error blast_binary(
+    const Expr* const expr,
+    const SharedExpr& larg,
+    const SharedExpr& rarg,
+    F f);
+
+  Error encode_bits_literal(
+    const Expr* const expr,
+    unsigned long long literal);
+
+#define SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(type)                              \
+  virtual Error __encode_literal(                                              \
+    const Expr* const expr,                                                    \
+    type literal) override                                                     \
+  {                                                                            \
+    return encode_bits_literal(expr,                                           \
+      static_cast<unsigned long long>(literal));                               \
+  }                                                                            \
+
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(bool)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(char)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(short)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(int)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(long)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(long long)
+SMT_BITBLAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+  virtual Error __encode_constant(
+    const Expr* const expr,
+    const UnsafeDecl& decl) override;
+
+  virtual Error __encode_func_app(
+    const Expr* const expr,
+    const UnsafeDecl& func_decl,
+    const size_t arity,
+    const SharedExpr* const args) override
+  {
+    return UNSUPPORT_ERROR;
+  }
+
+  virtual Error __encode_const_array(
+    const Expr* const expr,
+    const SharedExpr& init) override
+  {
+    return UNSUPPORT_ERROR;
+  }
+
+  virtual Error __encode_array_select(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index) override
+  {
+    return UNSUPPORT_ERROR;
+  }
+
+  virtual Error __encode_array_store(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index,
+    const SharedExpr& value) override
+  {
+    return UNSUPPORT_ERROR;
+  }
+
+#define SMT_BITBLAST_ENCODE_UNARY(name)                                        \
+  virtual Error __encode_unary_##name(                                         \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg) override;                                           \
+
+#define SMT_BITBLAST_ENCODE_BINARY(name)                                       \
+  virtual Error __encode_binary_##name(                                        \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg) override;                                          \
+
+SMT_BITBLAST_ENCODE_UNARY(lnot)
+SMT_BITBLAST_ENCODE_UNARY(not)
+SMT_BITBLAST_ENCODE_UNARY(sub)
+
+SMT_BITBLAST_ENCODE_BINARY(sub)
+SMT_BITBLAST_ENCODE_BINARY(and)
+SMT_BITBLAST_ENCODE_BINARY(or)
+SMT_BITBLAST_ENCODE_BINARY(xor)
+SMT_BITBLAST_ENCODE_BINARY(lshl)
+SMT_BITBLAST_ENCODE_BINARY(lshr)
+SMT_BITBLAST_ENCODE_BINARY(land)
+SMT_BITBLAST_ENCODE_BINARY(lor)
+SMT_BITBLAST_ENCODE_BINARY(imp)
+SMT_BITBLAST_ENCODE_BINARY(eql)
+SMT_BITBLAST_ENCODE_BINARY(add)
+SMT_BITBLAST_ENCODE_BINARY(mul)
+SMT_BITBLAST_ENCODE_BINARY(quo)
+SMT_BITBLAST_ENCODE_BINARY(rem)
+SMT_BITBLAST_ENCODE_BINARY(lss)
+SMT_BITBLAST_ENCODE_BINARY(gtr)
+SMT_BITBLAST_ENCODE_BINARY(neq)
+SMT_BITBLAST_ENCODE_BINARY(leq)
+SMT_BITBLAST_ENCODE_BINARY(geq)
+
+  virtual Error __encode_nary(
+    const Expr* const expr,
+    Opcode opcode,
+    const SharedExprs& args) override;
+
+  virtual Error __encode_bv_zero_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_sign_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override;
+
+  virtual Error __encode_bv_extract(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned high,
+    const unsigned low) override;
+
+  virtual bool __is_encoded(const Expr* const expr) const override
+  {
+    return m_bits_table.find(expr) != nullptr;
+  }
+
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+  virtual void __interrupt() override;
+
+  virtual bool __is_interruptible() const override
+  {
+    return true;
+  }
+
+public:
+  BitBlastSolver();
+
+  /// Only QF_BV is supported
+  BitBlastSolver(Logic logic);
+
+  BitBlastSolver(const BitBlastSolver&) = delete;
+
+  /// Number of AND gates in the AIG since the last reset()
+  size_t aig_size() const
+  {
+    return m_and_table.size();
+  }
+
+  const SatSolver::Stats& sat_stats() const
+  {
+    return m_sat_solver->stats();
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_CACHE_H_
+#define __SMT_CACHE_H_
+
+#include <list>
+#include <unordered_map>
+
+#include "smt.h"
+
+namespace smt
+{
+
+/// Decorator that caches the results of check() of another solver
+
+/// The result of check() is keyed on the set of assertions, regardless
+/// of their order and duplicates. Expressions are compared by address,
+/// so structurally equal assertions are only recognized as such if they
+/// are hash-consed, see ENABLE_HASH_CONS.
+///
+/// Like the counterexample cache of KLEE, the cache also answers
+/// queries that it has not seen before:
+///
+/// - a superset of an unsatisfiable set of assertions is unsatisfiable;
+/// - a subset of a satisfiable set of assertions is satisfiable.
+///
+/// Only sat and unsat results are cached. When the cache is full, the
+/// least recently used result is evicted. The cache outlives reset(),
+/// so the same decorator can be reused for many unrelated queries.
+///
+/// Subsets and supersets are found by a linear scan over the cached
+/// results, most recently used first. Since every cached result costs a
+/// subset test, each scan gives up after scan_limit results.
+class CachingSolver : public internal::DecoratorSolver
+{
+public:
+  struct CacheStats
+  {
+    /// Queries whose set of assertions was in the cache
+    uint64_t hits;
+
+    /// Queries that are a subset of a cached satisfiable set
+    uint64_t sat_subset_hits;
+
+    /// Queries that are a superset of a cached unsatisfiable set
+    uint64_t unsat_superset_hits;
+
+    /// Queries that were answered by the decorated solver
+    uint64_t misses;
+
+    /// Results that were dropped because the cache was full
+    uint64_t evictions;
+
+    /// Scans for a subset or superset that gave up after scan_limit
+    /// results, so a cached answer may have been missed
+    uint64_t scan_limit_hits;
+  };
+
+private:
+  struct Entry
+  {
+    // sorted by address and without duplicates
+    SharedExprs key;
+
+    // over-approximation of key for fast subset tests
+    uint64_t signature;
+
+    CheckResult result;
+  };
+
+  typedef std::list<Entry> Entries;
+
+  struct KeyHash
+  {
+    size_t operator()(const SharedExprs* const key) const;
+  };
+
+  struct KeyEqual
+  {
+    bool operator()(
+      const SharedExprs* const x,
+      const SharedExprs* const y) const;
+  };
+
+  Solver& m_solver;
+  const size_t m_capacity;
+  const size_t m_scan_limit;
+
+  // most recently used first
+  Entries m_entries;
+
+  // keys are owned by m_entries
+  std::unordered_map<const SharedExprs*, Entries::iterator,
+    KeyHash, KeyEqual> m_table;
+
+  CacheStats m_cache_stats;
+
+  static uint64_t signature(const SharedExprs& key);
+
+  // most recently used entry whose key satisfies the predicate among
+  // the m_scan_limit most recently used entries
+  template<typename Predicate>
+  Entries::iterator find_entry(Predicate predicate);
+
+  void insert(SharedExprs&& key, uint64_t signature, CheckResult result);
+
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+  // the decorated solver enforces the time limit and is interrupted
+  virtual void __interrupt() override
+  {
+    m_solver.interrupt();
+  }
+
+  virtual bool __is_interruptible() const override
+  {
+    return m_solver.is_interruptible();
+  }
+
+  virtual void __set_timeout(const ElapsedTime timeout) override
+  {
+    m_solver.set_timeout(timeout);
+  }
+
+public:
+  /// The decorated solver must outlive the decorator and must only be
+  /// used through it, so that both have the same assertions
+  CachingSolver(
+    Solver& solver,
+    size_t capacity = 4096,
+    size_t scan_limit = 256);
+
+  CachingSolver(const CachingSolver&) = delete;
+
+  const CacheStats& cache_stats() const
+  {
+    return m_cache_stats;
+  }
+
+  /// Number of cached results
+  size_t cache_size() const
+  {
+    return m_entries.size();
+  }
+
+  /// Forget all cached results, but not the assertions
+  void clear_cache();
+};
+
+}
+
+#endif
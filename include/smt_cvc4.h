@@ -17,6 +17,17 @@
 #include <cvc4/expr/expr_manager.h>
 #include <cvc4/smt/smt_engine.h>
 
+// CVC4 1.7 introduced this header, and SmtEngine can check several
+// assumptions and report those in the unsat core since at least then.
+// The pinned CVC4 1.4, see solvers/INSTALL_CVC4, has neither.
+#ifndef SMT_CVC4_UNSAT_ASSUMPTIONS
+#if defined(__has_include)
+#if __has_include(<cvc4/api/cvc4cpp.h>)
+#define SMT_CVC4_UNSAT_ASSUMPTIONS
+#endif
+#endif
+#endif
+
 #include <unordered_map>
 
 namespace smt
@@ -32,32 +43,70 @@ private:
   CVC4::SmtEngine* m_smt_engine;
   CVC4::Expr m_expr;
 
-#ifdef ENABLE_HASH_CONS
-  typedef std::unordered_map<uintptr_t, const CVC4::Expr> ExprMap;
-#else
+  typedef internal::ExprSideTable<CVC4::Expr> CVC4ExprTable;
+
+  // Cache CVC4 expressions, see find_expr()
+  CVC4ExprTable m_expr_table;
+
   // We should not use symbol names as key because these need not be unique
   // across different SMT-LIB 2.0 namespaces such as sorts, bindings etc.
-  typedef std::unordered_map<std::string, const CVC4::Expr> ExprMap;
-#endif
+  // But every constant and function application of a declaration must
+  // refer to the same CVC4 variable, which mkVar() does not ensure.
+  typedef std::unordered_map<std::string, const CVC4::Expr> DeclMap;
+
+  // Cache CVC4 declarations
+  DeclMap m_decl_map;
 
-  // Cache CVC4 expressions
-  ExprMap m_expr_map;
+  // \return cached CVC4 expression of a declaration, or nullptr
+  const CVC4::Expr* find_decl_expr(const std::string& symbol) const
+  {
+    DeclMap::const_iterator it = m_decl_map.find(symbol);
+    if (it == m_decl_map.cend())
+      return nullptr;
+
+    return &it->second;
+  }
 
-  void set_expr(const CVC4::Expr& expr)
+  // \pre: find_decl_expr(symbol) == nullptr
+  void cache_decl_expr(
+    const std::string& symbol,
+    const CVC4::Expr& decl_expr)
   {
-    m_expr = expr;
+    m_decl_map.insert(DeclMap::value_type(symbol, decl_expr));
+  }
+
+  // \return has m_expr been set to the cached expression?
+  bool find_expr(const Expr* const expr)
+  {
+    const CVC4::Expr* const cvc4_expr_ptr = m_expr_table.find(expr);
+    if (cvc4_expr_ptr == nullptr)
+      return false;
+
+    m_expr = *cvc4_expr_ptr;
+    return true;
+  }
+
+  // \pre: not find_expr(expr)
+  void set_expr(const Expr* const expr, const CVC4::Expr& cvc4_expr)
+  {
+    m_expr = cvc4_expr;
+    m_expr_table.insert(expr, m_expr);
   }
 
   template<typename T>
-  Error nostring_encode_number(const Sort& sort, T literal)
+  Error nostring_encode_number(const Expr* const expr, T literal)
   {
+    if (find_expr(expr))
+      return OK;
+
+    const Sort& sort = expr->sort();
     assert(!sort.is_bool());
 
     if (sort.is_bv()) {
-      set_expr(m_expr_manager.mkConst(CVC4::BitVector(sort.bv_size(),
+      set_expr(expr, m_expr_manager.mkConst(CVC4::BitVector(sort.bv_size(),
         CVC4::Integer(literal))));
     } else if (sort.is_int() || sort.is_real()) {
-      set_expr(m_expr_manager.mkConst(CVC4::Rational(literal)));
+      set_expr(expr, m_expr_manager.mkConst(CVC4::Rational(literal)));
     } else {
       return UNSUPPORT_ERROR;
     }
@@ -65,16 +114,20 @@ private:
     return OK;
   }
 
-  Error string_encode_number(const Sort& sort, std::string&& literal)
+  Error string_encode_number(const Expr* const expr, std::string&& literal)
   {
+    if (find_expr(expr))
+      return OK;
+
+    const Sort& sort = expr->sort();
     assert(!sort.is_bool());
 
     // Should use move semantics on the integer once CVC4 supports it
     const CVC4::Integer integer(std::move(literal));
     if (sort.is_bv()) {
-      set_expr(m_expr_manager.mkConst(CVC4::BitVector(sort.bv_size(), integer)));
+      set_expr(expr, m_expr_manager.mkConst(CVC4::BitVector(sort.bv_size(), integer)));
     } else if (sort.is_int() || sort.is_real()) {
-      set_expr(m_expr_manager.mkConst(CVC4::Rational(integer)));
+      set_expr(expr, m_expr_manager.mkConst(CVC4::Rational(integer)));
     } else {
       return UNSUPPORT_ERROR;
     }
@@ -86,9 +139,12 @@ private:
     const Expr* const expr,
     bool literal) override
   {
+    if (find_expr(expr))
+      return OK;
+
     assert(expr->sort().is_bool());
 
-    set_expr(m_expr_manager.mkConst(literal));
+    set_expr(expr, m_expr_manager.mkConst(literal));
     return OK;
   }
 
@@ -97,7 +153,7 @@ private:
     const Expr* const expr,                                               \
     type literal) override                                                \
   {                                                                       \
-    return nostring_encode_number<type>(expr->sort(), literal);           \
+    return nostring_encode_number<type>(expr, literal);                   \
   }                                                                       \
 
 #define SMT_CVC4_STRING_ENCODE_LITERAL(type)                              \
@@ -105,7 +161,7 @@ private:
     const Expr* const expr,                                               \
     type literal) override                                                \
   {                                                                       \
-    return string_encode_number(expr->sort(), std::to_string(literal));   \
+    return string_encode_number(expr, std::to_string(literal));           \
   }                                                                       \
 
 SMT_CVC4_NOSTRING_ENCODE_LITERAL(char)
@@ -175,28 +231,25 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const Expr* const expr,
     const UnsafeDecl& decl) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
 
     const std::string& const_symbol = decl.symbol();
 
-#ifdef ENABLE_HASH_CONS
-    uintptr_t key = reinterpret_cast<uintptr_t>(expr);
-#else
-    const std::string& key = const_symbol;
-#endif
-
-    ExprMap::const_iterator it = m_expr_map.find(key);
-    if (it == m_expr_map.cend()) {
+    const CVC4::Expr* const_expr_ptr = find_decl_expr(const_symbol);
+    if (const_expr_ptr == nullptr) {
       CVC4::Type type;
       err = build_type(decl.sort(), type);
       if (err) {
         return err;
       }
 
-      set_expr(m_expr_manager.mkVar(const_symbol, type));
-      m_expr_map.insert(ExprMap::value_type(key, m_expr));
+      set_expr(expr, m_expr_manager.mkVar(const_symbol, type));
+      cache_decl_expr(const_symbol, m_expr);
     } else {
-      set_expr(it->second);
+      set_expr(expr, *const_expr_ptr);
     }
 
     return OK;
@@ -208,27 +261,24 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const size_t arity,
     const SharedExpr* const args) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     CVC4::Expr func_expr;
     const std::string& func_symbol = decl.symbol();
 
-#ifdef ENABLE_HASH_CONS
-    uintptr_t key = reinterpret_cast<uintptr_t>(expr);
-#else
-    const std::string& key = func_symbol;
-#endif
-
-    ExprMap::const_iterator it = m_expr_map.find(key);
-    if (it == m_expr_map.cend()) {
+    const CVC4::Expr* func_expr_ptr = find_decl_expr(func_symbol);
+    if (func_expr_ptr == nullptr) {
       CVC4::Type func_type;
       err = build_type(decl.sort(), func_type);
       if (err) {
         return err;
       }
       func_expr = m_expr_manager.mkVar(func_symbol, func_type);
-      m_expr_map.insert(ExprMap::value_type(key, func_expr));
+      cache_decl_expr(func_symbol, func_expr);
     } else {
-      func_expr = it->second;
+      func_expr = *func_expr_ptr;
     }
 
     std::vector<CVC4::Expr> exprs;
@@ -241,7 +291,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
       exprs.push_back(m_expr);
     }
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::APPLY_UF, func_expr, exprs));
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::APPLY_UF, func_expr, exprs));
     return OK;
   }
 
@@ -249,6 +299,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const Expr* const expr,
     const SharedExpr& init) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
 
     CVC4::Type type;
@@ -263,7 +316,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     }
 
     const CVC4::ArrayType array_type(type);
-    set_expr(m_expr_manager.mkConst(CVC4::ArrayStoreAll(array_type, m_expr)));
+    set_expr(expr, m_expr_manager.mkConst(CVC4::ArrayStoreAll(array_type, m_expr)));
     return OK;
   }
 
@@ -272,6 +325,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& array,
     const SharedExpr& index) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = array.encode(*this);
     if (err) {
@@ -285,7 +341,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     }
     const CVC4::Expr index_expr = m_expr;
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::SELECT,
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::SELECT,
       array_expr, index_expr));
     return OK;
   }
@@ -296,6 +352,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& index,
     const SharedExpr& value) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = array.encode(*this);
     if (err) {
@@ -315,7 +374,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     }
     const CVC4::Expr value_expr = m_expr;
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::STORE,
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::STORE,
       array_expr, index_expr, value_expr));
     return OK;
   }
@@ -324,11 +383,14 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::NOT, m_expr));
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::NOT, m_expr));
     return OK;
   }
 
@@ -336,11 +398,14 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_NOT, m_expr));
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_NOT, m_expr));
     return OK;
   }
 
@@ -348,6 +413,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
@@ -358,7 +426,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     else
       kind = CVC4::kind::UMINUS;
 
-    set_expr(m_expr_manager.mkExpr(kind, m_expr));
+    set_expr(expr, m_expr_manager.mkExpr(kind, m_expr));
     return OK;
   }
 
@@ -381,7 +449,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
 
     const CVC4::Expr rexpr(m_expr);
 
-    set_expr(m_expr_manager.mkExpr(kind, lexpr, rexpr));
+    set_expr(expr, m_expr_manager.mkExpr(kind, lexpr, rexpr));
     return OK;
   }
 
@@ -390,6 +458,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind = CVC4::kind::MINUS;
 
     if (expr->sort().is_bv())
@@ -403,6 +474,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::BITVECTOR_AND, larg, rarg);
   }
@@ -412,6 +486,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::BITVECTOR_OR, larg, rarg);
   }
@@ -421,6 +498,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::BITVECTOR_XOR, larg, rarg);
   }
@@ -430,6 +510,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::BITVECTOR_SHL, larg, rarg);
   }
@@ -439,6 +522,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::BITVECTOR_LSHR, larg, rarg);
   }
@@ -448,6 +534,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::AND, larg, rarg);
   }
@@ -457,6 +546,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::OR, larg, rarg);
   }
@@ -466,6 +558,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::IMPLIES, larg, rarg);
   }
@@ -475,6 +570,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind = CVC4::kind::EQUAL;
 
     if (larg.sort().is_bool())
@@ -488,6 +586,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind = CVC4::kind::PLUS;
 
     if (expr->sort().is_bv())
@@ -501,6 +602,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind = CVC4::kind::MULT;
 
     if (expr->sort().is_bv())
@@ -514,6 +618,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     const Sort& sort = expr->sort();
@@ -545,6 +652,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     const Sort& sort = expr->sort();
@@ -572,6 +682,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     if (larg.sort().is_bv())
@@ -594,6 +707,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     if (larg.sort().is_bv())
@@ -616,6 +732,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     return encode_binary(expr,
       CVC4::kind::DISTINCT, larg, rarg);
   }
@@ -625,6 +744,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     if (larg.sort().is_bv())
@@ -647,6 +769,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     CVC4::kind::Kind_t kind;
 
     if (larg.sort().is_bv())
@@ -669,6 +794,9 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     Opcode opcode,
     const SharedExprs& args) override
   {
+    if (find_expr(expr))
+      return OK;
+
     switch (opcode)
     {
     case NEQ:
@@ -687,7 +815,7 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
       if (err)
         return err;
 
-      set_expr(m_expr);
+      set_expr(expr, m_expr);
       return OK;
     }
 
@@ -703,11 +831,11 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     }
 
     if (opcode == NEQ)
-      set_expr(m_expr_manager.mkExpr(CVC4::kind::DISTINCT, exprs));
+      set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::DISTINCT, exprs));
     else if (opcode == LAND)
-      set_expr(m_expr_manager.mkExpr(CVC4::kind::AND, exprs));
+      set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::AND, exprs));
     else if (opcode == LOR)
-      set_expr(m_expr_manager.mkExpr(CVC4::kind::OR, exprs));
+      set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::OR, exprs));
 
     return OK;
   }
@@ -717,12 +845,15 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& bv,
     const unsigned ext) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
     }
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_ZERO_EXTEND,
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_ZERO_EXTEND,
       m_expr_manager.mkConst(CVC4::BitVectorZeroExtend(ext)), m_expr));
     return OK;
   }
@@ -732,12 +863,15 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExpr& bv,
     const unsigned ext) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
     }
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_SIGN_EXTEND,
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_SIGN_EXTEND,
       m_expr_manager.mkConst(CVC4::BitVectorSignExtend(ext)), m_expr));
     return OK;
   }
@@ -748,31 +882,43 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const unsigned high,
     const unsigned low) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
     }
 
-    set_expr(m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_EXTRACT,
+    set_expr(expr, m_expr_manager.mkExpr(CVC4::kind::BITVECTOR_EXTRACT,
       m_expr_manager.mkConst(CVC4::BitVectorExtract(high, low)), m_expr));
     return OK;
   }
 
-  virtual void __notify_delete(const Expr* const expr) override
+  virtual bool __is_encoded(const Expr* const expr) const override
   {
-#ifdef ENABLE_HASH_CONS
-    m_expr_map.erase(reinterpret_cast<uintptr_t>(expr));
+    return m_expr_table.find(expr) != nullptr;
+  }
+
+  void set_options()
+  {
+    m_smt_engine->setOption("incremental", true);
+#ifdef SMT_CVC4_UNSAT_ASSUMPTIONS
+    m_smt_engine->setOption("produce-unsat-assumptions", true);
 #endif
   }
 
   virtual void __reset() override
   {
     // free memory first
-    m_expr_map.clear();
+    m_expr_table.clear();
+    m_decl_map.clear();
     m_expr = CVC4::Expr();
 
     delete m_smt_engine;
     m_smt_engine = new CVC4::SmtEngine(&m_expr_manager);
+    set_options();
+    m_smt_engine->setTimeLimit(timeout().count());
   }
 
   virtual void __push() override
@@ -818,7 +964,99 @@ SMT_CVC4_STRING_ENCODE_LITERAL(unsigned long long)
     const SharedExprs& assumptions,
     SharedExprs& unsat_core) override
   {
-    return {unknown, 0};
+    std::vector<CVC4::Expr> cvc4_assumptions;
+    cvc4_assumptions.reserve(assumptions.size());
+    for (const SharedExpr& assumption : assumptions)
+    {
+      const Error err = assumption.encode(*this);
+      if (err)
+        return {unknown, 0};
+
+      cvc4_assumptions.push_back(m_expr);
+    }
+
+#ifdef SMT_CVC4_UNSAT_ASSUMPTIONS
+    const CVC4::Result result = m_smt_engine->checkSat(cvc4_assumptions);
+#else
+    // only a single assumption can be checked, so it is the conjunction
+    CVC4::Expr conjunction;
+    if (cvc4_assumptions.size() == 1)
+      conjunction = cvc4_assumptions.front();
+    else if (1 < cvc4_assumptions.size())
+      conjunction = m_expr_manager.mkExpr(CVC4::kind::AND, cvc4_assumptions);
+
+    const CVC4::Result result = m_smt_engine->checkSat(conjunction);
+#endif
+
+    switch (result.isSat()) {
+    case CVC4::Result::Sat::SAT:
+      return {sat, 0};
+    case CVC4::Result::Sat::SAT_UNKNOWN:
+      return {unknown, 0};
+    case CVC4::Result::Sat::UNSAT:
+      break;
+    }
+
+    if (unsat_core.empty())
+      return {unsat, 0};
+
+#ifdef SMT_CVC4_UNSAT_ASSUMPTIONS
+    // subset of cvc4_assumptions in undefined order
+    const std::vector<CVC4::Expr> cvc4_unsat_core =
+      m_smt_engine->getUnsatAssumptions();
+#else
+    // not minimal, but the conjunction of all assumptions is unsat
+    const std::vector<CVC4::Expr>& cvc4_unsat_core = cvc4_assumptions;
+#endif
+
+    if (cvc4_unsat_core.empty())
+      return {unsat, 0};
+
+    const size_t cvc4_unsat_core_size = cvc4_unsat_core.size();
+    const size_t cvc4_assumptions_size = cvc4_assumptions.size();
+
+    assert(cvc4_unsat_core_size <= cvc4_assumptions_size);
+
+    size_t i, j;
+    SharedExprs::size_type k = unsat_core.size();
+    for (i = cvc4_assumptions_size; i != 0 && k != 0; --i)
+    {
+      const CVC4::Expr& x = cvc4_assumptions[i - 1];
+      for (j = i - 1; j != 0; --j)
+      {
+        if (x == cvc4_assumptions[j - 1])
+          goto SKIP_DUPLICATE;
+      }
+
+      for (j = 0; j < cvc4_unsat_core_size; ++j)
+      {
+        if (x == cvc4_unsat_core[j])
+        {
+          unsat_core[--k] = assumptions[i - 1];
+          break;
+        }
+      }
+
+      SKIP_DUPLICATE: continue;
+    }
+
+    return {unsat, unsat_core.size() - k};
+  }
+
+  virtual void __interrupt() override
+  {
+    m_smt_engine->interrupt();
+  }
+
+  virtual bool __is_interruptible() const override
+  {
+    return true;
+  }
+
+  // zero means no time limit, and the limit applies to each check
+  virtual void __set_timeout(const ElapsedTime timeout) override
+  {
+    m_smt_engine->setTimeLimit(timeout.count());
   }
 
 public:
@@ -828,9 +1066,10 @@ public:
     m_expr_manager(),
     m_smt_engine(new CVC4::SmtEngine(&m_expr_manager)),
     m_expr(),
-    m_expr_map()
+    m_expr_table(),
+    m_decl_map()
   {
-    m_smt_engine->setOption("incremental", true);
+    set_options();
     m_smt_engine->setOption("output-language", "smt2");
   }
 
@@ -839,9 +1078,10 @@ public:
     m_expr_manager(options),
     m_smt_engine(new CVC4::SmtEngine(&m_expr_manager)),
     m_expr(),
-    m_expr_map()
+    m_expr_table(),
+    m_decl_map()
   {
-    m_smt_engine->setOption("incremental", true);
+    set_options();
   }
 
   CVC4Solver(Logic logic)
@@ -849,9 +1089,10 @@ public:
     m_expr_manager(),
     m_smt_engine(new CVC4::SmtEngine(&m_expr_manager)),
     m_expr(),
-    m_expr_map()
+    m_expr_table(),
+    m_decl_map()
   {
-    m_smt_engine->setOption("incremental", true);
+    set_options();
     m_smt_engine->setOption("output-language", "smt2");
     m_smt_engine->setLogic(Logics::acronyms[logic]);
   }
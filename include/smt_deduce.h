@@ -2,12 +2,13 @@
 // Use of this source code is governed by a BSD-style
 // license that can be found in the LICENSE file.
 
-#ifndef _SMT_LATTICE_H_
-#define _SMT_LATTICE_H_
+#ifndef __SMT_DEDUCE_H_
+#define __SMT_DEDUCE_H_
 
+#include <cstdint>
+#include <string>
 #include <unordered_map>
 #include <vector>
-#include <stack>
 
 #include "smt.h"
 
@@ -19,380 +20,328 @@ namespace smt
 /// This solver shows how symbolic execution can use abstraction techniques
 /// to check whether the Boolean skeleton of path conditions is unsatisfiable.
 ///
+/// Every Boolean expression is a literal over dense node ids: Boolean
+/// constants and all other atoms, e.g. `x < 3` for an integer `x`, are
+/// variables, and conjunctions, disjunctions and equivalences are gates
+/// whose definitions are clauses. Unit propagation over these clauses
+/// uses two watched literals, so an assertion only visits the clauses
+/// whose watched literals it falsifies.
+///
+/// Facts are kept on a trail. push() marks its end, and pop() unassigns
+/// the facts after the mark and re-examines only the clauses watching
+/// them, so neither reprocesses the other assertions.
+///
 /// This solver design is inspired by recent papers on abstract satisfaction,
 /// see D'Silva, Haller and Kroening who published in POPL'13 and POPL'14.
 class DeduceSolver : public Solver
 {
-private:
-  static constexpr Error conflict_error()
+public:
+  /// Twice the node id, plus one if the literal is negative
+  typedef uint32_t Lit;
+
+  struct Stats
   {
-    return static_cast<Error>(404U);
-  }
+    uint64_t propagations;
+    uint64_t conflicts;
+  };
 
-  /// Partial assignment for predicates in the Boolean skeleton of the
-  /// formula to be checked for unsatisfiability
+private:
+  typedef uint32_t ClauseRef;
+
+  static constexpr ClauseRef s_no_clause = static_cast<ClauseRef>(-1);
+
+  static constexpr size_t s_no_level = static_cast<size_t>(-1);
 
-  /// Unit propagation is implemented as an abstract transformer that
-  /// assigns satisfying truth values to the Boolean variables according
-  /// to the in-order traversal of the formula's syntactic structure.
-  ///
-  /// Conflicts are detected by unit_propagate(), the only function
-  /// that is allowed to directly update the partial assignments!
-  typedef std::unordered_map<uintptr_t, bool> PartialAssignment;
+  // literal of every non-Boolean expression
+  static constexpr Lit s_opaque_lit = static_cast<Lit>(-1);
 
-  /// Partial assignment of predicates in the Boolean skeleton
-  PartialAssignment m_partial_assignment;
+  // node 0 is the constant true
+  static constexpr Lit s_true_lit = 0;
 
-  /// Used to interpret the formula in negation normal form
-  bool m_is_negation;
+  // truth values of literals, indexed by Lit
+  static constexpr int8_t s_true = 1;
+  static constexpr int8_t s_false = -1;
+  static constexpr int8_t s_undef = 0;
 
-  bool is_top(uintptr_t addr)
+  static constexpr Lit negate(const Lit lit)
   {
-    PartialAssignment::const_iterator citer = m_partial_assignment.find(addr);
-    return citer == m_partial_assignment.cend();
+    return lit ^ 1;
   }
 
-  bool is_false(uintptr_t addr)
-  {
-    PartialAssignment::const_iterator citer = m_partial_assignment.find(addr);
-    if (citer == m_partial_assignment.cend())
-      return false;
+  // the first two literals are watched
+  typedef std::vector<Lit> Clause;
 
-    return !citer->second;
-  }
+  std::vector<Clause> m_clauses;
 
-  Error unit_propagate(const Expr* const expr, bool fact)
-  {
-    PartialAssignment::iterator iter;
-    bool ok;
+  // clauses after this prefix are attached once a conflict is undone
+  size_t m_attached_size;
 
-    std::tie(iter, ok) = m_partial_assignment.emplace(
-      reinterpret_cast<uintptr_t>(expr), fact);
-    const bool is_consistent = iter->second == fact;
+  // indexed by Lit, clauses in which the literal is watched
+  std::vector<std::vector<ClauseRef>> m_watches;
 
-    /// a newly inserted fact cannot yield a conflict
-    assert(!ok || is_consistent);
+  // indexed by Lit
+  std::vector<int8_t> m_values;
 
-    if (!is_consistent)
-      return conflict_error();
+  std::vector<Lit> m_trail;
 
-    return OK;
-  }
+  // end of the trail at each push()
+  std::vector<size_t> m_trail_lims;
 
-  /// \pre: expr->sort().is_bool()
-  Error abstract_binary_relation(
-    const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg)
-  {
-    return unit_propagate(expr, !m_is_negation);
-  }
+  // next fact on the trail whose watches are visited
+  size_t m_qhead;
 
-  virtual Error __encode_literal(
-    const Expr* const expr,
-    bool literal)
-  {
-    if (!expr->sort().is_bool())
-      return UNSUPPORT_ERROR;
+  // push() level at which a conflict was deduced, or s_no_level
+  size_t m_conflict_level;
 
-    if (literal == m_is_negation)
-      return conflict_error();
+  // falsified clause, or s_no_clause if an assertion was false
+  ClauseRef m_conflict;
 
-    return OK;
-  }
+  typedef internal::ExprSideTable<Lit> LitTable;
+  LitTable m_lit_table;
 
-#define SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(type) \
-  virtual Error __encode_literal(                     \
-     const Expr* const expr,                          \
-     type literal) override                           \
-  {                                                   \
-    return UNSUPPORT_ERROR;                           \
-  }                                                   \
-
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(char)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(signed char)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned char)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(wchar_t)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(char16_t)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(char32_t)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(short)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned short)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(int)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned int)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(long)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(long long)
-SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
+  // literals of Boolean constants keyed by their symbol
+  std::unordered_map<std::string, Lit> m_constant_table;
 
-  virtual Error __encode_constant(
-    const Expr* const expr,
-    const UnsafeDecl& decl) override
-  {
-    if (!decl.sort().is_bool())
-      return UNSUPPORT_ERROR;
+  // literal of the last encoded expression
+  Lit m_lit;
 
-    return unit_propagate(expr, !m_is_negation);
-  }
+  Stats m_stats;
 
-  virtual Error __encode_func_app(
-    const Expr* const expr,
-    const UnsafeDecl& decl,
-    const size_t arity,
-    const SharedExpr* const args) override
+  int8_t value(const Lit lit) const
   {
-    return UNSUPPORT_ERROR;
+    return m_values[lit];
   }
 
-  virtual Error __encode_const_array(
-    const Expr* const expr,
-    const SharedExpr& init) override
+  bool is_conflict() const
   {
-    return UNSUPPORT_ERROR;
+    return m_conflict_level != s_no_level;
   }
 
-  virtual Error __encode_array_select(
-    const Expr* const expr,
-    const SharedExpr& array,
-    const SharedExpr& index) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  void set_conflict(ClauseRef cref);
 
-  virtual Error __encode_array_store(
-    const Expr* const expr,
-    const SharedExpr& array,
-    const SharedExpr& index,
-    const SharedExpr& value) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  Lit new_node();
 
-  virtual Error __encode_unary_lnot(
-    const Expr* const expr,
-    const SharedExpr& arg) override
-  {
-    m_is_negation = !m_is_negation;
-    const Error err = arg.encode(*this);
-    m_is_negation = !m_is_negation;
+  // literal equivalent to the conjunction of lits, which are sorted
+  Lit mk_and(std::vector<Lit>& lits);
 
-    if (err)
-      return err;
+  Lit mk_or(std::vector<Lit>& lits);
 
-    return OK;
-  }
+  // literal equivalent to a <-> b
+  Lit mk_iff(Lit a, Lit b);
 
-  virtual Error __encode_unary_not(
-    const Expr* const expr,
-    const SharedExpr& arg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  void add_clause(Clause&& clause);
+  void attach_clause(ClauseRef cref);
 
-  virtual Error __encode_unary_sub(
-    const Expr* const expr,
-    const SharedExpr& arg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  // restores the watches of a clause whose watched literals may both be
+  // false after the trail has been shortened
+  void examine_clause(ClauseRef cref);
 
-  virtual Error __encode_binary_sub(
-    const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  // \pre: value(lit) == s_undef
+  void enqueue(Lit lit);
 
-  virtual Error __encode_binary_and(
-    const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  void propagate();
 
-  virtual Error __encode_binary_or(
-    const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  void cancel_until(size_t level);
 
-  virtual Error __encode_binary_xor(
-    const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+  // \return has m_lit been set to the cached literal of expr?
+  bool find_lit(const Expr* const expr);
 
-  virtual Error __encode_binary_land(
+  // \pre: not find_lit(expr)
+  void cache_lit(const Expr* const expr);
+
+  // Fresh variable for a Boolean expr, otherwise s_opaque_lit
+  Error encode_atom(const Expr* const expr);
+
+  // Bool arguments form a gate, others an atom
+  Error encode_relation(
     const Expr* const expr,
     const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    Error err;
-    if (!m_is_negation || is_false(larg.addr()))
-    {
-      err = rarg.encode(*this);
-      if (err)
-        return err;
-    }
-
-    if (!m_is_negation || is_false(rarg.addr()))
-    {
-      err = larg.encode(*this);
-      if (err)
-        return err;
-    }
+    const SharedExpr& rarg,
+    bool is_equality);
 
-    return OK;
-  }
+  Error encode_gate(
+    const Expr* const expr,
+    Opcode opcode,
+    const SharedExpr* const args,
+    size_t size);
 
-  virtual Error __encode_binary_lor(
+  virtual Error __encode_literal(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
+    bool literal) override
   {
-    Error err;
-    if (m_is_negation || is_false(larg.addr()))
-    {
-      err = rarg.encode(*this);
-      if (err)
-        return err;
-    }
-
-    if (m_is_negation || is_false(rarg.addr()))
-    {
-      err = larg.encode(*this);
-      if (err)
-        return err;
-    }
+    if (find_lit(expr))
+      return OK;
 
+    m_lit = literal ? s_true_lit : negate(s_true_lit);
+    cache_lit(expr);
     return OK;
   }
 
-  virtual Error __encode_binary_imp(
+#define SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(type)                                \
+  virtual Error __encode_literal(                                              \
+    const Expr* const expr,                                                    \
+    type literal) override                                                     \
+  {                                                                            \
+    if (find_lit(expr))                                                        \
+      return OK;                                                               \
+                                                                               \
+    return encode_atom(expr);                                                  \
+  }                                                                            \
+
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(char)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(short)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(int)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(long)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(long long)
+SMT_DEDUCE_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+  virtual Error __encode_constant(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+    const UnsafeDecl& decl) override;
 
-  virtual Error __encode_binary_eql(
+  virtual Error __encode_func_app(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
+    const UnsafeDecl& decl,
+    const size_t arity,
+    const SharedExpr* const args) override
   {
-    return abstract_binary_relation(expr, larg, rarg);
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
-  virtual Error __encode_binary_add(
+  virtual Error __encode_const_array(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
+    const SharedExpr& init) override
   {
-    return UNSUPPORT_ERROR;
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
-  virtual Error __encode_binary_mul(
+  virtual Error __encode_array_select(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
+    const SharedExpr& array,
+    const SharedExpr& index) override
   {
-    return UNSUPPORT_ERROR;
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
-  virtual Error __encode_binary_quo(
+  virtual Error __encode_array_store(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
+    const SharedExpr& array,
+    const SharedExpr& index,
+    const SharedExpr& value) override
   {
-    return UNSUPPORT_ERROR;
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
-  virtual Error __encode_binary_rem(
+  virtual Error __encode_unary_lnot(
     const Expr* const expr,
-    const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return UNSUPPORT_ERROR;
-  }
+    const SharedExpr& arg) override;
+
+#define SMT_DEDUCE_ENCODE_UNARY_ATOM(name)                                     \
+  virtual Error __encode_unary_##name(                                         \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg) override                                            \
+  {                                                                            \
+    if (find_lit(expr))                                                        \
+      return OK;                                                               \
+                                                                               \
+    return encode_atom(expr);                                                  \
+  }                                                                            \
+
+#define SMT_DEDUCE_ENCODE_BINARY_ATOM(name)                                    \
+  virtual Error __encode_binary_##name(                                        \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg) override                                           \
+  {                                                                            \
+    if (find_lit(expr))                                                        \
+      return OK;                                                               \
+                                                                               \
+    return encode_atom(expr);                                                  \
+  }                                                                            \
+
+SMT_DEDUCE_ENCODE_UNARY_ATOM(not)
+SMT_DEDUCE_ENCODE_UNARY_ATOM(sub)
+
+SMT_DEDUCE_ENCODE_BINARY_ATOM(sub)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(and)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(or)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(xor)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(lshl)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(lshr)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(add)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(mul)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(quo)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(rem)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(lss)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(gtr)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(leq)
+SMT_DEDUCE_ENCODE_BINARY_ATOM(geq)
 
-  virtual Error __encode_binary_lss(
+  virtual Error __encode_binary_land(
     const Expr* const expr,
     const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return abstract_binary_relation(expr, larg, rarg);
-  }
+    const SharedExpr& rarg) override;
 
-  virtual Error __encode_binary_gtr(
+  virtual Error __encode_binary_lor(
     const Expr* const expr,
     const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return abstract_binary_relation(expr, larg, rarg);
-  }
+    const SharedExpr& rarg) override;
 
-  virtual Error __encode_binary_neq(
+  virtual Error __encode_binary_imp(
     const Expr* const expr,
     const SharedExpr& larg,
-    const SharedExpr& rarg) override
-  {
-    return abstract_binary_relation(expr, larg, rarg);
-  }
+    const SharedExpr& rarg) override;
 
-  virtual Error __encode_binary_leq(
+  virtual Error __encode_binary_eql(
     const Expr* const expr,
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
-    return abstract_binary_relation(expr, larg, rarg);
+    return encode_relation(expr, larg, rarg, true);
   }
 
-  virtual Error __encode_binary_geq(
+  virtual Error __encode_binary_neq(
     const Expr* const expr,
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
-    return abstract_binary_relation(expr, larg, rarg);
+    return encode_relation(expr, larg, rarg, false);
   }
 
   virtual Error __encode_nary(
     const Expr* const expr,
     Opcode opcode,
-    const SharedExprs& args) override
-  {
-    switch (opcode)
-    {
-    case LAND:
-    case LOR:
-      break;
-
-    default:
-      return UNSUPPORT_ERROR;
-    }
-
-    Error err;
-    for (const SharedExpr& arg : args)
-    {
-      err = arg.encode(*this);
-      if (err)
-        return err;
-    }
-
-    return OK;
-  }
+    const SharedExprs& args) override;
 
   virtual Error __encode_bv_zero_extend(
     const Expr* const expr,
     const SharedExpr& bv,
     const unsigned ext) override
   {
-    return UNSUPPORT_ERROR;
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
   virtual Error __encode_bv_sign_extend(
@@ -400,7 +349,10 @@ SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
     const SharedExpr& bv,
     const unsigned ext) override
   {
-    return UNSUPPORT_ERROR;
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
   }
 
   virtual Error __encode_bv_extract(
@@ -409,82 +361,54 @@ SMT_LATTICE_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
     const unsigned high,
     const unsigned low) override
   {
-    return UNSUPPORT_ERROR;
-  }
-
-  virtual void __notify_delete(const Expr* const expr) override
-  {
-    m_partial_assignment.erase(reinterpret_cast<uintptr_t>(expr));
-  }
-
-  virtual void __reset() override
-  {
-    m_partial_assignment.clear();
-    m_is_negation = false;
-  }
+    if (find_lit(expr))
+      return OK;
 
-  virtual void __push() override
-  {
+    return encode_atom(expr);
   }
 
-  virtual void __pop() override
+  virtual bool __is_encoded(const Expr* const expr) const override
   {
+    return m_lit_table.find(expr) != nullptr;
   }
 
-  virtual Error __unsafe_add(const SharedExpr& condition) override
-  {
-    return OK;
-  }
-
-  virtual Error __add(const Bool& condition) override
-  {
-    return __unsafe_add(condition);
-  }
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
 
   /// Is the conjunction of assertions unsatisfiable?
 
   /// Since this implementation considers only the Boolean skeleton of the
-  /// formula, __check() is necessarily incomplete.
+  /// formula, __check() is necessarily incomplete: it returns unsat if
+  /// unit propagation has deduced a conflict and unknown otherwise.
   virtual CheckResult __check() override
   {
-    Error err;
-    PartialAssignment::size_type size;
-
-    m_partial_assignment.clear();
-    for (;;)
-    {
-      size = m_partial_assignment.size();
-      err = __encode_nary(nullptr, LAND, Solver::assertions().terms);
-
-      if (err == conflict_error())
-        return unsat;
-
-      // reached fixed point
-      if (size == m_partial_assignment.size())
-        return unknown;
-    }
-
-    return sat;
+    return is_conflict() ? unsat : unknown;
   }
 
   virtual std::pair<CheckResult, SharedExprs::size_type>
   __check_assumptions(
     const SharedExprs& assumptions,
-    SharedExprs& unsat_core) override
+    SharedExprs& unsat_core) override;
+
+public:
+  DeduceSolver();
+  DeduceSolver(Logic logic);
+
+  DeduceSolver(const DeduceSolver&) = delete;
+
+  /// Number of nodes in the Boolean skeleton, including the constant true
+  size_t nodes_size() const
   {
-    return {unknown, 0};
+    return m_values.size() / 2;
   }
 
-public:
-  DeduceSolver()
-  : Solver(),
-    m_partial_assignment(),
-    m_is_negation(false) {}
-
-  DeduceSolver(Logic logic)
-  : Solver(logic),
-    m_partial_assignment(),
-    m_is_negation(false) {}
+  const Stats& deduce_stats() const
+  {
+    return m_stats;
+  }
 };
 
 }
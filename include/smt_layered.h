@@ -0,0 +1,127 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_LAYERED_H_
+#define __SMT_LAYERED_H_
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "smt.h"
+
+namespace smt
+{
+
+/// Decorator that asks a sequence of solvers until one of them knows
+
+/// The solvers, called layers, are ordered from the cheapest to the most
+/// expensive one. Typically, the first layers are incomplete, such as
+/// DeduceSolver or BddSolver, and the last one is complete, such as
+/// Z3Solver. check() returns the first sat or unsat result of a layer,
+/// so the later layers are only asked if all earlier ones return unknown.
+///
+/// Assertions are mirrored into a layer only when it is asked, and then
+/// only those that it has not seen yet. Since a layer that is never asked
+/// never sees the assertions, its cost is not incurred at all. pop() is
+/// passed on immediately to those layers that have seen the popped level.
+///
+/// LayerStats record how many queries each layer has resolved and how
+/// much time was spent in it, including the time to mirror assertions.
+class LayeredSolver : public internal::DecoratorSolver
+{
+public:
+  typedef std::chrono::microseconds LayerTime;
+
+  struct LayerStats
+  {
+    /// Number of queries that each layer was asked, indexed like the
+    /// solvers passed to the constructor
+    std::vector<uint64_t> queries;
+
+    /// Number of sat or unsat results of each layer
+    std::vector<uint64_t> resolved;
+
+    /// Time spent in each layer, including the mirroring of assertions
+    std::vector<LayerTime> elapsed_time;
+
+    /// Queries for which all layers returned unknown
+    uint64_t unknowns;
+  };
+
+private:
+  struct Layer
+  {
+    Solver* solver;
+
+    // number of mirrored assertions
+    size_t size;
+
+    // number of push() calls that have been mirrored
+    size_t level;
+  };
+
+  std::vector<Layer> m_layers;
+
+  // number of assertions at each push()
+  std::vector<size_t> m_lims;
+
+  LayerStats m_layer_stats;
+
+  // set by interrupt(), cleared by the next query
+  std::atomic<bool> m_interrupted;
+
+  // add the assertions and push() calls that layer has not seen yet
+  void mirror(Layer& layer);
+
+  // ask the layers in order until query returns sat or unsat
+  template<class Query>
+  void ask(Query query);
+
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+  virtual void __interrupt() override;
+
+  // a running layer may not be interruptible
+  virtual bool __is_interruptible() const override;
+
+  virtual void __set_timeout(const ElapsedTime timeout) override;
+
+public:
+  /// Ask the given solvers in order, which must be distinct
+
+  /// The solvers are not owned by the decorator, must outlive it and
+  /// must only be used through it while it exists.
+  ///
+  /// \pre: !solvers.empty()
+  LayeredSolver(const std::vector<Solver*>& solvers);
+
+  LayeredSolver(const LayeredSolver&) = delete;
+
+  const LayerStats& layer_stats() const
+  {
+    return m_layer_stats;
+  }
+
+  /// Fraction of the queries asked of a layer that it resolved
+  double resolution_rate(size_t layer) const;
+
+  /// Estimated time that the last layer would have taken to answer the
+  /// queries that earlier layers resolved, based on its mean query time
+  LayerTime saved_time() const;
+};
+
+}
+
+#endif
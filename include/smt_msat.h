@@ -6,9 +6,10 @@
 #define __SMT_MSAT_H_
 
 #include <limits>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
 #include <mathsat.h>
-#include <unordered_map>
 
 #include "smt.h"
 
@@ -22,19 +23,56 @@ private:
   msat_env m_env;
   msat_term m_term;
 
-  typedef std::unordered_map<uintptr_t, const msat_term> TermMap;
-  TermMap m_term_map;
+  typedef internal::ExprSideTable<msat_term> TermTable;
+  TermTable m_term_table;
+
+  // Activation literal of an assumption, which is equivalent to the
+  // assumption in the given scope
+  struct Prop
+  {
+    msat_term term;
+    Scope scope;
+  };
+
+  typedef internal::ExprSideTable<Prop> PropTable;
+  PropTable m_prop_table;
+
+  // makes the names of activation literals unique
+  uint64_t m_prop_counter;
+
+  typedef std::chrono::steady_clock DeadlineClock;
+
+  // set by __interrupt(), cleared when the next check starts
+  std::atomic<bool> m_is_interrupted;
+
+  // only meaningful while checking with a nonzero timeout()
+  DeadlineClock::time_point m_deadline;
+
+  // polled by MathSAT during msat_solve() and its variants
+  static int is_terminated(void* const user_data)
+  {
+    const MsatSolver& solver = *static_cast<const MsatSolver*>(user_data);
+    if (solver.m_is_interrupted.load() || solver.is_cancelled())
+      return 1;
+
+    return solver.timeout() != ElapsedTime::zero() &&
+      solver.m_deadline <= DeadlineClock::now();
+  }
+
+  void start_check()
+  {
+    m_is_interrupted.store(false);
+    m_deadline = DeadlineClock::now() + timeout();
+  }
 
   // \return has m_term been set to cached expression?
   bool find_term(const Expr* const expr)
   {
-    const TermMap::const_iterator citer = m_term_map.find(
-      reinterpret_cast<uintptr_t>(expr));
-
-    if (citer == m_term_map.cend())
+    const msat_term* const term_ptr = m_term_table.find(expr);
+    if (term_ptr == nullptr)
       return false;
 
-    m_term = citer->second;
+    m_term = *term_ptr;
     return true;
   }
 
@@ -44,9 +82,8 @@ private:
     m_term = term;
     assert(!MSAT_ERROR_TERM(m_term));
 
-    bool ok = std::get<1>(m_term_map.emplace(
-      reinterpret_cast<uintptr_t>(expr), term));
-    assert(ok);
+    // terms are owned by m_env
+    m_term_table.insert(expr, term);
   }
 
   Error encode_number(
@@ -1071,9 +1108,9 @@ SMT_MSAT_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
     return OK;
   }
 
-  virtual void __notify_delete(const Expr* const expr) override
+  virtual bool __is_encoded(const Expr* const expr) const override
   {
-    m_term_map.erase(reinterpret_cast<uintptr_t>(expr));
+    return m_term_table.find(expr) != nullptr;
   }
 
   virtual void __reset() override
@@ -1081,7 +1118,11 @@ SMT_MSAT_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
     // keeps terms around!
     int status = msat_reset_env(m_env);
     assert(status == 0);
-    m_term_map.clear();
+    m_term_table.clear();
+    m_prop_table.clear();
+
+    status = msat_set_termination_test(m_env, is_terminated, this);
+    assert(status == 0);
   }
 
   virtual void __push() override
@@ -1112,6 +1153,7 @@ SMT_MSAT_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
 
   virtual CheckResult __check() override
   {
+    start_check();
     switch (msat_solve(m_env)) {
     case MSAT_UNSAT:
       return unsat;
@@ -1122,58 +1164,29 @@ SMT_MSAT_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
     }
   }
 
+  virtual void __interrupt() override
+  {
+    m_is_interrupted.store(true);
+  }
+
+  virtual bool __is_interruptible() const override
+  {
+    return true;
+  }
+
   virtual std::pair<CheckResult, SharedExprs::size_type>
   __check_assumptions(
     const SharedExprs& assumptions,
     SharedExprs& unsat_core) override
   {
-    static constexpr char s_msat_prop_prefix[] = "msat_prop!";
-
-    Error err;
-
     const size_t msat_props_size = assumptions.size();
     msat_term msat_props[msat_props_size];
 
-    msat_term* msat_assertions = nullptr;
-    size_t msat_props_index = 0, msat_assertions_size = 0;
+    size_t msat_props_index = 0;
     for (const SharedExpr& assumption : assumptions)
-    {
-      err = assumption.encode(*this);
-      assert(err == OK);
-
-      if (msat_term_is_constant(m_env, m_term))
-      {
-        msat_props[msat_props_index] = m_term;
-      }
-      else
-      {
-        // restore assertions later
-        if (msat_assertions == nullptr)
-          msat_assertions = msat_get_asserted_formulas(m_env, &msat_assertions_size);
-
-        const msat_type bool_type = msat_get_bool_type(m_env);
-        assert(!MSAT_ERROR_TYPE(bool_type));
-
-        const std::string name = s_msat_prop_prefix + std::to_string(msat_props_index);
-        const msat_decl constant_decl = msat_declare_function(m_env, name.c_str(), bool_type);
-        assert(!MSAT_ERROR_DECL(constant_decl));
-
-        const msat_term constant_term = msat_make_constant(m_env, constant_decl);
-        assert(!MSAT_ERROR_TERM(constant_term));
-
-        const msat_term iff_term = msat_make_iff(m_env, constant_term, m_term);
-        assert(!MSAT_ERROR_TERM(iff_term));
-
-        const int status = msat_assert_formula(m_env, iff_term);
-        assert(status == 0);
-
-        msat_props[msat_props_index] = constant_term;
-      }
-
-      assert(msat_props_index < msat_props_size);
-      msat_props_index++;
-    }
+      msat_props[msat_props_index++] = prop(assumption);
 
+    start_check();
     msat_result result = msat_solve_with_assumptions(
       m_env, msat_props, msat_props_size);
     switch (result)
@@ -1212,22 +1225,56 @@ SMT_MSAT_CAST_ENCODE_BUILTIN_LITERAL(unsigned long long)
 
     msat_free(msat_unsat_core);
 
-    // restore original assertions
-    if (msat_assertions != nullptr)
+    // assume that msat_unsat_core may contain duplicates
+    assert(unsat_core.size() - k <= msat_unsat_core_size);
+    return {unsat, unsat_core.size() - k};
+  }
+
+  // \return Boolean constant that is equivalent to assumption in MathSAT
+  msat_term prop(const SharedExpr& assumption)
+  {
+    static constexpr char s_msat_prop_prefix[] = "msat_prop!";
+
+    const Expr* const expr = &assumption.ref();
+    Prop* prop_ptr = m_prop_table.find(expr);
+    if (prop_ptr != nullptr && is_live(prop_ptr->scope))
+      return prop_ptr->term;
+
+    const Error err = assumption.encode(*this);
+    assert(err == OK);
+
+    // constants need no activation literal
+    if (msat_term_is_constant(m_env, m_term))
+      return m_term;
+
+    if (prop_ptr == nullptr)
     {
-      int status = msat_reset_env(m_env);
-      assert(status == 0);
+      const msat_type bool_type = msat_get_bool_type(m_env);
+      assert(!MSAT_ERROR_TYPE(bool_type));
+
+      const std::string name = s_msat_prop_prefix +
+        std::to_string(m_prop_counter++);
+      const msat_decl constant_decl =
+        msat_declare_function(m_env, name.c_str(), bool_type);
+      assert(!MSAT_ERROR_DECL(constant_decl));
 
-      while (msat_assertions_size != 0)
-        msat_assert_formula(m_env, msat_assertions[--msat_assertions_size]);
+      const msat_term constant_term = msat_make_constant(m_env, constant_decl);
+      assert(!MSAT_ERROR_TERM(constant_term));
 
-      msat_free(msat_assertions);
+      // terms are owned by m_env
+      m_prop_table.insert(expr, Prop{constant_term, scope()});
+      prop_ptr = m_prop_table.find(expr);
     }
 
-    // assume that msat_unsat_core may contain duplicates
-    assert(unsat_core.size() - k <= msat_unsat_core_size);
-    assert(msat_assertions_size == 0);
-    return {unsat, unsat_core.size() - k};
+    // the equivalence has not been added yet, or it has been popped
+    const msat_term iff_term = msat_make_iff(m_env, prop_ptr->term, m_term);
+    assert(!MSAT_ERROR_TERM(iff_term));
+
+    const int status = msat_assert_formula(m_env, iff_term);
+    assert(status == 0);
+
+    prop_ptr->scope = scope();
+    return prop_ptr->term;
   }
 
 public:
@@ -1237,12 +1284,19 @@ public:
     m_config(msat_create_config()),
     m_env(msat_create_env(m_config)),
     m_term(),
-    m_term_map()
+    m_term_table(),
+    m_prop_table(),
+    m_prop_counter(0),
+    m_is_interrupted(false),
+    m_deadline()
   {
     assert(!MSAT_ERROR_CONFIG(m_config));
     assert(!MSAT_ERROR_ENV(m_env));
 
     MSAT_MAKE_ERROR_TERM(m_term);
+
+    const int status = msat_set_termination_test(m_env, is_terminated, this);
+    assert(status == 0);
   }
 
   MsatSolver(Logic logic)
@@ -1250,12 +1304,19 @@ public:
     m_config(msat_create_default_config(Logics::acronyms[logic])),
     m_env(msat_create_env(m_config)),
     m_term(),
-    m_term_map()
+    m_term_table(),
+    m_prop_table(),
+    m_prop_counter(0),
+    m_is_interrupted(false),
+    m_deadline()
   {
     assert(!MSAT_ERROR_CONFIG(m_config));
     assert(!MSAT_ERROR_ENV(m_env));
 
     MSAT_MAKE_ERROR_TERM(m_term);
+
+    const int status = msat_set_termination_test(m_env, is_terminated, this);
+    assert(status == 0);
   }
 
   ~MsatSolver()
@@ -0,0 +1,120 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_POOL_H_
+#define __SMT_POOL_H_
+
+#include "smt.h"
+
+#ifdef ENABLE_CONCURRENCY
+
+#include <deque>
+#include <future>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace smt
+{
+
+/// Worker threads that check queries asynchronously
+
+/// Each solver of the pool is used by a worker thread of its own. A
+/// query is a set of assertions, which check_async() copies, so the
+/// caller can build the terms of the next query while the previous
+/// queries are checked. Queries are assigned to idle workers in the
+/// order in which they are submitted.
+///
+/// Before every query, the worker's solver is reset. Backend contexts
+/// are therefore constructed only once, and solvers that cache encoded
+/// expressions across reset(), such as Z3Solver, reuse them for terms
+/// that are shared between queries.
+///
+/// Timeouts and other options must be set on the solvers before they
+/// are passed to the pool.
+///
+/// Since expressions are shared between threads, this class is only
+/// available if ENABLE_CONCURRENCY is defined.
+class SolverPool
+{
+public:
+  struct PoolStats
+  {
+    /// Number of queries passed to check_async()
+    uint64_t queries;
+
+    /// Queries that had to wait because all workers were busy
+    uint64_t queued_queries;
+  };
+
+private:
+  struct Job
+  {
+    Bools assertions;
+    std::promise<CheckResult> promise;
+  };
+
+  const std::vector<Solver*> m_solvers;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+
+  // signals a new job or m_stop to the workers
+  std::condition_variable m_job_cond;
+
+  // signals the end of a job to the destructor
+  std::condition_variable m_done_cond;
+
+  // all members below are guarded by m_mutex
+  std::deque<Job> m_jobs;
+  bool m_stop;
+
+  // workers that wait for a job
+  size_t m_idle;
+
+  // workers that are checking a query, only these are interrupted
+  std::vector<bool> m_busy;
+
+  PoolStats m_pool_stats;
+
+  void run(size_t index);
+
+  std::future<CheckResult> submit(Job&& job);
+
+public:
+  /// Check queries with the given solvers, which must be distinct
+
+  /// The solvers are not owned by the pool, must outlive it and must
+  /// not be used otherwise while it exists.
+  ///
+  /// \pre: !solvers.empty()
+  SolverPool(const std::vector<Solver*>& solvers);
+
+  SolverPool(const SolverPool&) = delete;
+
+  /// Interrupts running queries until they return and joins all
+  /// worker threads
+
+  /// Queries that have not started yet are unknown.
+  ~SolverPool();
+
+  size_t size() const
+  {
+    return m_solvers.size();
+  }
+
+  /// Check the conjunction of the assertions on the next idle worker
+
+  /// Exceptions thrown by the backend are stored in the future.
+  std::future<CheckResult> check_async(const Bools& assertions);
+  std::future<CheckResult> check_async(Bools&& assertions);
+
+  PoolStats pool_stats();
+};
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_PORTFOLIO_H_
+#define __SMT_PORTFOLIO_H_
+
+#include "smt.h"
+
+#ifdef ENABLE_CONCURRENCY
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace smt
+{
+
+/// Decorator that races several solvers on the same assertions
+
+/// Every assertion is added to all solvers on the caller's thread. Each
+/// solver has its own worker thread, and check() returns the first sat
+/// or unsat result of any of them, after which the other solvers are
+/// interrupted, see Solver::interrupt(). The result is unknown only if
+/// all solvers return unknown.
+///
+/// check() does not wait for the interrupted solvers. Instead, the next
+/// call of any function that modifies the solvers waits for them, so
+/// the caller can already build the terms of the next query.
+///
+/// Since expressions are shared between threads, this decorator is only
+/// available if ENABLE_CONCURRENCY is defined.
+class PortfolioSolver : public internal::DecoratorSolver
+{
+public:
+  struct PortfolioStats
+  {
+    /// Number of sat or unsat results that were returned first, indexed
+    /// like the solvers passed to the constructor
+    std::vector<uint64_t> wins;
+
+    /// Queries for which all solvers returned unknown
+    uint64_t unknowns;
+  };
+
+private:
+  static constexpr size_t s_no_winner = static_cast<size_t>(-1);
+
+  const std::vector<Solver*> m_solvers;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+
+  // signals a new job or m_stop to the workers
+  std::condition_variable m_job_cond;
+
+  // signals a winner or that all workers are done
+  std::condition_variable m_done_cond;
+
+  // incremented for every job, guarded by m_mutex
+  uint64_t m_job;
+  bool m_stop;
+
+  // workers that have not finished the current job
+  size_t m_running;
+
+  // solvers that are inside check() or check_assumptions(), only
+  // these are interrupted so that no interrupt outlives its check
+  std::vector<bool> m_busy;
+
+  // set by interrupt(), cleared by the next job
+  bool m_interrupted;
+
+  // index of the first solver that returned sat or unsat
+  size_t m_winner;
+  CheckResult m_result;
+
+  // inputs and outputs of check_assumptions(), one unsat core and
+  // result size per solver so that slower solvers do not interfere
+  bool m_is_check_assumptions;
+  Bools m_assumptions;
+  std::vector<Bools> m_unsat_cores;
+  std::vector<Bools::SizeType> m_unsat_core_sizes;
+
+  PortfolioStats m_portfolio_stats;
+
+  void run(size_t index);
+
+  // \pre: lock holds m_mutex
+  //
+  // Wait until all workers are done or, if until_winner is true, until
+  // there is a winner. Once the job is decided or interrupted, the busy
+  // solvers are interrupted again every millisecond until they return.
+  void await(std::unique_lock<std::mutex>& lock, bool until_winner);
+
+  // wait for the interrupted solvers of the previous job
+  void wait();
+
+  // \return index of the winner or s_no_winner
+  size_t race();
+
+  // \pre: m_mutex is locked
+  void interrupt_busy();
+
+  virtual void __reset() override;
+  virtual void __push() override;
+  virtual void __pop() override;
+  virtual Error __add(const Bool& condition) override;
+  virtual Error __unsafe_add(const SharedExpr& condition) override;
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+  virtual void __interrupt() override;
+
+  // the losers are waited for, see wait()
+  virtual bool __is_interruptible() const override;
+
+  virtual void __set_timeout(const ElapsedTime timeout) override;
+
+public:
+  /// Race the given solvers, which must be distinct
+
+  /// The solvers are not owned by the decorator, must outlive it and
+  /// must only be used through it while it exists.
+  ///
+  /// \pre: !solvers.empty()
+  PortfolioSolver(const std::vector<Solver*>& solvers);
+
+  PortfolioSolver(const PortfolioSolver&) = delete;
+
+  /// Interrupts and joins all worker threads
+  ~PortfolioSolver();
+
+  const PortfolioStats& portfolio_stats() const
+  {
+    return m_portfolio_stats;
+  }
+};
+
+}
+
+#endif
+
+#endif
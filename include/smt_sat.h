@@ -0,0 +1,269 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_SAT_H_
+#define __SMT_SAT_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "smt.h"
+
+namespace smt
+{
+
+/// Incremental CDCL SAT solver for clauses in conjunctive normal form
+
+/// The search uses two watched literals per clause, first-UIP conflict
+/// analysis with learnt clause minimization, VSIDS variable activities
+/// with phase saving, restarts after a Luby sequence of conflicts and
+/// deletion of inactive learnt clauses.
+///
+/// Clauses can be added between calls of solve(), and each call can
+/// take assumptions, i.e. literals that only hold for that call. If the
+/// clauses conjoined with the assumptions are unsatisfiable, conflict()
+/// returns the assumptions that were needed to derive a contradiction.
+///
+/// There is no ownership of variables or clauses across threads, but
+/// interrupt() may be called from any thread.
+class SatSolver
+{
+public:
+  typedef uint32_t Var;
+
+  /// Twice the variable, plus one if the literal is negative
+  typedef uint32_t Lit;
+
+  static constexpr Lit undef_lit()
+  {
+    return static_cast<Lit>(-1);
+  }
+
+  static constexpr Lit lit(const Var var, const bool is_negative = false)
+  {
+    return 2 * var + static_cast<Lit>(is_negative);
+  }
+
+  static constexpr Var var(const Lit lit)
+  {
+    return lit >> 1;
+  }
+
+  static constexpr bool is_negative(const Lit lit)
+  {
+    return lit & 1;
+  }
+
+  static constexpr Lit negate(const Lit lit)
+  {
+    return lit ^ 1;
+  }
+
+  struct Stats
+  {
+    uint64_t decisions;
+    uint64_t propagations;
+    uint64_t conflicts;
+    uint64_t restarts;
+
+    /// Learnt clauses that have been removed by clause deletion
+    uint64_t deleted_clauses;
+  };
+
+  /// Polled during solve(), which returns unknown if it returns true
+  typedef bool (*TerminationTest)(void* user_data);
+
+private:
+  typedef uint32_t ClauseRef;
+
+  static constexpr ClauseRef s_no_reason = static_cast<ClauseRef>(-1);
+
+  // truth values of literals, indexed by Lit
+  static constexpr int8_t s_true = 1;
+  static constexpr int8_t s_false = -1;
+  static constexpr int8_t s_undef = 0;
+
+  struct Clause
+  {
+    // the first two literals are watched
+    std::vector<Lit> lits;
+    double activity;
+    bool is_learnt;
+  };
+
+  struct Watcher
+  {
+    ClauseRef cref;
+
+    // some other literal of the clause; if it is true, the clause need
+    // not be visited at all
+    Lit blocker;
+  };
+
+  // false if the clauses are unsatisfiable without assumptions
+  bool m_ok;
+
+  std::vector<Clause> m_clauses;
+  std::vector<ClauseRef> m_free_clauses;
+  std::vector<ClauseRef> m_learnts;
+
+  // indexed by Lit, clauses in which the literal is watched
+  std::vector<std::vector<Watcher>> m_watches;
+
+  // indexed by Lit
+  std::vector<int8_t> m_values;
+
+  // indexed by Var
+  std::vector<unsigned> m_levels;
+  std::vector<ClauseRef> m_reasons;
+  std::vector<double> m_activities;
+  std::vector<bool> m_phases;
+  std::vector<bool> m_seen;
+
+  std::vector<Lit> m_trail;
+  std::vector<size_t> m_trail_lims;
+  size_t m_qhead;
+
+  // binary max-heap of unassigned variables ordered by activity
+  std::vector<Var> m_heap;
+  std::vector<int> m_heap_indices;
+
+  double m_var_inc;
+  double m_clause_inc;
+  double m_max_learnts;
+
+  std::vector<Lit> m_assumptions;
+  std::vector<Lit> m_conflict;
+
+  // model of the last satisfiable solve(), indexed by Var
+  std::vector<bool> m_model;
+
+  TerminationTest m_termination_test;
+  void* m_termination_data;
+
+  Stats m_stats;
+
+  int8_t value(const Lit lit) const
+  {
+    return m_values[lit];
+  }
+
+  unsigned decision_level() const
+  {
+    return m_trail_lims.size();
+  }
+
+  bool is_terminated() const
+  {
+    return m_termination_test != nullptr &&
+      m_termination_test(m_termination_data);
+  }
+
+  void heap_up(size_t i);
+  void heap_down(size_t i);
+  void heap_insert(Var var);
+  Var heap_pop();
+
+  void bump_var(Var var);
+  void bump_clause(Clause& clause);
+
+  ClauseRef alloc_clause(std::vector<Lit>&& lits, bool is_learnt);
+  void attach_clause(ClauseRef cref);
+  bool is_locked(ClauseRef cref) const;
+  void reduce_learnts();
+
+  void enqueue(Lit lit, ClauseRef reason);
+  void cancel_until(unsigned level);
+
+  // \return conflicting clause, or s_no_reason
+  ClauseRef propagate();
+
+  void analyze(ClauseRef conflict, std::vector<Lit>& learnt,
+    unsigned& backtrack_level);
+
+  bool is_redundant(Lit lit) const;
+
+  // sets m_conflict to the assumptions that imply the negation of lit
+  void analyze_final(Lit lit);
+
+  Lit pick_branch_lit();
+
+  enum SearchResult { SEARCH_SAT, SEARCH_UNSAT, SEARCH_UNKNOWN, SEARCH_RESTART };
+
+  SearchResult search(uint64_t max_conflicts);
+
+public:
+  SatSolver();
+
+  SatSolver(const SatSolver&) = delete;
+
+  Var new_var();
+
+  size_t vars_size() const
+  {
+    return m_levels.size();
+  }
+
+  /// Add the disjunction of the literals
+
+  /// Must not be called during solve().
+  ///
+  /// \return false if the clauses have become unsatisfiable
+  bool add_clause(std::vector<Lit> lits);
+
+  bool add_clause(const Lit a)
+  {
+    return add_clause(std::vector<Lit>{a});
+  }
+
+  bool add_clause(const Lit a, const Lit b)
+  {
+    return add_clause(std::vector<Lit>{a, b});
+  }
+
+  bool add_clause(const Lit a, const Lit b, const Lit c)
+  {
+    return add_clause(std::vector<Lit>{a, b, c});
+  }
+
+  /// Check the clauses conjoined with the assumptions
+
+  /// Returns unknown if the termination test holds.
+  CheckResult solve(const std::vector<Lit>& assumptions);
+
+  CheckResult solve()
+  {
+    return solve(std::vector<Lit>());
+  }
+
+  /// After solve() has returned unsat, a subset of its assumptions whose
+  /// conjunction with the clauses is unsatisfiable
+
+  /// It is empty if the clauses alone are unsatisfiable.
+  const std::vector<Lit>& conflict() const
+  {
+    return m_conflict;
+  }
+
+  /// After solve() has returned sat, the value of the variable
+  bool model_value(const Var var) const
+  {
+    return var < m_model.size() && m_model[var];
+  }
+
+  void set_termination_test(TerminationTest test, void* const user_data)
+  {
+    m_termination_test = test;
+    m_termination_data = user_data;
+  }
+
+  const Stats& stats() const
+  {
+    return m_stats;
+  }
+};
+
+}
+
+#endif
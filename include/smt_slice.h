@@ -0,0 +1,334 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_SLICE_H_
+#define __SMT_SLICE_H_
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "smt.h"
+
+namespace smt
+{
+
+/// Decorator that checks independent groups of assertions separately
+
+/// Two assertions depend on each other if they share a constant or an
+/// uninterpreted function, possibly through other assertions. check()
+/// partitions the assertions into groups of dependent assertions with
+/// union-find, and the assertions are satisfiable exactly if each group
+/// is. This is the constraint independence optimization of KLEE.
+///
+/// The constants of every assertion are collected once by a traversal
+/// of its DAG and kept until the assertion is popped or the solver is
+/// reset. The group of the most recently added assertion is checked
+/// first, because the other groups are typically unchanged since the
+/// previous check() and their results can be reused.
+///
+/// Every group is checked in the decorated solver after it has been
+/// reset, so the decorated solver may itself be a CachingSolver. Thus,
+/// each group whose result cannot be reused costs a reset() and the
+/// addition of all its assertions, and the decorated solver forgets
+/// what it has learnt about them. Groups cannot be kept in push() and
+/// pop() scopes of their own because a new assertion may merge groups.
+/// The cost is small for solvers that keep their encoding of shared
+/// terms across reset(), such as Z3Solver.
+class SlicingSolver : public Solver
+{
+public:
+  struct SliceStats
+  {
+    /// Number of calls of check()
+    uint64_t checks;
+
+    /// Sum of the number of assertions at each check()
+    uint64_t query_assertions;
+
+    /// Groups that were passed to the decorated solver
+    uint64_t solved_slices;
+
+    /// Sum of the number of assertions of all solved groups
+    uint64_t slice_assertions;
+
+    /// Groups whose result of the previous check() was reused
+    uint64_t reused_slices;
+
+    double average_query_size() const
+    {
+      return checks == 0 ? 0.0 :
+        static_cast<double>(query_assertions) / checks;
+    }
+
+    double average_slice_size() const
+    {
+      return solved_slices == 0 ? 0.0 :
+        static_cast<double>(slice_assertions) / solved_slices;
+    }
+  };
+
+private:
+  typedef std::vector<const UnsafeDecl*> Decls;
+
+  struct DeclHash
+  {
+    size_t operator()(const UnsafeDecl* const decl) const
+    {
+      return decl->hash();
+    }
+  };
+
+  struct DeclEqual
+  {
+    bool operator()(
+      const UnsafeDecl* const x,
+      const UnsafeDecl* const y) const
+    {
+      return *x == *y;
+    }
+  };
+
+  struct SliceHash
+  {
+    size_t operator()(const SharedExprs& slice) const;
+  };
+
+  struct SliceEqual
+  {
+    bool operator()(const SharedExprs& x, const SharedExprs& y) const;
+  };
+
+  typedef std::unordered_map<SharedExprs, CheckResult,
+    SliceHash, SliceEqual> SliceResults;
+
+  Solver& m_solver;
+
+  // constants and functions of the assertions in the order in which
+  // they were added, which are owned by subexpressions of them; a
+  // prefix of assertions() because pop() truncates it
+  std::vector<Decls> m_term_decls;
+
+  // used while an assertion is being traversed
+  std::unordered_set<const Expr*> m_visited;
+  Decls m_decls;
+
+  // results of the groups of the previous check()
+  SliceResults m_slice_results;
+
+  SliceStats m_slice_stats;
+
+  // set by __interrupt(), cleared when the next check() starts
+  std::atomic<bool> m_is_interrupted;
+
+  // constants and functions of the i-th assertion
+  //
+  // \pre: the constants of all earlier assertions have been collected
+  const Decls& decls(size_t i);
+
+  Error visit(const Expr* const expr)
+  {
+    m_visited.insert(expr);
+    return OK;
+  }
+
+#define SMT_SLICE_ENCODE_BUILTIN_LITERAL(type)                                 \
+  virtual Error __encode_literal(                                              \
+    const Expr* const expr,                                                    \
+    type literal) override                                                     \
+  {                                                                            \
+    return visit(expr);                                                        \
+  }                                                                            \
+
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(bool)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(char)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(short)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(int)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(long)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(long long)
+SMT_SLICE_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+  virtual Error __encode_constant(
+    const Expr* const expr,
+    const UnsafeDecl& decl) override
+  {
+    m_decls.push_back(&decl);
+    return visit(expr);
+  }
+
+  virtual Error __encode_func_app(
+    const Expr* const expr,
+    const UnsafeDecl& func_decl,
+    const size_t arity,
+    const SharedExpr* const args) override
+  {
+    m_decls.push_back(&func_decl);
+    return visit(expr);
+  }
+
+  virtual Error __encode_const_array(
+    const Expr* const expr,
+    const SharedExpr& init) override
+  {
+    return visit(expr);
+  }
+
+  virtual Error __encode_array_select(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index) override
+  {
+    return visit(expr);
+  }
+
+  virtual Error __encode_array_store(
+    const Expr* const expr,
+    const SharedExpr& array,
+    const SharedExpr& index,
+    const SharedExpr& value) override
+  {
+    return visit(expr);
+  }
+
+#define SMT_SLICE_ENCODE_UNARY(name)                                           \
+  virtual Error __encode_unary_##name(                                         \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg) override                                            \
+  {                                                                            \
+    return visit(expr);                                                        \
+  }                                                                            \
+
+#define SMT_SLICE_ENCODE_BINARY(name)                                          \
+  virtual Error __encode_binary_##name(                                        \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg) override                                           \
+  {                                                                            \
+    return visit(expr);                                                        \
+  }                                                                            \
+
+SMT_SLICE_ENCODE_UNARY(lnot)
+SMT_SLICE_ENCODE_UNARY(not)
+SMT_SLICE_ENCODE_UNARY(sub)
+
+SMT_SLICE_ENCODE_BINARY(sub)
+SMT_SLICE_ENCODE_BINARY(and)
+SMT_SLICE_ENCODE_BINARY(or)
+SMT_SLICE_ENCODE_BINARY(xor)
+SMT_SLICE_ENCODE_BINARY(lshl)
+SMT_SLICE_ENCODE_BINARY(lshr)
+SMT_SLICE_ENCODE_BINARY(land)
+SMT_SLICE_ENCODE_BINARY(lor)
+SMT_SLICE_ENCODE_BINARY(imp)
+SMT_SLICE_ENCODE_BINARY(eql)
+SMT_SLICE_ENCODE_BINARY(add)
+SMT_SLICE_ENCODE_BINARY(mul)
+SMT_SLICE_ENCODE_BINARY(quo)
+SMT_SLICE_ENCODE_BINARY(rem)
+SMT_SLICE_ENCODE_BINARY(lss)
+SMT_SLICE_ENCODE_BINARY(gtr)
+SMT_SLICE_ENCODE_BINARY(neq)
+SMT_SLICE_ENCODE_BINARY(leq)
+SMT_SLICE_ENCODE_BINARY(geq)
+
+  virtual Error __encode_nary(
+    const Expr* const expr,
+    Opcode opcode,
+    const SharedExprs& args) override
+  {
+    return visit(expr);
+  }
+
+  virtual Error __encode_bv_zero_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override
+  {
+    return visit(expr);
+  }
+
+  virtual Error __encode_bv_sign_extend(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned ext) override
+  {
+    return visit(expr);
+  }
+
+  virtual Error __encode_bv_extract(
+    const Expr* const expr,
+    const SharedExpr& bv,
+    const unsigned high,
+    const unsigned low) override
+  {
+    return visit(expr);
+  }
+
+  virtual bool __is_encoded(const Expr* const expr) const override
+  {
+    return m_visited.find(expr) != m_visited.cend();
+  }
+
+  // assertions are only passed to the decorated solver by check()
+  virtual void __reset() override;
+  virtual void __push() override {}
+  virtual void __pop() override;
+
+  virtual Error __add(const Bool& condition) override
+  {
+    return OK;
+  }
+
+  virtual Error __unsafe_add(const SharedExpr& condition) override
+  {
+    return OK;
+  }
+
+  virtual CheckResult __check() override;
+
+  virtual std::pair<CheckResult, SharedExprs::size_type>
+  __check_assumptions(
+    const SharedExprs& assumptions,
+    SharedExprs& unsat_core) override;
+
+  // no further slices are solved once check() has been interrupted
+  virtual void __interrupt() override
+  {
+    m_is_interrupted.store(true);
+    m_solver.interrupt();
+  }
+
+  virtual bool __is_interruptible() const override
+  {
+    return m_solver.is_interruptible();
+  }
+
+  // each slice is checked with the time limit of a whole check()
+  virtual void __set_timeout(const ElapsedTime timeout) override
+  {
+    m_solver.set_timeout(timeout);
+  }
+
+public:
+  /// The decorated solver must outlive the decorator
+  SlicingSolver(Solver& solver);
+
+  SlicingSolver(const SlicingSolver&) = delete;
+
+  const SliceStats& slice_stats() const
+  {
+    return m_slice_stats;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,338 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_SMTLIB_H_
+#define __SMT_SMTLIB_H_
+
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "smt.h"
+
+namespace smt
+{
+
+namespace internal
+{
+  class SmtLibNodes;
+}
+
+/// Streaming writer of SMT-LIB 2 scripts
+
+/// Every subexpression is visited exactly once and printed with an
+/// explicit stack, so the output of a DAG is linear in its number of
+/// nodes, regardless of its depth. A subexpression that occurs more
+/// than once is printed once and then referred to by a name:
+///
+/// - write_term() binds shared subterms with let, grouped so that each
+///   let only refers to the names bound by the enclosing ones;
+/// - write_assertions() binds them with define-fun since subterms may
+///   be shared by several assertions.
+///
+/// Constants and functions are declared on first use. Characters are
+/// collected in a buffer that is written to the stream in large chunks.
+class SmtLibWriter
+{
+private:
+  static constexpr size_t s_buffer_size = 1 << 16;
+
+  std::ostream& m_out;
+  std::string m_buffer;
+
+  // symbols that have already been declared
+  std::unordered_set<std::string> m_declared;
+
+  // suffix of the next name bound by define-fun
+  unsigned m_define_counter;
+
+  void put(const char c)
+  {
+    m_buffer.push_back(c);
+  }
+
+  void put(const char* const chars)
+  {
+    m_buffer.append(chars);
+  }
+
+  void put(const std::string& chars)
+  {
+    m_buffer.append(chars);
+  }
+
+  // flush the buffer if it is full
+  void flush_if_full()
+  {
+    if (m_buffer.size() >= s_buffer_size)
+      flush();
+  }
+
+  void write_sort(const Sort& sort);
+
+  // declare-fun of every symbol that has not yet been declared
+  void write_declarations(const internal::SmtLibNodes& nodes);
+
+  // name of a bound node, or the node itself if is_body is true
+  void write_node(
+    const internal::SmtLibNodes& nodes,
+    uint32_t index,
+    bool is_body);
+
+public:
+  /// out must outlive the writer
+  SmtLibWriter(std::ostream& out);
+
+  /// Flushes the buffer
+  ~SmtLibWriter();
+
+  SmtLibWriter(const SmtLibWriter&) = delete;
+
+  void write_logic(Logic logic);
+
+  /// Declare all new symbols, then assert every condition
+
+  /// \pre: every condition is Boolean
+  Error write_assertions(const SharedExprs& conditions);
+
+  Error write_assertions(const Bools& conditions)
+  {
+    return write_assertions(conditions.terms);
+  }
+
+  /// Term with let bindings, symbols must have been declared
+  Error write_term(const SharedExpr& expr);
+
+  void write_check_sat();
+
+  /// Write the buffer to the stream
+
+  /// \returns IO_ERROR if the stream is in a failed state
+  Error flush();
+};
+
+/// SMT-LIB 2 script of all assertions of the solver, followed by check-sat
+Error write_smtlib(std::ostream& out, const Solver& solver);
+
+/// Single-pass parser of SMT-LIB 2 scripts into hash-consed expressions
+
+/// Terms are parsed with an explicit stack rather than by recursion, so
+/// the nesting depth of a term is only bounded by the available memory.
+/// Every symbol is resolved while its term is parsed; the expressions
+/// are built with make_shared_expr() and thus share all subterms that
+/// are equal, including those bound by let.
+///
+/// SMT-LIB 2 does not distinguish signed from unsigned bit vectors, so
+/// all bit-vector terms have unsigned sorts. Signed operations such as
+/// bvslt are applied to signed views of their arguments, which are
+/// extractions of all their bits.
+///
+/// Assertions, push, pop and check-sat are forwarded to the solver, if
+/// any, as soon as they are parsed. The following are not supported:
+/// ite, concat, bvashr, mod, single-bit extractions, bit-vector literals
+/// wider than 64 bits, and define-fun with parameters.
+class SmtLibParser
+{
+private:
+  enum TokenKind : uint8_t
+  {
+    LPAREN_TOKEN,
+    RPAREN_TOKEN,
+    SYMBOL_TOKEN,
+    KEYWORD_TOKEN,
+    NUMERAL_TOKEN,
+    DECIMAL_TOKEN,
+    BINARY_TOKEN,
+    HEX_TOKEN,
+    STRING_TOKEN,
+    END_TOKEN,
+    ERROR_TOKEN
+  };
+
+  enum FrameKind : uint8_t
+  {
+    // arguments of a function or operator
+    APP_FRAME,
+
+    // (let (...) ...) before and after the list of bindings
+    LET_BINDINGS_FRAME,
+    LET_BODY_FRAME,
+
+    // (name term) in the bindings of a let
+    LET_BINDING_FRAME,
+
+    // (! term :attribute ...)
+    ANNOTATION_FRAME
+  };
+
+  struct Frame
+  {
+    FrameKind kind;
+
+    // operator of an application, see smt_smtlib.cpp
+    uint8_t op;
+
+    // start of the arguments in m_args
+    uint32_t args_begin;
+
+    // extract, zero_extend and sign_extend, or first let name
+    uint32_t indices[2];
+
+    // declared function or constant array sort, if any
+    const void* ptr;
+  };
+
+  struct Declaration
+  {
+    UnsafeDecl decl;
+
+    // constant expression or definition, null if decl is a function
+    SharedExpr term;
+  };
+
+  struct Scope
+  {
+    size_t decl_names_size;
+    size_t assertions_size;
+  };
+
+  Solver* const m_solver;
+
+  // input of parse()
+  const char* m_begin;
+  const char* m_pos;
+  const char* m_end;
+
+  // last token read by next_token()
+  TokenKind m_token_kind;
+  const char* m_token;
+  size_t m_token_size;
+
+  // line of the token where parsing failed
+  size_t m_error_line;
+
+  // reused key of hash table lookups
+  std::string m_key;
+
+  std::vector<Frame> m_frames;
+  SharedExprs m_args;
+
+  // names bound by enclosing let terms, innermost binding last
+  std::vector<std::string> m_let_names;
+  std::unordered_map<std::string, SharedExprs> m_lets;
+
+  std::unordered_map<std::string, Declaration> m_decls;
+
+  // in the order in which they were declared, see Scope
+  std::vector<std::string> m_decl_names;
+
+  std::vector<Scope> m_scopes;
+  SharedExprs m_assertions;
+  std::vector<CheckResult> m_check_results;
+
+  void next_token();
+
+  template<size_t N>
+  bool is_token(const char (&chars)[N]) const
+  {
+    return m_token_kind == SYMBOL_TOKEN && m_token_size == N - 1 &&
+      std::memcmp(m_token, chars, N - 1) == 0;
+  }
+
+  // sets m_error_line to the line of the current token
+  Error error(Error err);
+
+  Error expect(TokenKind kind);
+  Error token_numeral(unsigned long long& numeral);
+  Error parse_index(uint32_t& index);
+
+  // the first token of the sort has already been read
+  Error parse_sort(const Sort*& sort);
+
+  // rest of an s-expression whose opening parenthesis has been read
+  Error skip_sexpr();
+  Error skip_attributes();
+
+  Error parse_atom(SharedExpr& term);
+  Error parse_bv_literal(SharedExpr& term);
+  Error parse_indexed_head(Frame& frame);
+
+  // term is null unless the application is an indexed or negative literal
+  Error open_term(SharedExpr& term);
+
+  // term is null if the frame is part of a let
+  Error close_frame(SharedExpr& term);
+
+  Error apply(
+    const Frame& frame,
+    SharedExpr* args,
+    size_t size,
+    SharedExpr& term);
+
+  Error parse_term(SharedExpr& term);
+
+  // definition is null for declare-fun and declare-const
+  Error declare(
+    std::string&& name,
+    const Sort& sort,
+    const SharedExpr* definition);
+
+  // the opening parenthesis has already been read
+  Error parse_command();
+
+  void pop_scope();
+
+public:
+  /// If solver is not null, it must outlive the parser
+  SmtLibParser(Solver* solver = nullptr);
+
+  SmtLibParser(const SmtLibParser&) = delete;
+
+  /// Execute all commands of an SMT-LIB 2 script
+
+  /// Declarations and assertions remain in scope for subsequent
+  /// calls, so a script can be parsed in several pieces of complete
+  /// commands.
+  ///
+  /// \returns FORMAT_ERROR if the script is malformed or uses an
+  ///   undeclared symbol, UNSUPPORT_ERROR if it uses features that
+  ///   have no counterpart in smt-kit, see error_line()
+  Error parse(const char* data, size_t size);
+
+  Error parse(const std::string& script)
+  {
+    return parse(script.data(), script.size());
+  }
+
+  /// \returns IO_ERROR if the file cannot be read
+  Error parse_file(const std::string& path);
+
+  /// Parse a single term over the symbols declared so far
+  Error parse_term(const std::string& text, SharedExpr& term);
+
+  /// Assertions of all scopes that have not been popped
+  const SharedExprs& assertions() const
+  {
+    return m_assertions;
+  }
+
+  /// Result of every check-sat, or unknown if there is no solver
+  const std::vector<CheckResult>& check_results() const
+  {
+    return m_check_results;
+  }
+
+  /// Line, starting at one, at which the last parse failed
+  size_t error_line() const
+  {
+    return m_error_line;
+  }
+};
+
+}
+
+#endif
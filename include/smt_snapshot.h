@@ -0,0 +1,182 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#ifndef __SMT_SNAPSHOT_H_
+#define __SMT_SNAPSHOT_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "smt.h"
+
+namespace smt
+{
+
+namespace internal
+{
+  /// First bytes of every snapshot
+
+  /// All integers are stored in the byte order of the machine that wrote
+  /// the snapshot; the byte_order field detects a mismatch.
+  struct SnapshotHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t sorts_size;
+    uint32_t sort_args_size;
+    uint32_t symbols_size;
+    uint32_t nodes_size;
+    uint32_t children_size;
+    uint32_t roots_size;
+    uint32_t strings_size;
+
+    // sizes of long and wchar_t, whose literals are stored
+    uint32_t type_sizes;
+  };
+
+  /// Sort whose sort arguments, if any, precede it in the sort table
+  struct SnapshotSort
+  {
+    uint8_t kind;
+    uint8_t is_signed;
+    uint16_t reserved;
+    uint32_t bv_size;
+
+    // range in the sort argument table
+    uint32_t args_begin;
+    uint32_t args_size;
+  };
+
+  /// Declaration of a constant or function
+  struct SnapshotSymbol
+  {
+    uint32_t sort;
+
+    // range in the string table, either a prefix or a name
+    uint32_t string_begin;
+    uint32_t string_size;
+
+    // zero unless is_prefix is nonzero
+    uint32_t counter;
+    uint32_t is_prefix;
+  };
+}
+
+/// Flattened expression DAGs that can be written to a file and mapped
+
+/// A snapshot stores every distinct subexpression of a set of roots
+/// exactly once. Nodes are kept as a structure of arrays in post-order,
+/// so every node refers to its arguments by the 32-bit indexes of
+/// earlier nodes. Sorts and declarations are interned in tables of
+/// their own, and all names are kept in a single string table.
+///
+/// Since a snapshot contains no pointers, it can be written to a file,
+/// mapped read-only into memory and loaded into hash-consed expressions
+/// without parsing. The format is specific to the machine and build
+/// (e.g. the size of long) that wrote it, which load() checks.
+///
+/// Declarations with a prefix (see UnsafeDecl) are only equal to the
+/// declarations of the program that loads the snapshot if the program
+/// passes its prefix addresses to load(); other prefixes are interned
+/// as new strings that are never freed. The same holds for array and
+/// function sorts, which are equal to statically allocated sorts of the
+/// same structure.
+class Snapshot
+{
+private:
+  // aligned owned storage, empty if the snapshot is mapped or viewed
+  std::vector<uint64_t> m_buffer;
+
+  const char* m_data;
+  size_t m_size;
+
+  // nonzero if m_data must be unmapped
+  size_t m_mapped_size;
+
+  const internal::SnapshotHeader* m_header;
+  const internal::SnapshotSort* m_sorts;
+  const uint32_t* m_sort_args;
+  const internal::SnapshotSymbol* m_symbols;
+  const uint8_t* m_node_kinds;
+  const uint8_t* m_node_opcodes;
+  const uint32_t* m_node_sorts;
+
+  // nodes_size + 1 offsets into m_children
+  const uint32_t* m_node_children;
+
+  // literal value, symbol or parameters of bit vector operations
+  const uint64_t* m_node_payloads;
+
+  const uint32_t* m_children;
+  const uint32_t* m_roots;
+  const char* m_strings;
+
+  void unmap();
+
+  // set the table pointers and validate them
+  Error attach(const char* data, size_t size);
+
+public:
+  Snapshot();
+  Snapshot(Snapshot&&);
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(Snapshot&&);
+
+  ~Snapshot();
+
+  /// Flatten the DAGs of all roots
+  Error build(const SharedExprs& roots);
+
+  /// Map a file written by write()
+  Error map(const std::string& path);
+
+  /// Refer to a snapshot in memory that is not owned and must outlive it
+
+  /// \pre: data is 8-byte aligned
+  Error view(const void* const data, const size_t size);
+
+  Error write(const std::string& path) const;
+
+  /// Recreate the roots in the order they were given to build()
+
+  /// Prefixes are matched by their contents with those of the declarations
+  /// in the snapshot so that loaded declarations use the given addresses.
+  Error load(
+    SharedExprs& roots,
+    const std::vector<const char*>& prefixes =
+      std::vector<const char*>()) const;
+
+  /// Load the roots, which must be Boolean, and add them to the solver
+  Error add(
+    Solver& solver,
+    const std::vector<const char*>& prefixes =
+      std::vector<const char*>()) const;
+
+  /// Snapshot bytes, e.g. to send them to another process
+  const void* data() const
+  {
+    return m_data;
+  }
+
+  size_t size() const
+  {
+    return m_size;
+  }
+
+  size_t nodes_size() const
+  {
+    return m_header == nullptr ? 0 : m_header->nodes_size;
+  }
+
+  size_t roots_size() const
+  {
+    return m_header == nullptr ? 0 : m_header->roots_size;
+  }
+};
+
+}
+
+#endif
@@ -7,15 +7,23 @@
 
 #include "smt.h"
 
-#include <unordered_map>
 #include <cstdint>
 #include <tuple>
+#include <vector>
 
 // avoid name clash
 #define Expr VCExpr
 #include <stp/c_interface.h>
 #undef Expr
 
+// Recent versions of STP, such as those built by solvers/INSTALL_STP,
+// take a time limit in seconds as the fourth argument of
+// vc_query_with_timeout(). Define SMT_STP_NO_QUERY_TIMEOUT for older
+// versions, whose checks then ignore Solver::set_timeout().
+#ifndef SMT_STP_NO_QUERY_TIMEOUT
+#define SMT_STP_QUERY_TIMEOUT
+#endif
+
 namespace smt
 {
 
@@ -25,26 +33,34 @@ namespace smt
 /// STP interface frees memory automatically.
 ///
 /// \see_also klee/lib/solver/Solver.cpp
-/// \see_also StpSolver::__notify_delete(const Expr * const)
 class StpSolver : public Solver
 {
 private:
   VC m_vc;
   VCExpr m_expr;
 
-  typedef std::unordered_map<uintptr_t, const VCExpr> ExprMap;
-  ExprMap m_expr_map;
+  // Newer versions of STP delete expressions automatically.
+  // If we want to free VCExpr pointers ourselves, we would
+  // have to set EXPRDELETE to zero to avoid double-free errors.
+  // But experiments indicate that this is significantly slower
+  // (sometimes 30X) than letting STP manage its own memory.
+  typedef internal::ExprSideTable<VCExpr> VCExprTable;
+  VCExprTable m_expr_table;
+
+  // negative if there is no time limit
+  int m_timeout_seconds;
+
+  // most queries that check_assumptions() spends on shrinking a core
+  static constexpr size_t s_max_core_queries = 64;
 
   // \return has m_expr been set to cached expression?
   bool find_expr(const Expr* const expr)
   {
-    const ExprMap::const_iterator citer = m_expr_map.find(
-      reinterpret_cast<uintptr_t>(expr));
-
-    if (citer == m_expr_map.cend())
+    const VCExpr* const vc_expr_ptr = m_expr_table.find(expr);
+    if (vc_expr_ptr == nullptr)
       return false;
 
-    m_expr = citer->second;
+    m_expr = *vc_expr_ptr;
     return true;
   }
 
@@ -52,10 +68,7 @@ private:
   void cache_expr(const Expr* const expr, const VCExpr vc_expr)
   {
     m_expr = vc_expr;
-
-    bool ok = std::get<1>(m_expr_map.emplace(
-      reinterpret_cast<uintptr_t>(expr), vc_expr));
-    assert(ok);
+    m_expr_table.insert(expr, vc_expr);
   }
   
   template<typename T>
@@ -995,24 +1008,16 @@ SMT_STP_ENCODE_BV_LITERAL(unsigned long long)
     return OK;
   }
 
-  virtual void __notify_delete(const Expr* const expr) override
+  virtual bool __is_encoded(const Expr* const expr) const override
   {
-    // Newer versions of STP delete expressions automatically.
-    // If we want to free VCExpr pointers ourselves, we would
-    // have to set EXPRDELETE to zero to avoid double-free errors.
-    // But experiments indicate that this is significantly slower
-    // (sometimes 30X) than letting STP manage its own memory.
-    //
-    // We still erase the entry from m_expr_map so a new
-    // expression at the same address is cached correctly.
-    m_expr_map.erase(reinterpret_cast<uintptr_t>(expr));
+    return m_expr_table.find(expr) != nullptr;
   }
 
   virtual void __reset() override
   {
     vc_Destroy(m_vc);
     m_vc = vc_createValidityChecker();
-    m_expr_map.clear();
+    m_expr_table.clear();
   }
 
   virtual void __push() override
@@ -1040,11 +1045,16 @@ SMT_STP_ENCODE_BV_LITERAL(unsigned long long)
     return __unsafe_add(condition);
   }
 
-  virtual CheckResult __check() override
+  // "\phi implies false" is equivalent to "not(\phi)"
+  // where \phi is the conjunction of assertFormula()
+  CheckResult query()
   {
-    // "\phi implies false" is equivalent to "not(\phi)"
-    // where \phi is the conjunction of assertFormula()
+#ifdef SMT_STP_QUERY_TIMEOUT
+    const int result = vc_query_with_timeout(m_vc, vc_falseExpr(m_vc),
+      -1, m_timeout_seconds);
+#else
     const int result = vc_query(m_vc, vc_falseExpr(m_vc));
+#endif
 
     switch(result)
     {
@@ -1058,12 +1068,115 @@ SMT_STP_ENCODE_BV_LITERAL(unsigned long long)
     }
   }
 
+  // \return query() of the assertions conjoined with the core and the
+  //   first n assumptions, all of which are retracted afterwards
+  CheckResult query(
+    const std::vector<VCExpr>& vc_core,
+    const std::vector<VCExpr>& vc_assumptions,
+    const size_t n)
+  {
+    assert(n <= vc_assumptions.size());
+
+    vc_push(m_vc);
+    for (const VCExpr vc_expr : vc_core)
+      vc_assertFormula(m_vc, vc_expr);
+
+    for (size_t i = 0; i < n; ++i)
+      vc_assertFormula(m_vc, vc_assumptions[i]);
+
+    const CheckResult result = query();
+    vc_pop(m_vc);
+    return result;
+  }
+
+  virtual CheckResult __check() override
+  {
+    return query();
+  }
+
+  // STP has no unsat core API, nor can it tell which activation literals
+  // a refutation used, so a binary search finds the shortest prefix of
+  // the assumptions that is unsat together with the core found so far.
+  // The last assumption of that prefix belongs to the core, and the
+  // search repeats on the assumptions before it. Core elements are
+  // therefore found from the highest index downwards, each with O(log n)
+  // queries, and each query asserts the core and the prefix again.
+  //
+  // A core of k assumptions thus costs O(k log n) queries. After
+  // s_max_core_queries, the search stops and the remaining prefix is
+  // added to the core as a whole, which is still unsat but not minimal.
   virtual std::pair<CheckResult, SharedExprs::size_type>
   __check_assumptions(
     const SharedExprs& assumptions,
     SharedExprs& unsat_core) override
   {
-    return {unknown, 0};
+    std::vector<VCExpr> vc_assumptions;
+    vc_assumptions.reserve(assumptions.size());
+    for (const SharedExpr& assumption : assumptions)
+    {
+      const Error err = assumption.encode(*this);
+      if (err)
+        return {unknown, 0};
+
+      vc_assumptions.push_back(m_expr);
+    }
+
+    std::vector<VCExpr> vc_core;
+    const CheckResult result = query(vc_core, vc_assumptions,
+      vc_assumptions.size());
+
+    if (result != unsat || unsat_core.empty())
+      return {result, 0};
+
+    // invariant: query(vc_core, vc_assumptions, limit) is unsat
+    size_t limit = vc_assumptions.size();
+    size_t lo, hi, mid;
+    size_t queries = 0;
+    SharedExprs::size_type k = unsat_core.size();
+    while (k != 0 && limit != 0)
+    {
+      if (queries >= s_max_core_queries)
+      {
+        while (k != 0 && limit != 0)
+          unsat_core[--k] = assumptions[--limit];
+
+        break;
+      }
+
+      // smallest n <= limit such that query(vc_core, vc_assumptions, n)
+      // is unsat; unknown counts as sat so that hi is always unsat
+      lo = 0;
+      hi = limit;
+      while (lo < hi)
+      {
+        mid = lo + (hi - lo) / 2;
+        ++queries;
+        if (query(vc_core, vc_assumptions, mid) == unsat)
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+
+      // vc_core alone is unsat
+      if (hi == 0)
+        break;
+
+      limit = hi - 1;
+      unsat_core[--k] = assumptions[limit];
+      vc_core.push_back(vc_assumptions[limit]);
+    }
+
+    return {unsat, unsat_core.size() - k};
+  }
+
+  // STP cannot be interrupted, and its time limit is in whole seconds,
+  // see SMT_STP_QUERY_TIMEOUT
+  virtual void __set_timeout(const ElapsedTime timeout) override
+  {
+    if (timeout == ElapsedTime::zero())
+      m_timeout_seconds = -1;
+    else
+      m_timeout_seconds = static_cast<int>((timeout.count() + 999) / 1000);
   }
 
 public:
@@ -1072,7 +1185,8 @@ public:
   : Solver(),
     m_vc(vc_createValidityChecker()),
     m_expr(),
-    m_expr_map()
+    m_expr_table(),
+    m_timeout_seconds(-1)
   {
     assert(m_vc && "unable to create validity checker");
   }
@@ -1082,7 +1196,8 @@ public:
   : Solver(logic),
     m_vc(vc_createValidityChecker()),
     m_expr(),
-    m_expr_map()
+    m_expr_table(),
+    m_timeout_seconds(-1)
   {
     assert(logic == QF_ABV_LOGIC || logic == QF_BV_LOGIC);
     assert(m_vc && "unable to create validity checker");
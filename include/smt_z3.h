@@ -6,7 +6,22 @@
 #define __SMT_Z3_H_
 
 #include <z3++.h>
+
+#if defined(__has_include)
+#if __has_include(<z3_version.h>)
+#include <z3_version.h>
+#endif
+#endif
+
+// Since Z3 4.8, a context interrupt stays pending after the check that
+// it was meant for and silently discards assertions of the next check
+#if defined(Z3_MAJOR_VERSION) && \
+  (Z3_MAJOR_VERSION > 4 || (Z3_MAJOR_VERSION == 4 && Z3_MINOR_VERSION >= 8))
+#define SMT_Z3_SOLVER_INTERRUPT
+#endif
 #include <vector>
+#include <tuple>
+#include <cstdint>
 
 #include "smt.h"
 
@@ -20,11 +35,52 @@ private:
   z3::solver m_z3_solver;
   z3::expr m_z3_expr;
 
+  // Z3 reference counts every entry so that it outlives m_z3_expr;
+  // entries of deleted expressions are released when they are replaced
+  typedef internal::ExprSideTable<Z3_ast> ASTTable;
+  ASTTable m_ast_table;
+
+  // Activation literal of an assumption, which implies the assumption
+  // in the given scope; the literal is reference counted by Z3
+  struct Prop
+  {
+    Z3_ast ast;
+    Scope scope;
+  };
+
+  typedef internal::ExprSideTable<Prop> PropTable;
+  PropTable m_prop_table;
+
+  // \return has m_z3_expr been set to cached expression?
+  bool find_expr(const Expr* const expr)
+  {
+    const Z3_ast* const ast_ptr = m_ast_table.find(expr);
+    if (ast_ptr == nullptr)
+      return false;
+
+    m_z3_expr = z3::expr(m_z3_context, *ast_ptr);
+    return true;
+  }
+
+  // \pre: not find_expr(expr)
+  void cache_expr(const Expr* const expr)
+  {
+    const Z3_ast ast = m_z3_expr;
+    Z3_inc_ref(m_z3_context, ast);
+
+    const Z3_ast stale_ast = m_ast_table.insert(expr, ast);
+    if (stale_ast != nullptr)
+      Z3_dec_ref(m_z3_context, stale_ast);
+  }
+
   template<typename T>
   Error nocast_encode_literal(
      const Expr* const expr,
      T literal)
   {
+    if (find_expr(expr))
+      return OK;
+
     const Sort& sort = expr->sort();
 
     if (sort.is_bool()) {
@@ -39,6 +95,7 @@ private:
       return UNSUPPORT_ERROR;
     }
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -120,8 +177,30 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     return OK;
   }
 
+  // Z3 only accepts integers up to 2^30 - 1 as symbols
+  static constexpr internal::Symbols::Id s_max_int_symbol = (1U << 30) - 1;
+
+  // Prefixed declarations are interned in the global table on their
+  // first encoding and named by integer symbols, which Z3 keeps apart
+  // from string symbols. Thus, as with UnsafeDecl::operator==(), a
+  // prefixed "x!3" differs from a declaration whose name is "x!3",
+  // whereas backends that only accept string names identify the two.
+  z3::symbol build_symbol(const UnsafeDecl& decl)
+  {
+    if (decl.prefix() != nullptr)
+    {
+      const internal::Symbols::Id id =
+        internal::Symbols::global_intern(decl.prefix(), decl.counter());
+
+      if (id <= s_max_int_symbol)
+        return m_z3_context.int_symbol(id);
+    }
+
+    return m_z3_context.str_symbol(decl.symbol().c_str());
+  }
+
   Error decl_func(
-    const std::string& symbol,
+    const z3::symbol& symbol,
     const Sort& sort,
     z3::func_decl& z3_func_decl)
   {
@@ -144,7 +223,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
       return err;
     }
 
-    z3_func_decl = m_z3_context.function(symbol.c_str(), arity,
+    z3_func_decl = m_z3_context.function(symbol, arity,
       z3_domain_sorts.data(), z3_range_sort);
     return OK;
   }
@@ -153,12 +232,16 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const Expr* const expr,
     const UnsafeDecl& decl) override
   {
+    if (find_expr(expr))
+      return OK;
+
     z3::sort z3_sort(m_z3_context);
     const Error err = build_sort(decl.sort(), z3_sort);
     if (err) {
       return err;
     }
-    m_z3_expr = m_z3_context.constant(decl.symbol().c_str(), z3_sort);
+    m_z3_expr = m_z3_context.constant(build_symbol(decl), z3_sort);
+    cache_expr(expr);
     return OK;
   }
 
@@ -168,9 +251,12 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const size_t arity,
     const SharedExpr* const args) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     z3::func_decl z3_func_decl(m_z3_context);
-    err = decl_func(func_decl.symbol(), func_decl.sort(), z3_func_decl);
+    err = decl_func(build_symbol(func_decl), func_decl.sort(), z3_func_decl);
     if (err) {
       return err;
     }
@@ -186,6 +272,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     }
     m_z3_expr = z3_func_decl(z3_args.size(), z3_args.data());
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -193,6 +280,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const Expr* const expr,
     const SharedExpr& init) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Sort& sort = expr->sort();
     assert(sort.is_array());
 
@@ -208,6 +298,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
       return err;
     }
     m_z3_expr = z3::const_array(z3_domain_sort, m_z3_expr);
+    cache_expr(expr);
     return OK;
   }
 
@@ -216,6 +307,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& array,
     const SharedExpr& index) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
 
     err = array.encode(*this);
@@ -231,6 +325,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr z3_index_expr(m_z3_expr);
 
     m_z3_expr = z3::select(z3_array_expr, z3_index_expr);
+    cache_expr(expr);
     return OK;
   }
 
@@ -240,6 +335,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& index,
     const SharedExpr& value) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
 
     err = array.encode(*this);
@@ -261,6 +359,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr z3_value_expr(m_z3_expr);
 
     m_z3_expr = z3::store(z3_array_expr, z3_index_expr, z3_value_expr);
+    cache_expr(expr);
     return OK;
   }
 
@@ -268,11 +367,15 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
 
     m_z3_expr = !m_z3_expr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -280,11 +383,15 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
 
     m_z3_expr = ~m_z3_expr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -292,11 +399,15 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const Expr* const expr,
     const SharedExpr& arg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = arg.encode(*this);
     if (err)
       return err;
 
     m_z3_expr = -m_z3_expr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -305,6 +416,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -319,6 +433,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr - rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -327,6 +442,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -341,6 +459,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr & rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -349,6 +468,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -363,6 +485,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr | rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -371,6 +494,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -385,6 +511,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr ^ rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -393,6 +520,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -410,6 +540,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     m_z3_expr = z3::expr(m_z3_context,
       Z3_mk_bvshl(m_z3_context, lexpr, rexpr));
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -418,6 +549,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -435,6 +569,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     m_z3_expr = z3::expr(m_z3_context,
       Z3_mk_bvlshr(m_z3_context, lexpr, rexpr));
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -443,6 +578,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -457,6 +595,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr && rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -465,6 +604,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -479,6 +621,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr || rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -487,6 +630,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -501,6 +647,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = implies(lexpr, rexpr);
+    cache_expr(expr);
     return OK;
   }
 
@@ -509,6 +656,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -523,6 +673,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr == rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -531,6 +682,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -545,6 +699,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr + rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -553,6 +708,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -567,6 +725,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr * rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -575,6 +734,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -594,6 +756,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     else
       m_z3_expr = lexpr / rexpr;
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -610,6 +773,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -629,6 +795,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     else
       m_z3_expr = lexpr < rexpr;
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -637,6 +804,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -656,6 +826,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     else
       m_z3_expr = lexpr > rexpr;
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -664,6 +835,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -678,6 +852,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const z3::expr rexpr(m_z3_expr);
 
     m_z3_expr = lexpr != rexpr;
+    cache_expr(expr);
     return OK;
   }
 
@@ -686,6 +861,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -705,6 +883,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     else
       m_z3_expr = lexpr <= rexpr;
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -713,6 +892,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& larg,
     const SharedExpr& rarg) override
   {
+    if (find_expr(expr))
+      return OK;
+
     Error err;
     err = larg.encode(*this);
     if (err)
@@ -732,6 +914,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     else
       m_z3_expr = lexpr >= rexpr;
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -740,6 +923,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     Opcode opcode,
     const SharedExprs& args) override
   {
+    if (find_expr(expr))
+      return OK;
+
     switch (opcode)
     {
     case NEQ:
@@ -781,6 +967,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     for (i = 0; i < args_size; i++)
       Z3_dec_ref(m_z3_context, asts[i]);
 
+    cache_expr(expr);
     return OK;
   }
 
@@ -789,6 +976,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& bv,
     const unsigned ext) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
@@ -796,6 +986,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
 
     m_z3_expr = z3::expr(m_z3_context,
       Z3_mk_zero_ext(m_z3_context, ext, m_z3_expr));
+    cache_expr(expr);
     return OK;
   }
 
@@ -804,6 +995,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const SharedExpr& bv,
     const unsigned ext) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
@@ -811,6 +1005,7 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
 
     m_z3_expr = z3::expr(m_z3_context,
       Z3_mk_sign_ext(m_z3_context, ext, m_z3_expr));
+    cache_expr(expr);
     return OK;
   }
 
@@ -820,6 +1015,9 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     const unsigned high,
     const unsigned low) override
   {
+    if (find_expr(expr))
+      return OK;
+
     const Error err = bv.encode(*this);
     if (err) {
       return err;
@@ -827,17 +1025,30 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
 
     m_z3_expr = z3::expr(m_z3_context,
       Z3_mk_extract(m_z3_context, high, low, m_z3_expr));
+    cache_expr(expr);
     return OK;
   }
 
-  virtual void __notify_delete(const Expr* const expr) override
+  virtual bool __is_encoded(const Expr* const expr) const override
   {
-    // do nothing
+    return m_ast_table.find(expr) != nullptr;
   }
 
+  // the ASTs of deleted expressions are released here, otherwise only
+  // once their index is reused, see internal::ExprSideTable
   virtual void __reset() override
   {
     m_z3_solver.reset();
+
+    m_ast_table.sweep([this](const Z3_ast ast)
+    {
+      Z3_dec_ref(m_z3_context, ast);
+    });
+
+    m_prop_table.sweep([this](const Prop& prop)
+    {
+      Z3_dec_ref(m_z3_context, prop.ast);
+    });
   }
 
   virtual void __push() override
@@ -877,56 +1088,47 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     }
   }
 
-  class TemporaryAssertions
+  virtual void __interrupt() override
   {
-  private:
-    z3::solver& m_solver_ref;
+    // Z3 ignores an interrupt before its check has started. If a timeout
+    // is set, Z3 4.8 may also lose an interrupt that arrives while the
+    // check starts, and then the timeout too; callers cannot detect this.
+#ifdef SMT_Z3_SOLVER_INTERRUPT
+    Z3_solver_interrupt(m_z3_context, m_z3_solver);
+#else
+    m_z3_context.interrupt();
+#endif
+  }
 
-  public:
-    TemporaryAssertions(z3::solver& solver_ref)
-    : m_solver_ref(solver_ref)
-    {
-      m_solver_ref.push();
-    }
+  virtual bool __is_interruptible() const override
+  {
+    return true;
+  }
 
-    ~TemporaryAssertions()
-    {
-      m_solver_ref.pop();
-    }
-  };
+  virtual void __set_timeout(const ElapsedTime timeout) override
+  {
+    // Z3 interprets the largest value as no timeout
+    const unsigned z3_timeout = timeout == ElapsedTime::zero() ?
+      std::numeric_limits<unsigned>::max() :
+      static_cast<unsigned>(timeout.count());
+
+    z3::params z3_params(m_z3_context);
+    z3_params.set("timeout", z3_timeout);
+    m_z3_solver.set(z3_params);
+  }
 
   virtual std::pair<CheckResult, SharedExprs::size_type>
   __check_assumptions(
     const SharedExprs& assumptions,
     SharedExprs& unsat_core) override
   {
-    static constexpr char s_z3_prop_prefix[] = "z3_prop!";
-
-    TemporaryAssertions temporary_assertions(m_z3_solver);
-    Error err;
-
-    z3::expr z3_prop(m_z3_context);
     z3::expr_vector z3_props(m_z3_context);
     z3_props.resize(assumptions.size());
 
     size_t z3_props_index = 0;
     for (const SharedExpr& assumption : assumptions)
-    {
-      err = assumption.encode(*this);
-      assert(err == OK);
-
-      if (m_z3_expr.is_const())
-      {
-        Z3_ast_vector_set(m_z3_context, z3_props, z3_props_index++, m_z3_expr);
-      }
-      else
-      {
-        const std::string name = s_z3_prop_prefix + std::to_string(z3_props_index);
-        z3_prop = m_z3_context.constant(name.c_str(), m_z3_context.bool_sort());
-        m_z3_solver.add(implies(z3_prop, m_z3_expr));
-        Z3_ast_vector_set(m_z3_context, z3_props, z3_props_index++, z3_prop);
-      }
-    }
+      Z3_ast_vector_set(m_z3_context, z3_props, z3_props_index++,
+        prop(assumption));
 
     z3::check_result check_result = m_z3_solver.check(z3_props);
     switch (check_result)
@@ -979,19 +1181,73 @@ SMT_Z3_CAST_ENCODE_BUILTIN_LITERAL(unsigned long)
     return {unsat, unsat_core.size() - k};
   }
 
+  // \return Boolean constant that implies assumption in the backend
+  Z3_ast prop(const SharedExpr& assumption)
+  {
+    static constexpr char s_z3_prop_prefix[] = "z3_prop";
+
+    const Expr* const expr = &assumption.ref();
+    Prop* prop_ptr = m_prop_table.find(expr);
+    if (prop_ptr != nullptr && is_live(prop_ptr->scope))
+      return prop_ptr->ast;
+
+    const Error err = assumption.encode(*this);
+    assert(err == OK);
+
+    // constants need no activation literal
+    if (m_z3_expr.is_const())
+      return m_z3_expr;
+
+    if (prop_ptr == nullptr)
+    {
+      const Z3_ast ast = Z3_mk_fresh_const(m_z3_context, s_z3_prop_prefix,
+        m_z3_context.bool_sort());
+      Z3_inc_ref(m_z3_context, ast);
+
+      const Prop stale_prop = m_prop_table.insert(expr, Prop{ast, scope()});
+      if (stale_prop.ast != nullptr)
+        Z3_dec_ref(m_z3_context, stale_prop.ast);
+
+      prop_ptr = m_prop_table.find(expr);
+    }
+
+    // the implication has not been added yet, or it has been popped
+    const z3::expr z3_prop(m_z3_context, prop_ptr->ast);
+    m_z3_solver.add(implies(z3_prop, m_z3_expr));
+    prop_ptr->scope = scope();
+    return prop_ptr->ast;
+  }
+
 public:
   /// Auto configure Z3
   Z3Solver()
   : Solver(),
     m_z3_context(),
     m_z3_solver(m_z3_context),
-    m_z3_expr(m_z3_context) {}
+    m_z3_expr(m_z3_context),
+    m_ast_table(),
+    m_prop_table() {}
 
   Z3Solver(Logic logic)
   : Solver(logic),
     m_z3_context(),
     m_z3_solver(m_z3_context, Logics::acronyms[logic]),
-    m_z3_expr(m_z3_context) {}
+    m_z3_expr(m_z3_context),
+    m_ast_table(),
+    m_prop_table() {}
+
+  ~Z3Solver()
+  {
+    m_ast_table.for_each([this](const Z3_ast ast)
+    {
+      Z3_dec_ref(m_z3_context, ast);
+    });
+
+    m_prop_table.for_each([this](const Prop& prop)
+    {
+      Z3_dec_ref(m_z3_context, prop.ast);
+    });
+  }
 
   z3::context& context()
   {
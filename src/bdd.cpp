@@ -1,158 +1,693 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
 #include <cassert>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
 
 #include "bdd.h"
 
 namespace bdd
 {
 
-void BDD::clear()
+void BDDnode::remove_reference()
+{
+  assert(reference_counter != 0);
+
+  // reclaimed by the next BDDManager::gc() unless it is still reachable
+  --reference_counter;
+}
+
+BDD::BDD(BDDManager* mgr, Edge edge)
+: m_mgr(mgr),
+  m_edge(edge)
+{
+  node().add_reference();
+}
+
+BDD::BDD(const BDD& other)
+: m_mgr(other.m_mgr),
+  m_edge(other.m_edge)
+{
+  if (m_mgr != nullptr)
+    node().add_reference();
+}
+
+BDD::BDD(BDD&& other)
+: m_mgr(other.m_mgr),
+  m_edge(other.m_edge)
 {
-  if(node!=nullptr)
+  other.m_mgr = nullptr;
+}
+
+BDD& BDD::operator=(const BDD& other)
+{
+  if (other.m_mgr != nullptr)
+    other.node().add_reference();
+
+  clear();
+  m_mgr = other.m_mgr;
+  m_edge = other.m_edge;
+  return *this;
+}
+
+BDD& BDD::operator=(BDD&& other)
+{
+  if (this != &other)
   {
-    node->remove_reference();
-    node=nullptr;
+    clear();
+    m_mgr = other.m_mgr;
+    m_edge = other.m_edge;
+    other.m_mgr = nullptr;
   }
+  return *this;
 }
 
-void BDDnode::remove_reference()
+BDDnode& BDD::node() const
 {
-  assert(reference_counter!=0);
-  
-  reference_counter--;
+  assert(m_mgr != nullptr);
+  return m_mgr->m_nodes[BDDManager::index(m_edge)];
+}
 
-  if(reference_counter==0 && node_number>=2)
+void BDD::clear()
+{
+  if (m_mgr != nullptr)
   {
-    BDDManager::reverse_keyt reverse_key(var, low, high);
-    mgr->reverse_map.erase(reverse_key);
-    low.clear();
-    high.clear();
-  } 
+    node().remove_reference();
+    m_mgr = nullptr;
+  }
+}
+
+bool BDD::is_constant() const
+{
+  return BDDManager::index(m_edge) == 0;
+}
+
+bool BDD::is_true() const
+{
+  return m_edge == BDDManager::s_true_edge;
+}
+
+bool BDD::is_false() const
+{
+  return m_edge == BDDManager::s_false_edge;
+}
+
+unsigned BDD::var() const
+{
+  return node().var;
+}
+
+BDD BDD::low() const
+{
+  assert(!is_constant());
+  return BDD(m_mgr, node().low ^ (m_edge & 1U));
+}
+
+BDD BDD::high() const
+{
+  assert(!is_constant());
+  return BDD(m_mgr, node().high ^ (m_edge & 1U));
+}
+
+BDD BDD::operator!() const
+{
+  assert(m_mgr != nullptr);
+  return BDD(m_mgr, m_edge ^ 1U);
+}
+
+BDD BDD::operator&(const BDD& other) const
+{
+  m_mgr->check_manager(other);
+  m_mgr->maybe_gc();
+  return BDD(m_mgr, m_mgr->and_rec(m_edge, other.m_edge));
+}
+
+BDD BDD::operator|(const BDD& other) const
+{
+  m_mgr->check_manager(other);
+  m_mgr->maybe_gc();
+
+  // De Morgan
+  return BDD(m_mgr, m_mgr->and_rec(m_edge ^ 1U, other.m_edge ^ 1U) ^ 1U);
 }
 
-BDD BDDManager::make_var(const std::string &label)
+BDD BDD::operator^(const BDD& other) const
 {
-  var_table.push_back(var_table_entryt(label));
-  true_bdd.node->var=var_table.size()+1;
-  false_bdd.node->var=var_table.size()+1;
-  return mk(var_table.size(), false_bdd, true_bdd);
+  m_mgr->check_manager(other);
+  m_mgr->maybe_gc();
+  return BDD(m_mgr, m_mgr->xor_rec(m_edge, other.m_edge));
 }
 
-bool equal_fkt(bool x, bool y)
+BDD BDD::operator==(const BDD& other) const
 {
-  return x==y;
+  m_mgr->check_manager(other);
+  m_mgr->maybe_gc();
+  return BDD(m_mgr, m_mgr->xor_rec(m_edge, other.m_edge) ^ 1U);
 }
 
-BDD BDD::operator ==(const BDD &other) const
+BDD ite(const BDD& f, const BDD& g, const BDD& h)
 {
-  return apply(equal_fkt, *this, other);
+  assert(f.manager() != nullptr);
+  return f.manager()->ite(f, g, h);
 }
 
-bool xor_fkt(bool x, bool y)
+constexpr Edge BDDManager::s_true_edge;
+constexpr Edge BDDManager::s_false_edge;
+
+BDDManager::BDDManager(size_t initial_nodes)
+: m_nodes(),
+  m_var_table(),
+  m_unique_table(),
+  m_cache(),
+  m_free_list(0),
+  m_free_size(0),
+  m_gc_threshold(initial_nodes),
+  m_stats()
 {
-  return x ^ y;
+  size_t size = 1024;
+  while (size < initial_nodes)
+    size <<= 1;
+
+  m_nodes.reserve(size);
+  m_unique_table.assign(size, 0);
+  m_cache.assign(size, CacheEntry());
+
+  // the terminal is the only node with index zero, so s_true_edge
+  // is its regular edge and s_false_edge its complement
+  m_nodes.push_back(BDDnode(terminal_var(), s_true_edge, s_true_edge));
+  m_stats.nodes = m_stats.peak_nodes = 1;
 }
 
-BDD BDD::operator ^(const BDD &other) const
+void BDDManager::check_manager(const BDD& x) const
 {
-  return apply(xor_fkt, *this, other);
+  assert(x.m_mgr == this);
 }
 
-BDD BDD::operator !() const
+BDD BDDManager::True()
 {
-  return node->mgr->True() ^ *this;
+  return BDD(this, s_true_edge);
 }
 
-bool and_fkt(bool x, bool y)
+BDD BDDManager::False()
 {
-  return x && y;
+  return BDD(this, s_false_edge);
 }
 
-BDD BDD::operator &(const BDD &other) const
+BDD BDDManager::make_var(const std::string& label)
 {
-  return apply(and_fkt, *this, other);
+  m_var_table.push_back(label);
+  return var(m_var_table.size() - 1);
 }
 
-bool or_fkt(bool x, bool y)
+BDD BDDManager::var(unsigned var)
 {
-  return x || y;
+  assert(var < m_var_table.size());
+  return BDD(this, mk_edge(var, s_false_edge, s_true_edge));
 }
 
-BDD BDD::operator |(const BDD &other) const
+const std::string& BDDManager::label(unsigned var) const
 {
-  return apply(or_fkt, *this, other);
+  assert(var < m_var_table.size());
+  return m_var_table[var];
 }
 
-BDDManager::BDDManager()
+BDD BDDManager::mk(unsigned var, const BDD& low, const BDD& high)
 {
-  // add true/false nodes
-  append_node(0, 0, BDD(), BDD());
-  false_bdd=BDD(&nodes.back());
-  append_node(1, 1, BDD(), BDD());
-  true_bdd=BDD(&nodes.back());
+  check_manager(low);
+  check_manager(high);
+  assert(var < m_var_table.size());
+  assert(var < low.var() && var < high.var());
+
+  maybe_gc();
+  return BDD(this, mk_edge(var, low.m_edge, high.m_edge));
+}
+
+BDD BDDManager::ite(const BDD& f, const BDD& g, const BDD& h)
+{
+  check_manager(f);
+  check_manager(g);
+  check_manager(h);
+
+  maybe_gc();
+  return BDD(this, ite_rec(f.m_edge, g.m_edge, h.m_edge));
+}
+
+void BDDManager::cofactors(
+  Edge edge,
+  unsigned var,
+  Edge& low,
+  Edge& high) const
+{
+  const BDDnode& n = m_nodes[index(edge)];
+  if (n.var == var)
+  {
+    low = n.low ^ (edge & 1U);
+    high = n.high ^ (edge & 1U);
+  }
+  else
+  {
+    assert(var < n.var);
+    low = high = edge;
+  }
 }
 
-BDDManager::~BDDManager()
+size_t BDDManager::bucket(unsigned var, Edge low, Edge high) const
 {
+  uint64_t h = var;
+  h = h * 0x9E3779B97F4A7C15ULL + low;
+  h = h * 0x9E3779B97F4A7C15ULL + high;
+  h ^= h >> 29;
+  return static_cast<size_t>(h) & (m_unique_table.size() - 1);
 }
 
-BDD BDDManager::mk(unsigned var, const BDD &low, const BDD &high)
+void BDDManager::resize_unique_table(size_t size)
 {
-  assert(var<=var_table.size());
+  m_unique_table.assign(size, 0);
+  for (uint32_t i = 1; i < m_nodes.size(); ++i)
+  {
+    BDDnode& n = m_nodes[i];
+    if (n.var == free_var())
+      continue;
 
-  if(low.node_number()==high.node_number())
+    uint32_t& head = m_unique_table[bucket(n.var, n.low, n.high)];
+    n.next = head;
+    head = i;
+  }
+}
+
+Edge BDDManager::mk_edge(unsigned var, Edge low, Edge high)
+{
+  if (low == high)
     return low;
+
+  // keep high edges regular
+  if (is_complemented(high))
+    return mk_edge(var, low ^ 1U, high ^ 1U) ^ 1U;
+
+  ++m_stats.unique_lookups;
+
+  uint32_t* head = &m_unique_table[bucket(var, low, high)];
+  for (uint32_t i = *head; i != 0; i = m_nodes[i].next)
+  {
+    const BDDnode& n = m_nodes[i];
+    if (n.var == var && n.low == low && n.high == high)
+    {
+      ++m_stats.unique_hits;
+      return i << 1;
+    }
+  }
+
+  uint32_t i;
+  if (m_free_list != 0)
+  {
+    i = m_free_list;
+    m_free_list = m_nodes[i].next;
+    --m_free_size;
+    m_nodes[i] = BDDnode(var, low, high);
+  }
   else
   {
-    reverse_keyt reverse_key(var, low, high);
-    reverse_mapt::const_iterator it=reverse_map.find(reverse_key);
+    if (m_nodes.size() == m_unique_table.size())
+    {
+      resize_unique_table(m_unique_table.size() << 1);
+      head = &m_unique_table[bucket(var, low, high)];
+
+      // keep the computed cache as large as the unique table
+      std::vector<CacheEntry> cache(m_cache.size() << 1, CacheEntry());
+      for (const CacheEntry& entry : m_cache)
+        if (entry.op != 0)
+          cache[cache_hash(static_cast<Op>(entry.op), entry.f, entry.g,
+            entry.h) & (cache.size() - 1)] = entry;
+      m_cache.swap(cache);
+    }
+
+    i = m_nodes.size();
+    m_nodes.push_back(BDDnode(var, low, high));
+  }
+
+  m_nodes[i].next = *head;
+  *head = i;
+
+  ++m_stats.created_nodes;
+  m_stats.nodes = m_nodes.size() - m_free_size;
+  if (m_stats.peak_nodes < m_stats.nodes)
+    m_stats.peak_nodes = m_stats.nodes;
+
+  return i << 1;
+}
+
+size_t BDDManager::cache_hash(Op op, Edge f, Edge g, Edge h)
+{
+  uint64_t k = op;
+  k = k * 0x9E3779B97F4A7C15ULL + f;
+  k = k * 0x9E3779B97F4A7C15ULL + g;
+  k = k * 0x9E3779B97F4A7C15ULL + h;
+  k ^= k >> 31;
+  return static_cast<size_t>(k);
+}
+
+BDDManager::CacheEntry& BDDManager::cache_entry(
+  Op op,
+  Edge f,
+  Edge g,
+  Edge h)
+{
+  return m_cache[cache_hash(op, f, g, h) & (m_cache.size() - 1)];
+}
+
+Edge BDDManager::and_rec(Edge f, Edge g)
+{
+  if (f == g || g == s_true_edge)
+    return f;
+
+  if (f == s_true_edge)
+    return g;
+
+  if (f == (g ^ 1U) || f == s_false_edge || g == s_false_edge)
+    return s_false_edge;
+
+  // commutative
+  if (g < f)
+    std::swap(f, g);
 
-    if(it!=reverse_map.end())
-      return BDD(it->second);
-    else
+  ++m_stats.cache_lookups;
+
+  CacheEntry* entry = &cache_entry(AND_OP, f, g, 0);
+  if (entry->op == AND_OP && entry->f == f && entry->g == g)
+  {
+    ++m_stats.cache_hits;
+    return entry->result;
+  }
+
+  const unsigned var = std::min(top_var(f), top_var(g));
+
+  Edge f0, f1, g0, g1;
+  cofactors(f, var, f0, f1);
+  cofactors(g, var, g0, g1);
+
+  const Edge low = and_rec(f0, g0);
+  const Edge high = and_rec(f1, g1);
+  const Edge result = mk_edge(var, low, high);
+
+  // the cache may have been resized by mk_edge()
+  entry = &cache_entry(AND_OP, f, g, 0);
+  *entry = {AND_OP, f, g, 0, result};
+
+  return result;
+}
+
+Edge BDDManager::xor_rec(Edge f, Edge g)
+{
+  if (f == g)
+    return s_false_edge;
+
+  if (f == (g ^ 1U))
+    return s_true_edge;
+
+  // complement edges distribute over XOR
+  const Edge complement = (f ^ g) & 1U;
+  f &= ~1U;
+  g &= ~1U;
+
+  if (f == s_true_edge)
+    return g ^ complement ^ 1U;
+
+  if (g == s_true_edge)
+    return f ^ complement ^ 1U;
+
+  // commutative
+  if (g < f)
+    std::swap(f, g);
+
+  ++m_stats.cache_lookups;
+
+  CacheEntry* entry = &cache_entry(XOR_OP, f, g, 0);
+  if (entry->op == XOR_OP && entry->f == f && entry->g == g)
+  {
+    ++m_stats.cache_hits;
+    return entry->result ^ complement;
+  }
+
+  const unsigned var = std::min(top_var(f), top_var(g));
+
+  Edge f0, f1, g0, g1;
+  cofactors(f, var, f0, f1);
+  cofactors(g, var, g0, g1);
+
+  const Edge low = xor_rec(f0, g0);
+  const Edge high = xor_rec(f1, g1);
+  const Edge result = mk_edge(var, low, high);
+
+  entry = &cache_entry(XOR_OP, f, g, 0);
+  *entry = {XOR_OP, f, g, 0, result};
+
+  return result ^ complement;
+}
+
+Edge BDDManager::ite_rec(Edge f, Edge g, Edge h)
+{
+  if (f == s_true_edge)
+    return g;
+
+  if (f == s_false_edge)
+    return h;
+
+  if (g == h)
+    return g;
+
+  // special cases that reduce to AND
+  if (g == f || g == s_true_edge)
+    return and_rec(f ^ 1U, h ^ 1U) ^ 1U;
+
+  if (g == (f ^ 1U) || g == s_false_edge)
+    return and_rec(f ^ 1U, h);
+
+  if (h == f || h == s_false_edge)
+    return and_rec(f, g);
+
+  if (h == (f ^ 1U) || h == s_true_edge)
+    return and_rec(f, g ^ 1U) ^ 1U;
+
+  if (g == (h ^ 1U))
+    return xor_rec(f, h);
+
+  // standard triples: f and g are regular
+  if (is_complemented(f))
+  {
+    f ^= 1U;
+    std::swap(g, h);
+  }
+
+  const Edge complement = g & 1U;
+  g ^= complement;
+  h ^= complement;
+
+  ++m_stats.cache_lookups;
+
+  CacheEntry* entry = &cache_entry(ITE_OP, f, g, h);
+  if (entry->op == ITE_OP && entry->f == f && entry->g == g && entry->h == h)
+  {
+    ++m_stats.cache_hits;
+    return entry->result ^ complement;
+  }
+
+  const unsigned var = std::min(top_var(f), std::min(top_var(g), top_var(h)));
+
+  Edge f0, f1, g0, g1, h0, h1;
+  cofactors(f, var, f0, f1);
+  cofactors(g, var, g0, g1);
+  cofactors(h, var, h0, h1);
+
+  const Edge low = ite_rec(f0, g0, h0);
+  const Edge high = ite_rec(f1, g1, h1);
+  const Edge result = mk_edge(var, low, high);
+
+  entry = &cache_entry(ITE_OP, f, g, h);
+  *entry = {ITE_OP, f, g, h, result};
+
+  return result ^ complement;
+}
+
+void BDDManager::maybe_gc()
+{
+  if (m_free_size != 0 || m_nodes.size() < m_gc_threshold)
+    return;
+
+  gc();
+
+  // grow instead of collecting over and over again
+  if (m_free_size < m_nodes.size() / 4)
+    m_gc_threshold = m_nodes.size() << 1;
+  else
+    m_gc_threshold = m_nodes.size();
+}
+
+void BDDManager::gc()
+{
+  ++m_stats.gc_runs;
+
+  // mark everything reachable from a BDD object
+  std::vector<uint32_t> stack;
+  for (uint32_t i = 1; i < m_nodes.size(); ++i)
+  {
+    const BDDnode& n = m_nodes[i];
+    if (n.var != free_var() && n.reference_counter != 0 && !n.is_marked)
+      stack.push_back(i);
+
+    while (!stack.empty())
+    {
+      BDDnode& m = m_nodes[stack.back()];
+      stack.pop_back();
+      if (m.is_marked)
+        continue;
+
+      m.is_marked = true;
+      if (index(m.low) != 0)
+        stack.push_back(index(m.low));
+      if (index(m.high) != 0)
+        stack.push_back(index(m.high));
+    }
+  }
+
+  // sweep
+  size_t collected = 0;
+  for (uint32_t i = 1; i < m_nodes.size(); ++i)
+  {
+    BDDnode& n = m_nodes[i];
+    if (n.var == free_var())
+      continue;
+
+    if (n.is_marked)
     {
-      unsigned new_number=nodes.back().node_number+1;
-      append_node(var, new_number, low, high);
-      reverse_map[reverse_key]=&nodes.back();
-      return BDD(&nodes.back());
+      n.is_marked = false;
+      continue;
     }
+
+    n.var = free_var();
+    n.next = m_free_list;
+    m_free_list = i;
+    ++m_free_size;
+    ++collected;
   }
+
+  resize_unique_table(m_unique_table.size());
+  m_cache.assign(m_cache.size(), CacheEntry());
+
+  m_stats.collected_nodes += collected;
+  m_stats.nodes = m_nodes.size() - m_free_size;
 }
 
-bool operator < (const BDDManager::reverse_keyt &x,
-                 const BDDManager::reverse_keyt &y)
+double BDDManager::sat_count(const BDD& f) const
 {
-  if(x.var<y.var) return true;
-  if(x.var>y.var) return false;
-  if(x.low<y.low) return true;
-  if(x.low>y.low) return false;
-  return x.high<y.high;
+  return sat_count(f, m_var_table.size());
 }
 
-BDD apply(bool (*fkt)(bool x, bool y), const BDD &x, const BDD &y)
+double BDDManager::sat_count(const BDD& f, const size_t vars) const
 {
-  assert(x.node!=nullptr && y.node!=nullptr);
-  assert(x.node->mgr==y.node->mgr);
+  check_manager(f);
+  assert(vars <= m_var_table.size());
+
+  // Fraction of all assignments that satisfy an edge. Both polarities
+  // are computed separately because 1.0 - d cancels catastrophically
+  // when d is close to one.
+  std::unordered_map<Edge, double> density;
+  density[s_true_edge] = 1.0;
+  density[s_false_edge] = 0.0;
+
+  std::vector<Edge> stack{f.m_edge};
+  while (!stack.empty())
+  {
+    const Edge edge = stack.back();
+    if (density.count(edge))
+    {
+      stack.pop_back();
+      continue;
+    }
+
+    const BDDnode& n = m_nodes[index(edge)];
+    const Edge low = n.low ^ (edge & 1U);
+    const Edge high = n.high ^ (edge & 1U);
+
+    const auto d0 = density.find(low);
+    if (d0 == density.end())
+    {
+      stack.push_back(low);
+      continue;
+    }
+
+    const auto d1 = density.find(high);
+    if (d1 == density.end())
+    {
+      stack.push_back(high);
+      continue;
+    }
+
+    density[edge] = (d0->second + d1->second) / 2.0;
+    stack.pop_back();
+  }
+
+  double count = density[f.m_edge];
+  for (size_t v = 0; v < vars; ++v)
+    count *= 2.0;
+
+  return count;
+}
+
+size_t BDDManager::node_count(const BDD& f) const
+{
+  check_manager(f);
+
+  std::vector<bool> visited(m_nodes.size(), false);
+  std::vector<uint32_t> stack{index(f.m_edge)};
+  size_t count = 0;
+  while (!stack.empty())
+  {
+    const uint32_t i = stack.back();
+    stack.pop_back();
+    if (visited[i])
+      continue;
+
+    visited[i] = true;
+    ++count;
+    if (i != 0)
+    {
+      stack.push_back(index(m_nodes[i].low));
+      stack.push_back(index(m_nodes[i].high));
+    }
+  }
+
+  return count;
+}
+
+std::vector<unsigned> BDDManager::support(const BDD& f) const
+{
+  check_manager(f);
+
+  std::vector<bool> visited(m_nodes.size(), false);
+  std::vector<bool> is_support(m_var_table.size(), false);
+  std::vector<uint32_t> stack{index(f.m_edge)};
+  while (!stack.empty())
+  {
+    const uint32_t i = stack.back();
+    stack.pop_back();
+    if (i == 0 || visited[i])
+      continue;
+
+    visited[i] = true;
+    is_support[m_nodes[i].var] = true;
+    stack.push_back(index(m_nodes[i].low));
+    stack.push_back(index(m_nodes[i].high));
+  }
 
-  BDDManager *mgr=x.node->mgr;
-  
-  BDD u;
+  std::vector<unsigned> vars;
+  for (unsigned v = 0; v < is_support.size(); ++v)
+    if (is_support[v])
+      vars.push_back(v);
 
-  if(x.is_constant() && y.is_constant())
-    u=BDD(fkt(x.is_true(), y.is_true())?mgr->true_bdd:mgr->false_bdd);
-  else if(x.var()==y.var())
-    u=mgr->mk(x.var(),
-              apply(fkt, x.low(), y.low()),
-              apply(fkt, x.high(), y.high()));
-  else if(x.var()<y.var())
-    u=mgr->mk(x.var(),
-              apply(fkt, x.low(), y),
-              apply(fkt, x.high(), y));
-  else /* x.var() > y.var() */
-    u=mgr->mk(y.var(),
-              apply(fkt, x, y.low()),
-              apply(fkt, x, y.high()));
-    
-  return u;
+  return vars;
 }
 
 }
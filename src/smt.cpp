@@ -4,14 +4,298 @@
 
 #include "smt.h"
 
+#include <new>
+#include <cstdlib>
+#include <map>
+#include <ostream>
+#include <algorithm>
+
 namespace smt
 {
 
-Expr::SolverPtrs Expr::s_solver_ptrs;
+#ifdef ENABLE_CONCURRENCY
+std::atomic<unsigned> Expr::s_counter(0);
+#else
 unsigned Expr::s_counter = 0;
+#endif
+
+namespace internal
+{
+  SpinLock ExprIds::s_lock;
+  ExprIds::Slot* ExprIds::s_slots = nullptr;
+  uint32_t ExprIds::s_size = 0;
+  uint32_t ExprIds::s_capacity = 0;
+  uint32_t ExprIds::s_free_head = 0;
+
+  void ExprIds::grow()
+  {
+    const uint32_t capacity = s_capacity == 0 ? 1024 : 2 * s_capacity;
+    assert(s_capacity < capacity);
+
+    // never freed, see class comment
+    Slot* const slots = static_cast<Slot*>(
+      std::realloc(s_slots, capacity * sizeof(Slot)));
+
+    if (slots == nullptr)
+      throw std::bad_alloc();
+
+    s_slots = slots;
+    s_capacity = capacity;
+  }
+}
+
+namespace internal
+{
+  Symbols::Id Symbols::intern(const char* const prefix, const unsigned counter)
+  {
+    assert(prefix != nullptr);
+
+    std::vector<const char*>::const_iterator iter = std::find(
+      m_prefixes.cbegin(), m_prefixes.cend(), prefix);
+    const uint64_t prefix_index = iter - m_prefixes.cbegin();
+    if (iter == m_prefixes.cend())
+      m_prefixes.push_back(prefix);
+
+    const uint64_t key = (prefix_index << 32) | counter;
+    const std::pair<std::unordered_map<uint64_t, Id>::iterator, bool> result =
+      m_ids.emplace(key, static_cast<Id>(m_keys.size()));
+
+    if (result.second)
+    {
+      assert(m_keys.size() < std::numeric_limits<Id>::max());
+      m_keys.push_back(key);
+    }
+
+    return result.first->second;
+  }
+
+  std::string Symbols::name(const Id id) const
+  {
+    assert(id < m_keys.size());
+    const uint64_t key = m_keys[id];
+    return m_prefixes[key >> 32] + std::to_string(static_cast<unsigned>(key));
+  }
+
+  // zero-initialized and never destructed, like ExprIds
+  static SpinLock s_global_symbols_lock;
+  static Symbols* s_global_symbols;
+
+  Symbols::Id Symbols::global_intern(
+    const char* const prefix,
+    const unsigned counter)
+  {
+    std::lock_guard<SpinLock> lock(s_global_symbols_lock);
+    if (s_global_symbols == nullptr)
+      s_global_symbols = new Symbols();
+
+    return s_global_symbols->intern(prefix, counter);
+  }
+
+  std::string Symbols::global_name(const Id id)
+  {
+    std::lock_guard<SpinLock> lock(s_global_symbols_lock);
+    assert(s_global_symbols != nullptr);
+    return s_global_symbols->name(id);
+  }
+}
+
+#ifdef ENABLE_EXPR_POOL
+namespace internal
+{
+  constexpr size_t ExprPool::s_granularity;
+  constexpr size_t ExprPool::s_max_block_size;
+  constexpr size_t ExprPool::s_chunk_size;
+  constexpr size_t ExprPool::s_size_classes;
+
+  ExprPool::SizeClass ExprPool::s_pool[ExprPool::s_size_classes];
+  std::atomic<uint64_t> ExprPool::s_oversized_allocations(0);
+
+  void* ExprPool::refill(SizeClass& size_class, size_t block_size)
+  {
+    assert(size_class.free_list == nullptr);
+    assert(size_class.bump_begin == size_class.bump_end);
+
+    // round down so that the bump region is a multiple of block_size
+    const size_t chunk_size = (s_chunk_size / block_size) * block_size;
+    char* const chunk = static_cast<char*>(::operator new(chunk_size));
+    ++size_class.chunks;
+
+    size_class.bump_begin = chunk + block_size;
+    size_class.bump_end = chunk + chunk_size;
+    return chunk;
+  }
+
+  void ExprPool::add_stats(
+    SizeClass& size_class,
+    size_t block_size,
+    Stats& stats)
+  {
+    std::lock_guard<SpinLock> lock(size_class.lock);
+    const size_t chunk_size = (s_chunk_size / block_size) * block_size;
+
+    stats.chunks += size_class.chunks;
+    stats.reserved_bytes += size_class.chunks * chunk_size;
+    stats.live_blocks += size_class.live_blocks;
+    stats.live_bytes += size_class.live_blocks * block_size;
+    stats.allocations += size_class.allocations;
+  }
+
+  ExprPool::Stats ExprPool::stats()
+  {
+    Stats stats = {0};
+    for (size_t i = 0; i < s_size_classes; ++i)
+      add_stats(s_pool[i], (i + 1) * s_granularity, stats);
+
+    stats.oversized_allocations = s_oversized_allocations;
+    return stats;
+  }
+
+  ExprPool::Stats ExprPool::stats(size_t size)
+  {
+    assert(0 < size && size <= s_max_block_size);
+
+    const size_t i = size_class_index(size);
+    Stats stats = {0};
+    add_stats(s_pool[i], (i + 1) * s_granularity, stats);
+    return stats;
+  }
+}
+#endif
 
 constexpr const char* const Logics::acronyms[24];
 
+constexpr size_t Opcodes::size;
+constexpr const char* const Opcodes::names[Opcodes::size];
+
+constexpr unsigned Histogram::s_sub_bucket_bits;
+constexpr uint64_t Histogram::s_sub_buckets;
+constexpr size_t Histogram::s_buckets;
+
+size_t Histogram::bucket(uint64_t value)
+{
+  if (value < s_sub_buckets)
+    return value;
+
+  unsigned msb = s_sub_bucket_bits;
+  while ((value >> msb) != 1)
+    ++msb;
+
+  // the leading bit is dropped, the next s_sub_bucket_bits select
+  // one of the s_sub_buckets within the power of two
+  const unsigned shift = msb - s_sub_bucket_bits;
+  return (shift + 1) * s_sub_buckets +
+    ((value >> shift) - s_sub_buckets);
+}
+
+uint64_t Histogram::bucket_max(size_t bucket)
+{
+  if (bucket < s_sub_buckets)
+    return bucket;
+
+  const unsigned shift = bucket / s_sub_buckets - 1;
+  const uint64_t lower = (s_sub_buckets + bucket % s_sub_buckets) << shift;
+  return lower + ((uint64_t(1) << shift) - 1);
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+  assert(0.0 <= q && q <= 1.0);
+
+  if (m_count == 0)
+    return 0;
+
+  // rank of the sample, starting from one
+  uint64_t rank = static_cast<uint64_t>(q * m_count + 0.5);
+  if (rank == 0)
+    rank = 1;
+
+  uint64_t n = 0;
+  for (size_t i = 0; i < s_buckets; ++i)
+  {
+    n += m_buckets[i];
+    if (rank <= n)
+      return std::max(m_min, std::min(bucket_max(i), m_max));
+  }
+
+  return m_max;
+}
+
+void Histogram::clear()
+{
+  m_buckets.fill(0);
+  m_count = 0;
+  m_sum = 0;
+  m_min = std::numeric_limits<uint64_t>::max();
+  m_max = 0;
+}
+
+void Histogram::write_json(std::ostream& out) const
+{
+  out << "{\"count\":" << count()
+      << ",\"sum\":" << sum()
+      << ",\"min\":" << min()
+      << ",\"max\":" << max()
+      << ",\"p50\":" << quantile(0.5)
+      << ",\"p90\":" << quantile(0.9)
+      << ",\"p99\":" << quantile(0.99)
+      << ",\"p999\":" << quantile(0.999)
+      << "}";
+}
+
+static void write_json_opcodes(
+  std::ostream& out,
+  const std::array<uint64_t, Opcodes::size>& counters)
+{
+  out << "{";
+  for (size_t opcode = 0; opcode < Opcodes::size; ++opcode)
+  {
+    if (opcode != 0)
+      out << ",";
+
+    out << "\"" << Opcodes::names[opcode] << "\":" << counters[opcode];
+  }
+  out << "}";
+}
+
+void Solver::Stats::write_json(std::ostream& out) const
+{
+  out << "{\"constants\":" << constants
+      << ",\"func_apps\":" << func_apps
+      << ",\"array_selects\":" << array_selects
+      << ",\"array_stores\":" << array_stores
+      << ",\"unary_ops\":" << unary_ops
+      << ",\"binary_ops\":" << binary_ops
+      << ",\"nary_ops\":" << nary_ops
+      << ",\"equalities\":" << equalities
+      << ",\"disequalities\":" << disequalities
+      << ",\"inequalities\":" << inequalities
+      << ",\"implications\":" << implications
+      << ",\"conjunctions\":" << conjunctions
+      << ",\"disjunctions\":" << disjunctions
+      << ",\"encode_elapsed_ms\":" << encode_elapsed_time.count()
+      << ",\"check_elapsed_ms\":" << check_elapsed_time.count();
+
+  out << ",\"unary_opcodes\":";
+  write_json_opcodes(out, unary_opcodes);
+  out << ",\"binary_opcodes\":";
+  write_json_opcodes(out, binary_opcodes);
+  out << ",\"nary_opcodes\":";
+  write_json_opcodes(out, nary_opcodes);
+
+  out << ",\"checks\":{\"sat\":" << sat_checks
+      << ",\"unsat\":" << unsat_checks
+      << ",\"unknown\":" << unknown_checks
+      << ",\"timeout\":" << timeout_checks << "}";
+
+  out << ",\"check_latencies_us\":";
+  check_latencies.write_json(out);
+  out << ",\"check_formulas\":";
+  check_formulas.write_json(out);
+  out << ",\"check_dag_nodes\":";
+  check_dag_nodes.write_json(out);
+  out << "}";
+}
+
 static constexpr size_t MAX_BV_SIZE = 1024;
 static const Sort* bv_sorts[2][MAX_BV_SIZE] = { nullptr };
 
@@ -28,6 +312,48 @@ const Sort& bv_sort(bool is_signed, size_t size)
   return *bv_sorts[is_signed][size];
 }
 
+namespace
+{
+  // composite sorts keyed by whether they are function sorts and their
+  // sorts, allocated on first use and never freed like those of bv_sort()
+  typedef std::map<std::pair<bool, std::vector<const Sort*>>, const Sort*>
+    CompositeSorts;
+
+  internal::SpinLock s_composite_sort_lock;
+  CompositeSorts* s_composite_sorts = nullptr;
+
+  const Sort& composite_sort(
+    const bool is_func,
+    const std::vector<const Sort*>& sorts)
+  {
+    std::lock_guard<internal::SpinLock> lock(s_composite_sort_lock);
+
+    if (s_composite_sorts == nullptr)
+      s_composite_sorts = new CompositeSorts();
+
+    const Sort*& sort_ptr = (*s_composite_sorts)[std::make_pair(is_func, sorts)];
+    if (sort_ptr == nullptr)
+    {
+      const Sort** const sorts_ptr = new const Sort*[sorts.size()];
+      std::copy(sorts.cbegin(), sorts.cend(), sorts_ptr);
+      sort_ptr = new Sort(sorts_ptr, sorts.size(), is_func, !is_func);
+    }
+
+    return *sort_ptr;
+  }
+}
+
+const Sort& array_sort(const Sort& domain, const Sort& range)
+{
+  return composite_sort(false, {&domain, &range});
+}
+
+const Sort& func_sort(const std::vector<const Sort*>& sorts)
+{
+  assert(2 <= sorts.size());
+  return composite_sort(true, sorts);
+}
+
 SharedExpr constant(const UnsafeDecl& decl)
 {
   return make_shared_expr<ConstantExpr>(decl);
@@ -54,6 +380,121 @@ SharedExpr apply(
     func_decl, std::move(args));
 }
 
+namespace internal
+{
+
+#define SMT_MAKE_UNARY_CASE(opcode)                                            \
+  case opcode:                                                                 \
+    return make_shared_expr<UnaryExpr<opcode>>(sort, arg);                     \
+
+SharedExpr make_unary(
+  Opcode opcode,
+  const Sort& sort,
+  const SharedExpr& arg)
+{
+  switch (opcode)
+  {
+  SMT_MAKE_UNARY_CASE(LNOT)
+  SMT_MAKE_UNARY_CASE(NOT)
+  SMT_MAKE_UNARY_CASE(SUB)
+  default:
+    return SharedExpr();
+  }
+}
+
+#define SMT_MAKE_BINARY_CASE(opcode)                                           \
+  case opcode:                                                                 \
+    return make_shared_expr<BinaryExpr<opcode>>(sort, larg, rarg);             \
+
+SharedExpr make_binary(
+  Opcode opcode,
+  const Sort& sort,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  switch (opcode)
+  {
+  SMT_MAKE_BINARY_CASE(SUB)
+  SMT_MAKE_BINARY_CASE(AND)
+  SMT_MAKE_BINARY_CASE(OR)
+  SMT_MAKE_BINARY_CASE(XOR)
+  SMT_MAKE_BINARY_CASE(LSHL)
+  SMT_MAKE_BINARY_CASE(LSHR)
+  SMT_MAKE_BINARY_CASE(LAND)
+  SMT_MAKE_BINARY_CASE(LOR)
+  SMT_MAKE_BINARY_CASE(IMP)
+  SMT_MAKE_BINARY_CASE(EQL)
+  SMT_MAKE_BINARY_CASE(ADD)
+  SMT_MAKE_BINARY_CASE(MUL)
+  SMT_MAKE_BINARY_CASE(QUO)
+  SMT_MAKE_BINARY_CASE(REM)
+  SMT_MAKE_BINARY_CASE(LSS)
+  SMT_MAKE_BINARY_CASE(GTR)
+  SMT_MAKE_BINARY_CASE(NEQ)
+  SMT_MAKE_BINARY_CASE(LEQ)
+  SMT_MAKE_BINARY_CASE(GEQ)
+  default:
+    return SharedExpr();
+  }
+}
+
+#define SMT_MAKE_NARY_CASE(opcode)                                             \
+  case opcode:                                                                 \
+    return make_shared_expr<NaryExpr<opcode>>(sort, std::move(args));          \
+
+SharedExpr make_nary(
+  Opcode opcode,
+  const Sort& sort,
+  SharedExprs&& args)
+{
+  switch (opcode)
+  {
+  SMT_MAKE_NARY_CASE(LAND)
+  SMT_MAKE_NARY_CASE(LOR)
+  SMT_MAKE_NARY_CASE(NEQ)
+  SMT_MAKE_NARY_CASE(ADD)
+  SMT_MAKE_NARY_CASE(MUL)
+  SMT_MAKE_NARY_CASE(AND)
+  SMT_MAKE_NARY_CASE(OR)
+  SMT_MAKE_NARY_CASE(XOR)
+  SMT_MAKE_NARY_CASE(EQL)
+  default:
+    return SharedExpr();
+  }
+}
+
+template<size_t arity>
+static SharedExpr make_func_app(
+  const UnsafeDecl& func_decl,
+  const SharedExpr* const args)
+{
+  std::array<SharedExpr, arity> array;
+  std::copy(args, args + arity, array.begin());
+  return make_shared_expr<FuncAppExpr<arity>>(func_decl, std::move(array));
+}
+
+SharedExpr make_func_app(
+  const UnsafeDecl& func_decl,
+  const SharedExpr* const args,
+  const size_t arity)
+{
+  switch (arity)
+  {
+  case 1: return make_func_app<1>(func_decl, args);
+  case 2: return make_func_app<2>(func_decl, args);
+  case 3: return make_func_app<3>(func_decl, args);
+  case 4: return make_func_app<4>(func_decl, args);
+  case 5: return make_func_app<5>(func_decl, args);
+  case 6: return make_func_app<6>(func_decl, args);
+  case 7: return make_func_app<7>(func_decl, args);
+  case 8: return make_func_app<8>(func_decl, args);
+  default:
+    return SharedExpr();
+  }
+}
+
+}
+
 SharedExpr distinct(SharedExprs&& terms)
 {
   return make_shared_expr<NaryExpr<NEQ>>(
@@ -133,33 +574,155 @@ SharedExpr store(
     array, index, value);
 }
 
+CancellationToken::Scope::Scope(
+  CancellationToken* const token,
+  Solver& solver)
+: m_token(token),
+  m_solver(solver),
+  m_is_attached(false)
+{
+  if (m_token == nullptr)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_token->m_mutex);
+  if (m_token->is_cancelled())
+    return;
+
+  m_token->m_solvers.push_back(&m_solver);
+  m_is_attached = true;
+}
+
+CancellationToken::Scope::~Scope()
+{
+  if (!m_is_attached)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_token->m_mutex);
+  std::vector<Solver*>& solvers = m_token->m_solvers;
+  solvers.erase(std::find(solvers.begin(), solvers.end(), &m_solver));
+  m_token->m_detached_cond.notify_all();
+}
+
+void CancellationToken::cancel()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_is_cancelled.store(true);
+
+  // A solver may have attached but not yet entered its backend check,
+  // in which case Z3Solver, for example, ignores the interrupt. Solvers
+  // cannot detach, and therefore not be destroyed, while m_mutex is held.
+  while (std::any_of(m_solvers.cbegin(), m_solvers.cend(),
+    [](const Solver* solver) { return solver->is_interruptible(); }))
+  {
+    for (Solver* solver : m_solvers)
+      solver->interrupt();
+
+    m_detached_cond.wait_for(lock, std::chrono::milliseconds(1));
+  }
+}
+
 Solver::Solver()
 : m_stats{0},
   m_is_timer_on(false),
+  m_simplifier(nullptr),
+  m_timeout(ElapsedTime::zero()),
+  m_cancellation_token(nullptr),
+  m_is_encoding_dag(false),
+  m_dag_stack(),
+  m_dag_args(),
+  m_dag_nodes(0),
   m_assertions(),
-  m_assertion_stack()
+  m_assertion_dag_nodes(),
+  m_assertion_stack(),
+  m_scope_ids(1, 0),
+  m_last_scope_id(0)
 {
   m_stats.encode_elapsed_time = ElapsedTime::zero();
   m_stats.check_elapsed_time = ElapsedTime::zero();
-
-  Expr::register_solver(this);
 }
 
 Solver::Solver(Logic logic)
 : m_stats{0},
   m_is_timer_on(false),
+  m_simplifier(nullptr),
+  m_timeout(ElapsedTime::zero()),
+  m_cancellation_token(nullptr),
+  m_is_encoding_dag(false),
+  m_dag_stack(),
+  m_dag_args(),
+  m_dag_nodes(0),
   m_assertions(),
-  m_assertion_stack()
+  m_assertion_dag_nodes(),
+  m_assertion_stack(),
+  m_scope_ids(1, 0),
+  m_last_scope_id(0)
 {
   m_stats.encode_elapsed_time = ElapsedTime::zero();
   m_stats.check_elapsed_time = ElapsedTime::zero();
-
-  Expr::register_solver(this);
 }
 
-Solver::~Solver()
+Solver::~Solver() {}
+
+Error Solver::encode_dag(const Expr* const expr)
 {
-  Expr::unregister_solver(this);
+  if (m_is_encoding_dag || __is_encoded(expr))
+    return expr->__encode(*this);
+
+  // also reset if an exception is thrown
+  struct EncodingDagScope
+  {
+    Solver& solver;
+
+    EncodingDagScope(Solver& s)
+    : solver(s)
+    {
+      solver.m_is_encoding_dag = true;
+    }
+
+    ~EncodingDagScope()
+    {
+      solver.m_dag_stack.clear();
+      solver.m_is_encoding_dag = false;
+    }
+  } scope(*this);
+
+  m_dag_stack.emplace_back(expr, false);
+  while (!m_dag_stack.empty())
+  {
+    const Expr* const top = m_dag_stack.back().first;
+    const bool is_expanded = m_dag_stack.back().second;
+
+    // shared subexpressions may have been encoded since they were pushed
+    if (__is_encoded(top))
+    {
+      m_dag_stack.pop_back();
+      continue;
+    }
+
+    if (is_expanded)
+    {
+      m_dag_stack.pop_back();
+
+      const Error err = top->__encode(*this);
+      if (err)
+        return err;
+
+      ++m_dag_nodes;
+      continue;
+    }
+
+    m_dag_stack.back().second = true;
+
+    // push in reverse so that arguments are encoded from left to right
+    m_dag_args.clear();
+    top->__push_args(m_dag_args);
+    for (ExprPtrs::const_reverse_iterator iter = m_dag_args.crbegin();
+         iter != m_dag_args.crend(); ++iter)
+      m_dag_stack.emplace_back(*iter, false);
+  }
+
+  // the root is encoded last, so the Solver subclass refers to it
+  return OK;
 }
 
 Error Solver::encode_constant(
@@ -237,24 +800,7 @@ Error Solver::encode_nary(
 
   assert(!args.empty());
 
-  switch (opcode) {
-  case EQL:
-    m_stats.equalities += args.size();
-    break;
-  case NEQ:
-    m_stats.disequalities += args.size();
-    break;
-  case LAND:
-    m_stats.conjunctions += args.size();
-    break;
-  case LOR:
-    m_stats.disjunctions += args.size();
-    break;
-   default:
-    ;
-  }
-
-  m_stats.nary_ops++;
+  count_nary(opcode, args.size());
   return __encode_nary(expr, opcode, args);
 }
 
@@ -295,7 +841,9 @@ Error Solver::encode_bv_extract(
 void Solver::reset()
 {
   m_assertions.clear();
+  m_assertion_dag_nodes.clear();
   m_assertion_stack.clear();
+  m_scope_ids.assign(1, ++m_last_scope_id);
 
   __reset();
 }
@@ -303,6 +851,7 @@ void Solver::reset()
 void Solver::push()
 {
   m_assertion_stack.push_back(0);
+  m_scope_ids.push_back(++m_last_scope_id);
   __push();
 }
 
@@ -315,6 +864,7 @@ void Solver::pop()
   assert(n <= m_assertions.size());
 
   m_assertion_stack.pop_back();
+  m_scope_ids.pop_back();
   if (m_assertions.size() == n)
   {
     // not necessarily m_assertion_stack.empty()
@@ -326,6 +876,7 @@ void Solver::pop()
     m_assertions.resize(m_assertions.size() - n);
   }
 
+  m_assertion_dag_nodes.resize(m_assertions.size());
   __pop();
 }
 
@@ -334,58 +885,865 @@ void Solver::unsafe_add(const SharedExpr& condition)
   NonReentrantTimer<ElapsedTime> timer(m_stats.encode_elapsed_time);
 
   assert(condition.sort().is_bool());
-  m_assertions.terms.push_back(condition);
+  if (m_simplifier == nullptr)
+    m_assertions.terms.push_back(condition);
+  else
+    m_assertions.terms.push_back(m_simplifier->simplify(condition));
+
   if (!m_assertion_stack.empty())
     ++m_assertion_stack.back();
 
-  const Error err = __unsafe_add(condition);
-  assert(err == OK);
+  add_assertion(m_assertions.terms.back());
 }
 
 void Solver::add(const Bool& condition)
 {
   NonReentrantTimer<ElapsedTime> timer(m_stats.encode_elapsed_time);
 
-  m_assertions.push_back(condition);
+  if (m_simplifier == nullptr)
+    m_assertions.push_back(condition);
+  else
+    m_assertions.push_back(m_simplifier->simplify(condition));
+
   if (!m_assertion_stack.empty())
     ++m_assertion_stack.back();
 
-  const Error err = __unsafe_add(m_assertions.back());
-  assert(err == OK);
+  add_assertion(m_assertions.back());
 }
 
 void Solver::add(Bool&& condition)
 {
   NonReentrantTimer<ElapsedTime> timer(m_stats.encode_elapsed_time);
 
-  m_assertions.push_back(std::move(condition));
+  if (m_simplifier == nullptr)
+    m_assertions.push_back(std::move(condition));
+  else
+    m_assertions.push_back(m_simplifier->simplify(condition));
+
   if (!m_assertion_stack.empty())
     ++m_assertion_stack.back();
 
-  const Error err = __unsafe_add(m_assertions.back());
+  add_assertion(m_assertions.back());
+}
+
+void Solver::add_assertion(const SharedExpr& condition)
+{
+  const uint64_t dag_nodes = m_dag_nodes;
+  const Error err = __unsafe_add(condition);
   assert(err == OK);
+
+  m_assertion_dag_nodes.push_back(m_dag_nodes - dag_nodes +
+    (m_assertion_dag_nodes.empty() ? 0 : m_assertion_dag_nodes.back()));
+}
+
+CheckResult Solver::count_check(
+  const CheckResult result,
+  const CheckClock::time_point start,
+  const size_t formulas,
+  const uint64_t dag_nodes)
+{
+  const std::chrono::microseconds latency =
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      CheckClock::now() - start);
+
+  m_stats.check_latencies.record(latency.count());
+  m_stats.check_formulas.record(formulas);
+  m_stats.check_dag_nodes.record(dag_nodes +
+    (m_assertion_dag_nodes.empty() ? 0 : m_assertion_dag_nodes.back()));
+
+  switch (result)
+  {
+  case sat:
+    m_stats.sat_checks++;
+    break;
+  case unsat:
+    m_stats.unsat_checks++;
+    break;
+  default:
+    m_stats.unknown_checks++;
+    if (m_timeout != ElapsedTime::zero() && latency >= m_timeout)
+      m_stats.timeout_checks++;
+    break;
+  }
+
+  return result;
 }
 
 CheckResult Solver::check()
 {
   NonReentrantTimer<ElapsedTime> timer(m_stats.check_elapsed_time);
+  const CheckClock::time_point start = CheckClock::now();
 
   if (m_assertions.empty())
-    return sat;
+    return count_check(sat, start, 0, 0);
+
+  const CancellationToken::Scope scope(m_cancellation_token, *this);
+  if (scope.is_cancelled())
+    return count_check(unknown, start, m_assertions.size(), 0);
 
-  return __check();
+  return count_check(__check(), start, m_assertions.size(), 0);
 }
 
 std::pair<CheckResult, Bools::SizeType> Solver::check_assumptions(
   const Bools& assumptions,
   Bools& unsat_core)
 {
-  assert(m_assertion_stack.size() == 0);
-
   NonReentrantTimer<ElapsedTime> timer(m_stats.check_elapsed_time);
-  return __check_assumptions(assumptions.terms, unsat_core.terms);
+  const CheckClock::time_point start = CheckClock::now();
+
+  const CancellationToken::Scope scope(m_cancellation_token, *this);
+  if (scope.is_cancelled())
+  {
+    count_check(unknown, start, m_assertions.size() + assumptions.size(), 0);
+    return {unknown, 0};
+  }
+
+  // assumptions are encoded by the check
+  const uint64_t dag_nodes = m_dag_nodes;
+  std::pair<CheckResult, Bools::SizeType> result =
+    __check_assumptions(assumptions.terms, unsat_core.terms);
+
+  count_check(result.first, start,
+    m_assertions.size() + assumptions.size(), m_dag_nodes - dag_nodes);
+
+  return result;
 }
 
 Bool Identity<LAND, Bool>::term(literal<Bool>(true));
+Bool Identity<LOR, Bool>::term(literal<Bool>(false));
+
+Simplifier::Simplifier()
+: Solver(),
+  m_rewrite_table(),
+  m_rule_stats{0} {}
+
+uint64_t Simplifier::truncate(const Sort& sort, const uint64_t value)
+{
+  assert(sort.is_bv() && 0 < sort.bv_size() && sort.bv_size() <= 64);
+
+  const size_t bv_size = sort.bv_size();
+  if (bv_size == 64)
+    return value;
+
+  return value & ((UINT64_C(1) << bv_size) - 1);
+}
+
+long long Simplifier::to_signed(const Sort& sort, const uint64_t value)
+{
+  if (!sort.is_bv() || sort.bv_size() == 64)
+    return static_cast<long long>(value);
+
+  // sign extend
+  const uint64_t sign_bit = UINT64_C(1) << (sort.bv_size() - 1);
+  return static_cast<long long>((value ^ sign_bit) - sign_bit);
+}
+
+SharedExpr Simplifier::make_literal(const Sort& sort, const uint64_t value)
+{
+  if (sort.is_bool())
+  {
+    if (value)
+      return Identity<LAND, Bool>::term;
+
+    return Identity<LOR, Bool>::term;
+  }
+
+  if (sort.is_bv() && !sort.is_signed())
+    return literal<unsigned long long>(sort, value);
+
+  return literal<long long>(sort, to_signed(sort, value));
+}
+
+bool Simplifier::fold_unary(
+  Opcode opcode,
+  const Sort& sort,
+  const uint64_t arg,
+  uint64_t& value)
+{
+  if (sort.is_bool())
+  {
+    if (opcode != LNOT)
+      return false;
+
+    value = !arg;
+    return true;
+  }
+
+  if (sort.is_bv())
+  {
+    switch (opcode)
+    {
+    case NOT: value = truncate(sort, ~arg); return true;
+    case SUB: value = truncate(sort, -arg); return true;
+    default:  return false;
+    }
+  }
+
+  assert(sort.is_int());
+
+  const long long x = static_cast<long long>(arg);
+  if (opcode != SUB || x == std::numeric_limits<long long>::min())
+    return false;
+
+  value = static_cast<uint64_t>(-x);
+  return true;
+}
+
+bool Simplifier::fold_binary(
+  Opcode opcode,
+  const Sort& sort,
+  const uint64_t larg,
+  const uint64_t rarg,
+  uint64_t& value)
+{
+  if (sort.is_bool())
+  {
+    switch (opcode)
+    {
+    case LAND: value = larg && rarg;  return true;
+    case LOR:  value = larg || rarg;  return true;
+    case IMP:  value = !larg || rarg; return true;
+    case EQL:  value = larg == rarg;  return true;
+    case NEQ:
+    case XOR:  value = larg != rarg;  return true;
+    default:   return false;
+    }
+  }
+
+  if (sort.is_bv())
+  {
+    const uint64_t bv_size = sort.bv_size();
+    const bool is_signed = sort.is_signed();
+    const long long x = to_signed(sort, larg);
+    const long long y = to_signed(sort, rarg);
+
+    switch (opcode)
+    {
+    case ADD: value = truncate(sort, larg + rarg); return true;
+    case SUB: value = truncate(sort, larg - rarg); return true;
+    case MUL: value = truncate(sort, larg * rarg); return true;
+    case AND: value = larg & rarg; return true;
+    case OR:  value = larg | rarg; return true;
+    case XOR: value = larg ^ rarg; return true;
+
+    // shifting by the bit width or more yields zero in SMT-LIB
+    case LSHL:
+      value = rarg < bv_size ? truncate(sort, larg << rarg) : 0;
+      return true;
+
+    case LSHR:
+      value = rarg < bv_size ? larg >> rarg : 0;
+      return true;
+
+    // signed division and remainder are left to the solver
+    case QUO:
+      if (is_signed || rarg == 0)
+        return false;
+
+      value = larg / rarg;
+      return true;
+
+    case EQL: value = larg == rarg; return true;
+    case NEQ: value = larg != rarg; return true;
+    case LSS: value = is_signed ? x <  y : larg <  rarg; return true;
+    case GTR: value = is_signed ? x >  y : larg >  rarg; return true;
+    case LEQ: value = is_signed ? x <= y : larg <= rarg; return true;
+    case GEQ: value = is_signed ? x >= y : larg >= rarg; return true;
+    default:  return false;
+    }
+  }
+
+  assert(sort.is_int());
+
+  constexpr long long max = std::numeric_limits<long long>::max();
+  constexpr long long min = std::numeric_limits<long long>::min();
+
+  // products of such numbers cannot overflow
+  constexpr long long max_factor = std::numeric_limits<int32_t>::max();
+
+  const long long x = static_cast<long long>(larg);
+  const long long y = static_cast<long long>(rarg);
+
+  switch (opcode)
+  {
+  case ADD:
+    if ((0 < y && max - y < x) || (y < 0 && x < min - y))
+      return false;
+
+    value = static_cast<uint64_t>(x + y);
+    return true;
+
+  case SUB:
+    if ((y < 0 && max + y < x) || (0 < y && x < min + y))
+      return false;
+
+    value = static_cast<uint64_t>(x - y);
+    return true;
+
+  case MUL:
+    if (x < -max_factor || max_factor < x || y < -max_factor || max_factor < y)
+      return false;
+
+    value = static_cast<uint64_t>(x * y);
+    return true;
+
+  case EQL: value = x == y; return true;
+  case NEQ: value = x != y; return true;
+  case LSS: value = x <  y; return true;
+  case GTR: value = x >  y; return true;
+  case LEQ: value = x <= y; return true;
+  case GEQ: value = x >= y; return true;
+  default:  return false;
+  }
+}
+
+Simplifier::Rewrite Simplifier::rewrite(const SharedExpr& arg) const
+{
+  const Rewrite* const rewrite_ptr = m_rewrite_table.find(&arg.ref());
+
+  // arguments are rewritten first, see Solver::encode_dag()
+  assert(rewrite_ptr != nullptr);
+
+  if (rewrite_ptr == nullptr)
+    return Rewrite{arg, false, 0};
+
+  if (rewrite_ptr->expr.is_null())
+    return Rewrite{arg, rewrite_ptr->is_value, rewrite_ptr->value};
+
+  return *rewrite_ptr;
+}
+
+Error Simplifier::unchanged(const Expr* const expr)
+{
+  m_rewrite_table.insert(expr, Rewrite{SharedExpr(), false, 0});
+  return OK;
+}
+
+Error Simplifier::replace(const Expr* const expr, const Rewrite& rewrite)
+{
+  assert(!rewrite.expr.is_null());
+
+  if (&rewrite.expr.ref() == expr)
+    m_rewrite_table.insert(expr,
+      Rewrite{SharedExpr(), rewrite.is_value, rewrite.value});
+  else
+    m_rewrite_table.insert(expr, rewrite);
+
+  return OK;
+}
+
+Error Simplifier::replace(const Expr* const expr, SharedExpr&& rewrite)
+{
+  return replace(expr, Rewrite{std::move(rewrite), false, 0});
+}
+
+Error Simplifier::fold(const Expr* const expr, const uint64_t value)
+{
+  ++m_rule_stats.constant_folds;
+
+  SharedExpr literal_expr(make_literal(expr->sort(), value));
+
+  // so that the literal's value is known when it occurs elsewhere
+  if (!__is_encoded(&literal_expr.ref()))
+    m_rewrite_table.insert(&literal_expr.ref(),
+      Rewrite{SharedExpr(), true, value});
+
+  return replace(expr, Rewrite{std::move(literal_expr), true, value});
+}
+
+template<Opcode opcode>
+Error Simplifier::rewrite_unary(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  const Rewrite a(rewrite(arg));
+
+  uint64_t value;
+  if (a.is_value && fold_unary(opcode, arg.sort(), a.value, value))
+    return fold(expr, value);
+
+  if (a.expr.expr_kind() == UNARY_EXPR_KIND)
+  {
+    const UnaryExpr<opcode>* const unary_ptr =
+      dynamic_cast<const UnaryExpr<opcode>*>(&a.expr.ref());
+
+    // all unary operators are involutions
+    if (unary_ptr != nullptr)
+    {
+      ++m_rule_stats.double_negations;
+
+      const SharedExpr& operand = unary_ptr->operand();
+      const Rewrite* const rewrite_ptr = m_rewrite_table.find(&operand.ref());
+      if (rewrite_ptr == nullptr || !rewrite_ptr->expr.is_null())
+        return replace(expr, Rewrite{operand, false, 0});
+
+      return replace(expr,
+        Rewrite{operand, rewrite_ptr->is_value, rewrite_ptr->value});
+    }
+  }
+
+  if (a.expr.addr() == arg.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<UnaryExpr<opcode>>(expr->sort(), a.expr));
+}
+
+template<Opcode opcode>
+Error Simplifier::rewrite_binary(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const Rewrite l(rewrite(larg));
+  const Rewrite r(rewrite(rarg));
+  const Sort& sort = larg.sort();
+
+  uint64_t value;
+  if (l.is_value && r.is_value &&
+      fold_binary(opcode, sort, l.value, r.value, value))
+    return fold(expr, value);
+
+  const bool is_same = l.expr.addr() == r.expr.addr();
+  switch (opcode)
+  {
+  case IMP:
+    if (l.is_value && l.value)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, r);
+    }
+
+    if ((l.is_value && !l.value) || (r.is_value && r.value))
+    {
+      ++m_rule_stats.absorptions;
+      return replace(expr, Rewrite{Identity<LAND, Bool>::term, true, 1});
+    }
+
+    if (is_same)
+    {
+      ++m_rule_stats.trivial_relations;
+      return replace(expr, Rewrite{Identity<LAND, Bool>::term, true, 1});
+    }
+    break;
+
+  case EQL:
+    if (sort.is_bool() && l.is_value && l.value)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, r);
+    }
+
+    if (sort.is_bool() && r.is_value && r.value)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, l);
+    }
+    // fall through
+
+  case LEQ:
+  case GEQ:
+    if (is_same)
+    {
+      ++m_rule_stats.trivial_relations;
+      return replace(expr, Rewrite{Identity<LAND, Bool>::term, true, 1});
+    }
+    break;
+
+  case NEQ:
+  case LSS:
+  case GTR:
+    if (is_same)
+    {
+      ++m_rule_stats.trivial_relations;
+      return replace(expr, Rewrite{Identity<LOR, Bool>::term, true, 0});
+    }
+    break;
+
+  case ADD:
+  case OR:
+  case XOR:
+    if (l.is_value && l.value == 0)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, r);
+    }
+    // fall through
+
+  case SUB:
+  case LSHL:
+  case LSHR:
+    if (r.is_value && r.value == 0)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, l);
+    }
+    break;
+
+  case MUL:
+  case AND:
+    if (l.is_value && l.value == 0)
+    {
+      ++m_rule_stats.absorptions;
+      return replace(expr, l);
+    }
+
+    if (r.is_value && r.value == 0)
+    {
+      ++m_rule_stats.absorptions;
+      return replace(expr, r);
+    }
+
+    // for bit vectors, the identity of AND is not one but all ones
+    if (opcode == MUL || sort.is_bool())
+    {
+      if (l.is_value && l.value == 1)
+      {
+        ++m_rule_stats.identities;
+        return replace(expr, r);
+      }
+
+      if (r.is_value && r.value == 1)
+      {
+        ++m_rule_stats.identities;
+        return replace(expr, l);
+      }
+    }
+    break;
+
+  case QUO:
+    if (r.is_value && r.value == 1)
+    {
+      ++m_rule_stats.identities;
+      return replace(expr, l);
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  if (l.expr.addr() == larg.addr() && r.expr.addr() == rarg.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<BinaryExpr<opcode>>(expr->sort(), l.expr, r.expr));
+}
+
+template<Opcode opcode>
+Error Simplifier::rewrite_nary(
+  const Expr* const expr,
+  const SharedExprs& args)
+{
+  bool is_changed = false;
+  SharedExprs operands;
+  operands.reserve(args.size());
+  for (const SharedExpr& arg : args)
+  {
+    operands.push_back(rewrite(arg).expr);
+    is_changed |= operands.back().addr() != arg.addr();
+  }
+
+  if (!is_changed)
+    return unchanged(expr);
+
+  return replace(expr, make_shared_expr<NaryExpr<opcode>>(
+    expr->sort(), std::move(operands)));
+}
+
+template<Opcode opcode>
+Error Simplifier::rewrite_connective(
+  const Expr* const expr,
+  const SharedExprs& args)
+{
+  static_assert(opcode == LAND || opcode == LOR, "Logical connective");
+
+  // Boolean value of the identity element
+  constexpr uint64_t identity = opcode == LAND;
+
+  bool is_changed = false;
+  SharedExprs rewritten_args;
+  rewritten_args.reserve(args.size());
+  for (const SharedExpr& arg : args)
+  {
+    Rewrite a(rewrite(arg));
+    if (a.is_value)
+    {
+      if (a.value == identity)
+      {
+        ++m_rule_stats.identities;
+        is_changed = true;
+        continue;
+      }
+
+      ++m_rule_stats.absorptions;
+      return replace(expr, a);
+    }
+
+    is_changed |= a.expr.addr() != arg.addr();
+    rewritten_args.push_back(std::move(a.expr));
+  }
+
+  if (rewritten_args.empty())
+    return replace(expr, Rewrite{Identity<opcode, Bool>::term, true, identity});
+
+  if (rewritten_args.size() == 1)
+    return replace(expr, Rewrite{std::move(rewritten_args.front()), false, 0});
+
+  SharedExprs operands;
+  operands.reserve(rewritten_args.size());
+  for (SharedExpr& arg : rewritten_args)
+  {
+    // rewritten arguments are already flat
+    const Expr& arg_ref = arg.ref();
+    if (arg_ref.expr_kind() == BINARY_EXPR_KIND)
+    {
+      const BinaryExpr<opcode>* const binary_ptr =
+        dynamic_cast<const BinaryExpr<opcode>*>(&arg_ref);
+
+      if (binary_ptr != nullptr)
+      {
+        ++m_rule_stats.flattenings;
+        is_changed = true;
+        operands.push_back(binary_ptr->loperand());
+        operands.push_back(binary_ptr->roperand());
+        continue;
+      }
+    }
+    else if (arg_ref.expr_kind() == NARY_EXPR_KIND)
+    {
+      const NaryExpr<opcode>* const nary_ptr =
+        dynamic_cast<const NaryExpr<opcode>*>(&arg_ref);
+
+      if (nary_ptr != nullptr)
+      {
+        ++m_rule_stats.flattenings;
+        is_changed = true;
+        operands.insert(operands.end(), nary_ptr->operands().cbegin(),
+          nary_ptr->operands().cend());
+        continue;
+      }
+    }
+
+    operands.push_back(std::move(arg));
+  }
+
+  if (!is_changed)
+    return unchanged(expr);
+
+  if (operands.size() == 2)
+    return replace(expr, make_shared_expr<BinaryExpr<opcode>>(
+      expr->sort(), operands.front(), operands.back()));
+
+  return replace(expr, make_shared_expr<NaryExpr<opcode>>(
+    expr->sort(), std::move(operands)));
+}
+
+#define SMT_SIMPLIFIER_ENCODE_UNARY_DEF(name, opcode)                          \
+  Error Simplifier::__encode_unary_##name(                                     \
+    const Expr* const expr,                                                    \
+    const SharedExpr& arg)                                                     \
+  {                                                                            \
+    return rewrite_unary<opcode>(expr, arg);                                   \
+  }                                                                            \
+
+#define SMT_SIMPLIFIER_ENCODE_BINARY_DEF(name, opcode)                         \
+  Error Simplifier::__encode_binary_##name(                                    \
+    const Expr* const expr,                                                    \
+    const SharedExpr& larg,                                                    \
+    const SharedExpr& rarg)                                                    \
+  {                                                                            \
+    return rewrite_binary<opcode>(expr, larg, rarg);                           \
+  }                                                                            \
+
+SMT_SIMPLIFIER_ENCODE_UNARY_DEF(lnot, LNOT)
+SMT_SIMPLIFIER_ENCODE_UNARY_DEF(not, NOT)
+SMT_SIMPLIFIER_ENCODE_UNARY_DEF(sub, SUB)
+
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(sub, SUB)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(and, AND)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(or, OR)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(xor, XOR)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(lshl, LSHL)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(lshr, LSHR)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(imp, IMP)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(eql, EQL)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(add, ADD)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(mul, MUL)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(quo, QUO)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(rem, REM)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(lss, LSS)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(gtr, GTR)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(neq, NEQ)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(leq, LEQ)
+SMT_SIMPLIFIER_ENCODE_BINARY_DEF(geq, GEQ)
+
+Error Simplifier::__encode_binary_land(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return rewrite_connective<LAND>(expr, SharedExprs{larg, rarg});
+}
+
+Error Simplifier::__encode_binary_lor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return rewrite_connective<LOR>(expr, SharedExprs{larg, rarg});
+}
+
+Error Simplifier::__encode_constant(
+  const Expr* const expr,
+  const UnsafeDecl& decl)
+{
+  return unchanged(expr);
+}
+
+Error Simplifier::__encode_func_app(
+  const Expr* const expr,
+  const UnsafeDecl& func_decl,
+  const size_t arity,
+  const SharedExpr* const args)
+{
+  return unchanged(expr);
+}
+
+Error Simplifier::__encode_const_array(
+  const Expr* const expr,
+  const SharedExpr& init)
+{
+  const Rewrite i(rewrite(init));
+  if (i.expr.addr() == init.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<ConstArrayExpr>(expr->sort(), i.expr));
+}
+
+Error Simplifier::__encode_array_select(
+  const Expr* const expr,
+  const SharedExpr& array,
+  const SharedExpr& index)
+{
+  const Rewrite a(rewrite(array));
+  const Rewrite i(rewrite(index));
+  if (a.expr.addr() == array.addr() && i.expr.addr() == index.addr())
+    return unchanged(expr);
+
+  return replace(expr, make_shared_expr<ArraySelectExpr>(a.expr, i.expr));
+}
+
+Error Simplifier::__encode_array_store(
+  const Expr* const expr,
+  const SharedExpr& array,
+  const SharedExpr& index,
+  const SharedExpr& value)
+{
+  const Rewrite a(rewrite(array));
+  const Rewrite i(rewrite(index));
+  const Rewrite v(rewrite(value));
+  if (a.expr.addr() == array.addr() && i.expr.addr() == index.addr() &&
+      v.expr.addr() == value.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<ArrayStoreExpr>(a.expr, i.expr, v.expr));
+}
+
+Error Simplifier::__encode_nary(
+  const Expr* const expr,
+  Opcode opcode,
+  const SharedExprs& args)
+{
+  switch (opcode)
+  {
+  case LAND: return rewrite_connective<LAND>(expr, args);
+  case LOR:  return rewrite_connective<LOR>(expr, args);
+  case NEQ:  return rewrite_nary<NEQ>(expr, args);
+  default:   return unchanged(expr);
+  }
+}
+
+Error Simplifier::__encode_bv_zero_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  const Rewrite b(rewrite(bv));
+  if (b.expr.addr() == bv.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<BvZeroExtendExpr>(expr->sort(), b.expr, ext));
+}
+
+Error Simplifier::__encode_bv_sign_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  const Rewrite b(rewrite(bv));
+  if (b.expr.addr() == bv.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<BvSignExtendExpr>(expr->sort(), b.expr, ext));
+}
+
+Error Simplifier::__encode_bv_extract(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned high,
+  const unsigned low)
+{
+  const Rewrite b(rewrite(bv));
+  if (b.expr.addr() == bv.addr())
+    return unchanged(expr);
+
+  return replace(expr,
+    make_shared_expr<BvExtractExpr>(expr->sort(), b.expr, high, low));
+}
+
+Error Simplifier::__add(const Bool& condition)
+{
+  return UNSUPPORT_ERROR;
+}
+
+Error Simplifier::__unsafe_add(const SharedExpr& condition)
+{
+  return UNSUPPORT_ERROR;
+}
+
+CheckResult Simplifier::__check()
+{
+  return unknown;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+Simplifier::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  return {unknown, 0};
+}
+
+SharedExpr Simplifier::simplify(const SharedExpr& expr)
+{
+  if (!__is_encoded(&expr.ref()))
+  {
+    const Error err = expr.encode(*this);
+    assert(err == OK);
+  }
+
+  const Rewrite* const rewrite_ptr = m_rewrite_table.find(&expr.ref());
+  assert(rewrite_ptr != nullptr);
+
+  if (rewrite_ptr->expr.is_null())
+    return expr;
+
+  return rewrite_ptr->expr;
+}
 
 }
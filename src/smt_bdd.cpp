@@ -0,0 +1,889 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_bdd.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+using bdd::BDD;
+
+BddSolver::BddSolver()
+: Solver(),
+  m_manager(),
+  m_max_exact_width(0),
+  m_is_atom(),
+  m_first_vars(),
+  m_constant_table(),
+  m_bits_table(),
+  m_bits(),
+  m_levels()
+{
+  init_manager();
+}
+
+BddSolver::BddSolver(Logic logic)
+: Solver(logic),
+  m_manager(),
+  m_max_exact_width(0),
+  m_is_atom(),
+  m_first_vars(),
+  m_constant_table(),
+  m_bits_table(),
+  m_bits(),
+  m_levels()
+{
+  init_manager();
+}
+
+void BddSolver::init_manager()
+{
+  // drop every BDD object of the old manager first
+  m_constant_table.clear();
+  m_bits_table.clear();
+  m_bits.clear();
+  m_levels.clear();
+  m_is_atom.clear();
+  m_first_vars.clear();
+
+  m_manager.reset(new bdd::BDDManager());
+  m_levels.push_back(Level{m_manager->True(), true});
+}
+
+BDD BddSolver::new_var(const std::string& label, const bool is_atom)
+{
+  m_first_vars.push_back(m_is_atom.size());
+  m_is_atom.push_back(is_atom);
+  return m_manager->make_var(label);
+}
+
+BddSolver::Bits BddSolver::mk_not(const Bits& a)
+{
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = !a[i];
+
+  return r;
+}
+
+BddSolver::Bits BddSolver::mk_and(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = a[i] & b[i];
+
+  return r;
+}
+
+BddSolver::Bits BddSolver::mk_or(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = a[i] | b[i];
+
+  return r;
+}
+
+BddSolver::Bits BddSolver::mk_xor(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = a[i] ^ b[i];
+
+  return r;
+}
+
+// ripple-carry adder
+BddSolver::Bits BddSolver::mk_add(const Bits& a, const Bits& b, BDD carry)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    const BDD x = a[i] ^ b[i];
+    r[i] = x ^ carry;
+    carry = (a[i] & b[i]) | (x & carry);
+  }
+
+  return r;
+}
+
+BddSolver::Bits BddSolver::mk_neg(const Bits& a)
+{
+  return mk_add(mk_not(a), Bits(a.size(), m_manager->False()),
+    m_manager->True());
+}
+
+// shift-and-add multiplier truncated to the width of the operands
+BddSolver::Bits BddSolver::mk_mul(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  const size_t n = a.size();
+  Bits r(n, m_manager->False());
+  Bits partial(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (b[i].is_false())
+      continue;
+
+    for (size_t j = 0; j < n; ++j)
+      partial[j] = j < i ? m_manager->False() : a[j - i] & b[i];
+
+    r = mk_add(r, partial, m_manager->False());
+  }
+
+  return r;
+}
+
+BDD BddSolver::mk_eq(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  BDD r = m_manager->True();
+  for (size_t i = 0; i < a.size(); ++i)
+    r = r & (a[i] == b[i]);
+
+  return r;
+}
+
+BDD BddSolver::mk_lt(const Bits& a, const Bits& b, const bool is_signed)
+{
+  assert(a.size() == b.size());
+
+  // from the least significant bit upwards, the highest differing bit
+  // decides; in two's complement, the sign bit has the opposite meaning
+  BDD r = m_manager->False();
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    const bool is_sign_bit = is_signed && i + 1 == a.size();
+    r = ite(a[i] ^ b[i], is_sign_bit ? a[i] : b[i], r);
+  }
+
+  return r;
+}
+
+bool BddSolver::find_bits(const Expr* const expr)
+{
+  const Bits* const bits_ptr = m_bits_table.find(expr);
+  if (bits_ptr == nullptr)
+    return false;
+
+  m_bits = *bits_ptr;
+  return true;
+}
+
+void BddSolver::cache_bits(const Expr* const expr)
+{
+  m_bits_table.insert(expr, m_bits);
+}
+
+Error BddSolver::abstract_atom(const Expr* const expr)
+{
+  assert(expr->sort().is_bool());
+
+  const std::string label = "atom!" + std::to_string(m_is_atom.size());
+  m_bits.assign(1, new_var(label, true));
+  cache_bits(expr);
+  return OK;
+}
+
+Error BddSolver::encode_opaque(const Expr* const expr)
+{
+  if (expr->sort().is_bool())
+    return abstract_atom(expr);
+
+  m_bits.clear();
+  cache_bits(expr);
+  return OK;
+}
+
+bool BddSolver::has_atom(const BDD& f) const
+{
+  for (const unsigned var : m_manager->support(f))
+    if (m_is_atom[var])
+      return true;
+
+  return false;
+}
+
+template<class F>
+Error BddSolver::encode_unary(
+  const Expr* const expr,
+  const SharedExpr& arg,
+  F f)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Error err = arg.encode(*this);
+  if (err)
+    return err;
+
+  if (m_bits.empty())
+    return encode_opaque(expr);
+
+  m_bits = f(m_bits);
+  cache_bits(expr);
+  return OK;
+}
+
+template<class F>
+Error BddSolver::encode_binary(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg,
+  F f)
+{
+  if (find_bits(expr))
+    return OK;
+
+  Error err;
+  err = larg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits lbits(std::move(m_bits));
+
+  err = rarg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits rbits(std::move(m_bits));
+
+  if (lbits.empty() || rbits.empty())
+    return encode_opaque(expr);
+
+  m_bits = f(lbits, rbits);
+  cache_bits(expr);
+  return OK;
+}
+
+template<class F>
+Error BddSolver::encode_relation(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg,
+  F f)
+{
+  if (find_bits(expr))
+    return OK;
+
+  Error err;
+  err = larg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits lbits(std::move(m_bits));
+
+  err = rarg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits rbits(std::move(m_bits));
+
+  if (lbits.empty() || rbits.empty())
+    return abstract_atom(expr);
+
+  m_bits.assign(1, f(lbits, rbits));
+  cache_bits(expr);
+  return OK;
+}
+
+Error BddSolver::encode_bits_literal(
+  const Expr* const expr,
+  const unsigned long long literal)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Sort& sort = expr->sort();
+  if (sort.is_bool())
+  {
+    m_bits.assign(1, literal ? m_manager->True() : m_manager->False());
+  }
+  else if (sort.is_bv())
+  {
+    m_bits.resize(sort.bv_size());
+    for (size_t i = 0; i < m_bits.size(); ++i)
+    {
+      const size_t k = std::min<size_t>(i, 63);
+      m_bits[i] = (literal >> k) & 1 ? m_manager->True() : m_manager->False();
+    }
+  }
+  else
+  {
+    return encode_opaque(expr);
+  }
+
+  cache_bits(expr);
+  return OK;
+}
+
+Error BddSolver::__encode_constant(
+  const Expr* const expr,
+  const UnsafeDecl& decl)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Sort& sort = decl.sort();
+  size_t size;
+  if (sort.is_bool())
+    size = 1;
+  else if (sort.is_bv() && sort.bv_size() <= m_max_exact_width)
+    size = sort.bv_size();
+  else
+    return encode_opaque(expr);
+
+  // distinct expressions may declare the same constant
+  const std::string& symbol = decl.symbol();
+  Bits& bits = m_constant_table[symbol];
+  if (bits.empty())
+  {
+    if (sort.is_bool())
+    {
+      bits.push_back(new_var(symbol, false));
+    }
+    else
+    {
+      const unsigned first = m_first_vars.size();
+      for (size_t i = 0; i < size; ++i)
+      {
+        bits.push_back(
+          new_var(symbol + "[" + std::to_string(i) + "]", false));
+        m_first_vars.back() = first;
+      }
+    }
+  }
+
+  // overloaded symbols are not supported
+  if (bits.size() != size)
+    return encode_opaque(expr);
+
+  m_bits = bits;
+  cache_bits(expr);
+  return OK;
+}
+
+Error BddSolver::__encode_func_app(
+  const Expr* const expr,
+  const UnsafeDecl& func_decl,
+  const size_t arity,
+  const SharedExpr* const args)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_array_select(
+  const Expr* const expr,
+  const SharedExpr& array,
+  const SharedExpr& index)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_unary_lnot(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return encode_unary(expr, arg,
+    [this](const Bits& a) { return mk_not(a); });
+}
+
+Error BddSolver::__encode_unary_not(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return encode_unary(expr, arg,
+    [this](const Bits& a) { return mk_not(a); });
+}
+
+Error BddSolver::__encode_unary_sub(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return encode_unary(expr, arg,
+    [this](const Bits& a) { return mk_neg(a); });
+}
+
+Error BddSolver::__encode_binary_sub(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b)
+    {
+      return mk_add(a, mk_not(b), m_manager->True());
+    });
+}
+
+Error BddSolver::__encode_binary_and(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_and(a, b); });
+}
+
+Error BddSolver::__encode_binary_or(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(a, b); });
+}
+
+Error BddSolver::__encode_binary_xor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_xor(a, b); });
+}
+
+// shifts, divisions and remainders are opaque
+Error BddSolver::__encode_binary_lshl(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_binary_lshr(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_binary_land(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_and(a, b); });
+}
+
+Error BddSolver::__encode_binary_lor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(a, b); });
+}
+
+Error BddSolver::__encode_binary_imp(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(mk_not(a), b); });
+}
+
+Error BddSolver::__encode_binary_eql(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_relation(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_eq(a, b); });
+}
+
+Error BddSolver::__encode_binary_add(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b)
+    {
+      return mk_add(a, b, m_manager->False());
+    });
+}
+
+Error BddSolver::__encode_binary_mul(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_mul(a, b); });
+}
+
+Error BddSolver::__encode_binary_quo(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_binary_rem(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  if (find_bits(expr))
+    return OK;
+
+  return encode_opaque(expr);
+}
+
+Error BddSolver::__encode_binary_lss(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return encode_relation(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return mk_lt(a, b, is_signed);
+    });
+}
+
+Error BddSolver::__encode_binary_gtr(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return encode_relation(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return mk_lt(b, a, is_signed);
+    });
+}
+
+Error BddSolver::__encode_binary_neq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return encode_relation(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return !mk_eq(a, b); });
+}
+
+Error BddSolver::__encode_binary_leq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return encode_relation(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return !mk_lt(b, a, is_signed);
+    });
+}
+
+Error BddSolver::__encode_binary_geq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return encode_relation(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return !mk_lt(a, b, is_signed);
+    });
+}
+
+Error BddSolver::__encode_nary(
+  const Expr* const expr,
+  Opcode opcode,
+  const SharedExprs& args)
+{
+  if (find_bits(expr))
+    return OK;
+
+  switch (opcode)
+  {
+  case NEQ:
+  case LAND:
+  case LOR:
+    break;
+  default:
+    return encode_opaque(expr);
+  }
+
+  std::vector<Bits> args_bits;
+  args_bits.reserve(args.size());
+  for (const SharedExpr& arg : args)
+  {
+    const Error err = arg.encode(*this);
+    if (err)
+      return err;
+
+    // Boolean arguments are never opaque
+    if (m_bits.empty())
+    {
+      assert(opcode == NEQ);
+      return abstract_atom(expr);
+    }
+
+    args_bits.push_back(std::move(m_bits));
+  }
+
+  BDD r;
+  if (opcode == LAND)
+  {
+    r = m_manager->True();
+    for (const Bits& bits : args_bits)
+      r = r & bits[0];
+  }
+  else if (opcode == LOR)
+  {
+    r = m_manager->False();
+    for (const Bits& bits : args_bits)
+      r = r | bits[0];
+  }
+  else
+  {
+    // pairwise distinct
+    r = m_manager->True();
+    for (size_t i = 0; i < args_bits.size(); ++i)
+      for (size_t j = i + 1; j < args_bits.size(); ++j)
+        r = r & !mk_eq(args_bits[i], args_bits[j]);
+  }
+
+  m_bits.assign(1, r);
+  cache_bits(expr);
+  return OK;
+}
+
+Error BddSolver::__encode_bv_zero_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  return encode_unary(expr, bv,
+    [this, ext](const Bits& a)
+    {
+      Bits r(a);
+      r.resize(a.size() + ext, m_manager->False());
+      return r;
+    });
+}
+
+Error BddSolver::__encode_bv_sign_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  return encode_unary(expr, bv,
+    [ext](const Bits& a)
+    {
+      Bits r(a);
+      r.resize(a.size() + ext, a.back());
+      return r;
+    });
+}
+
+Error BddSolver::__encode_bv_extract(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned high,
+  const unsigned low)
+{
+  return encode_unary(expr, bv,
+    [high, low](const Bits& a)
+    {
+      assert(low <= high && high < a.size());
+      return Bits(a.begin() + low, a.begin() + high + 1);
+    });
+}
+
+void BddSolver::__reset()
+{
+  init_manager();
+}
+
+void BddSolver::__push()
+{
+  m_levels.push_back(m_levels.back());
+}
+
+void BddSolver::__pop()
+{
+  assert(1 < m_levels.size());
+  m_levels.pop_back();
+}
+
+Error BddSolver::__unsafe_add(const SharedExpr& condition)
+{
+  const Error err = condition.encode(*this);
+  if (err)
+    return err;
+
+  assert(m_bits.size() == 1);
+
+  Level& level = m_levels.back();
+  level.conjunction = level.conjunction & m_bits[0];
+  level.is_exact = level.is_exact && !has_atom(m_bits[0]);
+  return OK;
+}
+
+Error BddSolver::__add(const Bool& condition)
+{
+  return __unsafe_add(condition);
+}
+
+CheckResult BddSolver::__check()
+{
+  const Level& level = m_levels.back();
+  if (level.conjunction.is_false())
+    return unsat;
+
+  return level.is_exact ? sat : unknown;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+BddSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  const Level& level = m_levels.back();
+
+  Bits bits;
+  bits.reserve(assumptions.size());
+  bool is_exact = level.is_exact;
+  BDD conjunction = level.conjunction;
+  for (const SharedExpr& assumption : assumptions)
+  {
+    const Error err = assumption.encode(*this);
+    if (err)
+      return {unknown, 0};
+
+    is_exact = is_exact && !has_atom(m_bits[0]);
+    conjunction = conjunction & m_bits[0];
+    bits.push_back(m_bits[0]);
+  }
+
+  if (!conjunction.is_false())
+    return {is_exact ? sat : unknown, 0};
+
+  if (unsat_core.empty())
+    return {unsat, 0};
+
+  // assumptions that encode to the same BDD are duplicates
+  std::vector<bool> is_core(assumptions.size(), true);
+  for (size_t i = 0; i < bits.size(); ++i)
+    for (size_t j = 0; j < i && is_core[i]; ++j)
+      if (bits[i].id() == bits[j].id())
+        is_core[i] = false;
+
+  // deletion-based minimization from the lowest index upwards
+  for (size_t i = 0; i < bits.size(); ++i)
+  {
+    if (!is_core[i])
+      continue;
+
+    BDD rest = level.conjunction;
+    for (size_t j = 0; j < bits.size() && !rest.is_false(); ++j)
+      if (j != i && is_core[j])
+        rest = rest & bits[j];
+
+    if (rest.is_false())
+      is_core[i] = false;
+  }
+
+  SharedExprs::size_type k = unsat_core.size();
+  for (size_t i = assumptions.size(); i != 0 && k != 0; --i)
+    if (is_core[i - 1])
+      unsat_core[--k] = assumptions[i - 1];
+
+  return {unsat, unsat_core.size() - k};
+}
+
+double BddSolver::model_count() const
+{
+  const BDD& conjunction = m_levels.back().conjunction;
+
+  // widen the support to whole bit vector constants, whose bits are
+  // consecutive, so that bits fixed by no assertion are counted too
+  size_t vars = 0;
+  unsigned end = 0;
+  for (const unsigned var : m_manager->support(conjunction))
+  {
+    if (var < end)
+      continue;
+
+    const unsigned first = m_first_vars[var];
+    for (end = var + 1; end < m_first_vars.size(); ++end)
+      if (m_first_vars[end] != first)
+        break;
+
+    vars += end - first;
+  }
+
+  return m_manager->sat_count(conjunction, vars);
+}
+
+static bool enumerate_cubes(
+  const BDD& f,
+  BddSolver::Cube& cube,
+  const std::function<bool(const BddSolver::Cube&)>& g)
+{
+  if (f.is_false())
+    return true;
+
+  if (f.is_true())
+    return g(cube);
+
+  cube.emplace_back(f.var(), false);
+  if (!enumerate_cubes(f.low(), cube, g))
+    return false;
+
+  cube.back().second = true;
+  if (!enumerate_cubes(f.high(), cube, g))
+    return false;
+
+  cube.pop_back();
+  return true;
+}
+
+void BddSolver::enumerate_cubes(
+  const std::function<bool(const Cube&)>& f) const
+{
+  Cube cube;
+  smt::enumerate_cubes(m_levels.back().conjunction, cube, f);
+}
+
+}
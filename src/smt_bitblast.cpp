@@ -0,0 +1,939 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_bitblast.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+BitBlastSolver::BitBlastSolver()
+: Solver(),
+  m_sat_solver(),
+  m_and_table(),
+  m_constant_table(),
+  m_bits_table(),
+  m_bits(),
+  m_activations(),
+  m_is_interrupted(false),
+  m_deadline()
+{
+  init_sat_solver();
+}
+
+BitBlastSolver::BitBlastSolver(Logic logic)
+: Solver(logic),
+  m_sat_solver(),
+  m_and_table(),
+  m_constant_table(),
+  m_bits_table(),
+  m_bits(),
+  m_activations(),
+  m_is_interrupted(false),
+  m_deadline()
+{
+  assert(logic == QF_BV_LOGIC);
+  init_sat_solver();
+}
+
+bool BitBlastSolver::is_terminated(void* const user_data)
+{
+  const BitBlastSolver& solver = *static_cast<const BitBlastSolver*>(user_data);
+  if (solver.m_is_interrupted.load() || solver.is_cancelled())
+    return true;
+
+  return solver.timeout() != ElapsedTime::zero() &&
+    solver.m_deadline <= DeadlineClock::now();
+}
+
+void BitBlastSolver::start_check()
+{
+  m_is_interrupted.store(false);
+  m_deadline = DeadlineClock::now() + timeout();
+}
+
+void BitBlastSolver::init_sat_solver()
+{
+  m_sat_solver.reset(new SatSolver());
+  m_sat_solver->set_termination_test(is_terminated, this);
+
+  // variable zero is the constant node of the AIG
+  const SatSolver::Var var = m_sat_solver->new_var();
+  assert(SatSolver::lit(var) == true_lit());
+  m_sat_solver->add_clause(true_lit());
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_and(Lit a, Lit b)
+{
+  if (a == false_lit() || b == false_lit() || a == SatSolver::negate(b))
+    return false_lit();
+
+  if (a == true_lit() || a == b)
+    return b;
+
+  if (b == true_lit())
+    return a;
+
+  if (b < a)
+    std::swap(a, b);
+
+  const uint64_t key = static_cast<uint64_t>(a) << 32 | b;
+  const auto iter = m_and_table.find(key);
+  if (iter != m_and_table.end())
+    return iter->second;
+
+  // Tseitin encoding of c <=> a && b
+  const Lit c = SatSolver::lit(m_sat_solver->new_var());
+  m_sat_solver->add_clause(SatSolver::negate(c), a);
+  m_sat_solver->add_clause(SatSolver::negate(c), b);
+  m_sat_solver->add_clause(c, SatSolver::negate(a), SatSolver::negate(b));
+
+  m_and_table.emplace(key, c);
+  return c;
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_or(const Lit a, const Lit b)
+{
+  return SatSolver::negate(mk_and(SatSolver::negate(a), SatSolver::negate(b)));
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_xor(const Lit a, const Lit b)
+{
+  return mk_or(mk_and(a, SatSolver::negate(b)), mk_and(SatSolver::negate(a), b));
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_ite(const Lit c, const Lit t, const Lit e)
+{
+  if (t == e)
+    return t;
+
+  return mk_or(mk_and(c, t), mk_and(SatSolver::negate(c), e));
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_not(const Bits& a)
+{
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = SatSolver::negate(a[i]);
+
+  return r;
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_and(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = mk_and(a[i], b[i]);
+
+  return r;
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_or(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = mk_or(a[i], b[i]);
+
+  return r;
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_xor(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+    r[i] = mk_xor(a[i], b[i]);
+
+  return r;
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_ite(
+  const Lit c,
+  const Bits& t,
+  const Bits& e)
+{
+  assert(t.size() == e.size());
+
+  Bits r(t.size());
+  for (size_t i = 0; i < t.size(); ++i)
+    r[i] = mk_ite(c, t[i], e[i]);
+
+  return r;
+}
+
+// ripple-carry adder
+BitBlastSolver::Bits BitBlastSolver::mk_add(
+  const Bits& a,
+  const Bits& b,
+  Lit carry)
+{
+  assert(a.size() == b.size());
+
+  Bits r(a.size());
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    const Lit x = mk_xor(a[i], b[i]);
+    r[i] = mk_xor(x, carry);
+    carry = mk_or(mk_and(a[i], b[i]), mk_and(x, carry));
+  }
+
+  return r;
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_neg(const Bits& a)
+{
+  return mk_add(mk_not(a), Bits(a.size(), false_lit()), true_lit());
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_sub(const Bits& a, const Bits& b)
+{
+  return mk_add(a, mk_not(b), true_lit());
+}
+
+// shift-and-add multiplier truncated to the width of the operands
+BitBlastSolver::Bits BitBlastSolver::mk_mul(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  const size_t n = a.size();
+  Bits r(n, false_lit());
+  Bits partial(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (b[i] == false_lit())
+      continue;
+
+    for (size_t j = 0; j < n; ++j)
+      partial[j] = j < i ? false_lit() : mk_and(a[j - i], b[i]);
+
+    r = mk_add(r, partial);
+  }
+
+  return r;
+}
+
+// barrel shifter, shifting by the width or more yields zero
+BitBlastSolver::Bits BitBlastSolver::mk_shl(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  const size_t n = a.size();
+  Bits r(a);
+  Bits shifted(n);
+  Lit overflow = false_lit();
+  for (size_t k = 0; k < n; ++k)
+  {
+    if (k >= 32 || (static_cast<size_t>(1) << k) >= n)
+    {
+      overflow = mk_or(overflow, b[k]);
+      continue;
+    }
+
+    const size_t distance = static_cast<size_t>(1) << k;
+    for (size_t i = 0; i < n; ++i)
+      shifted[i] = i < distance ? false_lit() : r[i - distance];
+
+    r = mk_ite(b[k], shifted, r);
+  }
+
+  return mk_and(r, Bits(n, SatSolver::negate(overflow)));
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_lshr(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  const size_t n = a.size();
+  Bits r(a);
+  Bits shifted(n);
+  Lit overflow = false_lit();
+  for (size_t k = 0; k < n; ++k)
+  {
+    if (k >= 32 || (static_cast<size_t>(1) << k) >= n)
+    {
+      overflow = mk_or(overflow, b[k]);
+      continue;
+    }
+
+    const size_t distance = static_cast<size_t>(1) << k;
+    for (size_t i = 0; i < n; ++i)
+      shifted[i] = i + distance < n ? r[i + distance] : false_lit();
+
+    r = mk_ite(b[k], shifted, r);
+  }
+
+  return mk_and(r, Bits(n, SatSolver::negate(overflow)));
+}
+
+// Restoring division. As in SMT-LIB, dividing by zero yields a quotient
+// whose bits are all set and a remainder equal to the dividend.
+void BitBlastSolver::mk_udivrem(
+  const Bits& a,
+  const Bits& b,
+  Bits& q,
+  Bits& r)
+{
+  assert(a.size() == b.size());
+
+  const size_t n = a.size();
+
+  // one more bit so that shifting the remainder cannot overflow
+  Bits wide_b(b);
+  wide_b.push_back(false_lit());
+
+  q.assign(n, false_lit());
+  r.assign(n, false_lit());
+
+  Bits wide_r(n + 1);
+  for (size_t i = n; i != 0; --i)
+  {
+    wide_r[0] = a[i - 1];
+    for (size_t j = 0; j < n; ++j)
+      wide_r[j + 1] = r[j];
+
+    const Bits diff = mk_sub(wide_r, wide_b);
+    const Lit is_geq = SatSolver::negate(mk_ult(wide_r, wide_b));
+    q[i - 1] = is_geq;
+
+    const Bits next = mk_ite(is_geq, diff, wide_r);
+    r.assign(next.begin(), next.begin() + n);
+  }
+}
+
+BitBlastSolver::Bits BitBlastSolver::mk_abs(const Bits& a)
+{
+  return mk_ite(a.back(), mk_neg(a), a);
+}
+
+// signed division truncates towards zero like bvsdiv in SMT-LIB
+BitBlastSolver::Bits BitBlastSolver::mk_div(
+  const Bits& a,
+  const Bits& b,
+  const bool is_signed)
+{
+  Bits q, r;
+  if (!is_signed)
+  {
+    mk_udivrem(a, b, q, r);
+    return q;
+  }
+
+  mk_udivrem(mk_abs(a), mk_abs(b), q, r);
+  return mk_ite(mk_xor(a.back(), b.back()), mk_neg(q), q);
+}
+
+// signed remainders have the sign of the dividend like bvsrem in SMT-LIB
+BitBlastSolver::Bits BitBlastSolver::mk_rem(
+  const Bits& a,
+  const Bits& b,
+  const bool is_signed)
+{
+  Bits q, r;
+  if (!is_signed)
+  {
+    mk_udivrem(a, b, q, r);
+    return r;
+  }
+
+  mk_udivrem(mk_abs(a), mk_abs(b), q, r);
+  return mk_ite(a.back(), mk_neg(r), r);
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_eq(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  Lit r = true_lit();
+  for (size_t i = 0; i < a.size(); ++i)
+    r = mk_and(r, SatSolver::negate(mk_xor(a[i], b[i])));
+
+  return r;
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_ult(const Bits& a, const Bits& b)
+{
+  assert(a.size() == b.size());
+
+  // from the least significant bit upwards, the highest differing bit
+  // decides
+  Lit r = false_lit();
+  for (size_t i = 0; i < a.size(); ++i)
+    r = mk_ite(mk_xor(a[i], b[i]), b[i], r);
+
+  return r;
+}
+
+BitBlastSolver::Lit BitBlastSolver::mk_lt(
+  const Bits& a,
+  const Bits& b,
+  const bool is_signed)
+{
+  if (!is_signed)
+    return mk_ult(a, b);
+
+  // two's complement order is the unsigned order with flipped sign bits
+  Bits x(a), y(b);
+  x.back() = SatSolver::negate(x.back());
+  y.back() = SatSolver::negate(y.back());
+  return mk_ult(x, y);
+}
+
+bool BitBlastSolver::find_bits(const Expr* const expr)
+{
+  const Bits* const bits_ptr = m_bits_table.find(expr);
+  if (bits_ptr == nullptr)
+    return false;
+
+  m_bits = *bits_ptr;
+  return true;
+}
+
+void BitBlastSolver::cache_bits(const Expr* const expr)
+{
+  m_bits_table.insert(expr, m_bits);
+}
+
+template<class F>
+Error BitBlastSolver::blast_unary(
+  const Expr* const expr,
+  const SharedExpr& arg,
+  F f)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Error err = arg.encode(*this);
+  if (err)
+    return err;
+
+  m_bits = f(m_bits);
+  cache_bits(expr);
+  return OK;
+}
+
+template<class F>
+Error BitBlastSolver::blast_binary(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg,
+  F f)
+{
+  if (find_bits(expr))
+    return OK;
+
+  Error err;
+  err = larg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits lbits(std::move(m_bits));
+
+  err = rarg.encode(*this);
+  if (err)
+    return err;
+
+  const Bits rbits(std::move(m_bits));
+
+  m_bits = f(lbits, rbits);
+  cache_bits(expr);
+  return OK;
+}
+
+Error BitBlastSolver::encode_bits_literal(
+  const Expr* const expr,
+  const unsigned long long literal)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Sort& sort = expr->sort();
+  if (sort.is_bool())
+  {
+    m_bits.assign(1, literal ? true_lit() : false_lit());
+  }
+  else if (sort.is_bv())
+  {
+    m_bits.resize(sort.bv_size());
+    for (size_t i = 0; i < m_bits.size(); ++i)
+    {
+      const size_t k = std::min<size_t>(i, 63);
+      m_bits[i] = (literal >> k) & 1 ? true_lit() : false_lit();
+    }
+  }
+  else
+  {
+    return UNSUPPORT_ERROR;
+  }
+
+  cache_bits(expr);
+  return OK;
+}
+
+Error BitBlastSolver::__encode_constant(
+  const Expr* const expr,
+  const UnsafeDecl& decl)
+{
+  if (find_bits(expr))
+    return OK;
+
+  const Sort& sort = decl.sort();
+  size_t size;
+  if (sort.is_bool())
+    size = 1;
+  else if (sort.is_bv())
+    size = sort.bv_size();
+  else
+    return UNSUPPORT_ERROR;
+
+  // distinct expressions may declare the same constant
+  Bits& bits = m_constant_table[decl.symbol()];
+  if (bits.empty())
+  {
+    bits.resize(size);
+    for (Lit& lit : bits)
+      lit = SatSolver::lit(m_sat_solver->new_var());
+  }
+
+  // overloaded symbols are not supported
+  if (bits.size() != size)
+    return UNSUPPORT_ERROR;
+
+  m_bits = bits;
+  cache_bits(expr);
+  return OK;
+}
+
+Error BitBlastSolver::__encode_unary_lnot(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return blast_unary(expr, arg,
+    [this](const Bits& a) { return mk_not(a); });
+}
+
+Error BitBlastSolver::__encode_unary_not(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return blast_unary(expr, arg,
+    [this](const Bits& a) { return mk_not(a); });
+}
+
+Error BitBlastSolver::__encode_unary_sub(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  return blast_unary(expr, arg,
+    [this](const Bits& a) { return mk_neg(a); });
+}
+
+Error BitBlastSolver::__encode_binary_sub(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_sub(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_and(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_and(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_or(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_xor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_xor(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_lshl(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_shl(a, b); });
+}
+
+// logical shift regardless of the sort's signedness, like Z3Solver
+Error BitBlastSolver::__encode_binary_lshr(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_lshr(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_land(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_and(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_lor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_imp(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_or(mk_not(a), b); });
+}
+
+Error BitBlastSolver::__encode_binary_eql(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return Bits{mk_eq(a, b)}; });
+}
+
+Error BitBlastSolver::__encode_binary_add(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_add(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_mul(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b) { return mk_mul(a, b); });
+}
+
+Error BitBlastSolver::__encode_binary_quo(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = expr->sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return mk_div(a, b, is_signed);
+    });
+}
+
+Error BitBlastSolver::__encode_binary_rem(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = expr->sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return mk_rem(a, b, is_signed);
+    });
+}
+
+Error BitBlastSolver::__encode_binary_lss(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return Bits{mk_lt(a, b, is_signed)};
+    });
+}
+
+Error BitBlastSolver::__encode_binary_gtr(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return Bits{mk_lt(b, a, is_signed)};
+    });
+}
+
+Error BitBlastSolver::__encode_binary_neq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  return blast_binary(expr, larg, rarg,
+    [this](const Bits& a, const Bits& b)
+    {
+      return Bits{SatSolver::negate(mk_eq(a, b))};
+    });
+}
+
+Error BitBlastSolver::__encode_binary_leq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return Bits{SatSolver::negate(mk_lt(b, a, is_signed))};
+    });
+}
+
+Error BitBlastSolver::__encode_binary_geq(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const bool is_signed = larg.sort().is_signed();
+  return blast_binary(expr, larg, rarg,
+    [this, is_signed](const Bits& a, const Bits& b)
+    {
+      return Bits{SatSolver::negate(mk_lt(a, b, is_signed))};
+    });
+}
+
+Error BitBlastSolver::__encode_nary(
+  const Expr* const expr,
+  Opcode opcode,
+  const SharedExprs& args)
+{
+  if (find_bits(expr))
+    return OK;
+
+  switch (opcode)
+  {
+  case NEQ:
+  case LAND:
+  case LOR:
+    break;
+  default:
+    return UNSUPPORT_ERROR;
+  }
+
+  Error err;
+  std::vector<Bits> args_bits;
+  args_bits.reserve(args.size());
+  for (const SharedExpr& arg : args)
+  {
+    err = arg.encode(*this);
+    if (err)
+      return err;
+
+    args_bits.push_back(std::move(m_bits));
+  }
+
+  Lit r;
+  if (opcode == LAND)
+  {
+    r = true_lit();
+    for (const Bits& bits : args_bits)
+      r = mk_and(r, bits[0]);
+  }
+  else if (opcode == LOR)
+  {
+    r = false_lit();
+    for (const Bits& bits : args_bits)
+      r = mk_or(r, bits[0]);
+  }
+  else
+  {
+    // pairwise distinct
+    r = true_lit();
+    for (size_t i = 0; i < args_bits.size(); ++i)
+      for (size_t j = i + 1; j < args_bits.size(); ++j)
+        r = mk_and(r, SatSolver::negate(mk_eq(args_bits[i], args_bits[j])));
+  }
+
+  m_bits.assign(1, r);
+  cache_bits(expr);
+  return OK;
+}
+
+Error BitBlastSolver::__encode_bv_zero_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  return blast_unary(expr, bv,
+    [ext](const Bits& a)
+    {
+      Bits r(a);
+      r.resize(a.size() + ext, false_lit());
+      return r;
+    });
+}
+
+Error BitBlastSolver::__encode_bv_sign_extend(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned ext)
+{
+  return blast_unary(expr, bv,
+    [ext](const Bits& a)
+    {
+      Bits r(a);
+      r.resize(a.size() + ext, a.back());
+      return r;
+    });
+}
+
+Error BitBlastSolver::__encode_bv_extract(
+  const Expr* const expr,
+  const SharedExpr& bv,
+  const unsigned high,
+  const unsigned low)
+{
+  return blast_unary(expr, bv,
+    [high, low](const Bits& a)
+    {
+      assert(low <= high && high < a.size());
+      return Bits(a.begin() + low, a.begin() + high + 1);
+    });
+}
+
+void BitBlastSolver::__reset()
+{
+  m_and_table.clear();
+  m_constant_table.clear();
+  m_bits_table.clear();
+  m_bits.clear();
+  m_activations.clear();
+
+  init_sat_solver();
+}
+
+void BitBlastSolver::__push()
+{
+  m_activations.push_back(SatSolver::lit(m_sat_solver->new_var()));
+}
+
+void BitBlastSolver::__pop()
+{
+  assert(!m_activations.empty());
+
+  // the assertions of the level can never hold again
+  m_sat_solver->add_clause(SatSolver::negate(m_activations.back()));
+  m_activations.pop_back();
+}
+
+Error BitBlastSolver::__unsafe_add(const SharedExpr& condition)
+{
+  const Error err = condition.encode(*this);
+  if (err)
+    return err;
+
+  assert(m_bits.size() == 1);
+
+  if (m_activations.empty())
+    m_sat_solver->add_clause(m_bits[0]);
+  else
+    m_sat_solver->add_clause(
+      SatSolver::negate(m_activations.back()), m_bits[0]);
+
+  return OK;
+}
+
+Error BitBlastSolver::__add(const Bool& condition)
+{
+  return __unsafe_add(condition);
+}
+
+CheckResult BitBlastSolver::__check()
+{
+  start_check();
+  return m_sat_solver->solve(m_activations);
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+BitBlastSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  std::vector<Lit> lits(m_activations);
+  lits.reserve(m_activations.size() + assumptions.size());
+  for (const SharedExpr& assumption : assumptions)
+  {
+    const Error err = assumption.encode(*this);
+    if (err)
+      return {unknown, 0};
+
+    lits.push_back(m_bits[0]);
+  }
+
+  start_check();
+  const CheckResult result = m_sat_solver->solve(lits);
+  if (result != unsat || unsat_core.empty())
+    return {result, 0};
+
+  std::vector<Lit> conflict(m_sat_solver->conflict());
+  std::sort(conflict.begin(), conflict.end());
+
+  // assumptions that encode to the same literal are duplicates
+  const Lit* const assumption_lits = lits.data() + m_activations.size();
+  size_t i, j;
+  SharedExprs::size_type k = unsat_core.size();
+  for (i = assumptions.size(); i != 0 && k != 0; --i)
+  {
+    const Lit lit = assumption_lits[i - 1];
+    for (j = i - 1; j != 0; --j)
+    {
+      if (lit == assumption_lits[j - 1])
+        goto SKIP_DUPLICATE;
+    }
+
+    if (std::binary_search(conflict.begin(), conflict.end(), lit))
+      unsat_core[--k] = assumptions[i - 1];
+
+    SKIP_DUPLICATE: continue;
+  }
+
+  return {unsat, unsat_core.size() - k};
+}
+
+void BitBlastSolver::__interrupt()
+{
+  m_is_interrupted.store(true);
+}
+
+}
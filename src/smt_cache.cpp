@@ -0,0 +1,255 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_cache.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+namespace
+{
+  bool is_less(const SharedExpr& x, const SharedExpr& y)
+  {
+    return &x.ref() < &y.ref();
+  }
+
+  bool is_same(const SharedExpr& x, const SharedExpr& y)
+  {
+    return &x.ref() == &y.ref();
+  }
+
+  // sorted by address and without duplicates
+  SharedExprs make_key(const SharedExprs& assertions)
+  {
+    SharedExprs key(assertions);
+    std::sort(key.begin(), key.end(), is_less);
+    key.erase(std::unique(key.begin(), key.end(), is_same), key.end());
+    return key;
+  }
+
+  // is x a subset of y?
+  bool is_subset(
+    const SharedExprs& x,
+    const uint64_t x_signature,
+    const SharedExprs& y,
+    const uint64_t y_signature)
+  {
+    return x.size() <= y.size() && (x_signature & ~y_signature) == 0 &&
+      std::includes(y.cbegin(), y.cend(), x.cbegin(), x.cend(), is_less);
+  }
+}
+
+size_t CachingSolver::KeyHash::operator()(const SharedExprs* const key) const
+{
+  size_t h = key->size();
+  for (const SharedExpr& expr : *key)
+    h = hash_combine(h, reinterpret_cast<uintptr_t>(&expr.ref()));
+
+  return h;
+}
+
+bool CachingSolver::KeyEqual::operator()(
+  const SharedExprs* const x,
+  const SharedExprs* const y) const
+{
+  return x->size() == y->size() &&
+    std::equal(x->cbegin(), x->cend(), y->cbegin(), is_same);
+}
+
+CachingSolver::CachingSolver(
+  Solver& solver,
+  const size_t capacity,
+  const size_t scan_limit)
+: DecoratorSolver(),
+  m_solver(solver),
+  m_capacity(capacity),
+  m_scan_limit(scan_limit),
+  m_entries(),
+  m_table(),
+  m_cache_stats{0, 0, 0, 0, 0, 0} {}
+
+uint64_t CachingSolver::signature(const SharedExprs& key)
+{
+  uint64_t signature = 0;
+  for (const SharedExpr& expr : key)
+  {
+    // top six bits of the multiplicative hash of the address
+    const uint64_t h = reinterpret_cast<uintptr_t>(&expr.ref()) *
+      UINT64_C(0x9e3779b97f4a7c15);
+
+    signature |= UINT64_C(1) << (h >> 58);
+  }
+
+  return signature;
+}
+
+template<typename Predicate>
+CachingSolver::Entries::iterator CachingSolver::find_entry(
+  Predicate predicate)
+{
+  size_t scanned = 0;
+  for (Entries::iterator iter = m_entries.begin();
+       iter != m_entries.end(); ++iter, ++scanned)
+  {
+    if (scanned == m_scan_limit)
+    {
+      ++m_cache_stats.scan_limit_hits;
+      break;
+    }
+
+    if (predicate(*iter))
+    {
+      // mark as most recently used
+      m_entries.splice(m_entries.begin(), m_entries, iter);
+      return iter;
+    }
+  }
+
+  return m_entries.end();
+}
+
+void CachingSolver::insert(
+  SharedExprs&& key,
+  const uint64_t signature,
+  const CheckResult result)
+{
+  if (m_capacity == 0)
+    return;
+
+  if (m_entries.size() == m_capacity)
+  {
+    m_table.erase(&m_entries.back().key);
+    m_entries.pop_back();
+    ++m_cache_stats.evictions;
+  }
+
+  m_entries.push_front(Entry{std::move(key), signature, result});
+  m_table.emplace(&m_entries.front().key, m_entries.begin());
+}
+
+void CachingSolver::clear_cache()
+{
+  m_table.clear();
+  m_entries.clear();
+}
+
+void CachingSolver::__reset()
+{
+  m_solver.reset();
+}
+
+void CachingSolver::__push()
+{
+  m_solver.push();
+}
+
+void CachingSolver::__pop()
+{
+  m_solver.pop();
+}
+
+Error CachingSolver::__add(const Bool& condition)
+{
+  m_solver.add(condition);
+  return OK;
+}
+
+Error CachingSolver::__unsafe_add(const SharedExpr& condition)
+{
+  m_solver.unsafe_add(condition);
+  return OK;
+}
+
+CheckResult CachingSolver::__check()
+{
+  SharedExprs key(make_key(assertions().terms));
+  const uint64_t key_signature = signature(key);
+
+  const auto iter = m_table.find(&key);
+  if (iter != m_table.end())
+  {
+    m_entries.splice(m_entries.begin(), m_entries, iter->second);
+    ++m_cache_stats.hits;
+    return iter->second->result;
+  }
+
+  if (find_entry([&](const Entry& entry)
+      {
+        return entry.result == sat &&
+          is_subset(key, key_signature, entry.key, entry.signature);
+      }) != m_entries.end())
+  {
+    ++m_cache_stats.sat_subset_hits;
+    return sat;
+  }
+
+  if (find_entry([&](const Entry& entry)
+      {
+        return entry.result == unsat &&
+          is_subset(entry.key, entry.signature, key, key_signature);
+      }) != m_entries.end())
+  {
+    ++m_cache_stats.unsat_superset_hits;
+    return unsat;
+  }
+
+  ++m_cache_stats.misses;
+  const CheckResult result = m_solver.check();
+  if (result != unknown)
+    insert(std::move(key), key_signature, result);
+
+  return result;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+CachingSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  SharedExprs conditions(assertions().terms);
+  conditions.insert(conditions.end(), assumptions.cbegin(),
+    assumptions.cend());
+
+  SharedExprs key(make_key(conditions));
+  const uint64_t key_signature = signature(key);
+
+  // only sat is answered by the cache since unsat needs an unsat core
+  const auto iter = m_table.find(&key);
+  if (iter != m_table.end() && iter->second->result == sat)
+  {
+    m_entries.splice(m_entries.begin(), m_entries, iter->second);
+    ++m_cache_stats.hits;
+    return {sat, 0};
+  }
+
+  if (find_entry([&](const Entry& entry)
+      {
+        return entry.result == sat &&
+          is_subset(key, key_signature, entry.key, entry.signature);
+      }) != m_entries.end())
+  {
+    ++m_cache_stats.sat_subset_hits;
+    return {sat, 0};
+  }
+
+  Bools solver_assumptions(assumptions.size());
+  solver_assumptions.terms = assumptions;
+
+  Bools solver_unsat_core;
+  solver_unsat_core.terms.swap(unsat_core);
+
+  ++m_cache_stats.misses;
+  const std::pair<CheckResult, Bools::SizeType> result =
+    m_solver.check_assumptions(solver_assumptions, solver_unsat_core);
+
+  solver_unsat_core.terms.swap(unsat_core);
+  if (result.first != unknown && iter == m_table.end())
+    insert(std::move(key), key_signature, result.first);
+
+  return result;
+}
+
+}
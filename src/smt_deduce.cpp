@@ -0,0 +1,629 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_deduce.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+constexpr DeduceSolver::ClauseRef DeduceSolver::s_no_clause;
+constexpr size_t DeduceSolver::s_no_level;
+constexpr DeduceSolver::Lit DeduceSolver::s_opaque_lit;
+constexpr DeduceSolver::Lit DeduceSolver::s_true_lit;
+constexpr int8_t DeduceSolver::s_true;
+constexpr int8_t DeduceSolver::s_false;
+constexpr int8_t DeduceSolver::s_undef;
+
+DeduceSolver::DeduceSolver()
+: Solver(),
+  m_clauses(),
+  m_attached_size(0),
+  m_watches(),
+  m_values(),
+  m_trail(),
+  m_trail_lims(),
+  m_qhead(0),
+  m_conflict_level(s_no_level),
+  m_conflict(s_no_clause),
+  m_lit_table(),
+  m_constant_table(),
+  m_lit(s_opaque_lit),
+  m_stats()
+{
+  __reset();
+}
+
+DeduceSolver::DeduceSolver(Logic logic)
+: Solver(logic),
+  m_clauses(),
+  m_attached_size(0),
+  m_watches(),
+  m_values(),
+  m_trail(),
+  m_trail_lims(),
+  m_qhead(0),
+  m_conflict_level(s_no_level),
+  m_conflict(s_no_clause),
+  m_lit_table(),
+  m_constant_table(),
+  m_lit(s_opaque_lit),
+  m_stats()
+{
+  __reset();
+}
+
+void DeduceSolver::set_conflict(const ClauseRef cref)
+{
+  // keep the first conflict, which is undone by the same pop()
+  if (is_conflict())
+    return;
+
+  m_conflict_level = m_trail_lims.size();
+  m_conflict = cref;
+  m_stats.conflicts++;
+}
+
+DeduceSolver::Lit DeduceSolver::new_node()
+{
+  const Lit lit = static_cast<Lit>(m_values.size());
+  m_values.resize(m_values.size() + 2, s_undef);
+  m_watches.resize(m_watches.size() + 2);
+  return lit;
+}
+
+DeduceSolver::Lit DeduceSolver::mk_and(std::vector<Lit>& lits)
+{
+  std::sort(lits.begin(), lits.end());
+  lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+
+  // sorting puts complementary literals next to each other
+  size_t n = 0;
+  for (size_t i = 0; i < lits.size(); ++i)
+  {
+    if (lits[i] == s_true_lit)
+      continue;
+
+    if (lits[i] == negate(s_true_lit) ||
+        (n != 0 && lits[n - 1] == negate(lits[i])))
+      return negate(s_true_lit);
+
+    lits[n++] = lits[i];
+  }
+  lits.resize(n);
+
+  if (lits.empty())
+    return s_true_lit;
+
+  if (lits.size() == 1)
+    return lits[0];
+
+  // g <-> (a_1 and ... and a_n)
+  const Lit g = new_node();
+  Clause clause;
+  clause.reserve(lits.size() + 1);
+  clause.push_back(g);
+  for (const Lit lit : lits)
+  {
+    add_clause(Clause{negate(g), lit});
+    clause.push_back(negate(lit));
+  }
+  add_clause(std::move(clause));
+
+  return g;
+}
+
+DeduceSolver::Lit DeduceSolver::mk_or(std::vector<Lit>& lits)
+{
+  for (Lit& lit : lits)
+    lit = negate(lit);
+
+  return negate(mk_and(lits));
+}
+
+DeduceSolver::Lit DeduceSolver::mk_iff(const Lit a, const Lit b)
+{
+  if (a == b)
+    return s_true_lit;
+
+  if (a == negate(b))
+    return negate(s_true_lit);
+
+  // g <-> (a <-> b)
+  const Lit g = new_node();
+  add_clause(Clause{negate(g), negate(a), b});
+  add_clause(Clause{negate(g), a, negate(b)});
+  add_clause(Clause{g, a, b});
+  add_clause(Clause{g, negate(a), negate(b)});
+  return g;
+}
+
+void DeduceSolver::add_clause(Clause&& clause)
+{
+  assert(2 <= clause.size());
+
+  m_clauses.push_back(std::move(clause));
+
+  // after a conflict, clauses are attached once it has been undone
+  if (is_conflict())
+    return;
+
+  assert(m_attached_size + 1 == m_clauses.size());
+  attach_clause(m_attached_size++);
+}
+
+void DeduceSolver::attach_clause(const ClauseRef cref)
+{
+  Clause& clause = m_clauses[cref];
+
+  // watch literals that are not false, if any
+  for (size_t w = 0; w < 2; ++w)
+  {
+    for (size_t k = w; k < clause.size(); ++k)
+    {
+      if (value(clause[k]) != s_false)
+      {
+        std::swap(clause[w], clause[k]);
+        break;
+      }
+    }
+  }
+
+  m_watches[clause[0]].push_back(cref);
+  m_watches[clause[1]].push_back(cref);
+
+  if (value(clause[0]) == s_false)
+    set_conflict(cref);
+  else if (value(clause[0]) == s_undef && value(clause[1]) == s_false)
+    enqueue(clause[0]);
+}
+
+void DeduceSolver::examine_clause(const ClauseRef cref)
+{
+  Clause& clause = m_clauses[cref];
+
+  for (size_t w = 0; w < 2; ++w)
+  {
+    if (value(clause[w]) != s_false)
+      continue;
+
+    for (size_t k = 2; k < clause.size(); ++k)
+    {
+      if (value(clause[k]) != s_false)
+      {
+        std::vector<ClauseRef>& watches = m_watches[clause[w]];
+        watches.erase(std::find(watches.begin(), watches.end(), cref));
+
+        std::swap(clause[w], clause[k]);
+        m_watches[clause[w]].push_back(cref);
+        break;
+      }
+    }
+  }
+
+  const int8_t v0 = value(clause[0]);
+  const int8_t v1 = value(clause[1]);
+  if (v0 == s_false && v1 == s_false)
+    set_conflict(cref);
+  else if (v0 == s_undef && v1 == s_false)
+    enqueue(clause[0]);
+  else if (v0 == s_false && v1 == s_undef)
+    enqueue(clause[1]);
+}
+
+void DeduceSolver::enqueue(const Lit lit)
+{
+  assert(value(lit) == s_undef);
+
+  m_values[lit] = s_true;
+  m_values[negate(lit)] = s_false;
+  m_trail.push_back(lit);
+}
+
+void DeduceSolver::propagate()
+{
+  while (m_qhead < m_trail.size() && !is_conflict())
+  {
+    const Lit false_lit = negate(m_trail[m_qhead++]);
+    m_stats.propagations++;
+
+    std::vector<ClauseRef>& watches = m_watches[false_lit];
+    size_t i = 0, j = 0;
+    while (i < watches.size())
+    {
+      const ClauseRef cref = watches[i++];
+      Clause& clause = m_clauses[cref];
+
+      // make sure the false literal is the second one
+      if (clause[0] == false_lit)
+        std::swap(clause[0], clause[1]);
+
+      assert(clause[1] == false_lit);
+
+      if (value(clause[0]) == s_true)
+      {
+        watches[j++] = cref;
+        continue;
+      }
+
+      // look for a new literal to watch
+      bool is_moved = false;
+      for (size_t k = 2; k < clause.size(); ++k)
+      {
+        if (value(clause[k]) != s_false)
+        {
+          std::swap(clause[1], clause[k]);
+          m_watches[clause[1]].push_back(cref);
+          is_moved = true;
+          break;
+        }
+      }
+
+      if (is_moved)
+        continue;
+
+      // clause is unit or falsified
+      watches[j++] = cref;
+      if (value(clause[0]) == s_false)
+      {
+        set_conflict(cref);
+        while (i < watches.size())
+          watches[j++] = watches[i++];
+      }
+      else
+      {
+        enqueue(clause[0]);
+      }
+    }
+    watches.resize(j);
+  }
+}
+
+void DeduceSolver::cancel_until(const size_t level)
+{
+  assert(level < m_trail_lims.size());
+
+  const size_t lim = m_trail_lims[level];
+  m_trail_lims.resize(level);
+
+  for (size_t i = lim; i < m_trail.size(); ++i)
+  {
+    const Lit lit = m_trail[i];
+    m_values[lit] = s_undef;
+    m_values[negate(lit)] = s_undef;
+  }
+
+  ClauseRef conflict = s_no_clause;
+  if (is_conflict() && level < m_conflict_level)
+  {
+    conflict = m_conflict;
+    m_conflict_level = s_no_level;
+    m_conflict = s_no_clause;
+  }
+
+  std::vector<Lit> unassigned(m_trail.begin() + lim, m_trail.end());
+  m_trail.resize(lim);
+  m_qhead = std::min(m_qhead, lim);
+
+  if (is_conflict())
+    return;
+
+  // A clause that watched an unassigned literal and a false one may
+  // have become unit; all others still satisfy the watch invariant.
+  for (const Lit lit : unassigned)
+  {
+    const std::vector<ClauseRef>& watches = m_watches[lit];
+    for (size_t i = 0; i < watches.size(); ++i)
+    {
+      const ClauseRef cref = watches[i];
+      const Clause& clause = m_clauses[cref];
+      const Lit other = clause[0] == lit ? clause[1] : clause[0];
+      if (value(other) == s_false)
+        examine_clause(cref);
+    }
+  }
+
+  if (conflict != s_no_clause)
+    examine_clause(conflict);
+
+  while (m_attached_size < m_clauses.size() && !is_conflict())
+    attach_clause(m_attached_size++);
+
+  propagate();
+}
+
+bool DeduceSolver::find_lit(const Expr* const expr)
+{
+  const Lit* const lit_ptr = m_lit_table.find(expr);
+  if (lit_ptr == nullptr)
+    return false;
+
+  m_lit = *lit_ptr;
+  return true;
+}
+
+void DeduceSolver::cache_lit(const Expr* const expr)
+{
+  m_lit_table.insert(expr, m_lit);
+}
+
+Error DeduceSolver::encode_atom(const Expr* const expr)
+{
+  m_lit = expr->sort().is_bool() ? new_node() : s_opaque_lit;
+  cache_lit(expr);
+  return OK;
+}
+
+Error DeduceSolver::encode_relation(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg,
+  const bool is_equality)
+{
+  if (find_lit(expr))
+    return OK;
+
+  if (!larg.sort().is_bool())
+    return encode_atom(expr);
+
+  Error err;
+  err = larg.encode(*this);
+  if (err)
+    return err;
+
+  const Lit a = m_lit;
+
+  err = rarg.encode(*this);
+  if (err)
+    return err;
+
+  const Lit b = m_lit;
+
+  m_lit = mk_iff(a, b);
+  if (!is_equality)
+    m_lit = negate(m_lit);
+
+  cache_lit(expr);
+  return OK;
+}
+
+Error DeduceSolver::encode_gate(
+  const Expr* const expr,
+  const Opcode opcode,
+  const SharedExpr* const args,
+  const size_t size)
+{
+  if (find_lit(expr))
+    return OK;
+
+  std::vector<Lit> lits;
+  lits.reserve(size);
+  for (size_t i = 0; i < size; ++i)
+  {
+    const Error err = args[i].encode(*this);
+    if (err)
+      return err;
+
+    assert(m_lit != s_opaque_lit);
+    lits.push_back(m_lit);
+  }
+
+  switch (opcode)
+  {
+  case LAND:
+    m_lit = mk_and(lits);
+    break;
+
+  case LOR:
+    m_lit = mk_or(lits);
+    break;
+
+  case IMP:
+    assert(size == 2);
+    lits[0] = negate(lits[0]);
+    m_lit = mk_or(lits);
+    break;
+
+  default:
+    assert(false);
+    return UNSUPPORT_ERROR;
+  }
+
+  cache_lit(expr);
+  return OK;
+}
+
+Error DeduceSolver::__encode_constant(
+  const Expr* const expr,
+  const UnsafeDecl& decl)
+{
+  if (find_lit(expr))
+    return OK;
+
+  if (!decl.sort().is_bool())
+    return encode_atom(expr);
+
+  // distinct expressions may declare the same constant
+  std::unordered_map<std::string, Lit>::const_iterator iter =
+    m_constant_table.find(decl.symbol());
+
+  if (iter == m_constant_table.cend())
+    iter = m_constant_table.emplace(decl.symbol(), new_node()).first;
+
+  m_lit = iter->second;
+  cache_lit(expr);
+  return OK;
+}
+
+Error DeduceSolver::__encode_unary_lnot(
+  const Expr* const expr,
+  const SharedExpr& arg)
+{
+  if (find_lit(expr))
+    return OK;
+
+  const Error err = arg.encode(*this);
+  if (err)
+    return err;
+
+  assert(m_lit != s_opaque_lit);
+  m_lit = negate(m_lit);
+  cache_lit(expr);
+  return OK;
+}
+
+Error DeduceSolver::__encode_binary_land(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const SharedExpr args[] = {larg, rarg};
+  return encode_gate(expr, LAND, args, 2);
+}
+
+Error DeduceSolver::__encode_binary_lor(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const SharedExpr args[] = {larg, rarg};
+  return encode_gate(expr, LOR, args, 2);
+}
+
+Error DeduceSolver::__encode_binary_imp(
+  const Expr* const expr,
+  const SharedExpr& larg,
+  const SharedExpr& rarg)
+{
+  const SharedExpr args[] = {larg, rarg};
+  return encode_gate(expr, IMP, args, 2);
+}
+
+Error DeduceSolver::__encode_nary(
+  const Expr* const expr,
+  Opcode opcode,
+  const SharedExprs& args)
+{
+  switch (opcode)
+  {
+  case LAND:
+  case LOR:
+    return encode_gate(expr, opcode, args.data(), args.size());
+
+  default:
+    if (find_lit(expr))
+      return OK;
+
+    return encode_atom(expr);
+  }
+}
+
+void DeduceSolver::__reset()
+{
+  m_clauses.clear();
+  m_attached_size = 0;
+  m_watches.clear();
+  m_values.clear();
+  m_trail.clear();
+  m_trail_lims.clear();
+  m_qhead = 0;
+  m_conflict_level = s_no_level;
+  m_conflict = s_no_clause;
+  m_lit_table.clear();
+  m_constant_table.clear();
+  m_lit = s_opaque_lit;
+  m_stats = Stats();
+
+  const Lit true_lit = new_node();
+  assert(true_lit == s_true_lit);
+  enqueue(true_lit);
+  propagate();
+}
+
+void DeduceSolver::__push()
+{
+  m_trail_lims.push_back(m_trail.size());
+}
+
+void DeduceSolver::__pop()
+{
+  cancel_until(m_trail_lims.size() - 1);
+}
+
+Error DeduceSolver::__unsafe_add(const SharedExpr& condition)
+{
+  const Error err = condition.encode(*this);
+  if (err)
+    return err;
+
+  assert(m_lit != s_opaque_lit);
+
+  if (is_conflict())
+    return OK;
+
+  if (value(m_lit) == s_false)
+    set_conflict(s_no_clause);
+  else if (value(m_lit) == s_undef)
+    enqueue(m_lit);
+
+  propagate();
+  return OK;
+}
+
+Error DeduceSolver::__add(const Bool& condition)
+{
+  return __unsafe_add(condition);
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+DeduceSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  if (is_conflict())
+    return {unsat, 0};
+
+  std::vector<Lit> lits;
+  lits.reserve(assumptions.size());
+  for (const SharedExpr& assumption : assumptions)
+  {
+    const Error err = assumption.encode(*this);
+    if (err)
+      return {unknown, 0};
+
+    lits.push_back(m_lit);
+  }
+
+  if (is_conflict())
+    return {unsat, 0};
+
+  // the assumptions up to the first one whose propagation yields a
+  // conflict form an unsat core, which need not be minimal
+  __push();
+  size_t i = 0;
+  for (; i < lits.size() && !is_conflict(); ++i)
+  {
+    if (value(lits[i]) == s_false)
+      set_conflict(s_no_clause);
+    else if (value(lits[i]) == s_undef)
+      enqueue(lits[i]);
+
+    propagate();
+  }
+
+  const bool is_unsat = is_conflict();
+  __pop();
+
+  if (!is_unsat)
+    return {unknown, 0};
+
+  SharedExprs::size_type k = unsat_core.size();
+  for (; i != 0 && k != 0; --i)
+    unsat_core[--k] = assumptions[i - 1];
+
+  return {unsat, unsat_core.size() - k};
+}
+
+}
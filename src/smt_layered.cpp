@@ -0,0 +1,209 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_layered.h"
+
+namespace smt
+{
+
+LayeredSolver::LayeredSolver(const std::vector<Solver*>& solvers)
+: DecoratorSolver(),
+  m_layers(),
+  m_lims(),
+  m_layer_stats(),
+  m_interrupted(false)
+{
+  assert(!solvers.empty());
+
+  for (Solver* const solver : solvers)
+  {
+    assert(solver != nullptr);
+    m_layers.push_back(Layer{solver, 0, 0});
+  }
+
+  m_layer_stats.queries.assign(m_layers.size(), 0);
+  m_layer_stats.resolved.assign(m_layers.size(), 0);
+  m_layer_stats.elapsed_time.assign(m_layers.size(), LayerTime::zero());
+  m_layer_stats.unknowns = 0;
+}
+
+void LayeredSolver::mirror(Layer& layer)
+{
+  const SharedExprs& terms = assertions().terms;
+
+  // the levels of the layer are a prefix of m_lims, see __pop()
+  for (;;)
+  {
+    const size_t end = layer.level < m_lims.size() ?
+      m_lims[layer.level] : terms.size();
+
+    for (; layer.size < end; ++layer.size)
+      layer.solver->unsafe_add(terms[layer.size]);
+
+    if (layer.level == m_lims.size())
+      break;
+
+    layer.solver->push();
+    ++layer.level;
+  }
+}
+
+template<class Query>
+void LayeredSolver::ask(Query query)
+{
+  m_interrupted = false;
+
+  for (size_t i = 0; i < m_layers.size() && !m_interrupted; ++i)
+  {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    Layer& layer = m_layers[i];
+    mirror(layer);
+    const CheckResult result = query(*layer.solver);
+
+    m_layer_stats.elapsed_time[i] +=
+      std::chrono::duration_cast<LayerTime>(
+        std::chrono::steady_clock::now() - start);
+
+    ++m_layer_stats.queries[i];
+    if (result != unknown)
+    {
+      ++m_layer_stats.resolved[i];
+      return;
+    }
+  }
+
+  ++m_layer_stats.unknowns;
+}
+
+void LayeredSolver::__reset()
+{
+  m_lims.clear();
+  for (Layer& layer : m_layers)
+  {
+    layer.solver->reset();
+    layer.size = 0;
+    layer.level = 0;
+  }
+}
+
+void LayeredSolver::__push()
+{
+  m_lims.push_back(assertions().size());
+}
+
+void LayeredSolver::__pop()
+{
+  assert(!m_lims.empty());
+
+  // Solver::pop() has already dropped the popped assertions
+  m_lims.pop_back();
+  for (Layer& layer : m_layers)
+  {
+    // the layer has not seen the popped level
+    if (layer.level <= m_lims.size())
+    {
+      assert(layer.size <= assertions().size());
+      continue;
+    }
+
+    layer.solver->pop();
+    --layer.level;
+    assert(layer.level == m_lims.size());
+    layer.size = assertions().size();
+  }
+}
+
+Error LayeredSolver::__add(const Bool& condition)
+{
+  return OK;
+}
+
+Error LayeredSolver::__unsafe_add(const SharedExpr& condition)
+{
+  return OK;
+}
+
+CheckResult LayeredSolver::__check()
+{
+  CheckResult result = unknown;
+  ask([&result](Solver& solver)
+  {
+    return result = solver.check();
+  });
+
+  return result;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+LayeredSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  Bools solver_assumptions(assumptions.size());
+  solver_assumptions.terms = assumptions;
+
+  Bools solver_unsat_core;
+  solver_unsat_core.terms.swap(unsat_core);
+
+  std::pair<CheckResult, Bools::SizeType> result{unknown, 0};
+  ask([&](Solver& solver)
+  {
+    result = solver.check_assumptions(solver_assumptions,
+      solver_unsat_core);
+
+    return result.first;
+  });
+
+  solver_unsat_core.terms.swap(unsat_core);
+  return result;
+}
+
+void LayeredSolver::__interrupt()
+{
+  m_interrupted = true;
+  for (Layer& layer : m_layers)
+    layer.solver->interrupt();
+}
+
+bool LayeredSolver::__is_interruptible() const
+{
+  for (const Layer& layer : m_layers)
+    if (!layer.solver->is_interruptible())
+      return false;
+
+  return true;
+}
+
+void LayeredSolver::__set_timeout(const ElapsedTime timeout)
+{
+  for (Layer& layer : m_layers)
+    layer.solver->set_timeout(timeout);
+}
+
+double LayeredSolver::resolution_rate(const size_t layer) const
+{
+  const uint64_t queries = m_layer_stats.queries.at(layer);
+  if (queries == 0)
+    return 0.0;
+
+  return static_cast<double>(m_layer_stats.resolved[layer]) / queries;
+}
+
+LayeredSolver::LayerTime LayeredSolver::saved_time() const
+{
+  const size_t last = m_layers.size() - 1;
+  const uint64_t last_queries = m_layer_stats.queries[last];
+  if (last_queries == 0)
+    return LayerTime::zero();
+
+  uint64_t resolved = 0;
+  for (size_t i = 0; i < last; ++i)
+    resolved += m_layer_stats.resolved[i];
+
+  return m_layer_stats.elapsed_time[last] * resolved / last_queries;
+}
+
+}
@@ -0,0 +1,137 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_pool.h"
+
+#include <algorithm>
+
+#ifdef ENABLE_CONCURRENCY
+
+namespace smt
+{
+
+SolverPool::SolverPool(const std::vector<Solver*>& solvers)
+: m_solvers(solvers),
+  m_threads(),
+  m_mutex(),
+  m_job_cond(),
+  m_done_cond(),
+  m_jobs(),
+  m_stop(false),
+  m_idle(0),
+  m_busy(solvers.size(), false),
+  m_pool_stats{0, 0}
+{
+  assert(!m_solvers.empty());
+
+  m_threads.reserve(m_solvers.size());
+  for (size_t i = 0; i < m_solvers.size(); ++i)
+    m_threads.emplace_back(&SolverPool::run, this, i);
+}
+
+SolverPool::~SolverPool()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+
+    for (Job& job : m_jobs)
+      job.promise.set_value(unknown);
+
+    m_jobs.clear();
+    m_job_cond.notify_all();
+
+    // a busy worker may not have started its check yet, and solvers
+    // such as Z3Solver ignore an interrupt that arrives before that
+    while (std::find(m_busy.cbegin(), m_busy.cend(), true) != m_busy.cend())
+    {
+      for (size_t i = 0; i < m_solvers.size(); ++i)
+        if (m_busy[i])
+          m_solvers[i]->interrupt();
+
+      m_done_cond.wait_for(lock, std::chrono::milliseconds(1));
+    }
+  }
+
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void SolverPool::run(const size_t index)
+{
+  Solver& solver = *m_solvers[index];
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    ++m_idle;
+    m_job_cond.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+    --m_idle;
+
+    if (m_stop)
+      return;
+
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_busy[index] = true;
+    lock.unlock();
+
+    try
+    {
+      solver.reset();
+      for (const SharedExpr& assertion : job.assertions.terms)
+        solver.unsafe_add(assertion);
+
+      job.promise.set_value(solver.check());
+    }
+    catch (...)
+    {
+      job.promise.set_exception(std::current_exception());
+    }
+
+    lock.lock();
+    m_busy[index] = false;
+    m_done_cond.notify_all();
+  }
+}
+
+std::future<CheckResult> SolverPool::submit(Job&& job)
+{
+  std::future<CheckResult> future = job.promise.get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(!m_stop);
+
+    ++m_pool_stats.queries;
+    if (m_idle <= m_jobs.size())
+      ++m_pool_stats.queued_queries;
+
+    m_jobs.push_back(std::move(job));
+  }
+
+  m_job_cond.notify_one();
+  return future;
+}
+
+std::future<CheckResult> SolverPool::check_async(const Bools& assertions)
+{
+  return submit(Job{SharedExprs(assertions.terms),
+    std::promise<CheckResult>()});
+}
+
+std::future<CheckResult> SolverPool::check_async(Bools&& assertions)
+{
+  return submit(Job{std::move(assertions), std::promise<CheckResult>()});
+}
+
+SolverPool::PoolStats SolverPool::pool_stats()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_pool_stats;
+}
+
+}
+
+#endif
@@ -0,0 +1,272 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_portfolio.h"
+
+#ifdef ENABLE_CONCURRENCY
+
+namespace smt
+{
+
+constexpr size_t PortfolioSolver::s_no_winner;
+
+PortfolioSolver::PortfolioSolver(const std::vector<Solver*>& solvers)
+: DecoratorSolver(),
+  m_solvers(solvers),
+  m_threads(),
+  m_mutex(),
+  m_job_cond(),
+  m_done_cond(),
+  m_job(0),
+  m_stop(false),
+  m_running(0),
+  m_busy(solvers.size(), false),
+  m_interrupted(false),
+  m_winner(s_no_winner),
+  m_result(unknown),
+  m_is_check_assumptions(false),
+  m_assumptions(),
+  m_unsat_cores(solvers.size()),
+  m_unsat_core_sizes(solvers.size(), 0),
+  m_portfolio_stats{std::vector<uint64_t>(solvers.size(), 0), 0}
+{
+  assert(!m_solvers.empty());
+
+  m_threads.reserve(m_solvers.size());
+  for (size_t i = 0; i < m_solvers.size(); ++i)
+    m_threads.emplace_back(&PortfolioSolver::run, this, i);
+}
+
+PortfolioSolver::~PortfolioSolver()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_interrupted = true;
+    await(lock, false);
+    m_stop = true;
+  }
+
+  m_job_cond.notify_all();
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+void PortfolioSolver::run(const size_t index)
+{
+  Solver& solver = *m_solvers[index];
+  uint64_t job = 0;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_job_cond.wait(lock, [&]() { return m_stop || m_job != job; });
+    if (m_stop)
+      return;
+
+    job = m_job;
+
+    // the job has already been decided without this solver
+    if (m_interrupted || m_winner != s_no_winner)
+    {
+      --m_running;
+      m_done_cond.notify_all();
+      continue;
+    }
+
+    m_busy[index] = true;
+    lock.unlock();
+
+    // the inputs do not change until all workers are done
+    CheckResult result;
+    if (m_is_check_assumptions)
+    {
+      const std::pair<CheckResult, Bools::SizeType> pair =
+        solver.check_assumptions(m_assumptions, m_unsat_cores[index]);
+
+      result = pair.first;
+      m_unsat_core_sizes[index] = pair.second;
+    }
+    else
+    {
+      result = solver.check();
+    }
+
+    lock.lock();
+    m_busy[index] = false;
+    if (result != unknown && m_winner == s_no_winner)
+    {
+      m_winner = index;
+      m_result = result;
+      interrupt_busy();
+    }
+
+    --m_running;
+    m_done_cond.notify_all();
+  }
+}
+
+void PortfolioSolver::await(
+  std::unique_lock<std::mutex>& lock,
+  const bool until_winner)
+{
+  while (m_running != 0 && !(until_winner && m_winner != s_no_winner))
+  {
+    if (m_interrupted || m_winner != s_no_winner)
+    {
+      // a busy worker may not have started its check yet, and solvers
+      // such as Z3Solver ignore an interrupt that arrives before that
+      interrupt_busy();
+      m_done_cond.wait_for(lock, std::chrono::milliseconds(1));
+    }
+    else
+    {
+      m_done_cond.wait(lock);
+    }
+  }
+}
+
+void PortfolioSolver::wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  await(lock, false);
+}
+
+size_t PortfolioSolver::race()
+{
+  size_t winner;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    await(lock, false);
+
+    m_winner = s_no_winner;
+    m_interrupted = false;
+    m_running = m_solvers.size();
+    ++m_job;
+    m_job_cond.notify_all();
+
+    await(lock, true);
+    winner = m_winner;
+  }
+
+  if (winner == s_no_winner)
+    ++m_portfolio_stats.unknowns;
+  else
+    ++m_portfolio_stats.wins[winner];
+
+  return winner;
+}
+
+void PortfolioSolver::interrupt_busy()
+{
+  for (size_t i = 0; i < m_solvers.size(); ++i)
+    if (m_busy[i])
+      m_solvers[i]->interrupt();
+}
+
+void PortfolioSolver::__reset()
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->reset();
+}
+
+void PortfolioSolver::__push()
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->push();
+}
+
+void PortfolioSolver::__pop()
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->pop();
+}
+
+Error PortfolioSolver::__add(const Bool& condition)
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->add(condition);
+
+  return OK;
+}
+
+Error PortfolioSolver::__unsafe_add(const SharedExpr& condition)
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->unsafe_add(condition);
+
+  return OK;
+}
+
+CheckResult PortfolioSolver::__check()
+{
+  // workers of the previous job read m_is_check_assumptions
+  wait();
+
+  m_is_check_assumptions = false;
+
+  const size_t winner = race();
+  if (winner == s_no_winner)
+    return unknown;
+
+  return m_result;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+PortfolioSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  wait();
+
+  m_is_check_assumptions = true;
+  m_assumptions.terms = assumptions;
+  for (Bools& solver_unsat_core : m_unsat_cores)
+    solver_unsat_core.terms = unsat_core;
+
+  const size_t winner = race();
+  if (winner == s_no_winner)
+    return {unknown, 0};
+
+  // the winner's unsat core is no longer written by its worker
+  if (m_result == unsat)
+    unsat_core = m_unsat_cores[winner].terms;
+
+  return {m_result, m_unsat_core_sizes[winner]};
+}
+
+void PortfolioSolver::__interrupt()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_interrupted = true;
+  interrupt_busy();
+
+  // waiters repeat the interrupt until the busy workers return
+  m_done_cond.notify_all();
+}
+
+bool PortfolioSolver::__is_interruptible() const
+{
+  for (const Solver* solver : m_solvers)
+    if (!solver->is_interruptible())
+      return false;
+
+  return true;
+}
+
+void PortfolioSolver::__set_timeout(const ElapsedTime timeout)
+{
+  wait();
+  for (Solver* solver : m_solvers)
+    solver->set_timeout(timeout);
+}
+
+}
+
+#endif
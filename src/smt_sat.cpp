@@ -0,0 +1,692 @@
+// Copyright 2014, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_sat.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+constexpr SatSolver::ClauseRef SatSolver::s_no_reason;
+constexpr int8_t SatSolver::s_true;
+constexpr int8_t SatSolver::s_false;
+constexpr int8_t SatSolver::s_undef;
+
+static constexpr double s_var_decay = 0.95;
+static constexpr double s_clause_decay = 0.999;
+static constexpr uint64_t s_restart_base = 100;
+
+// Luby et al., the i-th element of 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, ...
+static uint64_t luby(uint64_t i)
+{
+  uint64_t size = 1, exp = 0;
+  while (size < i + 1)
+  {
+    size = 2 * size + 1;
+    ++exp;
+  }
+
+  while (size - 1 != i)
+  {
+    size = (size - 1) >> 1;
+    --exp;
+    i = i % size;
+  }
+
+  return static_cast<uint64_t>(1) << exp;
+}
+
+SatSolver::SatSolver()
+: m_ok(true),
+  m_clauses(),
+  m_free_clauses(),
+  m_learnts(),
+  m_watches(),
+  m_values(),
+  m_levels(),
+  m_reasons(),
+  m_activities(),
+  m_phases(),
+  m_seen(),
+  m_trail(),
+  m_trail_lims(),
+  m_qhead(0),
+  m_heap(),
+  m_heap_indices(),
+  m_var_inc(1.0),
+  m_clause_inc(1.0),
+  m_max_learnts(0.0),
+  m_assumptions(),
+  m_conflict(),
+  m_model(),
+  m_termination_test(nullptr),
+  m_termination_data(nullptr),
+  m_stats{0, 0, 0, 0, 0} {}
+
+SatSolver::Var SatSolver::new_var()
+{
+  const Var var = m_levels.size();
+
+  m_watches.emplace_back();
+  m_watches.emplace_back();
+  m_values.push_back(s_undef);
+  m_values.push_back(s_undef);
+  m_levels.push_back(0);
+  m_reasons.push_back(s_no_reason);
+  m_activities.push_back(0.0);
+  m_phases.push_back(true);
+  m_seen.push_back(false);
+  m_heap_indices.push_back(-1);
+  heap_insert(var);
+
+  return var;
+}
+
+void SatSolver::heap_up(size_t i)
+{
+  const Var var = m_heap[i];
+  while (i != 0)
+  {
+    const size_t parent = (i - 1) >> 1;
+    if (m_activities[m_heap[parent]] >= m_activities[var])
+      break;
+
+    m_heap[i] = m_heap[parent];
+    m_heap_indices[m_heap[i]] = i;
+    i = parent;
+  }
+
+  m_heap[i] = var;
+  m_heap_indices[var] = i;
+}
+
+void SatSolver::heap_down(size_t i)
+{
+  const Var var = m_heap[i];
+  const size_t size = m_heap.size();
+  for (;;)
+  {
+    size_t child = 2 * i + 1;
+    if (child >= size)
+      break;
+
+    if (child + 1 < size &&
+        m_activities[m_heap[child + 1]] > m_activities[m_heap[child]])
+      ++child;
+
+    if (m_activities[m_heap[child]] <= m_activities[var])
+      break;
+
+    m_heap[i] = m_heap[child];
+    m_heap_indices[m_heap[i]] = i;
+    i = child;
+  }
+
+  m_heap[i] = var;
+  m_heap_indices[var] = i;
+}
+
+void SatSolver::heap_insert(const Var var)
+{
+  if (m_heap_indices[var] >= 0)
+    return;
+
+  m_heap.push_back(var);
+  heap_up(m_heap.size() - 1);
+}
+
+SatSolver::Var SatSolver::heap_pop()
+{
+  assert(!m_heap.empty());
+
+  const Var var = m_heap.front();
+  m_heap_indices[var] = -1;
+
+  const Var last = m_heap.back();
+  m_heap.pop_back();
+  if (!m_heap.empty())
+  {
+    m_heap[0] = last;
+    heap_down(0);
+  }
+
+  return var;
+}
+
+void SatSolver::bump_var(const Var var)
+{
+  m_activities[var] += m_var_inc;
+  if (m_activities[var] > 1e100)
+  {
+    for (double& activity : m_activities)
+      activity *= 1e-100;
+
+    m_var_inc *= 1e-100;
+  }
+
+  if (m_heap_indices[var] >= 0)
+    heap_up(m_heap_indices[var]);
+}
+
+void SatSolver::bump_clause(Clause& clause)
+{
+  clause.activity += m_clause_inc;
+  if (clause.activity > 1e20)
+  {
+    for (const ClauseRef cref : m_learnts)
+      m_clauses[cref].activity *= 1e-20;
+
+    m_clause_inc *= 1e-20;
+  }
+}
+
+SatSolver::ClauseRef SatSolver::alloc_clause(
+  std::vector<Lit>&& lits,
+  const bool is_learnt)
+{
+  ClauseRef cref;
+  if (m_free_clauses.empty())
+  {
+    cref = m_clauses.size();
+    m_clauses.push_back(Clause{std::move(lits), 0.0, is_learnt});
+  }
+  else
+  {
+    cref = m_free_clauses.back();
+    m_free_clauses.pop_back();
+    m_clauses[cref] = Clause{std::move(lits), 0.0, is_learnt};
+  }
+
+  if (is_learnt)
+    m_learnts.push_back(cref);
+
+  return cref;
+}
+
+void SatSolver::attach_clause(const ClauseRef cref)
+{
+  const std::vector<Lit>& lits = m_clauses[cref].lits;
+  assert(lits.size() > 1);
+
+  m_watches[lits[0]].push_back(Watcher{cref, lits[1]});
+  m_watches[lits[1]].push_back(Watcher{cref, lits[0]});
+}
+
+bool SatSolver::is_locked(const ClauseRef cref) const
+{
+  const Lit first = m_clauses[cref].lits[0];
+  return value(first) == s_true && m_reasons[var(first)] == cref;
+}
+
+void SatSolver::reduce_learnts()
+{
+  std::sort(m_learnts.begin(), m_learnts.end(),
+    [this](const ClauseRef a, const ClauseRef b)
+    {
+      const Clause& x = m_clauses[a];
+      const Clause& y = m_clauses[b];
+      return x.lits.size() > 2 &&
+        (y.lits.size() == 2 || x.activity < y.activity);
+    });
+
+  // delete the less active half, except binary and reason clauses
+  const double limit = m_clause_inc / m_learnts.size();
+  const size_t half = m_learnts.size() / 2;
+  std::vector<bool> is_deleted(m_clauses.size(), false);
+
+  size_t i, j;
+  for (i = j = 0; i < m_learnts.size(); ++i)
+  {
+    const ClauseRef cref = m_learnts[i];
+    Clause& clause = m_clauses[cref];
+    if (clause.lits.size() > 2 && !is_locked(cref) &&
+        (i < half || clause.activity < limit))
+    {
+      is_deleted[cref] = true;
+      clause.lits.clear();
+      m_free_clauses.push_back(cref);
+      ++m_stats.deleted_clauses;
+    }
+    else
+    {
+      m_learnts[j++] = cref;
+    }
+  }
+  m_learnts.resize(j);
+
+  // freed clauses are reused, so no watcher may refer to them
+  for (std::vector<Watcher>& watchers : m_watches)
+    watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+      [&is_deleted](const Watcher& w) { return is_deleted[w.cref]; }),
+      watchers.end());
+}
+
+void SatSolver::enqueue(const Lit lit, const ClauseRef reason)
+{
+  assert(value(lit) == s_undef);
+
+  const Var v = var(lit);
+  m_values[lit] = s_true;
+  m_values[negate(lit)] = s_false;
+  m_levels[v] = decision_level();
+  m_reasons[v] = reason;
+  m_trail.push_back(lit);
+}
+
+void SatSolver::cancel_until(const unsigned level)
+{
+  if (decision_level() <= level)
+    return;
+
+  const size_t lim = m_trail_lims[level];
+  for (size_t i = m_trail.size(); i > lim; --i)
+  {
+    const Lit lit = m_trail[i - 1];
+    const Var v = var(lit);
+    m_values[lit] = s_undef;
+    m_values[negate(lit)] = s_undef;
+    m_reasons[v] = s_no_reason;
+    m_phases[v] = is_negative(lit);
+    heap_insert(v);
+  }
+
+  m_trail.resize(lim);
+  m_trail_lims.resize(level);
+  m_qhead = lim;
+}
+
+SatSolver::ClauseRef SatSolver::propagate()
+{
+  ClauseRef conflict = s_no_reason;
+  while (m_qhead < m_trail.size())
+  {
+    const Lit false_lit = negate(m_trail[m_qhead++]);
+    std::vector<Watcher>& watchers = m_watches[false_lit];
+    ++m_stats.propagations;
+
+    size_t i = 0, j = 0;
+    const size_t size = watchers.size();
+    while (i < size)
+    {
+      const Watcher w = watchers[i++];
+      if (value(w.blocker) == s_true)
+      {
+        watchers[j++] = w;
+        continue;
+      }
+
+      std::vector<Lit>& lits = m_clauses[w.cref].lits;
+      if (lits[0] == false_lit)
+        std::swap(lits[0], lits[1]);
+
+      assert(lits[1] == false_lit);
+
+      const Lit first = lits[0];
+      if (first != w.blocker && value(first) == s_true)
+      {
+        watchers[j++] = Watcher{w.cref, first};
+        continue;
+      }
+
+      // look for a literal that is not false to watch instead
+      bool is_moved = false;
+      for (size_t k = 2; k < lits.size(); ++k)
+      {
+        if (value(lits[k]) != s_false)
+        {
+          std::swap(lits[1], lits[k]);
+          m_watches[lits[1]].push_back(Watcher{w.cref, first});
+          is_moved = true;
+          break;
+        }
+      }
+
+      if (is_moved)
+        continue;
+
+      // the clause is unit or conflicting
+      watchers[j++] = Watcher{w.cref, first};
+      if (value(first) == s_false)
+      {
+        conflict = w.cref;
+        m_qhead = m_trail.size();
+        while (i < size)
+          watchers[j++] = watchers[i++];
+      }
+      else
+      {
+        enqueue(first, w.cref);
+      }
+    }
+
+    watchers.resize(j);
+  }
+
+  return conflict;
+}
+
+bool SatSolver::is_redundant(const Lit lit) const
+{
+  const ClauseRef reason = m_reasons[var(lit)];
+  if (reason == s_no_reason)
+    return false;
+
+  for (const Lit other : m_clauses[reason].lits)
+  {
+    const Var v = var(other);
+    if (v != var(lit) && !m_seen[v] && m_levels[v] != 0)
+      return false;
+  }
+
+  return true;
+}
+
+void SatSolver::analyze(
+  ClauseRef conflict,
+  std::vector<Lit>& learnt,
+  unsigned& backtrack_level)
+{
+  // leave room for the asserting literal
+  learnt.clear();
+  learnt.push_back(undef_lit());
+
+  size_t paths = 0;
+  Lit lit = undef_lit();
+  size_t index = m_trail.size();
+
+  do
+  {
+    assert(conflict != s_no_reason);
+
+    Clause& clause = m_clauses[conflict];
+    if (clause.is_learnt)
+      bump_clause(clause);
+
+    for (const Lit other : clause.lits)
+    {
+      if (other == lit)
+        continue;
+
+      const Var v = var(other);
+      if (m_seen[v] || m_levels[v] == 0)
+        continue;
+
+      m_seen[v] = true;
+      bump_var(v);
+
+      if (m_levels[v] >= decision_level())
+        ++paths;
+      else
+        learnt.push_back(other);
+    }
+
+    // next literal of the current level on the trail
+    while (!m_seen[var(m_trail[--index])]);
+
+    lit = m_trail[index];
+    conflict = m_reasons[var(lit)];
+    m_seen[var(lit)] = false;
+    --paths;
+  }
+  while (paths != 0);
+
+  learnt[0] = negate(lit);
+
+  // remove literals that are implied by the others
+  const std::vector<Lit> analyzed(learnt.begin() + 1, learnt.end());
+  size_t i, j;
+  for (i = j = 1; i < learnt.size(); ++i)
+    if (!is_redundant(learnt[i]))
+      learnt[j++] = learnt[i];
+
+  learnt.resize(j);
+
+  // the literal with the highest level is watched next to learnt[0]
+  if (learnt.size() == 1)
+  {
+    backtrack_level = 0;
+  }
+  else
+  {
+    size_t max = 1;
+    for (i = 2; i < learnt.size(); ++i)
+      if (m_levels[var(learnt[i])] > m_levels[var(learnt[max])])
+        max = i;
+
+    std::swap(learnt[1], learnt[max]);
+    backtrack_level = m_levels[var(learnt[1])];
+  }
+
+  for (const Lit other : analyzed)
+    m_seen[var(other)] = false;
+}
+
+void SatSolver::analyze_final(const Lit lit)
+{
+  m_conflict.clear();
+  m_conflict.push_back(negate(lit));
+
+  if (decision_level() == 0)
+    return;
+
+  m_seen[var(lit)] = true;
+  for (size_t i = m_trail.size(); i > m_trail_lims[0]; --i)
+  {
+    const Var v = var(m_trail[i - 1]);
+    if (!m_seen[v])
+      continue;
+
+    const ClauseRef reason = m_reasons[v];
+    if (reason == s_no_reason)
+    {
+      // only assumptions are decided below m_assumptions.size()
+      assert(m_levels[v] > 0);
+      m_conflict.push_back(m_trail[i - 1]);
+    }
+    else
+    {
+      for (const Lit other : m_clauses[reason].lits)
+        if (m_levels[var(other)] > 0)
+          m_seen[var(other)] = true;
+    }
+
+    m_seen[v] = false;
+  }
+
+  m_seen[var(lit)] = false;
+}
+
+SatSolver::Lit SatSolver::pick_branch_lit()
+{
+  while (!m_heap.empty())
+  {
+    const Var v = heap_pop();
+    if (value(lit(v)) == s_undef)
+      return lit(v, m_phases[v]);
+  }
+
+  return undef_lit();
+}
+
+SatSolver::SearchResult SatSolver::search(const uint64_t max_conflicts)
+{
+  uint64_t conflicts = 0;
+  std::vector<Lit> learnt;
+  unsigned backtrack_level;
+
+  for (;;)
+  {
+    const ClauseRef conflict = propagate();
+    if (conflict != s_no_reason)
+    {
+      ++m_stats.conflicts;
+      ++conflicts;
+
+      if (decision_level() == 0)
+        return SEARCH_UNSAT;
+
+      analyze(conflict, learnt, backtrack_level);
+      cancel_until(backtrack_level);
+
+      if (learnt.size() == 1)
+      {
+        enqueue(learnt[0], s_no_reason);
+      }
+      else
+      {
+        const Lit asserting = learnt[0];
+        const ClauseRef cref = alloc_clause(std::move(learnt), true);
+        attach_clause(cref);
+        bump_clause(m_clauses[cref]);
+        enqueue(asserting, cref);
+        learnt = std::vector<Lit>();
+      }
+
+      m_var_inc /= s_var_decay;
+      m_clause_inc /= s_clause_decay;
+
+      if (is_terminated())
+        return SEARCH_UNKNOWN;
+
+      continue;
+    }
+
+    if (conflicts >= max_conflicts)
+    {
+      cancel_until(0);
+      return SEARCH_RESTART;
+    }
+
+    if (m_learnts.size() >= m_max_learnts + m_trail.size())
+      reduce_learnts();
+
+    Lit next = undef_lit();
+    while (decision_level() < m_assumptions.size())
+    {
+      const Lit assumption = m_assumptions[decision_level()];
+      if (value(assumption) == s_true)
+      {
+        // dummy decision level
+        m_trail_lims.push_back(m_trail.size());
+      }
+      else if (value(assumption) == s_false)
+      {
+        analyze_final(negate(assumption));
+        return SEARCH_UNSAT;
+      }
+      else
+      {
+        next = assumption;
+        break;
+      }
+    }
+
+    if (next == undef_lit())
+    {
+      ++m_stats.decisions;
+      if ((m_stats.decisions & 0xff) == 0 && is_terminated())
+        return SEARCH_UNKNOWN;
+
+      next = pick_branch_lit();
+      if (next == undef_lit())
+        return SEARCH_SAT;
+    }
+
+    m_trail_lims.push_back(m_trail.size());
+    enqueue(next, s_no_reason);
+  }
+}
+
+bool SatSolver::add_clause(std::vector<Lit> lits)
+{
+  assert(decision_level() == 0);
+
+  if (!m_ok)
+    return false;
+
+  std::sort(lits.begin(), lits.end());
+
+  // remove false and duplicate literals, skip satisfied clauses
+  size_t i, j;
+  Lit prev = undef_lit();
+  for (i = j = 0; i < lits.size(); ++i)
+  {
+    const Lit lit = lits[i];
+    assert(var(lit) < vars_size());
+
+    if (value(lit) == s_true || lit == negate(prev))
+      return true;
+
+    if (value(lit) != s_false && lit != prev)
+      lits[j++] = prev = lit;
+  }
+  lits.resize(j);
+
+  if (lits.empty())
+    return m_ok = false;
+
+  if (lits.size() == 1)
+  {
+    enqueue(lits[0], s_no_reason);
+    return m_ok = propagate() == s_no_reason;
+  }
+
+  attach_clause(alloc_clause(std::move(lits), false));
+  return true;
+}
+
+CheckResult SatSolver::solve(const std::vector<Lit>& assumptions)
+{
+  m_conflict.clear();
+  if (!m_ok)
+    return unsat;
+
+  m_assumptions = assumptions;
+  m_max_learnts = std::max(m_clauses.size() / 3.0, 1000.0);
+
+  SearchResult result = SEARCH_RESTART;
+  for (uint64_t restart = 0; result == SEARCH_RESTART; ++restart)
+  {
+    if (is_terminated())
+    {
+      result = SEARCH_UNKNOWN;
+      break;
+    }
+
+    if (restart != 0)
+    {
+      ++m_stats.restarts;
+      m_max_learnts *= 1.05;
+    }
+
+    result = search(luby(restart) * s_restart_base);
+  }
+
+  if (result == SEARCH_SAT)
+  {
+    m_model.resize(vars_size());
+    for (Var v = 0; v < vars_size(); ++v)
+      m_model[v] = value(lit(v)) == s_true;
+  }
+
+  // unsat without assumptions in the conflict
+  if (result == SEARCH_UNSAT && m_conflict.empty())
+    m_ok = false;
+
+  cancel_until(0);
+  m_assumptions.clear();
+
+  switch (result)
+  {
+  case SEARCH_SAT:
+    return sat;
+  case SEARCH_UNSAT:
+    return unsat;
+  default:
+    return unknown;
+  }
+}
+
+}
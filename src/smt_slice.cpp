@@ -0,0 +1,236 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_slice.h"
+
+#include <algorithm>
+
+namespace smt
+{
+
+namespace
+{
+  bool is_less(const SharedExpr& x, const SharedExpr& y)
+  {
+    return &x.ref() < &y.ref();
+  }
+
+  bool is_same(const SharedExpr& x, const SharedExpr& y)
+  {
+    return &x.ref() == &y.ref();
+  }
+
+  // union-find over assertion indices with path halving
+  class DisjointSets
+  {
+  private:
+    std::vector<size_t> m_parents;
+
+  public:
+    DisjointSets(const size_t size)
+    : m_parents(size)
+    {
+      for (size_t i = 0; i < size; ++i)
+        m_parents[i] = i;
+    }
+
+    size_t find(size_t i)
+    {
+      while (m_parents[i] != i)
+      {
+        m_parents[i] = m_parents[m_parents[i]];
+        i = m_parents[i];
+      }
+
+      return i;
+    }
+
+    void unite(const size_t i, const size_t j)
+    {
+      const size_t x = find(i);
+      const size_t y = find(j);
+
+      // the smaller index becomes the root so that it is deterministic
+      if (x < y)
+        m_parents[y] = x;
+      else if (y < x)
+        m_parents[x] = y;
+    }
+  };
+}
+
+size_t SlicingSolver::SliceHash::operator()(const SharedExprs& slice) const
+{
+  size_t h = slice.size();
+  for (const SharedExpr& expr : slice)
+    h = hash_combine(h, reinterpret_cast<uintptr_t>(&expr.ref()));
+
+  return h;
+}
+
+bool SlicingSolver::SliceEqual::operator()(
+  const SharedExprs& x,
+  const SharedExprs& y) const
+{
+  return x.size() == y.size() &&
+    std::equal(x.cbegin(), x.cend(), y.cbegin(), is_same);
+}
+
+SlicingSolver::SlicingSolver(Solver& solver)
+: Solver(),
+  m_solver(solver),
+  m_term_decls(),
+  m_visited(),
+  m_decls(),
+  m_slice_results(),
+  m_slice_stats{0, 0, 0, 0, 0},
+  m_is_interrupted(false) {}
+
+const SlicingSolver::Decls& SlicingSolver::decls(const size_t i)
+{
+  assert(i <= m_term_decls.size());
+  if (i < m_term_decls.size())
+    return m_term_decls[i];
+
+  m_visited.clear();
+  m_decls.clear();
+
+  const Error err = assertions().terms[i].encode(*this);
+  assert(err == OK);
+
+  m_term_decls.push_back(m_decls);
+  return m_term_decls.back();
+}
+
+void SlicingSolver::__reset()
+{
+  m_term_decls.clear();
+}
+
+void SlicingSolver::__pop()
+{
+  // Solver::pop() has already dropped the popped assertions
+  if (assertions().size() < m_term_decls.size())
+    m_term_decls.resize(assertions().size());
+}
+
+CheckResult SlicingSolver::__check()
+{
+  const SharedExprs& terms = assertions().terms;
+  const size_t size = terms.size();
+  assert(size != 0);
+
+  ++m_slice_stats.checks;
+  m_slice_stats.query_assertions += size;
+  m_is_interrupted.store(false);
+
+  // assertions that share a constant or function are in the same set
+  DisjointSets sets(size);
+  std::unordered_map<const UnsafeDecl*, size_t, DeclHash, DeclEqual> owners;
+  for (size_t i = 0; i < size; ++i)
+  {
+    for (const UnsafeDecl* const decl : decls(i))
+    {
+      const auto pair = owners.emplace(decl, i);
+      if (!pair.second)
+        sets.unite(pair.first->second, i);
+    }
+  }
+
+  // group assertions by their representative
+  std::vector<SharedExprs> slices(size);
+  for (size_t i = 0; i < size; ++i)
+    slices[sets.find(i)].push_back(terms[i]);
+
+  for (SharedExprs& slice : slices)
+  {
+    std::sort(slice.begin(), slice.end(), is_less);
+    slice.erase(std::unique(slice.begin(), slice.end(), is_same),
+      slice.end());
+  }
+
+  // the slice of the most recently added assertion is most likely new,
+  // and it is also the most likely one to be unsatisfiable
+  const size_t last = sets.find(size - 1);
+  if (last != 0)
+    std::swap(slices[0], slices[last]);
+
+  SliceResults slice_results;
+  CheckResult result = sat;
+  for (SharedExprs& slice : slices)
+  {
+    if (slice.empty())
+      continue;
+
+    CheckResult slice_result;
+    const SliceResults::const_iterator iter = m_slice_results.find(slice);
+    const bool is_interrupted = m_is_interrupted.load() || is_cancelled();
+    if (is_interrupted && result != unsat)
+      result = unknown;
+
+    if (result == unsat || is_interrupted)
+    {
+      // remember the slices that were not needed for the next check
+      if (iter != m_slice_results.cend())
+        slice_results.emplace(std::move(slice), iter->second);
+
+      continue;
+    }
+
+    if (iter == m_slice_results.cend())
+    {
+      ++m_slice_stats.solved_slices;
+      m_slice_stats.slice_assertions += slice.size();
+
+      m_solver.reset();
+      for (const SharedExpr& condition : slice)
+        m_solver.unsafe_add(condition);
+
+      slice_result = m_solver.check();
+    }
+    else
+    {
+      ++m_slice_stats.reused_slices;
+      slice_result = iter->second;
+    }
+
+    if (slice_result != unknown)
+      slice_results.emplace(std::move(slice), slice_result);
+
+    if (slice_result == unsat)
+      result = unsat;
+    else if (slice_result == unknown)
+      result = unknown;
+  }
+
+  // keep only the slices of this check, so memory stays proportional
+  // to the assertions even if the solver is reused for many queries
+  m_slice_results.swap(slice_results);
+  return result;
+}
+
+std::pair<CheckResult, SharedExprs::size_type>
+SlicingSolver::__check_assumptions(
+  const SharedExprs& assumptions,
+  SharedExprs& unsat_core)
+{
+  // unsat cores may span slices, so the query is not sliced
+  m_solver.reset();
+  for (const SharedExpr& condition : assertions().terms)
+    m_solver.unsafe_add(condition);
+
+  Bools solver_assumptions(assumptions.size());
+  solver_assumptions.terms = assumptions;
+
+  Bools solver_unsat_core;
+  solver_unsat_core.terms.swap(unsat_core);
+
+  const std::pair<CheckResult, Bools::SizeType> result =
+    m_solver.check_assumptions(solver_assumptions, solver_unsat_core);
+
+  solver_unsat_core.terms.swap(unsat_core);
+  return result;
+}
+
+}
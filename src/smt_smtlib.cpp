@@ -0,0 +1,2293 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_smtlib.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace smt
+{
+
+namespace
+{
+  bool is_negative(const bool) { return false; }
+
+  template<typename T>
+  bool is_negative(const T literal)
+  {
+    return std::is_signed<T>::value && literal < static_cast<T>(0);
+  }
+
+  // absolute value of the literal as an unsigned 64-bit integer
+  template<typename T>
+  uint64_t magnitude(const T literal)
+  {
+    const uint64_t value = static_cast<uint64_t>(literal);
+    return is_negative(literal) ? 0 - value : value;
+  }
+
+  bool is_simple_symbol(const std::string& symbol)
+  {
+    static constexpr char chars[] = "~!@$%^&*_-+=<>.?/";
+
+    if (symbol.empty() || ('0' <= symbol[0] && symbol[0] <= '9'))
+      return false;
+
+    for (const char c : symbol)
+      if (!(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+            ('0' <= c && c <= '9') || std::strchr(chars, c) != nullptr))
+        return false;
+
+    return true;
+  }
+
+  std::string quote_symbol(const std::string& symbol)
+  {
+    if (is_simple_symbol(symbol))
+      return symbol;
+
+    return "|" + symbol + "|";
+  }
+
+  const char* unary_head(const Opcode opcode, const Sort& sort)
+  {
+    switch (opcode)
+    {
+    case LNOT: return "not";
+    case NOT:  return sort.is_bv() ? "bvnot" : "not";
+    case SUB:  return sort.is_bv() ? "bvneg" : "-";
+    default:   return nullptr;
+    }
+  }
+
+  // arg_sort is the sort of the arguments, which differs from the sort
+  // of the expression itself if it is a relation
+  const char* binary_head(const Opcode opcode, const Sort& arg_sort)
+  {
+    const bool is_bv = arg_sort.is_bv();
+    const bool is_unsigned = is_bv && !arg_sort.is_signed();
+
+    switch (opcode)
+    {
+    case ADD:  return is_bv ? "bvadd" : "+";
+    case SUB:  return is_bv ? "bvsub" : "-";
+    case MUL:  return is_bv ? "bvmul" : "*";
+    case AND:  return is_bv ? "bvand" : "and";
+    case OR:   return is_bv ? "bvor" : "or";
+    case XOR:  return is_bv ? "bvxor" : "xor";
+    case LSHL: return is_bv ? "bvshl" : nullptr;
+    case LSHR: return is_bv ? "bvlshr" : nullptr;
+    case LAND: return "and";
+    case LOR:  return "or";
+    case IMP:  return "=>";
+    case EQL:  return "=";
+    case NEQ:  return "distinct";
+    case QUO:
+      if (is_bv)
+        return is_unsigned ? "bvudiv" : "bvsdiv";
+
+      return arg_sort.is_int() ? "div" : "/";
+    case REM:
+      if (is_bv)
+        return is_unsigned ? "bvurem" : "bvsrem";
+
+      return nullptr;
+    case LSS:
+      if (is_bv)
+        return is_unsigned ? "bvult" : "bvslt";
+
+      return "<";
+    case GTR:
+      if (is_bv)
+        return is_unsigned ? "bvugt" : "bvsgt";
+
+      return ">";
+    case LEQ:
+      if (is_bv)
+        return is_unsigned ? "bvule" : "bvsle";
+
+      return "<=";
+    case GEQ:
+      if (is_bv)
+        return is_unsigned ? "bvuge" : "bvsge";
+
+      return ">=";
+    default:
+      return nullptr;
+    }
+  }
+}
+
+namespace internal
+{
+  /// Subexpressions in post-order with their SMT-LIB 2 operators
+
+  /// Like Simplifier, this is a Solver so that it can reuse
+  /// Solver::encode_dag() to visit shared subexpressions only once.
+  class SmtLibNodes : public Solver
+  {
+  public:
+    struct Node
+    {
+      // operator of an application, or the entire atom
+      std::string head;
+      bool is_atom;
+
+      const Sort* sort;
+
+      // range in args
+      uint32_t args_begin;
+      uint32_t args_size;
+
+      // number of occurrences as an argument or root
+      uint32_t refs;
+
+      // let nesting depth at which the node is bound, if any
+      uint32_t level;
+
+      // empty unless the node is bound to a name
+      std::string name;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> args;
+    std::vector<uint32_t> roots;
+
+    // constants and functions in the order they are first used
+    std::vector<const UnsafeDecl*> decls;
+
+  private:
+    ExprSideTable<uint32_t> m_node_table;
+    std::unordered_set<std::string> m_symbols;
+
+    // reused by record()
+    std::vector<const SharedExpr*> m_args;
+
+    Error record(const Expr* const expr, std::string&& head, bool is_atom)
+    {
+      Node node{std::move(head), is_atom, &expr->sort(),
+        static_cast<uint32_t>(args.size()), 0, 0, 0, std::string()};
+
+      for (const SharedExpr* const arg : m_args)
+      {
+        const uint32_t* const index_ptr = m_node_table.find(&arg->ref());
+
+        // encode_dag() records arguments before the expressions using them
+        assert(index_ptr != nullptr);
+        if (index_ptr == nullptr)
+          return OPCODE_ERROR;
+
+        args.push_back(*index_ptr);
+        ++nodes[*index_ptr].refs;
+        ++node.args_size;
+      }
+
+      m_node_table.insert(expr, nodes.size());
+      nodes.push_back(std::move(node));
+      return OK;
+    }
+
+    template<typename... Args>
+    Error record_app(
+      const Expr* const expr,
+      const char* const head,
+      const Args&... args)
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      if (head == nullptr)
+        return UNSUPPORT_ERROR;
+
+      m_args = {&args...};
+      return record(expr, head, false);
+    }
+
+    Error record_range(
+      const Expr* const expr,
+      std::string&& head,
+      const SharedExpr* const args,
+      const size_t args_size)
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args.clear();
+      for (size_t i = 0; i < args_size; ++i)
+        m_args.push_back(&args[i]);
+
+      return record(expr, std::move(head), false);
+    }
+
+    void declare(const UnsafeDecl& decl)
+    {
+      if (m_symbols.insert(decl.symbol()).second)
+        decls.push_back(&decl);
+    }
+
+    template<typename T>
+    Error record_literal(const Expr* const expr, const T literal)
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      const Sort& sort = expr->sort();
+      std::string atom;
+      if (sort.is_bool())
+        atom = literal ? "true" : "false";
+      else if (sort.is_bv())
+      {
+        // two's complement wider than 64 bits needs arbitrary precision
+        if (64 < sort.bv_size() && is_negative(literal))
+          return UNSUPPORT_ERROR;
+
+        uint64_t value = static_cast<uint64_t>(literal);
+        if (sort.bv_size() < 64)
+          value &= (static_cast<uint64_t>(1) << sort.bv_size()) - 1;
+
+        atom = "(_ bv" + std::to_string(value) + " " +
+          std::to_string(sort.bv_size()) + ")";
+      }
+      else if (sort.is_int() || sort.is_real())
+      {
+        atom = std::to_string(magnitude(literal));
+        if (sort.is_real())
+          atom += ".0";
+
+        if (is_negative(literal))
+          atom = "(- " + atom + ")";
+      }
+      else
+        return UNSUPPORT_ERROR;
+
+      m_args.clear();
+      return record(expr, std::move(atom), true);
+    }
+
+#define SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(type)                                 \
+    virtual Error __encode_literal(                                            \
+      const Expr* const expr,                                                  \
+      type literal) override                                                   \
+    {                                                                          \
+      return record_literal(expr, literal);                                    \
+    }                                                                          \
+
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(bool)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(char)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(signed char)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(unsigned char)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(wchar_t)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(char16_t)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(char32_t)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(short)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(unsigned short)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(int)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(unsigned int)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(long)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(unsigned long)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(long long)
+SMT_SMTLIB_ENCODE_BUILTIN_LITERAL(unsigned long long)
+
+    virtual Error __encode_constant(
+      const Expr* const expr,
+      const UnsafeDecl& decl) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      declare(decl);
+      m_args.clear();
+      return record(expr, quote_symbol(decl.symbol()), true);
+    }
+
+    virtual Error __encode_func_app(
+      const Expr* const expr,
+      const UnsafeDecl& func_decl,
+      const size_t arity,
+      const SharedExpr* const args) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      declare(func_decl);
+      return record_range(expr, quote_symbol(func_decl.symbol()),
+        args, arity);
+    }
+
+    virtual Error __encode_const_array(
+      const Expr* const expr,
+      const SharedExpr& init) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      const Sort& sort = expr->sort();
+      std::string head("(as const ");
+      head += SmtLibNodes::sort(sort);
+      head += ")";
+
+      m_args = {&init};
+      return record(expr, std::move(head), false);
+    }
+
+    virtual Error __encode_array_select(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index) override
+    {
+      return record_app(expr, "select", array, index);
+    }
+
+    virtual Error __encode_array_store(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index,
+      const SharedExpr& value) override
+    {
+      return record_app(expr, "store", array, index, value);
+    }
+
+#define SMT_SMTLIB_ENCODE_UNARY(name, opcode)                                   \
+    virtual Error __encode_unary_##name(                                       \
+      const Expr* const expr,                                                  \
+      const SharedExpr& arg) override                                          \
+    {                                                                          \
+      return record_app(expr, unary_head(opcode, expr->sort()), arg);          \
+    }                                                                          \
+
+#define SMT_SMTLIB_ENCODE_BINARY(name, opcode)                                  \
+    virtual Error __encode_binary_##name(                                      \
+      const Expr* const expr,                                                  \
+      const SharedExpr& larg,                                                  \
+      const SharedExpr& rarg) override                                         \
+    {                                                                          \
+      return record_app(expr, binary_head(opcode, larg.sort()), larg, rarg);   \
+    }                                                                          \
+
+SMT_SMTLIB_ENCODE_UNARY(lnot, LNOT)
+SMT_SMTLIB_ENCODE_UNARY(not, NOT)
+SMT_SMTLIB_ENCODE_UNARY(sub, SUB)
+
+SMT_SMTLIB_ENCODE_BINARY(sub, SUB)
+SMT_SMTLIB_ENCODE_BINARY(and, AND)
+SMT_SMTLIB_ENCODE_BINARY(or, OR)
+SMT_SMTLIB_ENCODE_BINARY(xor, XOR)
+SMT_SMTLIB_ENCODE_BINARY(lshl, LSHL)
+SMT_SMTLIB_ENCODE_BINARY(lshr, LSHR)
+SMT_SMTLIB_ENCODE_BINARY(land, LAND)
+SMT_SMTLIB_ENCODE_BINARY(lor, LOR)
+SMT_SMTLIB_ENCODE_BINARY(imp, IMP)
+SMT_SMTLIB_ENCODE_BINARY(eql, EQL)
+SMT_SMTLIB_ENCODE_BINARY(add, ADD)
+SMT_SMTLIB_ENCODE_BINARY(mul, MUL)
+SMT_SMTLIB_ENCODE_BINARY(quo, QUO)
+SMT_SMTLIB_ENCODE_BINARY(rem, REM)
+SMT_SMTLIB_ENCODE_BINARY(lss, LSS)
+SMT_SMTLIB_ENCODE_BINARY(gtr, GTR)
+SMT_SMTLIB_ENCODE_BINARY(neq, NEQ)
+SMT_SMTLIB_ENCODE_BINARY(leq, LEQ)
+SMT_SMTLIB_ENCODE_BINARY(geq, GEQ)
+
+    virtual Error __encode_nary(
+      const Expr* const expr,
+      Opcode opcode,
+      const SharedExprs& args) override
+    {
+      const char* const head = binary_head(opcode, args.front().sort());
+      if (head == nullptr)
+        return UNSUPPORT_ERROR;
+
+      return record_range(expr, head, args.data(), args.size());
+    }
+
+    virtual Error __encode_bv_zero_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args = {&bv};
+      return record(expr, "(_ zero_extend " + std::to_string(ext) + ")",
+        false);
+    }
+
+    virtual Error __encode_bv_sign_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args = {&bv};
+      return record(expr, "(_ sign_extend " + std::to_string(ext) + ")",
+        false);
+    }
+
+    virtual Error __encode_bv_extract(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned high,
+      const unsigned low) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args = {&bv};
+      return record(expr, "(_ extract " + std::to_string(high) + " " +
+        std::to_string(low) + ")", false);
+    }
+
+    virtual bool __is_encoded(const Expr* const expr) const override
+    {
+      return m_node_table.find(expr) != nullptr;
+    }
+
+    // a writer cannot decide formulas
+    virtual void __reset() override {}
+    virtual void __push() override {}
+    virtual void __pop() override {}
+
+    virtual Error __add(const Bool& condition) override
+    {
+      return UNSUPPORT_ERROR;
+    }
+
+    virtual Error __unsafe_add(const SharedExpr& condition) override
+    {
+      return UNSUPPORT_ERROR;
+    }
+
+    virtual CheckResult __check() override
+    {
+      return unknown;
+    }
+
+    virtual std::pair<CheckResult, SharedExprs::size_type>
+    __check_assumptions(
+      const SharedExprs& assumptions,
+      SharedExprs& unsat_core) override
+    {
+      return {unknown, 0};
+    }
+
+  public:
+    SmtLibNodes()
+    : Solver() {}
+
+    /// SMT-LIB 2 sort, which is only used for arrays and declarations
+    static std::string sort(const Sort& sort)
+    {
+      if (sort.is_bool())
+        return "Bool";
+
+      if (sort.is_int())
+        return "Int";
+
+      if (sort.is_real())
+        return "Real";
+
+      if (sort.is_bv())
+        return "(_ BitVec " + std::to_string(sort.bv_size()) + ")";
+
+      assert(sort.is_array());
+      return "(Array " + SmtLibNodes::sort(sort.sorts(0)) + " " +
+        SmtLibNodes::sort(sort.sorts(1)) + ")";
+    }
+
+    Error add_root(const SharedExpr& root)
+    {
+      assert(!root.is_null());
+
+      const Error err = root.encode(*this);
+      if (err)
+        return err;
+
+      const uint32_t* const index_ptr = m_node_table.find(&root.ref());
+      assert(index_ptr != nullptr);
+
+      roots.push_back(*index_ptr);
+      ++nodes[*index_ptr].refs;
+      return OK;
+    }
+
+    /// Should the node be printed once and then referred to by a name?
+    bool is_shared(const Node& node) const
+    {
+      return !node.is_atom && 1 < node.refs;
+    }
+  };
+}
+
+using internal::SmtLibNodes;
+
+SmtLibWriter::SmtLibWriter(std::ostream& out)
+: m_out(out),
+  m_buffer(),
+  m_declared(),
+  m_define_counter(0)
+{
+  m_buffer.reserve(s_buffer_size);
+}
+
+SmtLibWriter::~SmtLibWriter()
+{
+  flush();
+}
+
+Error SmtLibWriter::flush()
+{
+  m_out.write(m_buffer.data(), m_buffer.size());
+  m_buffer.clear();
+  return m_out ? OK : IO_ERROR;
+}
+
+void SmtLibWriter::write_sort(const Sort& sort)
+{
+  put(SmtLibNodes::sort(sort));
+}
+
+void SmtLibWriter::write_declarations(const SmtLibNodes& nodes)
+{
+  for (const UnsafeDecl* const decl : nodes.decls)
+  {
+    const std::string& symbol = decl->symbol();
+    if (!m_declared.insert(symbol).second)
+      continue;
+
+    const Sort& sort = decl->sort();
+    put("(declare-fun ");
+    put(quote_symbol(symbol));
+    put(" (");
+    if (sort.is_func())
+    {
+      // the last sort is the range
+      for (size_t i = 0; i + 1 < sort.sorts_size(); ++i)
+      {
+        if (i != 0)
+          put(' ');
+
+        write_sort(sort.sorts(i));
+      }
+
+      put(") ");
+      write_sort(sort.sorts(sort.sorts_size() - 1));
+    }
+    else
+    {
+      put(") ");
+      write_sort(sort);
+    }
+
+    put(")\n");
+    flush_if_full();
+  }
+}
+
+void SmtLibWriter::write_node(
+  const SmtLibNodes& nodes,
+  const uint32_t index,
+  const bool is_body)
+{
+  // node index and the number of arguments that have been written
+  std::vector<std::pair<uint32_t, uint32_t>> stack;
+  stack.emplace_back(index, 0);
+
+  bool is_root_body = is_body;
+  while (!stack.empty())
+  {
+    const uint32_t top = stack.back().first;
+    const uint32_t next = stack.back().second;
+    const SmtLibNodes::Node& node = nodes.nodes[top];
+
+    if (next == 0)
+    {
+      if (!is_root_body && !node.name.empty())
+      {
+        put(node.name);
+        stack.pop_back();
+        continue;
+      }
+
+      is_root_body = false;
+
+      if (node.is_atom)
+      {
+        put(node.head);
+        stack.pop_back();
+        continue;
+      }
+
+      put('(');
+      put(node.head);
+    }
+
+    if (next == node.args_size)
+    {
+      put(')');
+      stack.pop_back();
+      flush_if_full();
+      continue;
+    }
+
+    put(' ');
+    ++stack.back().second;
+    stack.emplace_back(nodes.args[node.args_begin + next], 0);
+  }
+}
+
+void SmtLibWriter::write_logic(Logic logic)
+{
+  put("(set-logic ");
+  put(Logics::acronyms[logic]);
+  put(")\n");
+}
+
+Error SmtLibWriter::write_assertions(const SharedExprs& conditions)
+{
+  SmtLibNodes nodes;
+  for (const SharedExpr& condition : conditions)
+  {
+    assert(condition.sort().is_bool());
+
+    const Error err = nodes.add_root(condition);
+    if (err)
+      return err;
+  }
+
+  write_declarations(nodes);
+
+  // post-order, so the arguments of a definition are defined before it
+  for (uint32_t i = 0; i < nodes.nodes.size(); ++i)
+  {
+    SmtLibNodes::Node& node = nodes.nodes[i];
+    if (!nodes.is_shared(node))
+      continue;
+
+    const std::string name("$e" + std::to_string(m_define_counter++));
+    put("(define-fun ");
+    put(name);
+    put(" () ");
+    write_sort(*node.sort);
+    put(' ');
+    write_node(nodes, i, true);
+    put(")\n");
+
+    node.name = std::move(name);
+  }
+
+  for (const uint32_t root : nodes.roots)
+  {
+    put("(assert ");
+    write_node(nodes, root, false);
+    put(")\n");
+  }
+
+  return flush();
+}
+
+Error SmtLibWriter::write_term(const SharedExpr& expr)
+{
+  SmtLibNodes nodes;
+  const Error err = nodes.add_root(expr);
+  if (err)
+    return err;
+
+  // level(n) is one more than the highest level of the bound nodes that
+  // occur in n without being separated by another bound node
+  std::vector<uint32_t> depths(nodes.nodes.size(), 0);
+  uint32_t levels_size = 0;
+  for (uint32_t i = 0; i < nodes.nodes.size(); ++i)
+  {
+    SmtLibNodes::Node& node = nodes.nodes[i];
+    for (uint32_t j = 0; j < node.args_size; ++j)
+    {
+      const uint32_t arg = nodes.args[node.args_begin + j];
+      const SmtLibNodes::Node& arg_node = nodes.nodes[arg];
+      depths[i] = std::max(depths[i],
+        nodes.is_shared(arg_node) ? arg_node.level : depths[arg]);
+    }
+
+    if (nodes.is_shared(node))
+    {
+      node.level = depths[i] + 1;
+      levels_size = std::max(levels_size, node.level);
+    }
+  }
+
+  // bound nodes in the order of their levels, and in post-order within
+  std::vector<std::vector<uint32_t>> levels(levels_size);
+  for (uint32_t i = 0; i < nodes.nodes.size(); ++i)
+  {
+    SmtLibNodes::Node& node = nodes.nodes[i];
+    if (nodes.is_shared(node))
+    {
+      node.name = "$l" + std::to_string(i);
+      levels[node.level - 1].push_back(i);
+    }
+  }
+
+  for (const std::vector<uint32_t>& level : levels)
+  {
+    put("(let (");
+    for (const uint32_t i : level)
+    {
+      if (i != level.front())
+        put(' ');
+
+      put('(');
+      put(nodes.nodes[i].name);
+      put(' ');
+      write_node(nodes, i, true);
+      put(')');
+    }
+
+    put(") ");
+  }
+
+  write_node(nodes, nodes.roots.front(), false);
+  m_buffer.append(levels_size, ')');
+  return flush();
+}
+
+void SmtLibWriter::write_check_sat()
+{
+  put("(check-sat)\n");
+}
+
+Error write_smtlib(std::ostream& out, const Solver& solver)
+{
+  SmtLibWriter writer(out);
+  const Error err = writer.write_assertions(solver.assertions());
+  if (err)
+    return err;
+
+  writer.write_check_sat();
+  return writer.flush();
+}
+
+namespace
+{
+  // operators of SMT-LIB 2 applications
+  enum SmtLibOp : uint8_t
+  {
+    NOT_OP,
+    AND_OP,
+    OR_OP,
+    IMP_OP,
+    XOR_OP,
+    EQ_OP,
+    DISTINCT_OP,
+    ADD_OP,
+    SUB_OP,
+    MUL_OP,
+    DIV_OP,
+    REAL_DIV_OP,
+    LT_OP,
+    LE_OP,
+    GT_OP,
+    GE_OP,
+    BVNOT_OP,
+    BVNEG_OP,
+    BVAND_OP,
+    BVOR_OP,
+    BVXOR_OP,
+    BVNAND_OP,
+    BVNOR_OP,
+    BVXNOR_OP,
+    BVADD_OP,
+    BVSUB_OP,
+    BVMUL_OP,
+    BVUDIV_OP,
+    BVUREM_OP,
+    BVSDIV_OP,
+    BVSREM_OP,
+    BVSHL_OP,
+    BVLSHR_OP,
+    BVULT_OP,
+    BVULE_OP,
+    BVUGT_OP,
+    BVUGE_OP,
+    BVSLT_OP,
+    BVSLE_OP,
+    BVSGT_OP,
+    BVSGE_OP,
+    SELECT_OP,
+    STORE_OP,
+
+    // heads that are parsed by SmtLibParser::parse_indexed_head()
+    EXTRACT_OP,
+    ZERO_EXTEND_OP,
+    SIGN_EXTEND_OP,
+    CONST_ARRAY_OP,
+
+    // declared function
+    FUNC_OP,
+
+    // operators without counterpart in smt-kit
+    UNSUPPORT_OP
+  };
+
+  const std::unordered_map<std::string, SmtLibOp>& smtlib_ops()
+  {
+    static const std::unordered_map<std::string, SmtLibOp> ops = {
+      {"not", NOT_OP},
+      {"and", AND_OP},
+      {"or", OR_OP},
+      {"=>", IMP_OP},
+      {"xor", XOR_OP},
+      {"=", EQ_OP},
+      {"distinct", DISTINCT_OP},
+      {"+", ADD_OP},
+      {"-", SUB_OP},
+      {"*", MUL_OP},
+      {"div", DIV_OP},
+      {"/", REAL_DIV_OP},
+      {"<", LT_OP},
+      {"<=", LE_OP},
+      {">", GT_OP},
+      {">=", GE_OP},
+      {"bvnot", BVNOT_OP},
+      {"bvneg", BVNEG_OP},
+      {"bvand", BVAND_OP},
+      {"bvor", BVOR_OP},
+      {"bvxor", BVXOR_OP},
+      {"bvnand", BVNAND_OP},
+      {"bvnor", BVNOR_OP},
+      {"bvxnor", BVXNOR_OP},
+      {"bvadd", BVADD_OP},
+      {"bvsub", BVSUB_OP},
+      {"bvmul", BVMUL_OP},
+      {"bvudiv", BVUDIV_OP},
+      {"bvurem", BVUREM_OP},
+      {"bvsdiv", BVSDIV_OP},
+      {"bvsrem", BVSREM_OP},
+      {"bvshl", BVSHL_OP},
+      {"bvlshr", BVLSHR_OP},
+      {"bvult", BVULT_OP},
+      {"bvule", BVULE_OP},
+      {"bvugt", BVUGT_OP},
+      {"bvuge", BVUGE_OP},
+      {"bvslt", BVSLT_OP},
+      {"bvsle", BVSLE_OP},
+      {"bvsgt", BVSGT_OP},
+      {"bvsge", BVSGE_OP},
+      {"select", SELECT_OP},
+      {"store", STORE_OP},
+      {"ite", UNSUPPORT_OP},
+      {"mod", UNSUPPORT_OP},
+      {"abs", UNSUPPORT_OP},
+      {"to_real", UNSUPPORT_OP},
+      {"to_int", UNSUPPORT_OP},
+      {"is_int", UNSUPPORT_OP},
+      {"concat", UNSUPPORT_OP},
+      {"bvashr", UNSUPPORT_OP},
+      {"bvsmod", UNSUPPORT_OP},
+      {"bvcomp", UNSUPPORT_OP},
+    };
+
+    return ops;
+  }
+
+  // characters of simple symbols and keywords
+  class SymbolChars
+  {
+  private:
+    bool m_table[256];
+
+  public:
+    SymbolChars()
+    : m_table()
+    {
+      for (const char c : std::string("~!@$%^&*_-+=<>.?/"))
+        m_table[static_cast<unsigned char>(c)] = true;
+
+      for (unsigned c = 'a'; c <= 'z'; ++c)
+        m_table[c] = true;
+
+      for (unsigned c = 'A'; c <= 'Z'; ++c)
+        m_table[c] = true;
+
+      for (unsigned c = '0'; c <= '9'; ++c)
+        m_table[c] = true;
+    }
+
+    bool operator()(const char c) const
+    {
+      return m_table[static_cast<unsigned char>(c)];
+    }
+  };
+
+  const SymbolChars is_symbol_char;
+
+  bool is_digit(const char c)
+  {
+    return '0' <= c && c <= '9';
+  }
+
+  bool is_space(const char c)
+  {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+  }
+
+  // see bv_sort(bool, size_t)
+  constexpr unsigned long long MAX_BV_SIZE = 1024;
+
+  SharedExpr bool_literal(const bool literal)
+  {
+    return make_shared_expr<LiteralExpr<bool>>(
+      internal::sort<Bool>(), literal);
+  }
+
+  bool has_sort(
+    const SharedExpr* const args,
+    const size_t size,
+    const Sort& sort)
+  {
+    for (size_t i = 0; i < size; ++i)
+      if (!(args[i].sort() == sort))
+        return false;
+
+    return true;
+  }
+
+  // Int literals become Real literals if another argument is Real
+  void coerce_literals(SharedExpr* const args, const size_t size)
+  {
+    if (std::none_of(args, args + size,
+        [](const SharedExpr& arg) { return arg.sort().is_real(); }))
+      return;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+      if (!args[i].sort().is_int() ||
+          args[i].ref().expr_kind() != LITERAL_EXPR_KIND)
+        continue;
+
+      const LiteralExpr<long long>* const literal_ptr =
+        dynamic_cast<const LiteralExpr<long long>*>(&args[i].ref());
+
+      if (literal_ptr != nullptr)
+        args[i] = make_shared_expr<LiteralExpr<long long>>(
+          internal::sort<Real>(), literal_ptr->literal());
+    }
+  }
+
+  // bits of an unsigned bit vector, interpreted in two's complement
+  SharedExpr signed_view(const SharedExpr& bv)
+  {
+    const size_t size = bv.sort().bv_size();
+    return make_shared_expr<BvExtractExpr>(
+      bv_sort(true, size), bv, size - 1, 0);
+  }
+
+  SharedExpr unsigned_view(const SharedExpr& bv)
+  {
+    const size_t size = bv.sort().bv_size();
+    return make_shared_expr<BvExtractExpr>(
+      bv_sort(false, size), bv, size - 1, 0);
+  }
+
+  // ((x_0 opcode x_1) opcode x_2) ...
+  SharedExpr fold_left(
+    const Opcode opcode,
+    const Sort& sort,
+    const SharedExpr* const args,
+    const size_t size)
+  {
+    SharedExpr term(args[0]);
+    for (size_t i = 1; i < size; ++i)
+      term = internal::make_binary(opcode, sort, term, args[i]);
+
+    return term;
+  }
+
+  // (x_0 opcode x_1) && (x_1 opcode x_2) ...
+  SharedExpr chain(
+    const Opcode opcode,
+    const SharedExpr* const args,
+    const size_t size)
+  {
+    const Sort& sort = internal::sort<Bool>();
+    if (size == 2)
+      return internal::make_binary(opcode, sort, args[0], args[1]);
+
+    SharedExprs terms;
+    terms.reserve(size - 1);
+    for (size_t i = 1; i < size; ++i)
+      terms.push_back(internal::make_binary(opcode, sort,
+        args[i - 1], args[i]));
+
+    return internal::make_nary(LAND, sort, std::move(terms));
+  }
+}
+
+SmtLibParser::SmtLibParser(Solver* solver)
+: m_solver(solver),
+  m_begin(nullptr),
+  m_pos(nullptr),
+  m_end(nullptr),
+  m_token_kind(END_TOKEN),
+  m_token(nullptr),
+  m_token_size(0),
+  m_error_line(0),
+  m_key(),
+  m_frames(),
+  m_args(),
+  m_let_names(),
+  m_lets(),
+  m_decls(),
+  m_decl_names(),
+  m_scopes(),
+  m_assertions(),
+  m_check_results() {}
+
+void SmtLibParser::next_token()
+{
+  for (;;)
+  {
+    while (m_pos != m_end && is_space(*m_pos))
+      ++m_pos;
+
+    if (m_pos == m_end || *m_pos != ';')
+      break;
+
+    while (m_pos != m_end && *m_pos != '\n')
+      ++m_pos;
+  }
+
+  m_token = m_pos;
+  m_token_size = 0;
+  if (m_pos == m_end)
+  {
+    m_token_kind = END_TOKEN;
+    return;
+  }
+
+  switch (*m_pos)
+  {
+  case '(':
+    m_token_kind = LPAREN_TOKEN;
+    ++m_pos;
+    break;
+  case ')':
+    m_token_kind = RPAREN_TOKEN;
+    ++m_pos;
+    break;
+  case '|':
+  {
+    const char* const end = static_cast<const char*>(
+      std::memchr(m_pos + 1, '|', m_end - m_pos - 1));
+
+    if (end == nullptr)
+    {
+      m_token_kind = ERROR_TOKEN;
+      return;
+    }
+
+    m_token_kind = SYMBOL_TOKEN;
+    m_token = m_pos + 1;
+    m_pos = end + 1;
+    m_token_size = end - m_token;
+    return;
+  }
+  case '"':
+    m_token_kind = STRING_TOKEN;
+    for (++m_pos;; ++m_pos)
+    {
+      if (m_pos == m_end)
+      {
+        m_token_kind = ERROR_TOKEN;
+        return;
+      }
+
+      // "" is an escaped quote
+      if (*m_pos == '"' && (m_pos + 1 == m_end || *++m_pos != '"'))
+        break;
+    }
+    break;
+  case '#':
+    ++m_pos;
+    if (m_pos != m_end && *m_pos == 'b')
+    {
+      m_token_kind = BINARY_TOKEN;
+      m_token = ++m_pos;
+      while (m_pos != m_end && (*m_pos == '0' || *m_pos == '1'))
+        ++m_pos;
+    }
+    else if (m_pos != m_end && *m_pos == 'x')
+    {
+      m_token_kind = HEX_TOKEN;
+      m_token = ++m_pos;
+      while (m_pos != m_end && std::isxdigit(
+          static_cast<unsigned char>(*m_pos)))
+        ++m_pos;
+    }
+    else
+    {
+      m_token_kind = ERROR_TOKEN;
+      return;
+    }
+
+    m_token_size = m_pos - m_token;
+    if (m_token_size == 0)
+      m_token_kind = ERROR_TOKEN;
+
+    return;
+  case ':':
+    m_token_kind = KEYWORD_TOKEN;
+    m_token = ++m_pos;
+    while (m_pos != m_end && is_symbol_char(*m_pos))
+      ++m_pos;
+    break;
+  default:
+    if (is_digit(*m_pos))
+    {
+      m_token_kind = NUMERAL_TOKEN;
+      while (m_pos != m_end && is_digit(*m_pos))
+        ++m_pos;
+
+      if (m_pos + 1 < m_end && *m_pos == '.' && is_digit(m_pos[1]))
+      {
+        m_token_kind = DECIMAL_TOKEN;
+        for (++m_pos; m_pos != m_end && is_digit(*m_pos); ++m_pos) {}
+      }
+    }
+    else if (is_symbol_char(*m_pos))
+    {
+      m_token_kind = SYMBOL_TOKEN;
+      while (m_pos != m_end && is_symbol_char(*m_pos))
+        ++m_pos;
+    }
+    else
+    {
+      m_token_kind = ERROR_TOKEN;
+      return;
+    }
+  }
+
+  m_token_size = m_pos - m_token;
+}
+
+Error SmtLibParser::error(const Error err)
+{
+  m_error_line = 1 + std::count(m_begin, m_token, '\n');
+  return err;
+}
+
+Error SmtLibParser::expect(const TokenKind kind)
+{
+  next_token();
+  return m_token_kind == kind ? OK : error(FORMAT_ERROR);
+}
+
+Error SmtLibParser::token_numeral(unsigned long long& numeral)
+{
+  if (m_token_kind != NUMERAL_TOKEN)
+    return error(FORMAT_ERROR);
+
+  numeral = 0;
+  for (size_t i = 0; i < m_token_size; ++i)
+  {
+    const unsigned digit = m_token[i] - '0';
+    if ((std::numeric_limits<unsigned long long>::max() - digit) / 10 <
+        numeral)
+      return error(UNSUPPORT_ERROR);
+
+    numeral = numeral * 10 + digit;
+  }
+
+  return OK;
+}
+
+Error SmtLibParser::parse_index(uint32_t& index)
+{
+  next_token();
+
+  unsigned long long numeral;
+  const Error err = token_numeral(numeral);
+  if (err)
+    return err;
+
+  if (MAX_BV_SIZE <= numeral)
+    return error(UNSUPPORT_ERROR);
+
+  index = numeral;
+  return OK;
+}
+
+Error SmtLibParser::parse_sort(const Sort*& sort)
+{
+  Error err;
+
+  if (is_token("Bool"))
+    sort = &internal::sort<Bool>();
+  else if (is_token("Int"))
+    sort = &internal::sort<Int>();
+  else if (is_token("Real"))
+    sort = &internal::sort<Real>();
+  else if (m_token_kind != LPAREN_TOKEN)
+    return error(m_token_kind == SYMBOL_TOKEN ?
+      UNSUPPORT_ERROR : FORMAT_ERROR);
+  else
+  {
+    next_token();
+    if (is_token("_"))
+    {
+      next_token();
+      if (!is_token("BitVec"))
+        return error(UNSUPPORT_ERROR);
+
+      uint32_t size;
+      err = parse_index(size);
+      if (err)
+        return err;
+
+      if (size == 0)
+        return error(FORMAT_ERROR);
+
+      sort = &bv_sort(false, size);
+    }
+    else if (is_token("Array"))
+    {
+      const Sort* domain_ptr;
+      const Sort* range_ptr;
+
+      next_token();
+      err = parse_sort(domain_ptr);
+      if (err)
+        return err;
+
+      next_token();
+      err = parse_sort(range_ptr);
+      if (err)
+        return err;
+
+      sort = &array_sort(*domain_ptr, *range_ptr);
+    }
+    else
+      return error(UNSUPPORT_ERROR);
+
+    return expect(RPAREN_TOKEN);
+  }
+
+  return OK;
+}
+
+Error SmtLibParser::skip_sexpr()
+{
+  for (size_t depth = 1; depth != 0;)
+  {
+    next_token();
+    switch (m_token_kind)
+    {
+    case LPAREN_TOKEN:
+      ++depth;
+      break;
+    case RPAREN_TOKEN:
+      --depth;
+      break;
+    case END_TOKEN:
+    case ERROR_TOKEN:
+      return error(FORMAT_ERROR);
+    default:
+      break;
+    }
+  }
+
+  return OK;
+}
+
+Error SmtLibParser::skip_attributes()
+{
+  for (;;)
+  {
+    next_token();
+    switch (m_token_kind)
+    {
+    case RPAREN_TOKEN:
+      return OK;
+    case LPAREN_TOKEN:
+    {
+      const Error err = skip_sexpr();
+      if (err)
+        return err;
+
+      break;
+    }
+    case END_TOKEN:
+    case ERROR_TOKEN:
+      return error(FORMAT_ERROR);
+    default:
+      break;
+    }
+  }
+}
+
+Error SmtLibParser::parse_atom(SharedExpr& term)
+{
+  Error err;
+  unsigned long long numeral = 0;
+
+  switch (m_token_kind)
+  {
+  case SYMBOL_TOKEN:
+  {
+    m_key.assign(m_token, m_token_size);
+    if (!m_let_names.empty())
+    {
+      const std::unordered_map<std::string, SharedExprs>::const_iterator
+        iter = m_lets.find(m_key);
+
+      if (iter != m_lets.cend() && !iter->second.empty())
+      {
+        term = iter->second.back();
+        return OK;
+      }
+    }
+
+    const std::unordered_map<std::string, Declaration>::const_iterator
+      iter = m_decls.find(m_key);
+
+    if (iter != m_decls.cend())
+    {
+      // functions must be applied
+      if (iter->second.term.is_null())
+        return error(FORMAT_ERROR);
+
+      term = iter->second.term;
+    }
+    else if (m_key == "true" || m_key == "false")
+      term = bool_literal(m_key == "true");
+    else
+      return error(FORMAT_ERROR);
+
+    return OK;
+  }
+  case NUMERAL_TOKEN:
+    err = token_numeral(numeral);
+    if (err)
+      return err;
+
+    if (std::numeric_limits<long long>::max() < numeral)
+      return error(UNSUPPORT_ERROR);
+
+    term = make_shared_expr<LiteralExpr<long long>>(
+      internal::sort<Int>(), numeral);
+    return OK;
+  case DECIMAL_TOKEN:
+  {
+    // only integral decimals are supported
+    const char* const point = static_cast<const char*>(
+      std::memchr(m_token, '.', m_token_size));
+
+    if (std::any_of(point + 1, m_token + m_token_size,
+        [](const char c) { return c != '0'; }))
+      return error(UNSUPPORT_ERROR);
+
+    const size_t token_size = m_token_size;
+    m_token_size = point - m_token;
+    m_token_kind = NUMERAL_TOKEN;
+    err = token_numeral(numeral);
+    m_token_kind = DECIMAL_TOKEN;
+    m_token_size = token_size;
+    if (err)
+      return err;
+
+    if (std::numeric_limits<long long>::max() < numeral)
+      return error(UNSUPPORT_ERROR);
+
+    term = make_shared_expr<LiteralExpr<long long>>(
+      internal::sort<Real>(), numeral);
+    return OK;
+  }
+  case BINARY_TOKEN:
+    if (64 < m_token_size)
+      return error(UNSUPPORT_ERROR);
+
+    for (size_t i = 0; i < m_token_size; ++i)
+      numeral = (numeral << 1) | (m_token[i] - '0');
+
+    term = make_shared_expr<LiteralExpr<unsigned long long>>(
+      bv_sort(false, m_token_size), numeral);
+    return OK;
+  case HEX_TOKEN:
+    if (16 < m_token_size)
+      return error(UNSUPPORT_ERROR);
+
+    for (size_t i = 0; i < m_token_size; ++i)
+    {
+      const char c = m_token[i];
+      const unsigned digit = is_digit(c) ? c - '0' :
+        10 + (std::tolower(static_cast<unsigned char>(c)) - 'a');
+
+      numeral = (numeral << 4) | digit;
+    }
+
+    term = make_shared_expr<LiteralExpr<unsigned long long>>(
+      bv_sort(false, 4 * m_token_size), numeral);
+    return OK;
+  default:
+    return error(FORMAT_ERROR);
+  }
+}
+
+Error SmtLibParser::parse_bv_literal(SharedExpr& term)
+{
+  // (_ bvN size)
+  next_token();
+  if (m_token_kind != SYMBOL_TOKEN || m_token_size < 3 ||
+      m_token[0] != 'b' || m_token[1] != 'v' ||
+      !std::all_of(m_token + 2, m_token + m_token_size, is_digit))
+    return error(UNSUPPORT_ERROR);
+
+  m_token += 2;
+  m_token_size -= 2;
+  m_token_kind = NUMERAL_TOKEN;
+
+  unsigned long long numeral;
+  Error err = token_numeral(numeral);
+  if (err)
+    return err;
+
+  uint32_t size;
+  err = parse_index(size);
+  if (err)
+    return err;
+
+  if (size == 0 || (size < 64 && (numeral >> size) != 0))
+    return error(FORMAT_ERROR);
+
+  term = make_shared_expr<LiteralExpr<unsigned long long>>(
+    bv_sort(false, size), numeral);
+  return expect(RPAREN_TOKEN);
+}
+
+Error SmtLibParser::parse_indexed_head(Frame& frame)
+{
+  Error err;
+
+  next_token();
+  if (is_token("_"))
+  {
+    next_token();
+    if (is_token("extract"))
+    {
+      frame.op = EXTRACT_OP;
+      err = parse_index(frame.indices[0]);
+      if (!err)
+        err = parse_index(frame.indices[1]);
+    }
+    else if (is_token("zero_extend") || is_token("sign_extend"))
+    {
+      frame.op = m_token[0] == 'z' ? ZERO_EXTEND_OP : SIGN_EXTEND_OP;
+      err = parse_index(frame.indices[0]);
+    }
+    else
+      return error(UNSUPPORT_ERROR);
+  }
+  else if (is_token("as"))
+  {
+    // (as const (Array A B))
+    next_token();
+    if (!is_token("const"))
+      return error(UNSUPPORT_ERROR);
+
+    const Sort* sort_ptr;
+    next_token();
+    err = parse_sort(sort_ptr);
+    if (!err && !sort_ptr->is_array())
+      err = error(FORMAT_ERROR);
+
+    frame.op = CONST_ARRAY_OP;
+    frame.ptr = sort_ptr;
+  }
+  else
+    return error(m_token_kind == SYMBOL_TOKEN ?
+      UNSUPPORT_ERROR : FORMAT_ERROR);
+
+  if (err)
+    return err;
+
+  return expect(RPAREN_TOKEN);
+}
+
+Error SmtLibParser::open_term(SharedExpr& term)
+{
+  Frame frame{APP_FRAME, 0, static_cast<uint32_t>(m_args.size()),
+    {0, 0}, nullptr};
+
+  next_token();
+  if (m_token_kind == LPAREN_TOKEN)
+  {
+    const Error err = parse_indexed_head(frame);
+    if (err)
+      return err;
+
+    m_frames.push_back(frame);
+    return OK;
+  }
+
+  if (m_token_kind != SYMBOL_TOKEN)
+    return error(FORMAT_ERROR);
+
+  if (is_token("_"))
+    return parse_bv_literal(term);
+
+  if (is_token("let"))
+  {
+    frame.kind = LET_BINDINGS_FRAME;
+    frame.indices[0] = m_let_names.size();
+    m_frames.push_back(frame);
+    return expect(LPAREN_TOKEN);
+  }
+
+  if (is_token("!"))
+  {
+    frame.kind = ANNOTATION_FRAME;
+    m_frames.push_back(frame);
+    return OK;
+  }
+
+  if (is_token("-"))
+  {
+    // fold a negated numeral into a literal
+    const char* const pos = m_pos;
+    next_token();
+    if (m_token_kind == NUMERAL_TOKEN || m_token_kind == DECIMAL_TOKEN)
+    {
+      SharedExpr literal;
+      const Error err = parse_atom(literal);
+      if (err)
+        return err;
+
+      next_token();
+      if (m_token_kind == RPAREN_TOKEN)
+      {
+        const LiteralExpr<long long>& literal_expr =
+          static_cast<const LiteralExpr<long long>&>(literal.ref());
+
+        term = make_shared_expr<LiteralExpr<long long>>(
+          literal.sort(), -literal_expr.literal());
+        return OK;
+      }
+    }
+
+    m_pos = pos;
+    frame.op = SUB_OP;
+    m_frames.push_back(frame);
+    return OK;
+  }
+
+  m_key.assign(m_token, m_token_size);
+
+  const std::unordered_map<std::string, SmtLibOp>::const_iterator
+    op_iter = smtlib_ops().find(m_key);
+
+  if (op_iter != smtlib_ops().cend())
+  {
+    if (op_iter->second == UNSUPPORT_OP)
+      return error(UNSUPPORT_ERROR);
+
+    frame.op = op_iter->second;
+  }
+  else
+  {
+    const std::unordered_map<std::string, Declaration>::const_iterator
+      decl_iter = m_decls.find(m_key);
+
+    if (decl_iter == m_decls.cend() || !decl_iter->second.term.is_null())
+      return error(is_token("as") ? UNSUPPORT_ERROR : FORMAT_ERROR);
+
+    frame.op = FUNC_OP;
+    frame.ptr = &decl_iter->second;
+  }
+
+  m_frames.push_back(frame);
+  return OK;
+}
+
+Error SmtLibParser::close_frame(SharedExpr& term)
+{
+  Frame& frame = m_frames.back();
+  const size_t size = m_args.size() - frame.args_begin;
+
+  switch (frame.kind)
+  {
+  case APP_FRAME:
+  {
+    const Error err = apply(frame, &m_args[frame.args_begin], size, term);
+    if (err)
+      return err;
+
+    break;
+  }
+  case LET_BINDING_FRAME:
+    if (size != 1)
+      return error(FORMAT_ERROR);
+
+    m_frames.pop_back();
+    return OK;
+  case LET_BINDINGS_FRAME:
+    // bindings are parallel, so they only take effect now
+    for (size_t i = 0; i < size; ++i)
+      m_lets[m_let_names[frame.indices[0] + i]].push_back(
+        std::move(m_args[frame.args_begin + i]));
+
+    m_args.resize(frame.args_begin);
+    frame.kind = LET_BODY_FRAME;
+    return OK;
+  case LET_BODY_FRAME:
+    if (size != 1)
+      return error(FORMAT_ERROR);
+
+    term = std::move(m_args.back());
+    for (size_t i = frame.indices[0]; i < m_let_names.size(); ++i)
+      m_lets[m_let_names[i]].pop_back();
+
+    m_let_names.resize(frame.indices[0]);
+    break;
+  default:
+    return error(FORMAT_ERROR);
+  }
+
+  m_args.resize(frame.args_begin);
+  m_frames.pop_back();
+  return OK;
+}
+
+Error SmtLibParser::apply(
+  const Frame& frame,
+  SharedExpr* const args,
+  const size_t size,
+  SharedExpr& term)
+{
+  if (size == 0)
+    return error(FORMAT_ERROR);
+
+  const Sort& bool_sort = internal::sort<Bool>();
+  const Opcode binary_opcodes[] = {ADD, SUB, MUL, QUO, QUO, LSS, LEQ, GTR,
+    GEQ};
+
+  const Sort& sort = args[0].sort();
+  switch (frame.op)
+  {
+  case NOT_OP:
+    if (size != 1 || !sort.is_bool())
+      return error(FORMAT_ERROR);
+
+    term = internal::make_unary(LNOT, bool_sort, args[0]);
+    break;
+  case AND_OP:
+  case OR_OP:
+  {
+    if (!has_sort(args, size, bool_sort))
+      return error(FORMAT_ERROR);
+
+    const Opcode opcode = frame.op == AND_OP ? LAND : LOR;
+    if (size == 1)
+      term = args[0];
+    else if (size == 2)
+      term = internal::make_binary(opcode, bool_sort, args[0], args[1]);
+    else
+      term = internal::make_nary(opcode, bool_sort,
+        SharedExprs(args, args + size));
+    break;
+  }
+  case IMP_OP:
+    if (size < 2 || !has_sort(args, size, bool_sort))
+      return error(FORMAT_ERROR);
+
+    // right associative
+    term = args[size - 1];
+    for (size_t i = size - 1; i != 0; --i)
+      term = internal::make_binary(IMP, bool_sort, args[i - 1], term);
+    break;
+  case XOR_OP:
+    if (size < 2 || !has_sort(args, size, bool_sort))
+      return error(FORMAT_ERROR);
+
+    term = fold_left(XOR, bool_sort, args, size);
+    break;
+  case EQ_OP:
+  case DISTINCT_OP:
+    coerce_literals(args, size);
+    if (size < 2 || !has_sort(args, size, args[0].sort()))
+      return error(FORMAT_ERROR);
+
+    if (frame.op == EQ_OP)
+      term = chain(EQL, args, size);
+    else if (size == 2)
+      term = internal::make_binary(NEQ, bool_sort, args[0], args[1]);
+    else
+      term = internal::make_nary(NEQ, bool_sort,
+        SharedExprs(args, args + size));
+    break;
+  case ADD_OP:
+  case SUB_OP:
+  case MUL_OP:
+  case DIV_OP:
+  case REAL_DIV_OP:
+  case LT_OP:
+  case LE_OP:
+  case GT_OP:
+  case GE_OP:
+  {
+    coerce_literals(args, size);
+
+    const Sort& arg_sort = args[0].sort();
+    if (!has_sort(args, size, arg_sort) ||
+        !(frame.op == DIV_OP ? arg_sort.is_int() :
+          frame.op == REAL_DIV_OP ? arg_sort.is_real() :
+          arg_sort.is_int() || arg_sort.is_real()))
+      return error(FORMAT_ERROR);
+
+    const Opcode opcode = binary_opcodes[frame.op - ADD_OP];
+    if (size == 1)
+    {
+      if (frame.op != SUB_OP)
+        return error(FORMAT_ERROR);
+
+      term = internal::make_unary(SUB, arg_sort, args[0]);
+    }
+    else if (LT_OP <= frame.op)
+      term = chain(opcode, args, size);
+    else
+      term = fold_left(opcode, arg_sort, args, size);
+    break;
+  }
+  case BVNOT_OP:
+  case BVNEG_OP:
+    if (size != 1 || !sort.is_bv())
+      return error(FORMAT_ERROR);
+
+    term = internal::make_unary(frame.op == BVNOT_OP ? NOT : SUB,
+      sort, args[0]);
+    break;
+  case BVAND_OP:
+  case BVOR_OP:
+  case BVXOR_OP:
+  case BVADD_OP:
+  case BVMUL_OP:
+  {
+    if (size < 2 || !sort.is_bv() || !has_sort(args, size, sort))
+      return error(FORMAT_ERROR);
+
+    const Opcode opcode = frame.op == BVAND_OP ? AND :
+      frame.op == BVOR_OP ? OR : frame.op == BVXOR_OP ? XOR :
+      frame.op == BVADD_OP ? ADD : MUL;
+
+    term = fold_left(opcode, sort, args, size);
+    break;
+  }
+  case BVNAND_OP:
+  case BVNOR_OP:
+  case BVXNOR_OP:
+  {
+    if (size != 2 || !sort.is_bv() || !has_sort(args, size, sort))
+      return error(FORMAT_ERROR);
+
+    const Opcode opcode = frame.op == BVNAND_OP ? AND :
+      frame.op == BVNOR_OP ? OR : XOR;
+
+    term = internal::make_unary(NOT, sort,
+      internal::make_binary(opcode, sort, args[0], args[1]));
+    break;
+  }
+  case BVSUB_OP:
+  case BVUDIV_OP:
+  case BVUREM_OP:
+  case BVSHL_OP:
+  case BVLSHR_OP:
+  {
+    if (size != 2 || !sort.is_bv() || !has_sort(args, size, sort))
+      return error(FORMAT_ERROR);
+
+    const Opcode opcode = frame.op == BVSUB_OP ? SUB :
+      frame.op == BVUDIV_OP ? QUO : frame.op == BVUREM_OP ? REM :
+      frame.op == BVSHL_OP ? LSHL : LSHR;
+
+    term = internal::make_binary(opcode, sort, args[0], args[1]);
+    break;
+  }
+  case BVSDIV_OP:
+  case BVSREM_OP:
+  {
+    if (size != 2 || !sort.is_bv() || !has_sort(args, size, sort))
+      return error(FORMAT_ERROR);
+
+    // BvExtractExpr needs at least two bits
+    if (sort.bv_size() == 1)
+      return error(UNSUPPORT_ERROR);
+
+    term = unsigned_view(internal::make_binary(
+      frame.op == BVSDIV_OP ? QUO : REM, bv_sort(true, sort.bv_size()),
+      signed_view(args[0]), signed_view(args[1])));
+    break;
+  }
+  case BVULT_OP:
+  case BVULE_OP:
+  case BVUGT_OP:
+  case BVUGE_OP:
+  case BVSLT_OP:
+  case BVSLE_OP:
+  case BVSGT_OP:
+  case BVSGE_OP:
+  {
+    if (size != 2 || !sort.is_bv() || !has_sort(args, size, sort))
+      return error(FORMAT_ERROR);
+
+    const unsigned index = (frame.op - BVULT_OP) % 4;
+    const Opcode opcode = binary_opcodes[5 + index];
+    if (frame.op < BVSLT_OP)
+      term = internal::make_binary(opcode, bool_sort, args[0], args[1]);
+    else if (sort.bv_size() == 1)
+      return error(UNSUPPORT_ERROR);
+    else
+      term = internal::make_binary(opcode, bool_sort,
+        signed_view(args[0]), signed_view(args[1]));
+    break;
+  }
+  case SELECT_OP:
+    if (size != 2 || !sort.is_array() || !(args[1].sort() == sort.sorts(0)))
+      return error(FORMAT_ERROR);
+
+    term = make_shared_expr<ArraySelectExpr>(args[0], args[1]);
+    break;
+  case STORE_OP:
+    if (size != 3 || !sort.is_array() ||
+        !(args[1].sort() == sort.sorts(0)) ||
+        !(args[2].sort() == sort.sorts(1)))
+      return error(FORMAT_ERROR);
+
+    term = make_shared_expr<ArrayStoreExpr>(args[0], args[1], args[2]);
+    break;
+  case EXTRACT_OP:
+  {
+    const uint32_t high = frame.indices[0];
+    const uint32_t low = frame.indices[1];
+    if (size != 1 || !sort.is_bv() || high < low || sort.bv_size() <= high)
+      return error(FORMAT_ERROR);
+
+    // BvExtractExpr needs at least two bits
+    if (high == low)
+      return error(UNSUPPORT_ERROR);
+
+    if (low == 0 && high + 1 == sort.bv_size())
+      term = args[0];
+    else
+      term = make_shared_expr<BvExtractExpr>(
+        bv_sort(false, high - low + 1), args[0], high, low);
+    break;
+  }
+  case ZERO_EXTEND_OP:
+  case SIGN_EXTEND_OP:
+  {
+    const uint32_t ext = frame.indices[0];
+    if (size != 1 || !sort.is_bv())
+      return error(FORMAT_ERROR);
+
+    if (MAX_BV_SIZE <= sort.bv_size() + ext ||
+        (frame.op == SIGN_EXTEND_OP && sort.bv_size() == 1))
+      return error(UNSUPPORT_ERROR);
+
+    const Sort& ext_sort = bv_sort(false, sort.bv_size() + ext);
+    if (ext == 0)
+      term = args[0];
+    else if (frame.op == ZERO_EXTEND_OP)
+      term = make_shared_expr<BvZeroExtendExpr>(ext_sort, args[0], ext);
+    else
+      term = make_shared_expr<BvSignExtendExpr>(ext_sort,
+        signed_view(args[0]), ext);
+    break;
+  }
+  case CONST_ARRAY_OP:
+  {
+    const Sort& array = *static_cast<const Sort*>(frame.ptr);
+    if (size != 1 || !(sort == array.sorts(1)))
+      return error(FORMAT_ERROR);
+
+    term = make_shared_expr<ConstArrayExpr>(array, args[0]);
+    break;
+  }
+  case FUNC_OP:
+  {
+    const UnsafeDecl& func_decl =
+      static_cast<const Declaration*>(frame.ptr)->decl;
+
+    // the last sort is the range
+    const Sort& func_sort = func_decl.sort();
+    if (func_sort.sorts_size() != size + 1)
+      return error(FORMAT_ERROR);
+
+    for (size_t i = 0; i < size; ++i)
+      if (!(args[i].sort() == func_sort.sorts(i)))
+        return error(FORMAT_ERROR);
+
+    term = internal::make_func_app(func_decl, args, size);
+    if (term.is_null())
+      return error(UNSUPPORT_ERROR);
+    break;
+  }
+  default:
+    return error(UNSUPPORT_ERROR);
+  }
+
+  return OK;
+}
+
+Error SmtLibParser::parse_term(SharedExpr& term)
+{
+  Error err;
+
+  // left over by a term that failed to parse
+  m_frames.clear();
+  m_args.clear();
+  m_let_names.clear();
+  m_lets.clear();
+
+  for (;;)
+  {
+    SharedExpr subterm;
+
+    next_token();
+    const bool is_binding = !m_frames.empty() &&
+      m_frames.back().kind == LET_BINDINGS_FRAME;
+
+    switch (m_token_kind)
+    {
+    case LPAREN_TOKEN:
+      if (is_binding)
+      {
+        // (name term)
+        next_token();
+        if (m_token_kind != SYMBOL_TOKEN)
+          return error(FORMAT_ERROR);
+
+        m_let_names.emplace_back(m_token, m_token_size);
+        m_frames.push_back(Frame{LET_BINDING_FRAME, 0,
+          static_cast<uint32_t>(m_args.size()), {0, 0}, nullptr});
+        continue;
+      }
+
+      err = open_term(subterm);
+      break;
+    case RPAREN_TOKEN:
+      if (m_frames.empty())
+        return error(FORMAT_ERROR);
+
+      err = close_frame(subterm);
+      break;
+    default:
+      if (is_binding)
+        return error(FORMAT_ERROR);
+
+      err = parse_atom(subterm);
+    }
+
+    if (err)
+      return err;
+
+    // the subterm is incomplete
+    if (subterm.is_null())
+      continue;
+
+    while (!m_frames.empty() && m_frames.back().kind == ANNOTATION_FRAME)
+    {
+      err = skip_attributes();
+      if (err)
+        return err;
+
+      m_frames.pop_back();
+    }
+
+    if (m_frames.empty())
+    {
+      term = std::move(subterm);
+      return OK;
+    }
+
+    m_args.push_back(std::move(subterm));
+  }
+}
+
+Error SmtLibParser::declare(
+  std::string&& name,
+  const Sort& sort,
+  const SharedExpr* const definition)
+{
+  if (name.empty() || smtlib_ops().count(name) != 0 ||
+      name == "true" || name == "false")
+    return error(FORMAT_ERROR);
+
+  const std::pair<std::unordered_map<std::string, Declaration>::iterator,
+    bool> pair = m_decls.emplace(name,
+      Declaration{UnsafeDecl(std::string(name), sort), SharedExpr()});
+
+  if (!pair.second)
+    return error(FORMAT_ERROR);
+
+  Declaration& declaration = pair.first->second;
+  if (definition != nullptr)
+    declaration.term = *definition;
+  else if (!sort.is_func())
+    declaration.term = constant(declaration.decl);
+
+  m_decl_names.push_back(std::move(name));
+  return OK;
+}
+
+void SmtLibParser::pop_scope()
+{
+  const Scope& scope = m_scopes.back();
+  for (size_t i = scope.decl_names_size; i < m_decl_names.size(); ++i)
+    m_decls.erase(m_decl_names[i]);
+
+  m_decl_names.resize(scope.decl_names_size);
+  m_assertions.erase(m_assertions.begin() + scope.assertions_size,
+    m_assertions.end());
+  m_scopes.pop_back();
+}
+
+Error SmtLibParser::parse_command()
+{
+  Error err;
+
+  next_token();
+  if (m_token_kind != SYMBOL_TOKEN)
+    return error(FORMAT_ERROR);
+
+  if (is_token("assert"))
+  {
+    SharedExpr condition;
+    err = parse_term(condition);
+    if (err)
+      return err;
+
+    if (!condition.sort().is_bool())
+      return error(FORMAT_ERROR);
+
+    err = expect(RPAREN_TOKEN);
+    if (err)
+      return err;
+
+    if (m_solver != nullptr)
+      m_solver->unsafe_add(condition);
+
+    m_assertions.push_back(std::move(condition));
+    return OK;
+  }
+
+  if (is_token("check-sat"))
+  {
+    err = expect(RPAREN_TOKEN);
+    if (err)
+      return err;
+
+    m_check_results.push_back(m_solver == nullptr ?
+      unknown : m_solver->check());
+    return OK;
+  }
+
+  if (is_token("push") || is_token("pop"))
+  {
+    const bool is_push = is_token("push");
+
+    unsigned long long levels = 1;
+    next_token();
+    if (m_token_kind != RPAREN_TOKEN)
+    {
+      err = token_numeral(levels);
+      if (err)
+        return err;
+
+      err = expect(RPAREN_TOKEN);
+      if (err)
+        return err;
+    }
+
+    if (!is_push && m_scopes.size() < levels)
+      return error(FORMAT_ERROR);
+
+    for (unsigned long long i = 0; i < levels; ++i)
+    {
+      if (is_push)
+      {
+        m_scopes.push_back(Scope{m_decl_names.size(), m_assertions.size()});
+        if (m_solver != nullptr)
+          m_solver->push();
+      }
+      else
+      {
+        pop_scope();
+        if (m_solver != nullptr)
+          m_solver->pop();
+      }
+    }
+
+    return OK;
+  }
+
+  if (is_token("declare-fun") || is_token("declare-const") ||
+      is_token("define-fun"))
+  {
+    const bool is_fun = is_token("declare-fun");
+    const bool is_define = is_token("define-fun");
+
+    next_token();
+    if (m_token_kind != SYMBOL_TOKEN)
+      return error(FORMAT_ERROR);
+
+    std::string name(m_token, m_token_size);
+
+    // domain of a function, followed by its range
+    std::vector<const Sort*> sorts;
+    if (is_fun || is_define)
+    {
+      err = expect(LPAREN_TOKEN);
+      if (err)
+        return err;
+
+      for (next_token(); m_token_kind != RPAREN_TOKEN; next_token())
+      {
+        // definitions of functions would have to be expanded
+        if (is_define)
+          return error(UNSUPPORT_ERROR);
+
+        const Sort* sort_ptr;
+        err = parse_sort(sort_ptr);
+        if (err)
+          return err;
+
+        sorts.push_back(sort_ptr);
+      }
+    }
+
+    const Sort* sort_ptr;
+    next_token();
+    err = parse_sort(sort_ptr);
+    if (err)
+      return err;
+
+    SharedExpr definition;
+    if (is_define)
+    {
+      err = parse_term(definition);
+      if (err)
+        return err;
+
+      if (!(definition.sort() == *sort_ptr))
+        return error(FORMAT_ERROR);
+    }
+
+    err = expect(RPAREN_TOKEN);
+    if (err)
+      return err;
+
+    if (!sorts.empty())
+    {
+      sorts.push_back(sort_ptr);
+      sort_ptr = &func_sort(sorts);
+    }
+
+    return declare(std::move(name), *sort_ptr,
+      is_define ? &definition : nullptr);
+  }
+
+  if (is_token("reset") || is_token("reset-assertions"))
+  {
+    const bool is_reset = is_token("reset");
+    err = expect(RPAREN_TOKEN);
+    if (err)
+      return err;
+
+    while (!m_scopes.empty())
+      pop_scope();
+
+    if (is_reset)
+    {
+      m_decls.clear();
+      m_decl_names.clear();
+    }
+
+    m_assertions.clear();
+    if (m_solver != nullptr)
+      m_solver->reset();
+
+    return OK;
+  }
+
+  if (is_token("exit"))
+  {
+    err = expect(RPAREN_TOKEN);
+    if (err)
+      return err;
+
+    // ignore the rest of the script
+    m_pos = m_end;
+    return OK;
+  }
+
+  // commands that have no effect on the assertions
+  if ((4 < m_token_size && (std::memcmp(m_token, "set-", 4) == 0 ||
+       std::memcmp(m_token, "get-", 4) == 0)) || is_token("echo"))
+    return skip_sexpr();
+
+  return error(UNSUPPORT_ERROR);
+}
+
+Error SmtLibParser::parse(const char* const data, const size_t size)
+{
+  m_begin = m_pos = data;
+  m_end = data + size;
+
+  for (;;)
+  {
+    next_token();
+    if (m_token_kind == END_TOKEN)
+      return OK;
+
+    if (m_token_kind != LPAREN_TOKEN)
+      return error(FORMAT_ERROR);
+
+    const Error err = parse_command();
+    if (err)
+      return err;
+  }
+}
+
+Error SmtLibParser::parse_file(const std::string& path)
+{
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return IO_ERROR;
+
+  std::string script(static_cast<size_t>(file.tellg()), '\0');
+  file.seekg(0);
+  if (!file.read(&script[0], script.size()))
+    return IO_ERROR;
+
+  return parse(script);
+}
+
+Error SmtLibParser::parse_term(const std::string& text, SharedExpr& term)
+{
+  m_begin = m_pos = text.data();
+  m_end = text.data() + text.size();
+
+  const Error err = parse_term(term);
+  if (err)
+    return err;
+
+  next_token();
+  return m_token_kind == END_TOKEN ? OK : error(FORMAT_ERROR);
+}
+
+}
@@ -0,0 +1,1194 @@
+// Copyright 2013, Alex Horn. All rights reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "smt_snapshot.h"
+
+#include <map>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace smt
+{
+
+namespace
+{
+  using internal::SnapshotHeader;
+  using internal::SnapshotSort;
+  using internal::SnapshotSymbol;
+
+  constexpr char SNAPSHOT_MAGIC[8] = "SMTSNAP";
+  constexpr uint32_t SNAPSHOT_VERSION = 1;
+  constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+  constexpr uint32_t SNAPSHOT_TYPE_SIZES = sizeof(long) | sizeof(wchar_t) << 8;
+
+  // see bv_sort(bool, size_t)
+  constexpr uint32_t MAX_BV_SIZE = 1024;
+
+  // largest arity of a function application that can be loaded
+  constexpr size_t MAX_FUNC_ARITY = 8;
+
+  enum SortKind : uint8_t
+  {
+    BOOL_SORT_KIND,
+    INT_SORT_KIND,
+    REAL_SORT_KIND,
+    BV_SORT_KIND,
+    ARRAY_SORT_KIND,
+    FUNC_SORT_KIND
+  };
+
+  // type of a literal, stored instead of an opcode
+  enum LiteralType : uint8_t
+  {
+    BOOL_LITERAL,
+    CHAR_LITERAL,
+    SIGNED_CHAR_LITERAL,
+    UNSIGNED_CHAR_LITERAL,
+    WCHAR_LITERAL,
+    CHAR16_LITERAL,
+    CHAR32_LITERAL,
+    SHORT_LITERAL,
+    UNSIGNED_SHORT_LITERAL,
+    INT_LITERAL,
+    UNSIGNED_INT_LITERAL,
+    LONG_LITERAL,
+    UNSIGNED_LONG_LITERAL,
+    LONG_LONG_LITERAL,
+    UNSIGNED_LONG_LONG_LITERAL,
+    LITERAL_TYPES_SIZE
+  };
+
+  // byte offsets of the sections, each of which is 8-byte aligned
+  struct Layout
+  {
+    size_t sorts;
+    size_t sort_args;
+    size_t symbols;
+    size_t node_kinds;
+    size_t node_opcodes;
+    size_t node_sorts;
+    size_t node_children;
+    size_t node_payloads;
+    size_t children;
+    size_t roots;
+    size_t strings;
+    size_t size;
+  };
+
+  size_t align(const size_t size)
+  {
+    return (size + 7) & ~static_cast<size_t>(7);
+  }
+
+  Layout layout(const SnapshotHeader& header)
+  {
+    Layout l;
+    l.sorts = align(sizeof(SnapshotHeader));
+    l.sort_args = l.sorts +
+      align(header.sorts_size * sizeof(SnapshotSort));
+    l.symbols = l.sort_args +
+      align(header.sort_args_size * sizeof(uint32_t));
+    l.node_kinds = l.symbols +
+      align(header.symbols_size * sizeof(SnapshotSymbol));
+    l.node_opcodes = l.node_kinds +
+      align(header.nodes_size * sizeof(uint8_t));
+    l.node_sorts = l.node_opcodes +
+      align(header.nodes_size * sizeof(uint8_t));
+    l.node_children = l.node_sorts +
+      align(header.nodes_size * sizeof(uint32_t));
+    l.node_payloads = l.node_children +
+      align((header.nodes_size + static_cast<size_t>(1)) * sizeof(uint32_t));
+    l.children = l.node_payloads +
+      align(header.nodes_size * sizeof(uint64_t));
+    l.roots = l.children +
+      align(header.children_size * sizeof(uint32_t));
+    l.strings = l.roots +
+      align(header.roots_size * sizeof(uint32_t));
+    l.size = l.strings +
+      align(header.strings_size * sizeof(char));
+    return l;
+  }
+
+  template<typename T>
+  void copy_section(
+    char* const data,
+    const size_t offset,
+    const std::vector<T>& section)
+  {
+    if (!section.empty())
+      std::memcpy(data + offset, section.data(), section.size() * sizeof(T));
+  }
+
+  /// Records every distinct subexpression in post-order
+
+  /// Like Simplifier, the builder is a Solver so that it can reuse
+  /// Solver::encode_dag() to visit shared subexpressions only once.
+  class SnapshotBuilder : public Solver
+  {
+  private:
+    // index of every recorded node
+    internal::ExprSideTable<uint32_t> m_node_table;
+
+    std::unordered_map<const Sort*, uint32_t> m_sort_table;
+
+    struct DeclHash
+    {
+      size_t operator()(const UnsafeDecl* const decl) const
+      {
+        return decl->hash();
+      }
+    };
+
+    struct DeclEqual
+    {
+      bool operator()(
+        const UnsafeDecl* const x,
+        const UnsafeDecl* const y) const
+      {
+        return *x == *y;
+      }
+    };
+
+    // declarations are owned by expressions that outlive the builder
+    std::unordered_map<const UnsafeDecl*, uint32_t,
+      DeclHash, DeclEqual> m_symbol_table;
+
+    // range of each prefix in m_strings
+    std::unordered_map<const char*, std::pair<uint32_t, uint32_t>>
+      m_prefix_table;
+
+    // reused by record()
+    std::vector<const SharedExpr*> m_args;
+    std::vector<uint32_t> m_arg_indexes;
+
+  public:
+    std::vector<SnapshotSort> m_sorts;
+    std::vector<uint32_t> m_sort_args;
+    std::vector<SnapshotSymbol> m_symbols;
+    std::vector<uint8_t> m_node_kinds;
+    std::vector<uint8_t> m_node_opcodes;
+    std::vector<uint32_t> m_node_sorts;
+    std::vector<uint32_t> m_node_children;
+    std::vector<uint64_t> m_node_payloads;
+    std::vector<uint32_t> m_children;
+    std::vector<uint32_t> m_roots;
+    std::vector<char> m_strings;
+
+  private:
+    uint32_t add_string(const char* const chars, const size_t size)
+    {
+      const uint32_t begin = m_strings.size();
+      m_strings.insert(m_strings.end(), chars, chars + size);
+      return begin;
+    }
+
+    Error intern_sort(const Sort& sort, uint32_t& index)
+    {
+      std::unordered_map<const Sort*, uint32_t>::const_iterator iter =
+        m_sort_table.find(&sort);
+
+      if (iter != m_sort_table.cend())
+      {
+        index = iter->second;
+        return OK;
+      }
+
+      SnapshotSort snapshot_sort{0, 0, 0, 0, 0, 0};
+      if (sort.is_bool())
+        snapshot_sort.kind = BOOL_SORT_KIND;
+      else if (sort.is_int())
+        snapshot_sort.kind = INT_SORT_KIND;
+      else if (sort.is_real())
+        snapshot_sort.kind = REAL_SORT_KIND;
+      else if (sort.is_bv())
+      {
+        snapshot_sort.kind = BV_SORT_KIND;
+        snapshot_sort.is_signed = sort.is_signed();
+        snapshot_sort.bv_size = sort.bv_size();
+      }
+      else if (sort.is_array())
+        snapshot_sort.kind = ARRAY_SORT_KIND;
+      else if (sort.is_func())
+        snapshot_sort.kind = FUNC_SORT_KIND;
+      else
+        return UNSUPPORT_ERROR;
+
+      // sort arguments precede the sort
+      std::vector<uint32_t> args(sort.sorts_size());
+      for (size_t i = 0; i < sort.sorts_size(); ++i)
+      {
+        const Error err = intern_sort(sort.sorts(i), args[i]);
+        if (err)
+          return err;
+      }
+
+      snapshot_sort.args_begin = m_sort_args.size();
+      snapshot_sort.args_size = args.size();
+      m_sort_args.insert(m_sort_args.end(), args.cbegin(), args.cend());
+
+      index = m_sorts.size();
+      m_sorts.push_back(snapshot_sort);
+      m_sort_table.emplace(&sort, index);
+      return OK;
+    }
+
+    Error intern_symbol(const UnsafeDecl& decl, uint32_t& index)
+    {
+      std::unordered_map<const UnsafeDecl*, uint32_t,
+        DeclHash, DeclEqual>::const_iterator iter =
+          m_symbol_table.find(&decl);
+
+      if (iter != m_symbol_table.cend())
+      {
+        index = iter->second;
+        return OK;
+      }
+
+      SnapshotSymbol symbol{0, 0, 0, 0, 0};
+      const Error err = intern_sort(decl.sort(), symbol.sort);
+      if (err)
+        return err;
+
+      if (decl.prefix() == nullptr)
+      {
+        const std::string& name = decl.symbol();
+        symbol.string_begin = add_string(name.data(), name.size());
+        symbol.string_size = name.size();
+      }
+      else
+      {
+        std::unordered_map<const char*,
+          std::pair<uint32_t, uint32_t>>::const_iterator prefix_iter =
+            m_prefix_table.find(decl.prefix());
+
+        if (prefix_iter == m_prefix_table.cend())
+        {
+          const size_t size = std::strlen(decl.prefix());
+          prefix_iter = m_prefix_table.emplace(decl.prefix(), std::make_pair(
+            add_string(decl.prefix(), size), size)).first;
+        }
+
+        symbol.string_begin = prefix_iter->second.first;
+        symbol.string_size = prefix_iter->second.second;
+        symbol.counter = decl.counter();
+        symbol.is_prefix = 1;
+      }
+
+      index = m_symbols.size();
+      m_symbols.push_back(symbol);
+      m_symbol_table.emplace(&decl, index);
+      return OK;
+    }
+
+    // record expr unless it has been already, args must be in m_args
+    Error record(
+      const Expr* const expr,
+      const uint8_t opcode,
+      const uint64_t payload)
+    {
+      // arguments are normally recorded by encode_dag() beforehand
+      m_arg_indexes.clear();
+      for (const SharedExpr* arg : m_args)
+      {
+        const uint32_t* index_ptr = m_node_table.find(&arg->ref());
+        if (index_ptr == nullptr)
+        {
+          // may clobber m_args, so take a copy first
+          const std::vector<const SharedExpr*> args(m_args);
+          const Error err = arg->encode(*this);
+          if (err)
+            return err;
+
+          m_args = args;
+          index_ptr = m_node_table.find(&arg->ref());
+          assert(index_ptr != nullptr);
+        }
+
+        m_arg_indexes.push_back(*index_ptr);
+      }
+
+      uint32_t sort_index;
+      const Error err = intern_sort(expr->sort(), sort_index);
+      if (err)
+        return err;
+
+      const uint32_t index = m_node_kinds.size();
+      m_node_kinds.push_back(expr->expr_kind());
+      m_node_opcodes.push_back(opcode);
+      m_node_sorts.push_back(sort_index);
+      m_node_payloads.push_back(payload);
+      m_children.insert(m_children.end(),
+        m_arg_indexes.cbegin(), m_arg_indexes.cend());
+      m_node_children.push_back(m_children.size());
+      m_node_table.insert(expr, index);
+      return OK;
+    }
+
+    template<typename... Args>
+    Error record_args(
+      const Expr* const expr,
+      const uint8_t opcode,
+      const uint64_t payload,
+      const Args&... args)
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args = {&args...};
+      return record(expr, opcode, payload);
+    }
+
+    Error record_range(
+      const Expr* const expr,
+      const uint8_t opcode,
+      const uint64_t payload,
+      const SharedExpr* const args,
+      const size_t args_size)
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      m_args.clear();
+      for (size_t i = 0; i < args_size; ++i)
+        m_args.push_back(&args[i]);
+
+      return record(expr, opcode, payload);
+    }
+
+#define SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(type, literal_type)                 \
+    virtual Error __encode_literal(                                            \
+      const Expr* const expr,                                                  \
+      type literal) override                                                   \
+    {                                                                          \
+      return record_args(expr, literal_type,                                   \
+        static_cast<uint64_t>(literal));                                       \
+    }                                                                          \
+
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(bool, BOOL_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(char, CHAR_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(signed char, SIGNED_CHAR_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(unsigned char, UNSIGNED_CHAR_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(wchar_t, WCHAR_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(char16_t, CHAR16_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(char32_t, CHAR32_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(short, SHORT_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(unsigned short, UNSIGNED_SHORT_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(int, INT_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(unsigned int, UNSIGNED_INT_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(long, LONG_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(unsigned long, UNSIGNED_LONG_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(long long, LONG_LONG_LITERAL)
+SMT_SNAPSHOT_ENCODE_BUILTIN_LITERAL(unsigned long long, UNSIGNED_LONG_LONG_LITERAL)
+
+    virtual Error __encode_constant(
+      const Expr* const expr,
+      const UnsafeDecl& decl) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      uint32_t symbol_index;
+      const Error err = intern_symbol(decl, symbol_index);
+      if (err)
+        return err;
+
+      return record_args(expr, 0, symbol_index);
+    }
+
+    virtual Error __encode_func_app(
+      const Expr* const expr,
+      const UnsafeDecl& func_decl,
+      const size_t arity,
+      const SharedExpr* const args) override
+    {
+      if (m_node_table.find(expr) != nullptr)
+        return OK;
+
+      if (MAX_FUNC_ARITY < arity)
+        return UNSUPPORT_ERROR;
+
+      uint32_t symbol_index;
+      const Error err = intern_symbol(func_decl, symbol_index);
+      if (err)
+        return err;
+
+      return record_range(expr, 0, symbol_index, args, arity);
+    }
+
+    virtual Error __encode_const_array(
+      const Expr* const expr,
+      const SharedExpr& init) override
+    {
+      return record_args(expr, 0, 0, init);
+    }
+
+    virtual Error __encode_array_select(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index) override
+    {
+      return record_args(expr, 0, 0, array, index);
+    }
+
+    virtual Error __encode_array_store(
+      const Expr* const expr,
+      const SharedExpr& array,
+      const SharedExpr& index,
+      const SharedExpr& value) override
+    {
+      return record_args(expr, 0, 0, array, index, value);
+    }
+
+#define SMT_SNAPSHOT_ENCODE_UNARY(name, opcode)                                 \
+    virtual Error __encode_unary_##name(                                       \
+      const Expr* const expr,                                                  \
+      const SharedExpr& arg) override                                          \
+    {                                                                          \
+      return record_args(expr, opcode, 0, arg);                                \
+    }                                                                          \
+
+#define SMT_SNAPSHOT_ENCODE_BINARY(name, opcode)                                \
+    virtual Error __encode_binary_##name(                                      \
+      const Expr* const expr,                                                  \
+      const SharedExpr& larg,                                                  \
+      const SharedExpr& rarg) override                                         \
+    {                                                                          \
+      return record_args(expr, opcode, 0, larg, rarg);                         \
+    }                                                                          \
+
+SMT_SNAPSHOT_ENCODE_UNARY(lnot, LNOT)
+SMT_SNAPSHOT_ENCODE_UNARY(not, NOT)
+SMT_SNAPSHOT_ENCODE_UNARY(sub, SUB)
+
+SMT_SNAPSHOT_ENCODE_BINARY(sub, SUB)
+SMT_SNAPSHOT_ENCODE_BINARY(and, AND)
+SMT_SNAPSHOT_ENCODE_BINARY(or, OR)
+SMT_SNAPSHOT_ENCODE_BINARY(xor, XOR)
+SMT_SNAPSHOT_ENCODE_BINARY(lshl, LSHL)
+SMT_SNAPSHOT_ENCODE_BINARY(lshr, LSHR)
+SMT_SNAPSHOT_ENCODE_BINARY(land, LAND)
+SMT_SNAPSHOT_ENCODE_BINARY(lor, LOR)
+SMT_SNAPSHOT_ENCODE_BINARY(imp, IMP)
+SMT_SNAPSHOT_ENCODE_BINARY(eql, EQL)
+SMT_SNAPSHOT_ENCODE_BINARY(add, ADD)
+SMT_SNAPSHOT_ENCODE_BINARY(mul, MUL)
+SMT_SNAPSHOT_ENCODE_BINARY(quo, QUO)
+SMT_SNAPSHOT_ENCODE_BINARY(rem, REM)
+SMT_SNAPSHOT_ENCODE_BINARY(lss, LSS)
+SMT_SNAPSHOT_ENCODE_BINARY(gtr, GTR)
+SMT_SNAPSHOT_ENCODE_BINARY(neq, NEQ)
+SMT_SNAPSHOT_ENCODE_BINARY(leq, LEQ)
+SMT_SNAPSHOT_ENCODE_BINARY(geq, GEQ)
+
+    virtual Error __encode_nary(
+      const Expr* const expr,
+      Opcode opcode,
+      const SharedExprs& args) override
+    {
+      return record_range(expr, opcode, 0, args.data(), args.size());
+    }
+
+    virtual Error __encode_bv_zero_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      return record_args(expr, 0, ext, bv);
+    }
+
+    virtual Error __encode_bv_sign_extend(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned ext) override
+    {
+      return record_args(expr, 0, ext, bv);
+    }
+
+    virtual Error __encode_bv_extract(
+      const Expr* const expr,
+      const SharedExpr& bv,
+      const unsigned high,
+      const unsigned low) override
+    {
+      return record_args(expr, 0,
+        static_cast<uint64_t>(high) << 32 | low, bv);
+    }
+
+    virtual bool __is_encoded(const Expr* const expr) const override
+    {
+      return m_node_table.find(expr) != nullptr;
+    }
+
+    // a builder cannot decide formulas
+    virtual void __reset() override {}
+    virtual void __push() override {}
+    virtual void __pop() override {}
+
+    virtual Error __add(const Bool& condition) override
+    {
+      return UNSUPPORT_ERROR;
+    }
+
+    virtual Error __unsafe_add(const SharedExpr& condition) override
+    {
+      return UNSUPPORT_ERROR;
+    }
+
+    virtual CheckResult __check() override
+    {
+      return unknown;
+    }
+
+    virtual std::pair<CheckResult, SharedExprs::size_type>
+    __check_assumptions(
+      const SharedExprs& assumptions,
+      SharedExprs& unsat_core) override
+    {
+      return {unknown, 0};
+    }
+
+  public:
+    SnapshotBuilder()
+    : Solver(),
+      m_node_children(1, 0) {}
+
+    Error add_root(const SharedExpr& root)
+    {
+      assert(!root.is_null());
+
+      const Error err = root.encode(*this);
+      if (err)
+        return err;
+
+      const uint32_t* const index_ptr = m_node_table.find(&root.ref());
+      assert(index_ptr != nullptr);
+
+      m_roots.push_back(*index_ptr);
+      return OK;
+    }
+  };
+
+  // prefixes that have not been passed to Snapshot::load(), allocated
+  // on first use and never freed like bv_sort(bool, size_t)
+  typedef std::map<std::string, const char*> LoadedPrefixes;
+
+  internal::SpinLock s_loaded_prefix_lock;
+  LoadedPrefixes* s_loaded_prefixes = nullptr;
+
+  const char* loaded_prefix(std::string&& prefix)
+  {
+    std::lock_guard<internal::SpinLock> lock(s_loaded_prefix_lock);
+
+    if (s_loaded_prefixes == nullptr)
+      s_loaded_prefixes = new LoadedPrefixes();
+
+    const char*& prefix_ptr = (*s_loaded_prefixes)[prefix];
+    if (prefix_ptr == nullptr)
+    {
+      char* const chars = new char[prefix.size() + 1];
+      std::memcpy(chars, prefix.c_str(), prefix.size() + 1);
+      prefix_ptr = chars;
+    }
+
+    return prefix_ptr;
+  }
+
+  SharedExpr make_literal(
+    const uint8_t literal_type,
+    const Sort& sort,
+    const uint64_t value)
+  {
+    switch (literal_type)
+    {
+    case BOOL_LITERAL:
+      return literal<bool>(sort, value != 0);
+    case CHAR_LITERAL:
+      return literal<char>(sort, static_cast<char>(value));
+    case SIGNED_CHAR_LITERAL:
+      return literal<signed char>(sort, static_cast<signed char>(value));
+    case UNSIGNED_CHAR_LITERAL:
+      return literal<unsigned char>(sort, static_cast<unsigned char>(value));
+    case WCHAR_LITERAL:
+      return literal<wchar_t>(sort, static_cast<wchar_t>(value));
+    case CHAR16_LITERAL:
+      return literal<char16_t>(sort, static_cast<char16_t>(value));
+    case CHAR32_LITERAL:
+      return literal<char32_t>(sort, static_cast<char32_t>(value));
+    case SHORT_LITERAL:
+      return literal<short>(sort, static_cast<short>(value));
+    case UNSIGNED_SHORT_LITERAL:
+      return literal<unsigned short>(sort, static_cast<unsigned short>(value));
+    case INT_LITERAL:
+      return literal<int>(sort, static_cast<int>(value));
+    case UNSIGNED_INT_LITERAL:
+      return literal<unsigned int>(sort, static_cast<unsigned int>(value));
+    case LONG_LITERAL:
+      return literal<long>(sort, static_cast<long>(value));
+    case UNSIGNED_LONG_LITERAL:
+      return literal<unsigned long>(sort, static_cast<unsigned long>(value));
+    case LONG_LONG_LITERAL:
+      return literal<long long>(sort, static_cast<long long>(value));
+    case UNSIGNED_LONG_LONG_LITERAL:
+      return literal<unsigned long long>(sort, value);
+    default:
+      return SharedExpr();
+    }
+  }
+}
+
+Snapshot::Snapshot()
+: m_buffer(),
+  m_data(nullptr),
+  m_size(0),
+  m_mapped_size(0),
+  m_header(nullptr),
+  m_sorts(nullptr),
+  m_sort_args(nullptr),
+  m_symbols(nullptr),
+  m_node_kinds(nullptr),
+  m_node_opcodes(nullptr),
+  m_node_sorts(nullptr),
+  m_node_children(nullptr),
+  m_node_payloads(nullptr),
+  m_children(nullptr),
+  m_roots(nullptr),
+  m_strings(nullptr) {}
+
+Snapshot::Snapshot(Snapshot&& other)
+: Snapshot()
+{
+  *this = std::move(other);
+}
+
+Snapshot& Snapshot::operator=(Snapshot&& other)
+{
+  if (this == &other)
+    return *this;
+
+  unmap();
+
+  // moving a vector keeps its storage, so the pointers remain valid
+  m_buffer = std::move(other.m_buffer);
+  m_data = other.m_data;
+  m_size = other.m_size;
+  m_mapped_size = other.m_mapped_size;
+  m_header = other.m_header;
+  m_sorts = other.m_sorts;
+  m_sort_args = other.m_sort_args;
+  m_symbols = other.m_symbols;
+  m_node_kinds = other.m_node_kinds;
+  m_node_opcodes = other.m_node_opcodes;
+  m_node_sorts = other.m_node_sorts;
+  m_node_children = other.m_node_children;
+  m_node_payloads = other.m_node_payloads;
+  m_children = other.m_children;
+  m_roots = other.m_roots;
+  m_strings = other.m_strings;
+
+  other.m_buffer.clear();
+  other.m_mapped_size = 0;
+  other.unmap();
+  return *this;
+}
+
+Snapshot::~Snapshot()
+{
+  unmap();
+}
+
+void Snapshot::unmap()
+{
+  if (m_mapped_size != 0)
+    munmap(const_cast<char*>(m_data), m_mapped_size);
+
+  m_buffer.clear();
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped_size = 0;
+  m_header = nullptr;
+  m_sorts = nullptr;
+  m_sort_args = nullptr;
+  m_symbols = nullptr;
+  m_node_kinds = nullptr;
+  m_node_opcodes = nullptr;
+  m_node_sorts = nullptr;
+  m_node_children = nullptr;
+  m_node_payloads = nullptr;
+  m_children = nullptr;
+  m_roots = nullptr;
+  m_strings = nullptr;
+}
+
+Error Snapshot::attach(const char* const data, const size_t size)
+{
+  if (size < sizeof(SnapshotHeader) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(uint64_t) != 0)
+    return FORMAT_ERROR;
+
+  const SnapshotHeader* const header =
+    reinterpret_cast<const SnapshotHeader*>(data);
+
+  if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->byte_order != SNAPSHOT_BYTE_ORDER ||
+      header->type_sizes != SNAPSHOT_TYPE_SIZES)
+    return FORMAT_ERROR;
+
+  const Layout l = layout(*header);
+  if (l.size != size)
+    return FORMAT_ERROR;
+
+  const SnapshotSort* const sorts =
+    reinterpret_cast<const SnapshotSort*>(data + l.sorts);
+  const uint32_t* const sort_args =
+    reinterpret_cast<const uint32_t*>(data + l.sort_args);
+  const SnapshotSymbol* const symbols =
+    reinterpret_cast<const SnapshotSymbol*>(data + l.symbols);
+  const uint8_t* const node_kinds =
+    reinterpret_cast<const uint8_t*>(data + l.node_kinds);
+  const uint8_t* const node_opcodes =
+    reinterpret_cast<const uint8_t*>(data + l.node_opcodes);
+  const uint32_t* const node_sorts =
+    reinterpret_cast<const uint32_t*>(data + l.node_sorts);
+  const uint32_t* const node_children =
+    reinterpret_cast<const uint32_t*>(data + l.node_children);
+  const uint64_t* const node_payloads =
+    reinterpret_cast<const uint64_t*>(data + l.node_payloads);
+  const uint32_t* const children =
+    reinterpret_cast<const uint32_t*>(data + l.children);
+  const uint32_t* const roots =
+    reinterpret_cast<const uint32_t*>(data + l.roots);
+
+  // sort arguments must precede their sort, so there are no cycles
+  for (uint32_t i = 0; i < header->sorts_size; ++i)
+  {
+    const SnapshotSort& sort = sorts[i];
+    if (sort.args_begin > header->sort_args_size ||
+        sort.args_size > header->sort_args_size - sort.args_begin)
+      return FORMAT_ERROR;
+
+    for (uint32_t j = 0; j < sort.args_size; ++j)
+      if (sort_args[sort.args_begin + j] >= i)
+        return FORMAT_ERROR;
+
+    switch (sort.kind)
+    {
+    case BOOL_SORT_KIND:
+    case INT_SORT_KIND:
+    case REAL_SORT_KIND:
+      if (sort.args_size != 0)
+        return FORMAT_ERROR;
+      break;
+    case BV_SORT_KIND:
+      if (sort.args_size != 0 || sort.bv_size == 0 ||
+          sort.bv_size >= MAX_BV_SIZE)
+        return FORMAT_ERROR;
+      break;
+    case ARRAY_SORT_KIND:
+      if (sort.args_size != 2)
+        return FORMAT_ERROR;
+      break;
+    case FUNC_SORT_KIND:
+      if (sort.args_size < 2)
+        return FORMAT_ERROR;
+      break;
+    default:
+      return FORMAT_ERROR;
+    }
+  }
+
+  for (uint32_t i = 0; i < header->symbols_size; ++i)
+  {
+    const SnapshotSymbol& symbol = symbols[i];
+    if (symbol.sort >= header->sorts_size ||
+        symbol.string_size == 0 ||
+        symbol.string_begin > header->strings_size ||
+        symbol.string_size > header->strings_size - symbol.string_begin)
+      return FORMAT_ERROR;
+  }
+
+  if (node_children[0] != 0 ||
+      node_children[header->nodes_size] != header->children_size)
+    return FORMAT_ERROR;
+
+  // nodes are in post-order, so arguments precede the nodes using them
+  for (uint32_t i = 0; i < header->nodes_size; ++i)
+  {
+    if (node_children[i] > node_children[i + 1] ||
+        node_sorts[i] >= header->sorts_size)
+      return FORMAT_ERROR;
+
+    for (uint32_t j = node_children[i]; j < node_children[i + 1]; ++j)
+      if (children[j] >= i)
+        return FORMAT_ERROR;
+
+    const uint32_t args_size = node_children[i + 1] - node_children[i];
+    switch (node_kinds[i])
+    {
+    case LITERAL_EXPR_KIND:
+      if (node_opcodes[i] >= LITERAL_TYPES_SIZE || args_size != 0)
+        return FORMAT_ERROR;
+      break;
+    case CONSTANT_EXPR_KIND:
+      if (node_payloads[i] >= header->symbols_size || args_size != 0)
+        return FORMAT_ERROR;
+      break;
+    case FUNC_APP_EXPR_KIND:
+      if (node_payloads[i] >= header->symbols_size || args_size == 0)
+        return FORMAT_ERROR;
+      break;
+    case UNARY_EXPR_KIND:
+    case CONST_ARRAY_EXPR_KIND:
+    case BV_ZERO_EXTEND_EXPR_KIND:
+    case BV_SIGN_EXTEND_EXPR_KIND:
+    case BV_EXTRACT_EXPR_KIND:
+      if (args_size != 1)
+        return FORMAT_ERROR;
+      break;
+    case BINARY_EXPR_KIND:
+    case ARRAY_SELECT_EXPR_KIND:
+      if (args_size != 2)
+        return FORMAT_ERROR;
+      break;
+    case ARRAY_STORE_EXPR_KIND:
+      if (args_size != 3)
+        return FORMAT_ERROR;
+      break;
+    case NARY_EXPR_KIND:
+      if (args_size == 0)
+        return FORMAT_ERROR;
+      break;
+    default:
+      return FORMAT_ERROR;
+    }
+  }
+
+  for (uint32_t i = 0; i < header->roots_size; ++i)
+    if (roots[i] >= header->nodes_size)
+      return FORMAT_ERROR;
+
+  m_data = data;
+  m_size = size;
+  m_header = header;
+  m_sorts = sorts;
+  m_sort_args = sort_args;
+  m_symbols = symbols;
+  m_node_kinds = node_kinds;
+  m_node_opcodes = node_opcodes;
+  m_node_sorts = node_sorts;
+  m_node_children = node_children;
+  m_node_payloads = node_payloads;
+  m_children = children;
+  m_roots = roots;
+  m_strings = data + l.strings;
+  return OK;
+}
+
+Error Snapshot::build(const SharedExprs& roots)
+{
+  unmap();
+
+  SnapshotBuilder builder;
+  for (const SharedExpr& root : roots)
+  {
+    const Error err = builder.add_root(root);
+    if (err)
+      return err;
+  }
+
+  if (std::numeric_limits<uint32_t>::max() <= builder.m_children.size())
+    return UNSUPPORT_ERROR;
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.sorts_size = builder.m_sorts.size();
+  header.sort_args_size = builder.m_sort_args.size();
+  header.symbols_size = builder.m_symbols.size();
+  header.nodes_size = builder.m_node_kinds.size();
+  header.children_size = builder.m_children.size();
+  header.roots_size = builder.m_roots.size();
+  header.strings_size = builder.m_strings.size();
+  header.type_sizes = SNAPSHOT_TYPE_SIZES;
+
+  const Layout l = layout(header);
+  assert(l.size % sizeof(uint64_t) == 0);
+
+  std::vector<uint64_t> buffer(l.size / sizeof(uint64_t), 0);
+  char* const data = reinterpret_cast<char*>(buffer.data());
+  std::memcpy(data, &header, sizeof(header));
+  copy_section(data, l.sorts, builder.m_sorts);
+  copy_section(data, l.sort_args, builder.m_sort_args);
+  copy_section(data, l.symbols, builder.m_symbols);
+  copy_section(data, l.node_kinds, builder.m_node_kinds);
+  copy_section(data, l.node_opcodes, builder.m_node_opcodes);
+  copy_section(data, l.node_sorts, builder.m_node_sorts);
+  copy_section(data, l.node_children, builder.m_node_children);
+  copy_section(data, l.node_payloads, builder.m_node_payloads);
+  copy_section(data, l.children, builder.m_children);
+  copy_section(data, l.roots, builder.m_roots);
+  copy_section(data, l.strings, builder.m_strings);
+
+  const Error err = attach(data, l.size);
+  assert(err == OK);
+
+  m_buffer = std::move(buffer);
+  return err;
+}
+
+Error Snapshot::map(const std::string& path)
+{
+  unmap();
+
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return IO_ERROR;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    close(fd);
+    return IO_ERROR;
+  }
+
+  const size_t size = st.st_size;
+  if (size < sizeof(SnapshotHeader))
+  {
+    close(fd);
+    return FORMAT_ERROR;
+  }
+
+  // the mapping stays valid after the file is closed
+  void* const addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (addr == MAP_FAILED)
+    return IO_ERROR;
+
+  const Error err = attach(static_cast<const char*>(addr), size);
+  if (err)
+  {
+    munmap(addr, size);
+    return err;
+  }
+
+  m_mapped_size = size;
+  return OK;
+}
+
+Error Snapshot::view(const void* const data, const size_t size)
+{
+  unmap();
+  return attach(static_cast<const char*>(data), size);
+}
+
+Error Snapshot::write(const std::string& path) const
+{
+  if (m_data == nullptr)
+    return FORMAT_ERROR;
+
+  std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out)
+    return IO_ERROR;
+
+  out.write(m_data, m_size);
+  out.close();
+  return out ? OK : IO_ERROR;
+}
+
+Error Snapshot::load(
+  SharedExprs& roots,
+  const std::vector<const char*>& prefixes) const
+{
+  if (m_header == nullptr)
+    return FORMAT_ERROR;
+
+  std::vector<const Sort*> sorts(m_header->sorts_size, nullptr);
+  for (uint32_t i = 0; i < m_header->sorts_size; ++i)
+  {
+    const SnapshotSort& sort = m_sorts[i];
+    switch (sort.kind)
+    {
+    case BOOL_SORT_KIND:
+      sorts[i] = &internal::sort<Bool>();
+      break;
+    case INT_SORT_KIND:
+      sorts[i] = &internal::sort<Int>();
+      break;
+    case REAL_SORT_KIND:
+      sorts[i] = &internal::sort<Real>();
+      break;
+    case BV_SORT_KIND:
+      sorts[i] = &bv_sort(sort.is_signed != 0, sort.bv_size);
+      break;
+    case ARRAY_SORT_KIND:
+      sorts[i] = &array_sort(*sorts[m_sort_args[sort.args_begin]],
+        *sorts[m_sort_args[sort.args_begin + 1]]);
+      break;
+    default:
+    {
+      std::vector<const Sort*> args(sort.args_size);
+      for (uint32_t j = 0; j < sort.args_size; ++j)
+        args[j] = sorts[m_sort_args[sort.args_begin + j]];
+
+      sorts[i] = &func_sort(args);
+    }
+    }
+  }
+
+  std::vector<UnsafeDecl> decls;
+  decls.reserve(m_header->symbols_size);
+  for (uint32_t i = 0; i < m_header->symbols_size; ++i)
+  {
+    const SnapshotSymbol& symbol = m_symbols[i];
+    const Sort& sort = *sorts[symbol.sort];
+    std::string name(m_strings + symbol.string_begin, symbol.string_size);
+
+    if (!symbol.is_prefix)
+    {
+      decls.emplace_back(std::move(name), sort);
+      continue;
+    }
+
+    const char* prefix = nullptr;
+    for (const char* const p : prefixes)
+      if (name == p)
+      {
+        prefix = p;
+        break;
+      }
+
+    if (prefix == nullptr)
+      prefix = loaded_prefix(std::move(name));
+
+    decls.emplace_back(prefix, symbol.counter, sort);
+  }
+
+  SharedExprs nodes(m_header->nodes_size);
+  for (uint32_t i = 0; i < m_header->nodes_size; ++i)
+  {
+    const Sort& sort = *sorts[m_node_sorts[i]];
+    const uint8_t opcode = m_node_opcodes[i];
+    const uint64_t payload = m_node_payloads[i];
+    const uint32_t* const args = m_children + m_node_children[i];
+    const uint32_t args_size = m_node_children[i + 1] - m_node_children[i];
+
+    SharedExpr& node = nodes[i];
+    switch (m_node_kinds[i])
+    {
+    case LITERAL_EXPR_KIND:
+      node = make_literal(opcode, sort, payload);
+      break;
+    case CONSTANT_EXPR_KIND:
+      node = constant(decls[payload]);
+      break;
+    case FUNC_APP_EXPR_KIND:
+    {
+      const UnsafeDecl& func_decl = decls[payload];
+      if (!func_decl.sort().is_func() ||
+          func_decl.sort().sorts_size() != args_size + 1)
+        return FORMAT_ERROR;
+
+      SharedExprs operands;
+      operands.reserve(args_size);
+      for (uint32_t j = 0; j < args_size; ++j)
+        operands.push_back(nodes[args[j]]);
+
+      // MAX_FUNC_ARITY < args_size
+      node = internal::make_func_app(func_decl, operands.data(), args_size);
+      if (node.is_null())
+        return UNSUPPORT_ERROR;
+
+      break;
+    }
+    case CONST_ARRAY_EXPR_KIND:
+      node = make_shared_expr<ConstArrayExpr>(sort, nodes[args[0]]);
+      break;
+    case ARRAY_SELECT_EXPR_KIND:
+      if (!nodes[args[0]].sort().is_array())
+        return FORMAT_ERROR;
+
+      node = make_shared_expr<ArraySelectExpr>(
+        nodes[args[0]], nodes[args[1]]);
+      break;
+    case ARRAY_STORE_EXPR_KIND:
+      if (!nodes[args[0]].sort().is_array())
+        return FORMAT_ERROR;
+
+      node = make_shared_expr<ArrayStoreExpr>(
+        nodes[args[0]], nodes[args[1]], nodes[args[2]]);
+      break;
+    case UNARY_EXPR_KIND:
+      node = internal::make_unary(static_cast<Opcode>(opcode), sort,
+        nodes[args[0]]);
+      break;
+    case BINARY_EXPR_KIND:
+      node = internal::make_binary(static_cast<Opcode>(opcode), sort,
+        nodes[args[0]], nodes[args[1]]);
+      break;
+    case NARY_EXPR_KIND:
+    {
+      SharedExprs operands;
+      operands.reserve(args_size);
+      for (uint32_t j = 0; j < args_size; ++j)
+        operands.push_back(nodes[args[j]]);
+
+      node = internal::make_nary(static_cast<Opcode>(opcode), sort,
+        std::move(operands));
+      break;
+    }
+    case BV_ZERO_EXTEND_EXPR_KIND:
+      node = make_shared_expr<BvZeroExtendExpr>(sort, nodes[args[0]],
+        static_cast<unsigned>(payload));
+      break;
+    case BV_SIGN_EXTEND_EXPR_KIND:
+      node = make_shared_expr<BvSignExtendExpr>(sort, nodes[args[0]],
+        static_cast<unsigned>(payload));
+      break;
+    case BV_EXTRACT_EXPR_KIND:
+      node = make_shared_expr<BvExtractExpr>(sort, nodes[args[0]],
+        static_cast<unsigned>(payload >> 32),
+        static_cast<unsigned>(payload));
+      break;
+    }
+
+    // unknown literal type or opcode
+    if (node.is_null())
+      return FORMAT_ERROR;
+  }
+
+  roots.reserve(roots.size() + m_header->roots_size);
+  for (uint32_t i = 0; i < m_header->roots_size; ++i)
+    roots.push_back(nodes[m_roots[i]]);
+
+  return OK;
+}
+
+Error Snapshot::add(
+  Solver& solver,
+  const std::vector<const char*>& prefixes) const
+{
+  SharedExprs roots;
+  const Error err = load(roots, prefixes);
+  if (err)
+    return err;
+
+  for (const SharedExpr& root : roots)
+    if (!root.sort().is_bool())
+      return UNSUPPORT_ERROR;
+
+  for (const SharedExpr& root : roots)
+    solver.unsafe_add(root);
+
+  return OK;
+}
+
+}
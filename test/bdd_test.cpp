@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+
+#include "bdd.h"
+
+#include <vector>
+
+using namespace bdd;
+
+TEST(BddTest, Constants)
+{
+  BDDManager mgr;
+
+  EXPECT_TRUE(mgr.True().is_true());
+  EXPECT_TRUE(mgr.False().is_false());
+  EXPECT_TRUE(mgr.True().is_constant());
+  EXPECT_TRUE(mgr.False().is_constant());
+  EXPECT_EQ(mgr.False().id(), (!mgr.True()).id());
+
+  BDD x;
+  EXPECT_TRUE(x.is_null());
+
+  x = mgr.make_var("x");
+  EXPECT_FALSE(x.is_null());
+  EXPECT_FALSE(x.is_constant());
+  EXPECT_EQ(0, x.var());
+  EXPECT_EQ("x", mgr.label(0));
+  EXPECT_TRUE(x.low().is_false());
+  EXPECT_TRUE(x.high().is_true());
+
+  x.clear();
+  EXPECT_TRUE(x.is_null());
+}
+
+TEST(BddTest, Canonicity)
+{
+  BDDManager mgr;
+
+  BDD x = mgr.make_var("x");
+  BDD y = mgr.make_var("y");
+  BDD z = mgr.make_var("z");
+
+  EXPECT_TRUE((x & !x).is_false());
+  EXPECT_TRUE((x | !x).is_true());
+  EXPECT_TRUE((x ^ x).is_false());
+  EXPECT_TRUE((x == x).is_true());
+  EXPECT_EQ(x.id(), (!!x).id());
+
+  // De Morgan
+  EXPECT_EQ((!(x & y)).id(), ((!x) | (!y)).id());
+  EXPECT_EQ((!(x | y)).id(), ((!x) & (!y)).id());
+
+  // distributivity
+  EXPECT_EQ((x & (y | z)).id(), ((x & y) | (x & z)).id());
+
+  // associativity and commutativity of XOR
+  EXPECT_EQ(((x ^ y) ^ z).id(), (z ^ (y ^ x)).id());
+  EXPECT_EQ((x ^ !y).id(), (!(x ^ y)).id());
+  EXPECT_EQ((x == y).id(), (!(x ^ y)).id());
+
+  // complement edges: a function and its negation share all nodes
+  const BDD f = (x & y) | z;
+  EXPECT_EQ(mgr.node_count(f), mgr.node_count(!f));
+  EXPECT_EQ(4, mgr.node_count(f));
+}
+
+TEST(BddTest, Ite)
+{
+  BDDManager mgr;
+
+  BDD x = mgr.make_var("x");
+  BDD y = mgr.make_var("y");
+  BDD z = mgr.make_var("z");
+
+  EXPECT_EQ(((x & y) | ((!x) & z)).id(), ite(x, y, z).id());
+  EXPECT_EQ((((!z) & y) | (z & x)).id(), ite(!z, y, x).id());
+  EXPECT_EQ((x & y).id(), ite(x, y, mgr.False()).id());
+  EXPECT_EQ((x | z).id(), ite(x, mgr.True(), z).id());
+  EXPECT_EQ((x ^ z).id(), ite(x, !z, z).id());
+  EXPECT_EQ(y.id(), ite(x, y, y).id());
+
+  const BDD f = ite(x ^ y, y | z, (!y) & z);
+  EXPECT_EQ((((x ^ y) & (y | z)) | ((!(x ^ y)) & (!y) & z)).id(), f.id());
+
+  // Shannon expansion with mk()
+  const BDD g = (y & z) | x;
+  EXPECT_EQ(g.id(), mgr.mk(0, y & z, mgr.True()).id());
+  EXPECT_EQ(x.var(), g.var());
+  EXPECT_EQ((y & z).id(), g.low().id());
+  EXPECT_TRUE(g.high().is_true());
+}
+
+TEST(BddTest, SatCount)
+{
+  BDDManager mgr;
+
+  EXPECT_EQ(1.0, mgr.sat_count(mgr.True()));
+  EXPECT_EQ(0.0, mgr.sat_count(mgr.False()));
+
+  BDD x = mgr.make_var("x");
+  BDD y = mgr.make_var("y");
+  BDD z = mgr.make_var("z");
+
+  EXPECT_EQ(8.0, mgr.sat_count(mgr.True()));
+  EXPECT_EQ(4.0, mgr.sat_count(x));
+  EXPECT_EQ(4.0, mgr.sat_count(!z));
+  EXPECT_EQ(1.0, mgr.sat_count(x & y & z));
+  EXPECT_EQ(7.0, mgr.sat_count(x | y | z));
+  EXPECT_EQ(4.0, mgr.sat_count(x ^ y ^ z));
+  EXPECT_EQ(4.0, mgr.sat_count(!(x ^ y ^ z)));
+  EXPECT_EQ(5.0, mgr.sat_count(!(x & (y | z))));
+
+  EXPECT_EQ(1.0, mgr.sat_count(mgr.True(), 0));
+  EXPECT_EQ(1.0, mgr.sat_count(x, 1));
+  EXPECT_EQ(3.0, mgr.sat_count(x | y, 2));
+}
+
+TEST(BddTest, GarbageCollection)
+{
+  // small pool to trigger automatic garbage collection
+  BDDManager mgr(16);
+
+  std::vector<BDD> vars;
+  for (unsigned i = 0; i < 16; ++i)
+    vars.push_back(mgr.make_var());
+
+  const BDD f = (vars[0] ^ vars[1]) & (vars[2] | vars[3]);
+  const size_t f_size = mgr.node_count(f);
+
+  for (unsigned n = 0; n < 64; ++n)
+  {
+    BDD g = mgr.True();
+    for (unsigned i = 0; i < 16; ++i)
+      g = g & (vars[(i + n) % 16] ^ vars[(i + n + 1) % 16]);
+  }
+
+  EXPECT_LT(0, mgr.stats().gc_runs);
+  EXPECT_LT(0, mgr.stats().collected_nodes);
+
+  mgr.gc();
+
+  // referenced nodes survive and remain canonical
+  EXPECT_EQ(f_size, mgr.node_count(f));
+  EXPECT_EQ(f.id(), ((vars[2] | vars[3]) & (vars[1] ^ vars[0])).id());
+  EXPECT_EQ(6.0 * (1 << 12), mgr.sat_count(f));
+
+  // only the variables, f and the terminal are alive
+  EXPECT_GE(16 + f_size, mgr.stats().nodes);
+}
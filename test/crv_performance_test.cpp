@@ -143,3 +143,76 @@ TEST(CrvPerformanceTest, UnsafeSequentialSymbolicModulus)
   std::chrono::seconds sec = std::chrono::duration_cast<std::chrono::seconds>(end - start);
   EXPECT_TRUE(sec.count() < 1);
 }
+
+static void simplifier_fib_t0(
+  const unsigned N,
+  crv::External<int>& i,
+  crv::External<int>& j)
+{
+  for (unsigned k = 0; k < N; k++)
+    i = i + j;
+}
+
+static void simplifier_fib_t1(
+  const unsigned N,
+  crv::External<int>& i,
+  crv::External<int>& j)
+{
+  for (unsigned k = 0; k < N; k++)
+    j = j + i;
+}
+
+static unsigned size(const smt::Solver::Stats& stats)
+{
+  return stats.constants + stats.func_apps + stats.array_selects +
+    stats.array_stores + stats.unary_ops + stats.binary_ops + stats.nary_ops;
+}
+
+static smt::CheckResult check_fib(
+  smt::Simplifier* simplifier,
+  unsigned& formula_size)
+{
+  constexpr unsigned N = 2;
+
+  crv::tracer().reset();
+  crv::dfs_checker().reset();
+  crv::Encoder encoder;
+  encoder.m_solver.set_simplifier(simplifier);
+
+  crv::External<int> i = 1, j = 1;
+  crv::Thread t0(simplifier_fib_t0, N, i, j);
+  crv::Thread t1(simplifier_fib_t1, N, i, j);
+
+  crv::dfs_checker().add_error(8 < i || 8 < j);
+
+  t0.join();
+  t1.join();
+
+  const smt::CheckResult result = encoder.check(crv::tracer(),
+    crv::dfs_checker());
+
+  formula_size = size(encoder.m_solver.stats());
+  return result;
+}
+
+// The encoder starts its conjunctions and disjunctions with literals,
+// which are removed by the simplifier together with the nesting.
+//
+// formula size (encoded nodes) and check time in milliseconds on a
+// 2.1 GHz core with Z3 4.8:
+//
+//   without simplifier  1501   880
+//   with simplifier     1046   540
+TEST(CrvPerformanceTest, Simplifier)
+{
+  unsigned formula_size, simplified_formula_size;
+
+  EXPECT_EQ(smt::unsat, check_fib(nullptr, formula_size));
+
+  smt::Simplifier simplifier;
+  EXPECT_EQ(smt::unsat, check_fib(&simplifier, simplified_formula_size));
+
+  EXPECT_LT(simplified_formula_size, formula_size);
+  EXPECT_LT(0U, simplifier.stats().identities);
+  EXPECT_LT(0U, simplifier.stats().flattenings);
+}
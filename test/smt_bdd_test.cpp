@@ -0,0 +1,334 @@
+#include "gtest/gtest.h"
+
+#include "smt_bdd.h"
+
+#include <string>
+#include <vector>
+
+using namespace smt;
+
+TEST(SmtBddTest, Bools)
+{
+  BddSolver s;
+
+  Bool x = any<Bool>("x");
+  Bool y = any<Bool>("y");
+  Bool z = any<Bool>("z");
+
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  {
+    s.add(x and not x);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  // beyond unit propagation
+  s.push();
+  {
+    s.add((x or y) and (not x or y) and (x or not y));
+    EXPECT_EQ(sat, s.check());
+
+    s.add(not x or not y);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(implies(x, y));
+    s.add(implies(y, z));
+    s.add(x);
+    EXPECT_EQ(sat, s.check());
+
+    s.push();
+    s.add(not z);
+    EXPECT_EQ(unsat, s.check());
+    s.pop();
+
+    EXPECT_EQ(sat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(x != y);
+    s.add(y != z);
+    s.add(x != z);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  EXPECT_EQ(sat, s.check());
+}
+
+TEST(SmtBddTest, Abstraction)
+{
+  BddSolver s;
+
+  Int a = any<Int>("a");
+  Int b = any<Int>("b");
+  Bool x = any<Bool>("x");
+
+  Bool lss = a < b;
+
+  s.push();
+  {
+    s.add(lss);
+    s.add(not lss);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(implies(x, lss) and implies(not x, lss));
+    s.add(not lss or a == b);
+    EXPECT_EQ(unknown, s.check());
+  }
+  s.pop();
+
+  // the abstraction is an over-approximation
+  s.push();
+  {
+    s.add(a < b and b < a);
+    EXPECT_EQ(unknown, s.check());
+  }
+  s.pop();
+
+  // atoms that cancel out do not make the result unknown
+  s.push();
+  {
+    s.add(x);
+    s.add(lss or not lss);
+    EXPECT_EQ(sat, s.check());
+  }
+  s.pop();
+
+  s.add(x);
+  EXPECT_EQ(sat, s.check());
+}
+
+TEST(SmtBddTest, ExactBitVectors)
+{
+  BddSolver s;
+  s.set_max_exact_width(8);
+  EXPECT_EQ(8U, s.max_exact_width());
+
+  Bv<int8_t> x = any<Bv<int8_t>>("x");
+  Bv<uint8_t> y = any<Bv<uint8_t>>("y");
+  Bv<int32_t> z = any<Bv<int32_t>>("z");
+
+  s.push();
+  {
+    s.add(x < 0 and x > -3);
+    EXPECT_EQ(sat, s.check());
+    EXPECT_EQ(2.0, s.model_count());
+
+    s.add(x * x == 4);
+    EXPECT_EQ(sat, s.check());
+    EXPECT_EQ(1.0, s.model_count());
+
+    s.add(x + 2 != 0);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(y > 250);
+    s.add((y & literal<Bv<uint8_t>>(1)) == 0);
+    s.add(bv_cast<uint16_t>(y) + 6 == 0x100);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(bv_cast<int16_t>(x) == -1);
+    s.add(bv_cast<uint8_t>(x) == y);
+    EXPECT_EQ(sat, s.check());
+
+    s.add(y < 255);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  // wider bit vectors are abstracted
+  s.push();
+  {
+    s.add(z < 0 and z > 0);
+    EXPECT_EQ(unknown, s.check());
+  }
+  s.pop();
+
+  // as are divisions
+  s.push();
+  {
+    s.add(x / 2 == 3);
+    EXPECT_EQ(unknown, s.check());
+  }
+  s.pop();
+}
+
+TEST(SmtBddTest, ModelCount)
+{
+  BddSolver s;
+
+  Bool x = any<Bool>("x");
+  Bool y = any<Bool>("y");
+  Bool z = any<Bool>("z");
+
+  EXPECT_EQ(1.0, s.model_count());
+
+  s.add(x or y or z);
+  EXPECT_EQ(7.0, s.model_count());
+
+  s.push();
+  s.add(not x);
+  EXPECT_EQ(3.0, s.model_count());
+  s.add(not y);
+  EXPECT_EQ(1.0, s.model_count());
+  s.add(not z);
+  EXPECT_EQ(0.0, s.model_count());
+  s.pop();
+
+  EXPECT_EQ(7.0, s.model_count());
+
+  // constants of popped assertions are not counted
+  s.push();
+  s.add(any<Bool>("w"));
+  EXPECT_EQ(7.0, s.model_count());
+  s.pop();
+
+  EXPECT_EQ(7.0, s.model_count());
+}
+
+TEST(SmtBddTest, EnumerateCubes)
+{
+  BddSolver s;
+
+  Bool x = any<Bool>("x");
+  Bool y = any<Bool>("y");
+
+  s.add(x != y);
+
+  std::vector<std::string> cubes;
+  s.enumerate_cubes([&s, &cubes](const BddSolver::Cube& cube)
+  {
+    std::string str;
+    for (const BddSolver::CubeLiteral& literal : cube)
+      str += (literal.second ? "" : "!") + s.label(literal.first) + " ";
+
+    cubes.push_back(str);
+    return true;
+  });
+
+  EXPECT_EQ((std::vector<std::string>{"!x y ", "x !y "}), cubes);
+
+  // stop early
+  unsigned n = 0;
+  s.enumerate_cubes([&n](const BddSolver::Cube&) { ++n; return false; });
+  EXPECT_EQ(1U, n);
+
+  // abstracted atoms
+  Int a = any<Int>("a");
+  s.add(a < 7);
+
+  n = 0;
+  s.enumerate_cubes([&s, &n](const BddSolver::Cube& cube)
+  {
+    EXPECT_EQ(3U, cube.size());
+    EXPECT_FALSE(s.is_atom(cube[0].first));
+    EXPECT_FALSE(s.is_atom(cube[1].first));
+    EXPECT_TRUE(s.is_atom(cube[2].first));
+    EXPECT_TRUE(cube[2].second);
+    ++n;
+    return true;
+  });
+  EXPECT_EQ(2U, n);
+}
+
+TEST(SmtBddTest, UnsatCore)
+{
+  BddSolver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool c = any<Bool>("c");
+  Bool not_b = not b;
+  Bool d = any<Bool>("d");
+
+  Bools unsat_core;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+    assumptions.push_back(not_b);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(2, r.second);
+
+    EXPECT_EQ(not_b.addr(), unsat_core.at(unsat_core.size() - 1).addr());
+    EXPECT_EQ(b.addr(), unsat_core.at(unsat_core.size() - 2).addr());
+
+    // singleton
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // assertion will contradict assumption
+    s.add(b);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not_b);
+    assumptions.push_back(c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+
+    // assumptions are not kept
+    EXPECT_EQ(sat, s.check());
+  }
+}
+
+TEST(SmtBddTest, Reset)
+{
+  BddSolver s;
+
+  Bool x = any<Bool>("x");
+  Int a = any<Int>("a");
+
+  s.add(x);
+  s.add(a < 3);
+  s.add(not x);
+  EXPECT_EQ(unsat, s.check());
+
+  s.reset();
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1.0, s.model_count());
+
+  s.add(x);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1.0, s.model_count());
+  EXPECT_EQ("x", s.label(0));
+}
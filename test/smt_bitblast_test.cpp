@@ -0,0 +1,338 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_bitblast.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace smt;
+
+static const std::vector<int8_t> s_signed_values =
+  {-128, -127, -7, -1, 0, 1, 2, 3, 7, 64, 127};
+
+static const std::vector<uint8_t> s_unsigned_values =
+  {0, 1, 2, 3, 7, 64, 128, 200, 255};
+
+// check the circuit of every operator on all pairs of values against C++
+template<typename T>
+static void check_arithmetic(const std::vector<T>& values)
+{
+  BitBlastSolver s;
+
+  const Bv<T> x = any<Bv<T>>("x");
+  const Bv<T> y = any<Bv<T>>("y");
+
+  for (const T a : values)
+  {
+    for (const T b : values)
+    {
+      s.push();
+      s.add(x == a);
+      s.add(y == b);
+
+      std::vector<Bool> conditions;
+      conditions.push_back((x + y) == static_cast<T>(a + b));
+      conditions.push_back((x - y) == static_cast<T>(a - b));
+      conditions.push_back((x * y) == static_cast<T>(a * b));
+      conditions.push_back((x & y) == static_cast<T>(a & b));
+      conditions.push_back((x | y) == static_cast<T>(a | b));
+      conditions.push_back((x ^ y) == static_cast<T>(a ^ b));
+      conditions.push_back(-x == static_cast<T>(-a));
+      conditions.push_back(~x == static_cast<T>(~a));
+
+      // overflow is undefined
+      if (b != 0 && !(a == -128 && b == static_cast<T>(-1)))
+      {
+        conditions.push_back((x / y) == static_cast<T>(a / b));
+        conditions.push_back((x % y) == static_cast<T>(a % b));
+      }
+
+      conditions.push_back((x < y) == literal<Bool>(a < b));
+      conditions.push_back((x > y) == literal<Bool>(a > b));
+      conditions.push_back((x <= y) == literal<Bool>(a <= b));
+      conditions.push_back((x >= y) == literal<Bool>(a >= b));
+      conditions.push_back((x == y) == literal<Bool>(a == b));
+      conditions.push_back((x != y) == literal<Bool>(a != b));
+
+      for (const Bool& condition : conditions)
+      {
+        s.push();
+        s.add(!condition);
+        EXPECT_EQ(unsat, s.check()) << +a << ", " << +b;
+        s.pop();
+      }
+
+      s.pop();
+    }
+  }
+}
+
+TEST(SmtBitBlastTest, SignedArithmetic)
+{
+  check_arithmetic(s_signed_values);
+}
+
+TEST(SmtBitBlastTest, UnsignedArithmetic)
+{
+  check_arithmetic(s_unsigned_values);
+}
+
+TEST(SmtBitBlastTest, Shifts)
+{
+  BitBlastSolver s;
+
+  const Bv<uint8_t> x = any<Bv<uint8_t>>("x");
+  const Bv<uint8_t> y = any<Bv<uint8_t>>("y");
+
+  for (const uint8_t a : s_unsigned_values)
+  {
+    for (uint8_t b = 0; b < 8; ++b)
+    {
+      s.push();
+      s.add(x == a);
+      s.add(y == b);
+      s.add((x << y) != static_cast<uint8_t>(a << b) ||
+        (x >> y) != static_cast<uint8_t>(a >> b));
+      EXPECT_EQ(unsat, s.check()) << +a << ", " << +b;
+      s.pop();
+    }
+  }
+
+  // shifting by the width yields zero
+  s.add(y == 8);
+  s.add((x << y) != 0 || (x >> y) != 0);
+  EXPECT_EQ(unsat, s.check());
+}
+
+TEST(SmtBitBlastTest, DivisionByZero)
+{
+  BitBlastSolver s;
+
+  const Bv<uint8_t> x = any<Bv<uint8_t>>("x");
+  const Bv<uint8_t> zero = any<Bv<uint8_t>>("zero");
+
+  s.add(zero == 0);
+  s.add((x / zero) != 0xff || (x % zero) != x);
+  EXPECT_EQ(unsat, s.check());
+}
+
+TEST(SmtBitBlastTest, Valid)
+{
+  BitBlastSolver s;
+
+  const Bv<int8_t> x = any<Bv<int8_t>>("x");
+  const Bv<int8_t> y = any<Bv<int8_t>>("y");
+
+  s.push();
+  s.add(x * y != y * x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(y != 0 && (x / y) * y + (x % y) != x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(x + y == x && y != 0);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(x * x == 49 && x < 0);
+  EXPECT_EQ(sat, s.check());
+  s.pop();
+}
+
+TEST(SmtBitBlastTest, Casts)
+{
+  BitBlastSolver s;
+
+  Bv<int8_t> x = any<Bv<int8_t>>("x");
+  Bv<int16_t> y = any<Bv<int16_t>>("y");
+  Bv<uint16_t> z = any<Bv<uint16_t>>("z");
+
+  s.add(x == static_cast<int8_t>(0x87));
+  s.add(y == bv_cast<int16_t>(x));
+  s.add(z == bv_cast<uint16_t>(bv_cast<uint8_t>(x)));
+
+  s.push();
+  s.add(y != static_cast<int16_t>(0xff87));
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(z != 0x0087);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(bv_cast<int8_t>(y) != x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+}
+
+TEST(SmtBitBlastTest, Bool)
+{
+  BitBlastSolver s;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool c = any<Bool>("c");
+
+  s.add(implies(a, b));
+  s.add(implies(b, c));
+  s.add(a || c);
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  s.add(!c);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(a != c);
+  s.add(!b);
+  EXPECT_EQ(sat, s.check());
+  s.pop();
+
+  Bools bools(3);
+  bools.push_back(a);
+  bools.push_back(b);
+  bools.push_back(c);
+
+  Bools distinct_bools(3);
+  distinct_bools.push_back(a);
+  distinct_bools.push_back(b);
+  distinct_bools.push_back(c);
+
+  s.push();
+  s.add(distinct(std::move(distinct_bools)));
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.push();
+  s.add(!conjunction(bools));
+  s.add(a);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(3, s.assertions().size());
+}
+
+TEST(SmtBitBlastTest, Distinct)
+{
+  BitBlastSolver s;
+
+  Terms<Bv<uint8_t>> xs(4);
+  for (int i = 0; i < 4; ++i)
+  {
+    const Bv<uint8_t> x = any<Bv<uint8_t>>("x" + std::to_string(i));
+    s.add(x < 3);
+    xs.push_back(x);
+  }
+
+  // four distinct values cannot all be smaller than three
+  s.add(distinct(std::move(xs)));
+  EXPECT_EQ(unsat, s.check());
+}
+
+TEST(SmtBitBlastTest, UnsatCore)
+{
+  BitBlastSolver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool c = any<Bool>("c");
+  Bool not_b = not b;
+  Bool d = any<Bool>("d");
+
+  Bools unsat_core;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+    assumptions.push_back(not_b);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(2, r.second);
+
+    EXPECT_EQ(not_b.addr(), unsat_core.at(unsat_core.size() - 1).addr());
+    EXPECT_EQ(b.addr(), unsat_core.at(unsat_core.size() - 2).addr());
+
+    // singleton
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // assertion will contradict assumption
+    s.add(b);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not_b);
+    assumptions.push_back(c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // inside a push/pop scope
+    s.push();
+    s.add(c);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+
+    s.pop();
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+}
+
+TEST(SmtBitBlastTest, Reset)
+{
+  BitBlastSolver s;
+
+  const Bv<int> x = any<Bv<int>>("x");
+
+  s.add(x < 3);
+  s.add(x > 3);
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_LT(0, s.aig_size());
+
+  s.reset();
+  EXPECT_EQ(0, s.aig_size());
+
+  s.add(x == 3);
+  EXPECT_EQ(sat, s.check());
+}
@@ -0,0 +1,192 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_cache.h"
+
+using namespace smt;
+
+TEST(SmtCacheTest, Hit)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+  const Bool a = x < y;
+  const Bool b = y < literal<Int>(3);
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver);
+
+  s.add(a);
+  s.add(b);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, s.cache_stats().misses);
+  EXPECT_EQ(1, s.cache_size());
+
+  // order and duplicates are irrelevant
+  s.reset();
+  s.add(b);
+  s.add(a);
+  s.add(b);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, s.cache_stats().hits);
+  EXPECT_EQ(1, s.cache_stats().misses);
+  EXPECT_EQ(1, z3_solver.stats().sat_checks);
+
+#ifdef ENABLE_HASH_CONS
+  // structurally equal assertions are the same expression
+  s.reset();
+  s.add(any<Int>("y") < literal<Int>(3));
+  s.add(any<Int>("x") < any<Int>("y"));
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(2, s.cache_stats().hits);
+#endif
+}
+
+TEST(SmtCacheTest, Subsumption)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+  const Bool a = x < literal<Int>(3);
+  const Bool b = literal<Int>(5) < x;
+  const Bool c = y == literal<Int>(1);
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver);
+
+  s.add(a);
+  s.add(b);
+  EXPECT_EQ(unsat, s.check());
+
+  // superset of an unsatisfiable set
+  s.add(c);
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(1, s.cache_stats().unsat_superset_hits);
+
+  s.reset();
+  s.add(a);
+  s.add(c);
+  EXPECT_EQ(sat, s.check());
+
+  // subset of a satisfiable set
+  s.reset();
+  s.add(c);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, s.cache_stats().sat_subset_hits);
+
+  EXPECT_EQ(0, s.cache_stats().hits);
+  EXPECT_EQ(2, s.cache_stats().misses);
+  EXPECT_EQ(2, s.cache_size());
+}
+
+TEST(SmtCacheTest, Eviction)
+{
+  const Int x = any<Int>("x");
+  const Bool a = x < literal<Int>(3);
+  const Bool b = literal<Int>(5) < x;
+  const Bool c = x == literal<Int>(4);
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver, 2);
+
+  for (const Bool& condition : {a, b, c})
+  {
+    s.reset();
+    s.add(condition);
+    EXPECT_EQ(sat, s.check());
+  }
+
+  EXPECT_EQ(3, s.cache_stats().misses);
+  EXPECT_EQ(1, s.cache_stats().evictions);
+  EXPECT_EQ(2, s.cache_size());
+
+  // least recently used result was evicted
+  s.reset();
+  s.add(a);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(4, s.cache_stats().misses);
+
+  s.reset();
+  s.add(c);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, s.cache_stats().hits);
+
+  s.clear_cache();
+  EXPECT_EQ(0, s.cache_size());
+}
+
+TEST(SmtCacheTest, ScanLimit)
+{
+  const Int x = any<Int>("x");
+  const Bool a = x < literal<Int>(3);
+  const Bool b = literal<Int>(5) < x;
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver, 4096, 1);
+
+  s.add(a);
+  s.add(b);
+  EXPECT_EQ(unsat, s.check());
+
+  s.reset();
+  s.add(x == literal<Int>(4));
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(2, s.cache_size());
+
+  // the unsat result is no longer the most recently used result
+  s.reset();
+  s.add(a);
+  s.add(b);
+  s.add(x == literal<Int>(7));
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(0, s.cache_stats().unsat_superset_hits);
+  EXPECT_EQ(2, s.cache_stats().scan_limit_hits);
+  EXPECT_EQ(3, s.cache_stats().misses);
+}
+
+TEST(SmtCacheTest, PushPop)
+{
+  const Int x = any<Int>("x");
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver);
+
+  s.add(x < literal<Int>(3));
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  s.add(literal<Int>(5) < x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  EXPECT_EQ(1, z3_solver.assertions().size());
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, s.cache_stats().hits);
+  EXPECT_EQ(2, z3_solver.stats().sat_checks + z3_solver.stats().unsat_checks);
+}
+
+TEST(SmtCacheTest, Assumptions)
+{
+  const Bool a = any<Bool>("a");
+  const Bool b = any<Bool>("b");
+
+  Z3Solver z3_solver;
+  CachingSolver s(z3_solver);
+
+  s.add(a || b);
+
+  Bools assumptions(1);
+  assumptions.push_back(!a);
+
+  Bools unsat_core(1);
+  EXPECT_EQ(sat, s.check_assumptions(assumptions, unsat_core).first);
+  EXPECT_EQ(sat, s.check_assumptions(assumptions, unsat_core).first);
+  EXPECT_EQ(1, s.cache_stats().hits);
+
+  // unsat cores are computed by the decorated solver
+  assumptions.push_back(!b);
+  std::pair<CheckResult, Bools::SizeType> result =
+    s.check_assumptions(assumptions, unsat_core);
+
+  EXPECT_EQ(unsat, result.first);
+  EXPECT_EQ(2, s.cache_stats().misses);
+}
@@ -1092,3 +1092,187 @@ TEST(SmtCVC4Test, LogicalShifts)
   }
   s.pop();
 }
+
+TEST(SmtCVC4Test, CheckAssumptions)
+{
+  CVC4Solver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  // ignore
+  Bools unsat_core;
+  unsat_core.resize(0);
+
+  Bv<int> x = any<Bv<int>>("x");
+  Bool a = x < 7;
+  Bool b = !a;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+
+    assumptions.pop_back();
+    assumptions.push_back(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+
+  s.reset();
+
+  {
+    Bools assumptions;
+    assumptions.push_back(b);
+
+    s.add(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+
+    assumptions.pop_back();
+    assumptions.push_back(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+}
+
+#ifdef SMT_CVC4_UNSAT_ASSUMPTIONS
+TEST(SmtCVC4Test, UnsatCore)
+{
+  CVC4Solver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool c = any<Bool>("c");
+  Bool not_b = not b;
+  Bool d = any<Bool>("d");
+
+  Bools unsat_core;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+    assumptions.push_back(not_b);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(2, r.second);
+
+    EXPECT_EQ(not_b.addr(), unsat_core.at(unsat_core.size() - 1).addr());
+    EXPECT_EQ(b.addr(), unsat_core.at(unsat_core.size() - 2).addr());
+
+    // singleton
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // assertion will contradict assumption
+    s.add(b);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not_b);
+    assumptions.push_back(c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // inside a push/pop scope
+    s.push();
+    s.add(c);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+
+    s.pop();
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+}
+#else
+TEST(SmtCVC4Test, UnsatCore)
+{
+  CVC4Solver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool not_b = not b;
+
+  Bools assumptions;
+  assumptions.push_back(a);
+  assumptions.push_back(b);
+  assumptions.push_back(not_b);
+  assumptions.push_back(b);
+
+  // all distinct assumptions are in the unsat core
+  Bools unsat_core;
+  unsat_core.resize(7);
+  r = s.check_assumptions(assumptions, unsat_core);
+
+  EXPECT_EQ(unsat, r.first);
+  EXPECT_EQ(3, r.second);
+  EXPECT_EQ(not_b.addr(), unsat_core.at(unsat_core.size() - 1).addr());
+  EXPECT_EQ(b.addr(), unsat_core.at(unsat_core.size() - 2).addr());
+  EXPECT_EQ(a.addr(), unsat_core.at(unsat_core.size() - 3).addr());
+
+  assumptions.pop_back();
+  assumptions.pop_back();
+  r = s.check_assumptions(assumptions, unsat_core);
+  EXPECT_EQ(sat, r.first);
+}
+#endif
+
+TEST(SmtCVC4Test, ExprCache)
+{
+  CVC4Solver s;
+
+  Decl<Func<Int, Int>> func_decl("f");
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+
+  // both applications refer to the same function
+  s.add(x == y);
+  s.add(apply(func_decl, x) != apply(func_decl, y));
+  EXPECT_EQ(unsat, s.check());
+
+  s.reset();
+
+  // exponentially many paths, but each shared node is encoded once
+  const Bool b = any<Bool>("b");
+  Bool chain = b;
+  for (unsigned i = 0; i < 64; i++)
+    chain = chain && (chain || !b);
+
+  s.add(chain);
+  s.add(!b);
+  EXPECT_EQ(unsat, s.check());
+}
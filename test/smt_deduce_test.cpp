@@ -55,12 +55,12 @@ TEST(SmtDeduceTest, Bools)
   }
   s.pop();
 
-  // increase precision
+  // gates propagate from their output to their inputs
   s.push();
   {
     smt::Bool ite = (x and y) or (not x and y);
     s.add(ite and not y);
-    EXPECT_EQ(smt::unknown, s.check());
+    EXPECT_EQ(smt::unsat, s.check());
   }
   s.pop();
 
@@ -126,12 +126,12 @@ TEST(SmtDeduceTest, Abstraction)
   }
   s.pop();
 
-  // increase precision
+  // gates propagate from their output to their inputs
   s.push();
   {
     smt::Bool ite = (x and y) or (not x and y);
     s.add(ite and not y);
-    EXPECT_EQ(smt::unknown, s.check());
+    EXPECT_EQ(smt::unsat, s.check());
   }
   s.pop();
 
@@ -177,3 +177,115 @@ TEST(SmtDeduceTest, Reset)
   s.add(x);
   EXPECT_EQ(smt::unknown, s.check());
 }
+
+TEST(SmtDeduceTest, Incremental)
+{
+  DeduceSolver s;
+  smt::Bool x = smt::any<smt::Bool>("x");
+  smt::Bool y = smt::any<smt::Bool>("y");
+  smt::Bool z = smt::any<smt::Bool>("z");
+  smt::Bool w = smt::any<smt::Bool>("w");
+
+  s.add(not x);
+  EXPECT_EQ(smt::unknown, s.check());
+
+  // gates defined at a popped level are kept
+  s.push();
+  {
+    s.add(x and y);
+    EXPECT_EQ(smt::unsat, s.check());
+
+    s.push();
+    s.add(z);
+    EXPECT_EQ(smt::unsat, s.check());
+    s.pop();
+
+    EXPECT_EQ(smt::unsat, s.check());
+  }
+  s.pop();
+
+  EXPECT_EQ(smt::unknown, s.check());
+
+  s.add((x and y) or z);
+  EXPECT_EQ(smt::unknown, s.check());
+
+  s.push();
+  {
+    s.add(implies(z, w));
+    EXPECT_EQ(smt::unknown, s.check());
+
+    s.add(not w);
+    EXPECT_EQ(smt::unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(w == z);
+    s.add(not w);
+    EXPECT_EQ(smt::unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(w != z);
+    s.add(w);
+    EXPECT_EQ(smt::unsat, s.check());
+  }
+  s.pop();
+
+  // pop() only undoes the facts of its level, so repeating the same
+  // push(), add() and pop() always takes the same number of propagations
+  uint64_t propagations = s.deduce_stats().propagations;
+  s.push();
+  s.add(w);
+  s.pop();
+  const uint64_t delta = s.deduce_stats().propagations - propagations;
+  EXPECT_LT(0U, delta);
+
+  propagations = s.deduce_stats().propagations;
+  for (unsigned i = 0; i < 100; ++i)
+  {
+    s.push();
+    s.add(w);
+    EXPECT_EQ(smt::unknown, s.check());
+    s.pop();
+  }
+  EXPECT_EQ(propagations + 100 * delta, s.deduce_stats().propagations);
+  EXPECT_EQ(smt::unknown, s.check());
+}
+
+TEST(SmtDeduceTest, UnsatCore)
+{
+  DeduceSolver s;
+  std::pair<smt::CheckResult, smt::Bools::SizeType> r;
+
+  smt::Bool a = smt::any<smt::Bool>("a");
+  smt::Bool b = smt::any<smt::Bool>("b");
+  smt::Bool c = smt::any<smt::Bool>("c");
+
+  s.add(implies(a, b));
+
+  smt::Bools assumptions;
+  assumptions.push_back(a);
+  assumptions.push_back(not b);
+  assumptions.push_back(c);
+
+  smt::Bools unsat_core;
+  unsat_core.resize(3);
+  r = s.check_assumptions(assumptions, unsat_core);
+  EXPECT_EQ(smt::unsat, r.first);
+  EXPECT_EQ(2, r.second);
+  EXPECT_EQ(assumptions.at(1).addr(), unsat_core.at(2).addr());
+  EXPECT_EQ(assumptions.at(0).addr(), unsat_core.at(1).addr());
+
+  // assumptions are not kept
+  EXPECT_EQ(smt::unknown, s.check());
+
+  assumptions.clear();
+  assumptions.push_back(a);
+  assumptions.push_back(c);
+  r = s.check_assumptions(assumptions, unsat_core);
+  EXPECT_EQ(smt::unknown, r.first);
+}
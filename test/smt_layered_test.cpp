@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include "smt_layered.h"
+#include "smt_deduce.h"
+#include "smt_z3.h"
+
+using namespace smt;
+
+TEST(SmtLayeredTest, Check)
+{
+  const Bool x = any<Bool>("x");
+  const Int a = any<Int>("a");
+  const Int b = any<Int>("b");
+
+  DeduceSolver deduce_solver;
+  Z3Solver z3_solver;
+  LayeredSolver s({&deduce_solver, &z3_solver});
+
+  s.add(a < b);
+  EXPECT_EQ(sat, s.check());
+
+  // resolved by the first layer
+  s.push();
+  {
+    s.add(x);
+    s.add(not x);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(b < a);
+    EXPECT_EQ(unsat, s.check());
+
+    // assertions are mirrored only once
+    EXPECT_EQ(2, z3_solver.assertions().size());
+    EXPECT_EQ(unsat, s.check());
+    EXPECT_EQ(2, z3_solver.assertions().size());
+  }
+  s.pop();
+
+  EXPECT_EQ(1, z3_solver.assertions().size());
+  EXPECT_EQ(1, deduce_solver.assertions().size());
+
+  s.add(a == b);
+  EXPECT_EQ(unsat, s.check());
+
+  const LayeredSolver::LayerStats& stats = s.layer_stats();
+  EXPECT_EQ(2, stats.queries.size());
+  EXPECT_EQ(5, stats.queries[0]);
+  EXPECT_EQ(1, stats.resolved[0]);
+  EXPECT_EQ(4, stats.queries[1]);
+  EXPECT_EQ(4, stats.resolved[1]);
+  EXPECT_EQ(0, stats.unknowns);
+
+  EXPECT_EQ(0.2, s.resolution_rate(0));
+  EXPECT_EQ(1.0, s.resolution_rate(1));
+}
+
+TEST(SmtLayeredTest, Mirror)
+{
+  const Bool x = any<Bool>("x");
+  const Bool y = any<Bool>("y");
+
+  DeduceSolver deduce_solver;
+  Z3Solver z3_solver;
+  LayeredSolver s({&deduce_solver, &z3_solver});
+
+  s.add(x or y);
+  s.push();
+  s.add(not x);
+  s.push();
+  s.add(not y);
+
+  // the last layer is never asked
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(0, z3_solver.assertions().size());
+
+  s.pop();
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(2, z3_solver.assertions().size());
+
+  // levels that a layer has not seen are not popped
+  s.pop();
+  EXPECT_EQ(1, z3_solver.assertions().size());
+  s.push();
+  s.add(not y);
+  s.push();
+  s.pop();
+  s.add(not x);
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(1, z3_solver.assertions().size());
+
+  s.reset();
+  EXPECT_EQ(0, deduce_solver.assertions().size());
+  EXPECT_EQ(0, z3_solver.assertions().size());
+
+  s.add(x);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(1, z3_solver.assertions().size());
+}
+
+TEST(SmtLayeredTest, Assumptions)
+{
+  const Bool a = any<Bool>("a");
+  const Bool b = any<Bool>("b");
+
+  DeduceSolver deduce_solver;
+  Z3Solver z3_solver;
+  LayeredSolver s({&deduce_solver, &z3_solver});
+
+  s.add(a or b);
+
+  Bools assumptions;
+  assumptions.push_back(not a);
+
+  Bools unsat_core;
+  unsat_core.resize(2);
+  EXPECT_EQ(sat, s.check_assumptions(assumptions, unsat_core).first);
+  EXPECT_EQ(1, s.layer_stats().queries[1]);
+
+  assumptions.push_back(not b);
+  const std::pair<CheckResult, Bools::SizeType> r =
+    s.check_assumptions(assumptions, unsat_core);
+  EXPECT_EQ(unsat, r.first);
+  EXPECT_EQ(2, r.second);
+  EXPECT_EQ(1, s.layer_stats().resolved[0]);
+  EXPECT_EQ(1, s.layer_stats().queries[1]);
+}
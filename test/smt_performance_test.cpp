@@ -0,0 +1,270 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_smtlib.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+using namespace smt;
+
+/* Deep DAG whose number of root-to-leaf paths grows like the Fibonacci
+   sequence, i.e. x_{i+2} = x_{i+1} + x_i. Every node is shared by its
+   two successors, as in the hash-consed chains built by crv::Encoder.
+
+   Total encode time in milliseconds on a single 2.1GHz core with Z3 4.8:
+
+     \begin{tabular}{r|r|r}
+     Depth & Without Expr cache & With Expr cache \\ \midrule
+     16 & 11 & 5\\
+     24 & 120 & 5\\
+     28 & 724 & 5\\
+     32 & 3650 & 5\\
+     1024 & - & 9\\
+     \end{tabular}
+*/
+TEST(SmtPerformanceTest, Z3SharedDagEncoding)
+{
+  constexpr unsigned N = 1024;
+
+  Z3Solver s;
+
+  Bv<unsigned> x0 = any<Bv<unsigned>>("x");
+  Bv<unsigned> x1 = any<Bv<unsigned>>("y");
+  for (unsigned i = 0; i < N; i++)
+  {
+    Bv<unsigned> x2 = x1 + x0;
+    x0 = x1;
+    x1 = x2;
+  }
+
+  s.add(x1 == 0u);
+
+  EXPECT_TRUE(s.stats().encode_elapsed_time.count() < 1000);
+}
+
+/* Throughput of creating and then destroying 2^18 hash-consed bit vector
+   terms of the form x + i < x, four times over. Every iteration creates
+   one LiteralExpr and two BinaryExpr nodes.
+
+   Total time in milliseconds on a single 2.1GHz core with g++ -O2:
+
+     \begin{tabular}{r|r|r}
+     Allocator & Hash table & Time (ms) \\ \midrule
+     operator new & std::unordered_multimap & 3026\\
+     internal::ExprPool & std::unordered_multimap & 1822\\
+     internal::ExprPool & Robin Hood & 1000\\
+     \end{tabular}
+
+   With the Robin Hood table, the average lookup inspects fewer than
+   two slots.
+*/
+TEST(SmtPerformanceTest, ExprCreateDestroy)
+{
+  constexpr unsigned N = 1U << 18;
+
+  auto start = std::chrono::system_clock::now();
+  for (unsigned k = 0; k < 4; k++)
+  {
+    Bv<unsigned> x = any<Bv<unsigned>>("x");
+    Bools bools;
+    bools.reserve(N);
+    for (unsigned i = 0; i < N; i++)
+      bools.push_back(x + literal<Bv<unsigned>>(i) < x);
+  }
+  auto end = std::chrono::system_clock::now();
+
+  std::chrono::seconds sec = std::chrono::duration_cast<std::chrono::seconds>(end - start);
+  EXPECT_TRUE(sec.count() < 10);
+
+#ifdef ENABLE_HASH_CONS
+  const internal::ExprStore<BinaryExpr<ADD>>::Stats stats =
+    internal::ExprStore<BinaryExpr<ADD>>::instance().stats();
+
+  EXPECT_LE(4 * N, stats.lookups);
+  EXPECT_LT(stats.average_probe_length(), 2.0);
+#endif
+}
+
+#ifdef ENABLE_EXPR_POOL
+/* Allocator microbenchmark that isolates the memory management cost of
+   expression nodes: 2^20 blocks of the size of a BinaryExpr are allocated
+   and then freed in reverse order, sixteen times over.
+
+   Total time in milliseconds on a single 2.1GHz core with g++ -O2:
+
+     \begin{tabular}{r|r}
+     Allocator & Time (ms) \\ \midrule
+     operator new & 934\\
+     internal::ExprPool & 408\\
+     \end{tabular}
+*/
+TEST(SmtPerformanceTest, ExprPoolThroughput)
+{
+  typedef internal::ExprPool ExprPool;
+
+  constexpr unsigned N = 1U << 20;
+  constexpr size_t block_size = sizeof(BinaryExpr<ADD>);
+
+  std::vector<void*> ptrs(N, nullptr);
+
+  auto start = std::chrono::system_clock::now();
+  for (unsigned k = 0; k < 16; k++)
+  {
+    for (unsigned i = 0; i < N; i++)
+      ptrs[i] = ::operator new(block_size);
+
+    for (unsigned i = N; i != 0; i--)
+      ::operator delete(ptrs[i - 1]);
+  }
+  auto end = std::chrono::system_clock::now();
+  const auto new_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  const ExprPool::Stats before = ExprPool::stats(block_size);
+
+  start = std::chrono::system_clock::now();
+  for (unsigned k = 0; k < 16; k++)
+  {
+    for (unsigned i = 0; i < N; i++)
+      ptrs[i] = ExprPool::allocate(block_size);
+
+    for (unsigned i = N; i != 0; i--)
+      ExprPool::deallocate(ptrs[i - 1], block_size);
+  }
+  end = std::chrono::system_clock::now();
+  const auto pool_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+  const ExprPool::Stats after = ExprPool::stats(block_size);
+  EXPECT_EQ(before.live_blocks, after.live_blocks);
+  EXPECT_EQ(before.allocations + 16 * N, after.allocations);
+
+  // chunks are reused after the first round
+  EXPECT_LE(after.chunks - before.chunks,
+    N / (ExprPool::s_chunk_size / block_size) + 1);
+
+  EXPECT_LE(pool_time.count(), 2 * new_time.count() + 100);
+}
+#endif
+
+#ifdef ENABLE_CONCURRENCY
+/* Scalability of independent checks that run in concurrent threads.
+   Each thread creates its own hash-consed terms, some of which are
+   equal to those of other threads, and encodes them with its own
+   Z3Solver. The amount of work per thread is fixed, so ideal scaling
+   keeps the total time constant as threads are added until all cores
+   are busy.
+
+   Total time in milliseconds with g++ -O2 and Z3 4.8 on a machine with
+   a single 2.1GHz core, i.e. where threads are time-sliced and the time
+   can only grow linearly; the point is that it grows no faster:
+
+     \begin{tabular}{r|r}
+     Threads & Time (ms) \\ \midrule
+     1 & 112\\
+     2 & 263\\
+     4 & 549\\
+     8 & 1354\\
+     \end{tabular}
+*/
+TEST(SmtPerformanceTest, ConcurrentChecks)
+{
+  constexpr unsigned N = 1U << 12;
+
+  const unsigned counter = Expr::s_counter;
+  const unsigned max_threads_size =
+    std::max(8U, std::thread::hardware_concurrency());
+
+  for (unsigned threads_size = 1; threads_size <= max_threads_size; threads_size *= 2)
+  {
+    std::vector<CheckResult> results(threads_size, unknown);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::system_clock::now();
+    for (unsigned t = 0; t < threads_size; t++)
+    {
+      threads.emplace_back([&results, t]()
+      {
+        Z3Solver s;
+
+        Bv<unsigned> x = any<Bv<unsigned>>("x");
+        Bv<unsigned> y = any<Bv<unsigned>>("y");
+        for (unsigned i = 0; i < N; i++)
+          s.add(x + literal<Bv<unsigned>>(i) != y);
+
+        s.add(x + literal<Bv<unsigned>>(t % N) == y);
+        results[t] = s.check();
+      });
+    }
+
+    for (std::thread& thread : threads)
+      thread.join();
+
+    auto end = std::chrono::system_clock::now();
+    std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    EXPECT_TRUE(ms.count() < 1000 * threads_size);
+
+    for (unsigned t = 0; t < threads_size; t++)
+      EXPECT_EQ(unsat, results[t]);
+  }
+
+  EXPECT_EQ(counter, Expr::s_counter);
+}
+#endif
+
+/* SMT-LIB 2 parser throughput on a generated QF_BV script of 2^18
+   assertions over 1024 constants, of which every fourth binds a shared
+   subterm with let. No solver is attached, so this measures only the
+   tokenizer, the symbol tables and the construction of hash-consed terms.
+
+   Almost every assertion contains a fresh literal, so about five new
+   expressions are created per assertion. Their construction, mostly the
+   lookups in ExprStore, takes about two thirds of the time; tokenizing
+   and resolving symbols take the rest.
+
+   Throughput on a single core with g++ -O2:
+
+     \begin{tabular}{r|r}
+     Script size (MB) & Throughput (MB/s) \\ \midrule
+     18.6 & 40\\
+     \end{tabular}
+*/
+TEST(SmtPerformanceTest, SmtLibParserThroughput)
+{
+  constexpr unsigned N = 1U << 18;
+  constexpr unsigned M = 1024;
+
+  std::string script("(set-logic QF_BV)\n");
+  for (unsigned j = 0; j < M; j++)
+    script += "(declare-fun x" + std::to_string(j) + " () (_ BitVec 32))\n";
+
+  for (unsigned i = 0; i < N; i++)
+  {
+    const std::string x("x" + std::to_string(i % M));
+    const std::string y("x" + std::to_string((i * 7) % M));
+    const std::string c("(_ bv" + std::to_string(i) + " 32)");
+    if (i % 4 == 0)
+      script += "(assert (let ((t (bvadd " + x + " " + c + "))) "
+        "(bvult (bvmul t t) " + y + ")))\n";
+    else
+      script += "(assert (bvule (bvadd " + x + " " + c + ") "
+        "(bvand " + y + " #x0000ffff)))\n";
+  }
+
+  SmtLibParser parser;
+
+  auto start = std::chrono::system_clock::now();
+  EXPECT_EQ(OK, parser.parse(script));
+  auto end = std::chrono::system_clock::now();
+
+  EXPECT_EQ(N, parser.assertions().size());
+
+  std::chrono::milliseconds ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  EXPECT_TRUE(ms.count() < 10000);
+
+  RecordProperty("MBPerSecond", static_cast<int>(
+    script.size() / 1000.0 / std::max<long>(1, ms.count())));
+}
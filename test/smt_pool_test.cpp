@@ -0,0 +1,101 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_pool.h"
+
+#include <future>
+
+using namespace smt;
+
+#ifdef ENABLE_CONCURRENCY
+
+TEST(SmtPoolTest, CheckAsync)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+
+  Z3Solver z3_solver_a;
+  Z3Solver z3_solver_b;
+  SolverPool pool({&z3_solver_a, &z3_solver_b});
+  EXPECT_EQ(2, pool.size());
+
+  Bools assertions;
+  assertions.push_back(x < y);
+  std::future<CheckResult> sat_future = pool.check_async(assertions);
+
+  // the pool copied the assertions
+  assertions.push_back(y < x);
+  std::future<CheckResult> unsat_future = pool.check_async(assertions);
+
+  std::vector<std::future<CheckResult>> futures;
+  for (int i = 0; i < 8; ++i)
+  {
+    Bools query;
+    query.push_back(x == literal<Int>(i));
+    query.push_back(x < y);
+    futures.push_back(pool.check_async(std::move(query)));
+  }
+
+  EXPECT_EQ(sat, sat_future.get());
+  EXPECT_EQ(unsat, unsat_future.get());
+  for (std::future<CheckResult>& future : futures)
+    EXPECT_EQ(sat, future.get());
+
+  EXPECT_EQ(10, pool.pool_stats().queries);
+  EXPECT_EQ(10, z3_solver_a.stats().sat_checks +
+    z3_solver_a.stats().unsat_checks + z3_solver_b.stats().sat_checks +
+    z3_solver_b.stats().unsat_checks);
+}
+
+TEST(SmtPoolTest, Destructor)
+{
+  typedef Bv<uint64_t> T;
+
+  const T x = any<T>("x");
+  const T y = any<T>("y");
+  const T one = literal<T>(1);
+  const T max = literal<T>(UINT64_C(0xffffffff));
+
+  // factor the product of two 31-bit primes by bit-blasting
+  Bools assertions;
+  assertions.push_back(x * y ==
+    literal<T>(UINT64_C(2147483647) * UINT64_C(2147483629)));
+  assertions.push_back(one < x && x < max);
+  assertions.push_back(one < y && y < max);
+
+  Z3Solver z3_solver;
+  std::future<CheckResult> running_future;
+  std::future<CheckResult> queued_future;
+
+  {
+    SolverPool pool({&z3_solver});
+    running_future = pool.check_async(assertions);
+    queued_future = pool.check_async(assertions);
+    EXPECT_LE(1, pool.pool_stats().queued_queries);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  EXPECT_EQ(unknown, running_future.get());
+  EXPECT_EQ(unknown, queued_future.get());
+  EXPECT_EQ(1, z3_solver.stats().unknown_checks);
+
+  // the worker is busy but has not started its check yet because it
+  // still encodes the assertions
+  for (uint64_t i = 0; i < 10000; ++i)
+    assertions.push_back(x != literal<T>(i));
+
+  for (int i = 0; i < 4; ++i)
+  {
+    {
+      SolverPool pool({&z3_solver});
+      running_future = pool.check_async(assertions);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(unknown, running_future.get());
+  }
+}
+
+#endif
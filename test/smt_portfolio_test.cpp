@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_portfolio.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace smt;
+
+#ifdef ENABLE_CONCURRENCY
+
+TEST(SmtPortfolioTest, Check)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+
+  Z3Solver z3_solver_a;
+  Z3Solver z3_solver_b(QF_LIA_LOGIC);
+  PortfolioSolver s({&z3_solver_a, &z3_solver_b});
+
+  s.add(x < y);
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  s.add(y < x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  EXPECT_EQ(sat, s.check());
+
+  // both solvers are done before their assertions change
+  s.add(x == literal<Int>(3));
+  EXPECT_EQ(2, z3_solver_a.assertions().size());
+  EXPECT_EQ(2, z3_solver_b.assertions().size());
+  EXPECT_EQ(sat, s.check());
+
+  const PortfolioSolver::PortfolioStats& stats = s.portfolio_stats();
+  EXPECT_EQ(2, stats.wins.size());
+  EXPECT_EQ(4, stats.wins[0] + stats.wins[1]);
+  EXPECT_EQ(0, stats.unknowns);
+}
+
+TEST(SmtPortfolioTest, Assumptions)
+{
+  const Bool a = any<Bool>("a");
+  const Bool b = any<Bool>("b");
+
+  Z3Solver z3_solver_a;
+  Z3Solver z3_solver_b;
+  PortfolioSolver s({&z3_solver_a, &z3_solver_b});
+
+  s.add(a || b);
+
+  Bools assumptions(2);
+  assumptions.push_back(!a);
+
+  Bools unsat_core(2);
+  EXPECT_EQ(sat, s.check_assumptions(assumptions, unsat_core).first);
+
+  assumptions.push_back(!b);
+  EXPECT_EQ(unsat, s.check_assumptions(assumptions, unsat_core).first);
+}
+
+TEST(SmtPortfolioTest, Interrupt)
+{
+  typedef Bv<uint64_t> T;
+
+  const T x = any<T>("x");
+  const T y = any<T>("y");
+  const T one = literal<T>(1);
+  const T max = literal<T>(UINT64_C(0xffffffff));
+
+  Z3Solver z3_solver_a;
+  Z3Solver z3_solver_b;
+  PortfolioSolver s({&z3_solver_a, &z3_solver_b});
+
+  // factor the product of two 31-bit primes by bit-blasting
+  s.add(x * y == literal<T>(UINT64_C(2147483647) * UINT64_C(2147483629)));
+  s.add(one < x && x < max);
+  s.add(one < y && y < max);
+
+  std::thread thread([&s]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    s.interrupt();
+  });
+
+  EXPECT_EQ(unknown, s.check());
+  thread.join();
+
+  EXPECT_EQ(1, s.portfolio_stats().unknowns);
+  EXPECT_EQ(1, z3_solver_a.stats().unknown_checks);
+  EXPECT_EQ(1, z3_solver_b.stats().unknown_checks);
+}
+
+TEST(SmtPortfolioTest, InterruptLoser)
+{
+  typedef Bv<uint64_t> T;
+
+  const T x = any<T>("x");
+  const T y = any<T>("y");
+  const T one = literal<T>(1);
+  const T max = literal<T>(UINT64_C(0xffffffff));
+
+  Z3Solver z3_solver_a;
+  Z3Solver z3_solver_b;
+
+  // only the loser has to factor the product of two 31-bit primes
+  z3_solver_b.add(x * y == literal<T>(UINT64_C(2147483647) * UINT64_C(2147483629)));
+  z3_solver_b.add(one < x && x < max);
+  z3_solver_b.add(one < y && y < max);
+
+  PortfolioSolver s({&z3_solver_a, &z3_solver_b});
+  s.add(x == x);
+
+  // the winner's interrupt may arrive before the loser's check starts
+  for (unsigned i = 0; i < 16; ++i)
+  {
+    EXPECT_EQ(sat, s.check());
+
+    // waits for the loser
+    s.push();
+    s.pop();
+  }
+
+  EXPECT_EQ(16, s.portfolio_stats().wins[0]);
+  EXPECT_EQ(0, z3_solver_b.stats().sat_checks);
+}
+
+#endif
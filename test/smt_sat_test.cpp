@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+
+#include "smt_sat.h"
+
+#include <algorithm>
+
+using namespace smt;
+
+typedef SatSolver::Lit Lit;
+
+static Lit pos(const SatSolver::Var var)
+{
+  return SatSolver::lit(var);
+}
+
+static Lit neg(const SatSolver::Var var)
+{
+  return SatSolver::lit(var, true);
+}
+
+TEST(SmtSatTest, Trivial)
+{
+  SatSolver s;
+  EXPECT_EQ(sat, s.solve());
+
+  const SatSolver::Var x = s.new_var();
+  const SatSolver::Var y = s.new_var();
+
+  EXPECT_TRUE(s.add_clause(pos(x), pos(y)));
+  EXPECT_TRUE(s.add_clause(neg(x)));
+  EXPECT_EQ(sat, s.solve());
+  EXPECT_FALSE(s.model_value(x));
+  EXPECT_TRUE(s.model_value(y));
+
+  EXPECT_FALSE(s.add_clause(neg(y)));
+  EXPECT_EQ(unsat, s.solve());
+  EXPECT_TRUE(s.conflict().empty());
+}
+
+// n + 1 pigeons do not fit into n holes
+static void add_pigeonhole(SatSolver& s, const unsigned n)
+{
+  std::vector<std::vector<SatSolver::Var>> p(n + 1);
+  for (unsigned i = 0; i <= n; ++i)
+    for (unsigned j = 0; j < n; ++j)
+      p[i].push_back(s.new_var());
+
+  for (unsigned i = 0; i <= n; ++i)
+  {
+    std::vector<Lit> clause;
+    for (unsigned j = 0; j < n; ++j)
+      clause.push_back(pos(p[i][j]));
+
+    s.add_clause(clause);
+  }
+
+  for (unsigned j = 0; j < n; ++j)
+    for (unsigned i = 0; i <= n; ++i)
+      for (unsigned k = i + 1; k <= n; ++k)
+        s.add_clause(neg(p[i][j]), neg(p[k][j]));
+}
+
+TEST(SmtSatTest, Pigeonhole)
+{
+  SatSolver s;
+  add_pigeonhole(s, 7);
+
+  EXPECT_EQ(unsat, s.solve());
+  EXPECT_LT(0, s.stats().conflicts);
+  EXPECT_LT(0, s.stats().restarts);
+}
+
+TEST(SmtSatTest, Assumptions)
+{
+  SatSolver s;
+
+  const SatSolver::Var a = s.new_var();
+  const SatSolver::Var b = s.new_var();
+  const SatSolver::Var c = s.new_var();
+  const SatSolver::Var d = s.new_var();
+
+  // a -> b, b -> c
+  s.add_clause(neg(a), pos(b));
+  s.add_clause(neg(b), pos(c));
+
+  EXPECT_EQ(sat, s.solve({pos(a), pos(d)}));
+  EXPECT_TRUE(s.model_value(c));
+
+  EXPECT_EQ(unsat, s.solve({pos(d), pos(a), neg(c)}));
+
+  // d is not needed for the contradiction
+  std::vector<Lit> conflict(s.conflict());
+  std::sort(conflict.begin(), conflict.end());
+  EXPECT_EQ((std::vector<Lit>{pos(a), neg(c)}), conflict);
+
+  // assumptions are not kept
+  EXPECT_EQ(sat, s.solve({neg(c)}));
+  EXPECT_FALSE(s.model_value(a));
+
+  // contradictory assumptions
+  EXPECT_EQ(unsat, s.solve({pos(d), neg(d)}));
+  conflict = s.conflict();
+  std::sort(conflict.begin(), conflict.end());
+  EXPECT_EQ((std::vector<Lit>{pos(d), neg(d)}), conflict);
+
+  // incremental
+  s.add_clause(pos(a));
+  EXPECT_EQ(unsat, s.solve({neg(c)}));
+  EXPECT_EQ(std::vector<Lit>{neg(c)}, s.conflict());
+  EXPECT_EQ(sat, s.solve());
+}
+
+static bool always_terminate(void*)
+{
+  return true;
+}
+
+TEST(SmtSatTest, Termination)
+{
+  SatSolver s;
+  add_pigeonhole(s, 6);
+
+  s.set_termination_test(always_terminate, nullptr);
+  EXPECT_EQ(unknown, s.solve());
+
+  // the clauses are kept
+  s.set_termination_test(nullptr, nullptr);
+  EXPECT_EQ(unsat, s.solve());
+}
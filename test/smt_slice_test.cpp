@@ -0,0 +1,169 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_cache.h"
+#include "smt_slice.h"
+
+using namespace smt;
+
+TEST(SmtSliceTest, Independent)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+  const Int z = any<Int>("z");
+
+  Z3Solver z3_solver;
+  SlicingSolver s(z3_solver);
+
+  s.add(x < literal<Int>(3));
+  s.add(y < z);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(2, s.slice_stats().solved_slices);
+  EXPECT_EQ(2, z3_solver.stats().sat_checks);
+
+  // only the slice of the new assertion is solved
+  s.add(literal<Int>(0) < x);
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(3, s.slice_stats().solved_slices);
+  EXPECT_EQ(1, s.slice_stats().reused_slices);
+  EXPECT_EQ(2, z3_solver.assertions().size());
+
+  // the new assertion connects the slices of x and y < z
+  s.add(x == y + literal<Int>(7));
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(4, s.slice_stats().solved_slices);
+  EXPECT_EQ(4, z3_solver.assertions().size());
+
+  s.add(z < y);
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(4, s.slice_stats().checks);
+}
+
+TEST(SmtSliceTest, Stats)
+{
+  Z3Solver z3_solver;
+  SlicingSolver s(z3_solver);
+
+  // ten independent assertions and one that depends on the first
+  for (int i = 0; i < 10; ++i)
+    s.add(any<Int>("x" + std::to_string(i)) < literal<Int>(i));
+
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(10, s.slice_stats().solved_slices);
+
+  s.add(literal<Int>(-5) < any<Int>("x0"));
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(11, s.slice_stats().solved_slices);
+  EXPECT_EQ(9, s.slice_stats().reused_slices);
+
+  EXPECT_EQ(10.5, s.slice_stats().average_query_size());
+  EXPECT_EQ(12.0 / 11.0, s.slice_stats().average_slice_size());
+}
+
+TEST(SmtSliceTest, Functions)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+  const Decl<Func<Int, Int>> f("f");
+
+  Z3Solver z3_solver;
+  SlicingSolver s(z3_solver);
+
+  // uninterpreted functions are shared like constants
+  s.add(apply(f, x) == literal<Int>(1));
+  s.add(apply(f, y) == literal<Int>(2));
+  s.add(x == y);
+  EXPECT_EQ(unsat, s.check());
+  EXPECT_EQ(1, s.slice_stats().solved_slices);
+
+  // literals do not connect assertions
+  s.reset();
+  s.add(x == literal<Int>(1));
+  s.add(y == literal<Int>(1));
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(3, s.slice_stats().solved_slices);
+}
+
+TEST(SmtSliceTest, PushPop)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+
+  Z3Solver z3_solver;
+  SlicingSolver s(z3_solver);
+
+  s.add(x < literal<Int>(3));
+  s.add(y < literal<Int>(3));
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  s.add(literal<Int>(5) < x);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  // the slice of y was not needed for unsat but is still remembered
+  EXPECT_EQ(sat, s.check());
+  EXPECT_EQ(4, s.slice_stats().solved_slices);
+  EXPECT_EQ(1, s.slice_stats().reused_slices);
+
+  // the constants of the popped assertion are collected anew
+  s.push();
+  s.add(literal<Int>(5) < y);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.reset();
+  s.add(literal<Int>(5) < y);
+  EXPECT_EQ(sat, s.check());
+}
+
+TEST(SmtSliceTest, Caching)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+
+  Z3Solver z3_solver;
+  CachingSolver caching_solver(z3_solver);
+  SlicingSolver s(caching_solver);
+
+  s.add(x < literal<Int>(3));
+  EXPECT_EQ(sat, s.check());
+
+  s.reset();
+  s.add(y < literal<Int>(3));
+  EXPECT_EQ(sat, s.check());
+
+  // a slice from an unrelated earlier query is found in the cache
+  s.reset();
+  s.add(y < literal<Int>(3));
+  s.add(x < literal<Int>(3));
+  EXPECT_EQ(sat, s.check());
+
+  EXPECT_EQ(1, s.slice_stats().reused_slices);
+  EXPECT_EQ(1, caching_solver.cache_stats().hits);
+  EXPECT_EQ(2, z3_solver.stats().sat_checks);
+}
+
+TEST(SmtSliceTest, Assumptions)
+{
+  const Bool a = any<Bool>("a");
+  const Bool b = any<Bool>("b");
+
+  Z3Solver z3_solver;
+  SlicingSolver s(z3_solver);
+
+  s.add(a || b);
+
+  Bools assumptions(2);
+  assumptions.push_back(!a);
+  assumptions.push_back(!b);
+
+  Bools unsat_core(2);
+  std::pair<CheckResult, Bools::SizeType> result =
+    s.check_assumptions(assumptions, unsat_core);
+
+  // unsat cores are computed by the decorated solver
+  EXPECT_EQ(unsat, result.first);
+  EXPECT_EQ(0, s.slice_stats().checks);
+}
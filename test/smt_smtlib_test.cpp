@@ -0,0 +1,219 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_smtlib.h"
+
+#include <sstream>
+#include <algorithm>
+
+using namespace smt;
+
+TEST(SmtLibWriterTest, Let)
+{
+  const Bv<int> x = any<Bv<int>>("x");
+  const Bv<int> y = x + x;
+  const Bool b = (y * y) < literal<Bv<int>>(-1);
+
+  std::stringstream out;
+  {
+    SmtLibWriter writer(out);
+    EXPECT_EQ(OK, writer.write_term(b));
+  }
+
+  EXPECT_EQ("(let (($l1 (bvadd x x))) "
+    "(bvslt (bvmul $l1 $l1) (_ bv4294967295 32)))", out.str());
+}
+
+TEST(SmtLibWriterTest, Assertions)
+{
+  const Decl<Func<Int, Int>> f_decl("f");
+  const Int i = any<Int>("i");
+  const Int j = apply(f_decl, i + literal<Int>(-3L));
+  const Bv<unsigned char> c = any<Bv<unsigned char>>("c 0");
+
+  Bools conditions(3);
+  conditions.push_back(j < literal<Int>(7L));
+  conditions.push_back(j != i && !(c == literal<Bv<unsigned char>>(9)));
+  conditions.push_back(c < literal<Bv<unsigned char>>(4));
+
+  std::stringstream out;
+  SmtLibWriter writer(out);
+  writer.write_logic(QF_UFLIA_LOGIC);
+  EXPECT_EQ(OK, writer.write_assertions(conditions));
+
+  // only new symbols are declared
+  EXPECT_EQ(OK, writer.write_assertions({i == literal<Int>(2L)}));
+  writer.write_check_sat();
+  EXPECT_EQ(OK, writer.flush());
+
+  EXPECT_EQ(
+    "(set-logic QF_UFLIA)\n"
+    "(declare-fun i () Int)\n"
+    "(declare-fun f (Int) Int)\n"
+    "(declare-fun |c 0| () (_ BitVec 8))\n"
+    "(define-fun $e0 () Int (f (+ i (- 3))))\n"
+    "(assert (< $e0 7))\n"
+    "(assert (and (distinct $e0 i) (not (= |c 0| (_ bv9 8)))))\n"
+    "(assert (bvult |c 0| (_ bv4 8)))\n"
+    "(assert (= i 2))\n"
+    "(check-sat)\n", out.str());
+}
+
+TEST(SmtLibWriterTest, DeepDag)
+{
+  // the tree of this DAG would have 2^depth leaves
+  constexpr size_t depth = 100000;
+
+  Bv<unsigned> x = any<Bv<unsigned>>("x");
+  for (size_t k = 0; k < depth; ++k)
+    x = x + x;
+
+  std::stringstream out;
+  SmtLibWriter writer(out);
+  EXPECT_EQ(OK, writer.write_assertions({x == literal<Bv<unsigned>>(0U)}));
+
+  // one declaration, a definition of every shared addition and assert
+  const std::string script(out.str());
+  EXPECT_EQ(depth + 1, std::count(script.cbegin(), script.cend(), '\n'));
+  EXPECT_GT(64 * depth, script.size());
+}
+
+TEST(SmtLibParserTest, RoundTrip)
+{
+  const Decl<Func<Int, Int>> f_decl("f");
+  const Int i = any<Int>("i");
+  const Int j = apply(f_decl, i + literal<Int>(-3L));
+  const Bv<unsigned char> c = any<Bv<unsigned char>>("c 0");
+  const Array<Int, Bv<unsigned char>> a =
+    any<Array<Int, Bv<unsigned char>>>("a");
+
+  Terms<Int> terms(3);
+  terms.push_back(i);
+  terms.push_back(j);
+  terms.push_back(-j);
+
+  Bools conditions(4);
+  conditions.push_back(j < literal<Int>(7L));
+  conditions.push_back(implies(j != i, !(c == literal<Bv<unsigned char>>(9))));
+  conditions.push_back(select(store(a, j, c), i) <=
+    (c & ~literal<Bv<unsigned char>>(4)));
+  conditions.push_back(distinct(std::move(terms)));
+
+  std::stringstream out;
+  {
+    SmtLibWriter writer(out);
+    EXPECT_EQ(OK, writer.write_assertions(conditions));
+  }
+
+  SmtLibParser parser;
+  EXPECT_EQ(OK, parser.parse(out.str()));
+  EXPECT_EQ(4, parser.assertions().size());
+  EXPECT_EQ(std::vector<CheckResult>(), parser.check_results());
+
+  std::stringstream round_trip;
+  {
+    SmtLibWriter writer(round_trip);
+    EXPECT_EQ(OK, writer.write_assertions(parser.assertions()));
+  }
+
+  EXPECT_EQ(out.str(), round_trip.str());
+}
+
+TEST(SmtLibParserTest, Let)
+{
+  SmtLibParser parser;
+  EXPECT_EQ(OK, parser.parse("(declare-fun a () (_ BitVec 32))"));
+
+  // bindings are parallel, so y is bound to the outer x
+  SharedExpr term;
+  EXPECT_EQ(OK, parser.parse_term("(let ((x (bvadd a a))) "
+    "(let ((x (bvmul x x)) (y x)) (! (bvult x y) :named n)))", term));
+
+  std::stringstream out;
+  {
+    SmtLibWriter writer(out);
+    EXPECT_EQ(OK, writer.write_term(term));
+  }
+
+  EXPECT_EQ("(let (($l1 (bvadd a a))) (bvult (bvmul $l1 $l1) $l1))",
+    out.str());
+
+  // let bindings go out of scope
+  EXPECT_EQ(FORMAT_ERROR, parser.parse_term("(let ((x a)) x) x", term));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse_term("x", term));
+}
+
+TEST(SmtLibParserTest, DeepTerm)
+{
+  constexpr size_t depth = 100000;
+
+  std::string text;
+  for (size_t k = 0; k < depth; ++k)
+    text += "(not ";
+
+  text += "p";
+  text.append(depth, ')');
+
+  SmtLibParser parser;
+  EXPECT_EQ(OK, parser.parse("(declare-const p Bool)"));
+
+  SharedExpr term;
+  EXPECT_EQ(OK, parser.parse_term(text, term));
+  EXPECT_TRUE(term.sort().is_bool());
+}
+
+TEST(SmtLibParserTest, Errors)
+{
+  SmtLibParser parser;
+  EXPECT_EQ(OK, parser.parse(
+    "(declare-const x Int)\n"
+    "(declare-fun b () (_ BitVec 8))\n"));
+
+  // commands before the error take effect
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(assert (< x 1))\n(assert (< y 1))"));
+  EXPECT_EQ(2, parser.error_line());
+  EXPECT_EQ(1, parser.assertions().size());
+
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(assert (= x b))"));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(assert (< x 1)"));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(assert x)"));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(declare-const x Int)"));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(pop 1)"));
+  EXPECT_EQ(FORMAT_ERROR, parser.parse("(assert (= b (_ bv256 8)))"));
+
+  EXPECT_EQ(UNSUPPORT_ERROR, parser.parse("(assert (= x (ite true 1 2)))"));
+  EXPECT_EQ(UNSUPPORT_ERROR, parser.parse("(declare-sort U 0)"));
+  EXPECT_EQ(UNSUPPORT_ERROR, parser.parse("(define-fun g ((y Int)) Int y)"));
+  EXPECT_EQ(UNSUPPORT_ERROR, parser.parse("(assert (= x 1.5))"));
+
+  // failed commands have no effect
+  EXPECT_EQ(1, parser.assertions().size());
+}
+
+TEST(SmtLibParserTest, Z3Solver)
+{
+  Z3Solver solver;
+  SmtLibParser parser(&solver);
+
+  EXPECT_EQ(OK, parser.parse(
+    "(set-logic QF_BV)\n"
+    "(set-info :source |signed and unsigned views|)\n"
+    "(declare-const x (_ BitVec 8))\n"
+    "(define-fun five () (_ BitVec 8) #x05)\n"
+    "(assert (bvult x five)) ; x < 5\n"
+    "(push 1)\n"
+    "(assert (bvsgt x (_ bv10 8)))\n"
+    "(check-sat)\n"
+    "(pop 1)\n"
+    "(assert (! (= (bvsdiv x #xff) #b11111110) :named two))\n"
+    "(check-sat)\n"
+    "(assert (= ((_ sign_extend 8) x) ((_ zero_extend 8) #x03)))\n"
+    "(check-sat)\n"
+    "(exit)\n"
+    "(check-sat)\n"));
+
+  EXPECT_EQ(std::vector<CheckResult>({unsat, sat, unsat}),
+    parser.check_results());
+  EXPECT_EQ(3, parser.assertions().size());
+}
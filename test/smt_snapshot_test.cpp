@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+
+#include "smt.h"
+#include "smt_z3.h"
+#include "smt_snapshot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+using namespace smt;
+
+static constexpr char x_prefix[] = "snapshot_x!";
+static constexpr char a_prefix[] = "snapshot_a!";
+
+TEST(SmtSnapshotTest, Empty)
+{
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build(SharedExprs()));
+  EXPECT_EQ(0, snapshot.nodes_size());
+  EXPECT_EQ(0, snapshot.roots_size());
+  EXPECT_EQ(0, snapshot.size() % 8);
+
+  SharedExprs roots;
+  EXPECT_EQ(OK, snapshot.load(roots));
+  EXPECT_TRUE(roots.empty());
+}
+
+TEST(SmtSnapshotTest, SharedSubexpressions)
+{
+  const Bv<int> x = any<Bv<int>>(x_prefix, 1);
+  const Bv<int> y = x + x;
+  const Bool b = (y * y) < literal<Bv<int>>(7);
+
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build({b, y}));
+
+  // x, x + x, (x + x) * (x + x), 7 and <
+  EXPECT_EQ(5, snapshot.nodes_size());
+  EXPECT_EQ(2, snapshot.roots_size());
+
+  SharedExprs roots;
+  EXPECT_EQ(OK, snapshot.load(roots, {x_prefix}));
+  ASSERT_EQ(2, roots.size());
+  EXPECT_TRUE(roots[0].sort().is_bool());
+  EXPECT_TRUE(roots[1].sort().is_bv());
+#ifdef ENABLE_HASH_CONS
+  EXPECT_EQ(b.addr(), roots[0].addr());
+  EXPECT_EQ(y.addr(), roots[1].addr());
+#endif
+}
+
+#ifdef ENABLE_HASH_CONS
+TEST(SmtSnapshotTest, AllExprKinds)
+{
+  const Decl<Func<Int, Bv<short>, Bool>> f_decl("snapshot_f");
+  const Int i = any<Int>(x_prefix, 2);
+  const Bv<short> s = any<Bv<short>>(x_prefix, 3);
+  const Array<Int, Bv<long>> a = any<Array<Int, Bv<long>>>(a_prefix, 1);
+
+  const Bv<long> e = select(store(a, i + literal<Int>(1L),
+    bv_cast<long>(s)), -i);
+  const Bv<char> t = bv_cast<char>(e);
+  const Bv<unsigned long long> z = bv_cast<unsigned long long>(
+    literal<Bv<unsigned>>(4294967295U));
+
+  Bools bools(4);
+  bools.push_back(apply(f_decl, i, s));
+  bools.push_back(!(t == literal<Bv<char>>('c')));
+  bools.push_back(z != literal<Bv<unsigned long long>>(0ULL));
+  bools.push_back(implies(literal<Bool>(true), i <= literal<Int>(-5L)));
+
+  const Bool c = conjunction(bools);
+  Terms<Int> ints(3);
+  ints.push_back(i);
+  ints.push_back(i * i);
+  ints.push_back(literal<Int>(0L));
+
+  const Bool d = distinct(std::move(ints));
+  const SharedExprs exprs = {c, d, e, t};
+
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build(exprs));
+
+  SharedExprs roots;
+  EXPECT_EQ(OK, snapshot.load(roots, {x_prefix, a_prefix}));
+  ASSERT_EQ(exprs.size(), roots.size());
+  for (size_t k = 0; k < exprs.size(); ++k)
+    EXPECT_EQ(exprs[k].addr(), roots[k].addr());
+
+  // other prefixes with the same contents are interned separately
+  roots.clear();
+  EXPECT_EQ(OK, snapshot.load(roots));
+  ASSERT_EQ(exprs.size(), roots.size());
+  EXPECT_NE(exprs[0].addr(), roots[0].addr());
+
+  SharedExprs reloaded;
+  EXPECT_EQ(OK, snapshot.load(reloaded));
+  ASSERT_EQ(roots.size(), reloaded.size());
+  for (size_t k = 0; k < roots.size(); ++k)
+    EXPECT_EQ(roots[k].addr(), reloaded[k].addr());
+}
+#endif
+
+TEST(SmtSnapshotTest, WriteAndMap)
+{
+  const Bv<int> x = any<Bv<int>>(x_prefix, 4);
+  const Bool b = x + literal<Bv<int>>(3) == literal<Bv<int>>(5);
+
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build({b}));
+
+  char path[] = "/tmp/smt_snapshot_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_LE(0, fd);
+  close(fd);
+
+  EXPECT_EQ(OK, snapshot.write(path));
+
+  Snapshot mapped;
+  EXPECT_EQ(OK, mapped.map(path));
+  EXPECT_EQ(snapshot.size(), mapped.size());
+  EXPECT_EQ(0, std::memcmp(snapshot.data(), mapped.data(), snapshot.size()));
+
+  // the mapping is owned by the moved-to snapshot
+  Snapshot moved(std::move(mapped));
+  EXPECT_EQ(nullptr, mapped.data());
+  EXPECT_EQ(0, mapped.nodes_size());
+  EXPECT_EQ(snapshot.nodes_size(), moved.nodes_size());
+
+  SharedExprs roots;
+  EXPECT_EQ(OK, moved.load(roots, {x_prefix}));
+  ASSERT_EQ(1, roots.size());
+#ifdef ENABLE_HASH_CONS
+  EXPECT_EQ(b.addr(), roots[0].addr());
+#endif
+
+  std::remove(path);
+  EXPECT_EQ(IO_ERROR, mapped.map(path));
+}
+
+TEST(SmtSnapshotTest, Corrupt)
+{
+  const Bv<int> x = any<Bv<int>>(x_prefix, 5);
+  const Bool b = -x < x;
+
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build({b}));
+
+  std::vector<uint64_t> buffer(snapshot.size() / 8);
+  std::memcpy(buffer.data(), snapshot.data(), snapshot.size());
+
+  Snapshot view;
+  EXPECT_EQ(OK, view.view(buffer.data(), snapshot.size()));
+  EXPECT_EQ(FORMAT_ERROR, view.view(buffer.data(), snapshot.size() - 8));
+  EXPECT_EQ(FORMAT_ERROR, view.view(buffer.data(), 4));
+
+  internal::SnapshotHeader* const header =
+    reinterpret_cast<internal::SnapshotHeader*>(buffer.data());
+
+  header->version++;
+  EXPECT_EQ(FORMAT_ERROR, view.view(buffer.data(), snapshot.size()));
+  header->version--;
+
+  // root refers to a node that does not exist
+  uint32_t* const roots = reinterpret_cast<uint32_t*>(
+    reinterpret_cast<char*>(buffer.data()) + snapshot.size() -
+      ((header->strings_size + 7) & ~7U) - 8);
+  EXPECT_EQ(snapshot.nodes_size() - 1, roots[0]);
+  roots[0] = snapshot.nodes_size();
+  EXPECT_EQ(FORMAT_ERROR, view.view(buffer.data(), snapshot.size()));
+
+  SharedExprs exprs;
+  EXPECT_EQ(FORMAT_ERROR, view.load(exprs));
+  EXPECT_TRUE(exprs.empty());
+}
+
+TEST(SmtSnapshotTest, Z3Solver)
+{
+  const Bv<int> x = any<Bv<int>>(x_prefix, 6);
+  const Bv<int> y = any<Bv<int>>(x_prefix, 7);
+
+  Snapshot snapshot;
+  EXPECT_EQ(OK, snapshot.build({x < y, y < literal<Bv<int>>(3)}));
+
+  Z3Solver s;
+  EXPECT_EQ(OK, snapshot.add(s, {x_prefix}));
+  EXPECT_EQ(2, s.assertions().size());
+  EXPECT_EQ(sat, s.check());
+
+  s.add(literal<Bv<int>>(1) < x);
+  EXPECT_EQ(unsat, s.check());
+
+  Snapshot terms;
+  EXPECT_EQ(OK, terms.build({x}));
+  EXPECT_EQ(UNSUPPORT_ERROR, terms.add(s));
+}
@@ -1179,3 +1179,127 @@ TEST(SmtStpTest, LogicalShifts)
   }
   s.pop();
 }
+
+TEST(SmtStpTest, CheckAssumptions)
+{
+  StpSolver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  // ignore
+  Bools unsat_core;
+  unsat_core.resize(0);
+
+  Bv<int> x = any<Bv<int>>("x");
+  Bool a = x < 7;
+  Bool b = !a;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+
+    assumptions.pop_back();
+    assumptions.push_back(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+
+  s.reset();
+
+  {
+    Bools assumptions;
+    assumptions.push_back(b);
+
+    s.add(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+
+    assumptions.pop_back();
+    assumptions.push_back(a);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+}
+
+TEST(SmtStpTest, UnsatCore)
+{
+  StpSolver s;
+  std::pair<CheckResult, Bools::SizeType> r;
+
+  Bool a = any<Bool>("a");
+  Bool b = any<Bool>("b");
+  Bool c = any<Bool>("c");
+  Bool not_b = not b;
+  Bool d = any<Bool>("d");
+
+  Bools unsat_core;
+
+  {
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(b);
+    assumptions.push_back(not_b);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(2, r.second);
+
+    EXPECT_EQ(not_b.addr(), unsat_core.at(unsat_core.size() - 1).addr());
+    EXPECT_EQ(b.addr(), unsat_core.at(unsat_core.size() - 2).addr());
+
+    // singleton
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // assertion will contradict assumption
+    s.add(b);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not_b);
+    assumptions.push_back(c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(7);
+    r = s.check_assumptions(assumptions, unsat_core);
+
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+    EXPECT_EQ(not_b.addr(), unsat_core.back().addr());
+  }
+
+  s.reset();
+
+  {
+    // inside a push/pop scope
+    s.push();
+    s.add(c);
+
+    Bools assumptions;
+    assumptions.push_back(a);
+    assumptions.push_back(not c);
+    assumptions.push_back(d);
+
+    unsat_core.resize(1);
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(unsat, r.first);
+    EXPECT_EQ(1, r.second);
+
+    s.pop();
+    r = s.check_assumptions(assumptions, unsat_core);
+    EXPECT_EQ(sat, r.first);
+  }
+}
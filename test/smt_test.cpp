@@ -3,6 +3,9 @@
 #include "smt.h"
 
 #include <thread>
+#include <sstream>
+#include <condition_variable>
+#include <mutex>
 
 using namespace smt;
 
@@ -227,6 +230,44 @@ TEST(SmtTest, Decl)
   EXPECT_FALSE(d2.sort().sorts(1).is_func());
 }
 
+TEST(SmtTest, Symbols)
+{
+  static constexpr char x_prefix[] = "x!";
+  static constexpr char y_prefix[] = "y!";
+
+  internal::Symbols symbols;
+
+  const internal::Symbols::Id x7 = symbols.intern(x_prefix, 7);
+  const internal::Symbols::Id y7 = symbols.intern(y_prefix, 7);
+  const internal::Symbols::Id x8 = symbols.intern(x_prefix, 8);
+
+  EXPECT_EQ(3U, symbols.size());
+
+  EXPECT_EQ(x7, symbols.intern(x_prefix, 7));
+  EXPECT_NE(x7, y7);
+  EXPECT_NE(x7, x8);
+  EXPECT_NE(y7, x8);
+  EXPECT_EQ(3U, symbols.size());
+
+  EXPECT_EQ("x!7", symbols.name(x7));
+  EXPECT_EQ("y!7", symbols.name(y7));
+  EXPECT_EQ("x!8", symbols.name(x8));
+
+  // the global table is shared by all solvers
+  const internal::Symbols::Id global_x7 =
+    internal::Symbols::global_intern(x_prefix, 7);
+  EXPECT_EQ(global_x7, internal::Symbols::global_intern(x_prefix, 7));
+  EXPECT_NE(global_x7, internal::Symbols::global_intern(y_prefix, 7));
+  EXPECT_EQ("x!7", internal::Symbols::global_name(global_x7));
+
+  // copies do not need the string
+  const Decl<Int> d2(y_prefix, 7);
+  const Decl<Int> d4(d2);
+  EXPECT_EQ(d2, d4);
+  EXPECT_EQ("y!7", d2.symbol());
+  EXPECT_EQ("y!7", d4.symbol());
+}
+
 TEST(SmtTest, FuncDecl)
 {
   const Decl<Func<Bv<long>, Int>> d0("f");
@@ -1054,6 +1095,11 @@ TEST(SmtTest, Identity)
   const LiteralExpr<bool>& ttexpr =
     static_cast<const LiteralExpr<bool>&>(ttexpr_term.ref());
   EXPECT_TRUE(ttexpr.literal());
+
+  const Bool ffexpr_term = Identity<LOR, Bool>::term;
+  const LiteralExpr<bool>& ffexpr =
+    static_cast<const LiteralExpr<bool>&>(ffexpr_term.ref());
+  EXPECT_FALSE(ffexpr.literal());
 }
 
 TEST(SmtTest, Signedness)
@@ -1567,3 +1613,401 @@ TEST(SmtTest, SortHash)
 
  EXPECT_EQ(47, k);
 }
+
+#ifdef ENABLE_EXPR_POOL
+TEST(SmtTest, ExprPool)
+{
+  typedef internal::ExprPool ExprPool;
+
+  const size_t block_size = sizeof(BinaryExpr<ADD>);
+  const ExprPool::Stats before = ExprPool::stats(block_size);
+
+  smt::Int x = any<smt::Int>("x");
+  smt::Int y = any<smt::Int>("y");
+  uintptr_t addr;
+  {
+    smt::Int z = x + y;
+    addr = z.addr();
+
+    const ExprPool::Stats stats = ExprPool::stats(block_size);
+    EXPECT_EQ(before.live_blocks + 1, stats.live_blocks);
+    EXPECT_EQ(before.allocations + 1, stats.allocations);
+    EXPECT_LE(1, stats.chunks);
+    EXPECT_LT(0.0, stats.occupancy());
+    EXPECT_LE(stats.occupancy(), 1.0);
+  }
+
+  EXPECT_EQ(before.live_blocks, ExprPool::stats(block_size).live_blocks);
+
+  // most recently freed block is reused first
+  smt::Int z = x - y;
+  EXPECT_EQ(addr, z.addr());
+
+  const ExprPool::Stats total = ExprPool::stats();
+  EXPECT_LE(ExprPool::stats(block_size).chunks, total.chunks);
+  EXPECT_LE(total.live_bytes, total.reserved_bytes);
+}
+#endif
+
+#ifdef ENABLE_HASH_CONS
+TEST(SmtTest, ExprStore)
+{
+  typedef internal::ExprStore<BinaryExpr<ADD>> ExprStore;
+  const ExprStore& expr_store = ExprStore::instance();
+
+  constexpr unsigned N = 1000;
+  const size_t size = expr_store.size();
+
+  smt::Int x = any<smt::Int>("x");
+  std::vector<smt::Int> terms;
+  for (unsigned i = 0; i < N; i++)
+    terms.push_back(x + literal<smt::Int>(i));
+
+  ExprStore::Stats stats = expr_store.stats();
+  EXPECT_EQ(size + N, stats.size);
+  EXPECT_LE(stats.size, stats.capacity);
+  EXPECT_LE(stats.load_factor(), 0.75);
+
+  // the capacity of each shard is a power of two, but not their sum
+  if (ExprStore::s_shards == 1)
+  {
+    EXPECT_EQ(0, stats.capacity & (stats.capacity - 1));
+  }
+  EXPECT_LE(stats.max_displacement, stats.size);
+
+  const uint64_t hits = stats.hits;
+  for (unsigned i = 0; i < N; i++)
+    EXPECT_EQ(terms[i].addr(), (x + literal<smt::Int>(i)).addr());
+
+  stats = expr_store.stats();
+  EXPECT_EQ(hits + N, stats.hits);
+  EXPECT_EQ(size + N, stats.size);
+  EXPECT_LE(stats.hits, stats.lookups);
+  EXPECT_LE(stats.lookups, stats.probes);
+
+  // delete every other expression while the rest remain reachable
+  const size_t capacity = stats.capacity;
+  for (unsigned i = 0; i < N; i += 2)
+    terms[i] = smt::Int();
+
+  stats = expr_store.stats();
+  EXPECT_EQ(size + N / 2, stats.size);
+  EXPECT_EQ(capacity, stats.capacity);
+
+  for (unsigned i = 1; i < N; i += 2)
+    EXPECT_EQ(terms[i].addr(), (x + literal<smt::Int>(i)).addr());
+
+  terms.clear();
+  EXPECT_EQ(size, expr_store.size());
+}
+#endif
+
+#ifdef ENABLE_CONCURRENCY
+TEST(SmtTest, ConcurrentExprSharing)
+{
+  constexpr unsigned threads_size = 4;
+  constexpr unsigned N = 2000;
+
+  smt::Int x = any<smt::Int>("x");
+  const unsigned counter = Expr::s_counter;
+
+  std::vector<std::vector<uintptr_t>> addrs(threads_size);
+  std::atomic<unsigned> done(0);
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < threads_size; t++)
+  {
+    threads.emplace_back([&x, &addrs, &done, t]()
+    {
+      std::vector<smt::Int> terms;
+      for (unsigned k = 0; k < 8; k++)
+      {
+        // alternately create and delete shared expressions
+        terms.clear();
+        for (unsigned i = 0; i < N; i++)
+          terms.push_back(x + literal<smt::Int>(i) * x);
+      }
+
+      for (const smt::Int& term : terms)
+        addrs[t].push_back(term.addr());
+
+      // keep terms alive until all threads are done
+      ++done;
+      while (done < threads_size)
+        std::this_thread::yield();
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (unsigned t = 1; t < threads_size; t++)
+    EXPECT_EQ(addrs[0], addrs[t]);
+
+  EXPECT_EQ(counter, Expr::s_counter);
+}
+#endif
+
+TEST(SmtTest, ExprSideTable)
+{
+  internal::ExprSideTable<int> side_table;
+
+  smt::Int x = any<smt::Int>("x");
+  smt::Int y = any<smt::Int>("y");
+
+  internal::ExprId id;
+  {
+    smt::Int z = x + y;
+    id = z.ref().id();
+
+    EXPECT_EQ(nullptr, side_table.find(&z.ref()));
+    EXPECT_EQ(0, side_table.insert(&z.ref(), 7));
+    ASSERT_NE(nullptr, side_table.find(&z.ref()));
+    EXPECT_EQ(7, *side_table.find(&z.ref()));
+  }
+
+  // most recently freed index is reused first
+  smt::Int z = x - y;
+  EXPECT_EQ(id.index, z.ref().id().index);
+  EXPECT_NE(id.generation, z.ref().id().generation);
+
+  // stale entry of deleted expression is not found but replaced
+  EXPECT_EQ(nullptr, side_table.find(&z.ref()));
+  EXPECT_EQ(7, side_table.insert(&z.ref(), 8));
+  EXPECT_EQ(8, *side_table.find(&z.ref()));
+  EXPECT_EQ(2, side_table.size());
+
+  int sum = 0;
+  side_table.for_each([&sum](int value) { sum += value; });
+  EXPECT_EQ(8, sum);
+
+  {
+    smt::Int w = x * y;
+    EXPECT_EQ(0, side_table.insert(&w.ref(), 9));
+  }
+
+  // only the entry of the deleted expression is removed
+  sum = 0;
+  EXPECT_EQ(1, side_table.sweep([&sum](int value) { sum += value; }));
+  EXPECT_EQ(9, sum);
+  EXPECT_EQ(8, *side_table.find(&z.ref()));
+  EXPECT_EQ(0, side_table.sweep([](int) {}));
+
+  side_table.clear();
+  EXPECT_EQ(nullptr, side_table.find(&z.ref()));
+  EXPECT_EQ(0, side_table.size());
+}
+
+#ifdef ENABLE_HASH_CONS
+TEST(SmtTest, Simplifier)
+{
+  Simplifier simplifier;
+
+  const smt::Bool tt = literal<smt::Bool>(true);
+  const smt::Bool ff = literal<smt::Bool>(false);
+  const smt::Bool a = any<smt::Bool>("a");
+  const smt::Bool b = any<smt::Bool>("b");
+  const smt::Bool c = any<smt::Bool>("c");
+  const smt::Bv<uint8_t> u = any<smt::Bv<uint8_t>>("u");
+  const smt::Bv<int8_t> s = any<smt::Bv<int8_t>>("s");
+  const smt::Int x = any<smt::Int>("x");
+
+  // constant folding with wrap-around and signed comparisons
+  EXPECT_EQ(literal<smt::Bv<uint8_t>>(4ULL).addr(), simplifier.simplify(
+    smt::SharedExpr(literal<smt::Bv<uint8_t>>(250U) + 10U)).addr());
+  EXPECT_EQ(tt.addr(), simplifier.simplify(
+    literal<smt::Bv<int8_t>>(-1) < literal<smt::Bv<int8_t>>(1)).addr());
+  EXPECT_EQ(ff.addr(), simplifier.simplify(
+    literal<smt::Bv<uint8_t>>(255U) < literal<smt::Bv<uint8_t>>(1U)).addr());
+  EXPECT_EQ(3U, simplifier.stats().constant_folds);
+
+  // folded literals are folded further
+  EXPECT_EQ(tt.addr(), simplifier.simplify((literal<smt::Int>(2) *
+    literal<smt::Int>(3)) + literal<smt::Int>(1) == 7).addr());
+  EXPECT_EQ(6U, simplifier.stats().constant_folds);
+
+  // identity and absorbing elements
+  EXPECT_EQ(a.addr(), simplifier.simplify(tt && a).addr());
+  EXPECT_EQ(a.addr(), simplifier.simplify(a || ff).addr());
+  EXPECT_EQ(ff.addr(), simplifier.simplify(a && ff).addr());
+  EXPECT_EQ(tt.addr(), simplifier.simplify(tt || a).addr());
+  EXPECT_EQ(a.addr(), simplifier.simplify(implies(tt, a)).addr());
+  EXPECT_EQ(tt.addr(), simplifier.simplify(implies(ff, a)).addr());
+  EXPECT_EQ(u.addr(), simplifier.simplify(smt::SharedExpr(u + 0U)).addr());
+  EXPECT_EQ(s.addr(), simplifier.simplify(smt::SharedExpr(s * 1)).addr());
+  EXPECT_EQ(literal<smt::Int>(0).addr(),
+    simplifier.simplify(smt::SharedExpr(0 * x)).addr());
+  EXPECT_EQ(5U, simplifier.stats().identities);
+  EXPECT_EQ(4U, simplifier.stats().absorptions);
+
+  // nested conjunctions are flattened
+  Bools operands;
+  operands.push_back(a);
+  operands.push_back(b);
+  operands.push_back(c);
+  const smt::Bool flat(conjunction(operands));
+  const smt::Bool nested(a && (tt && (b && c)));
+  EXPECT_EQ(flat.addr(), simplifier.simplify(nested).addr());
+  EXPECT_EQ(1U, simplifier.stats().flattenings);
+
+  // rewrites of live expressions are memoized
+  EXPECT_EQ(flat.addr(), simplifier.simplify(nested).addr());
+  EXPECT_EQ(6U, simplifier.stats().identities);
+  EXPECT_EQ(1U, simplifier.stats().flattenings);
+
+  // double negations are removed
+  EXPECT_EQ(a.addr(), simplifier.simplify(!(!a)).addr());
+  EXPECT_EQ(u.addr(), simplifier.simplify(smt::SharedExpr(~(~u))).addr());
+  EXPECT_EQ(2U, simplifier.stats().double_negations);
+
+  // relations between syntactically equal terms
+  EXPECT_EQ(tt.addr(), simplifier.simplify(x == x).addr());
+  EXPECT_EQ(ff.addr(), simplifier.simplify(u < u).addr());
+  EXPECT_EQ(2U, simplifier.stats().trivial_relations);
+
+  // irreducible expressions are unchanged
+  const smt::Bool d = x < 7 && a;
+  EXPECT_EQ(d.addr(), simplifier.simplify(d).addr());
+
+  // division by zero, signed division and overflows are not folded
+  const smt::Bv<uint8_t> e = literal<smt::Bv<uint8_t>>(1U) /
+    literal<smt::Bv<uint8_t>>(0U);
+  EXPECT_EQ(e.addr(), simplifier.simplify(smt::SharedExpr(e)).addr());
+
+  const smt::Bv<int8_t> f = literal<smt::Bv<int8_t>>(-7) /
+    literal<smt::Bv<int8_t>>(2);
+  EXPECT_EQ(f.addr(), simplifier.simplify(smt::SharedExpr(f)).addr());
+
+  const smt::Int g = literal<smt::Int>(std::numeric_limits<long long>::max())
+    + literal<smt::Int>(1);
+  EXPECT_EQ(g.addr(), simplifier.simplify(smt::SharedExpr(g)).addr());
+}
+#endif
+
+TEST(SmtTest, Histogram)
+{
+  Histogram histogram;
+
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(0U, histogram.min());
+  EXPECT_EQ(0U, histogram.max());
+  EXPECT_EQ(0U, histogram.quantile(0.5));
+
+  for (uint64_t i = 1; i <= 1000; ++i)
+    histogram.record(i);
+
+  EXPECT_EQ(1000U, histogram.count());
+  EXPECT_EQ(500500U, histogram.sum());
+  EXPECT_EQ(1U, histogram.min());
+  EXPECT_EQ(1000U, histogram.max());
+
+  // small values are exact
+  EXPECT_EQ(1U, histogram.quantile(0.0));
+  EXPECT_EQ(5U, histogram.quantile(0.005));
+  EXPECT_EQ(1000U, histogram.quantile(1.0));
+
+  // within 12.5% above the exact value
+  const uint64_t p50 = histogram.quantile(0.5);
+  EXPECT_LE(500U, p50);
+  EXPECT_GE(563U, p50);
+
+  const uint64_t p99 = histogram.quantile(0.99);
+  EXPECT_LE(990U, p99);
+  EXPECT_GE(1000U, p99);
+
+  histogram.record(std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), histogram.quantile(1.0));
+
+  std::stringstream out;
+  histogram.write_json(out);
+  EXPECT_EQ(0U, out.str().find("{\"count\":1001,"));
+
+  histogram.clear();
+  EXPECT_EQ(0U, histogram.count());
+  EXPECT_EQ(0U, histogram.quantile(0.99));
+}
+
+namespace
+{
+  // check() blocks until release() and ignores interrupt()
+  class BlockingSolver : public internal::DecoratorSolver
+  {
+  private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_is_started;
+    bool m_is_released;
+
+    virtual void __reset() override {}
+    virtual void __push() override {}
+    virtual void __pop() override {}
+
+    virtual Error __add(const Bool& condition) override
+    {
+      return OK;
+    }
+
+    virtual Error __unsafe_add(const SharedExpr& condition) override
+    {
+      return OK;
+    }
+
+    virtual CheckResult __check() override
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_is_started = true;
+      m_cond.notify_all();
+      m_cond.wait(lock, [this]() { return m_is_released; });
+      return sat;
+    }
+
+    virtual std::pair<CheckResult, SharedExprs::size_type>
+    __check_assumptions(
+      const SharedExprs& assumptions,
+      SharedExprs& unsat_core) override
+    {
+      return {__check(), 0};
+    }
+
+  public:
+    BlockingSolver()
+    : m_mutex(),
+      m_cond(),
+      m_is_started(false),
+      m_is_released(false) {}
+
+    void wait_until_started()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return m_is_started; });
+    }
+
+    void release()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_is_released = true;
+      m_cond.notify_all();
+    }
+  };
+}
+
+TEST(SmtTest, CancelUninterruptible)
+{
+  CancellationToken token;
+  BlockingSolver s;
+  s.set_cancellation_token(&token);
+  s.add(any<Bool>("b"));
+  EXPECT_FALSE(s.is_interruptible());
+
+  std::thread thread([&s]() { EXPECT_EQ(sat, s.check()); });
+  s.wait_until_started();
+
+  // returns although the check is still running
+  token.cancel();
+  EXPECT_TRUE(token.is_cancelled());
+
+  s.release();
+  thread.join();
+
+  EXPECT_EQ(unknown, s.check());
+}
@@ -5,6 +5,9 @@
 
 #include <sstream>
 #include <cstdint>
+#include <thread>
+#include <chrono>
+#include <pthread.h>
 
 using namespace smt;
 
@@ -1755,3 +1758,394 @@ TEST(SmtZ3Test, LogicalShifts)
   }
   s.pop();
 }
+
+TEST(SmtZ3Test, CacheEvictionOnDelete)
+{
+  Z3Solver s;
+
+  const Decl<Bv<unsigned>> x_decl("x");
+  const Decl<Bv<unsigned>> y_decl("y");
+
+  {
+    const ConstantExpr e0(x_decl);
+    EXPECT_EQ(OK, e0.encode(s));
+    EXPECT_EQ("x", s.expr().decl().name().str());
+
+    // cache hit
+    EXPECT_EQ(OK, e0.encode(s));
+    EXPECT_EQ("x", s.expr().decl().name().str());
+  }
+
+  // likely allocated at the same address as e0
+  {
+    const ConstantExpr e1(y_decl);
+    EXPECT_EQ(OK, e1.encode(s));
+    EXPECT_EQ("y", s.expr().decl().name().str());
+  }
+}
+
+struct DeepChain
+{
+  Z3Solver solver;
+  Bool chain;
+  Error err;
+};
+
+// Only encoding runs on the thread with a small stack because the
+// deletion of expressions and Z3's own algorithms are recursive
+static void* encode_deep_chain(void* arg)
+{
+  DeepChain* deep_chain = static_cast<DeepChain*>(arg);
+  deep_chain->err = deep_chain->chain.ref().encode(deep_chain->solver);
+  return nullptr;
+}
+
+TEST(SmtZ3Test, DeepChainEncoding)
+{
+  // deep enough to overflow the stack with recursive encoding
+  constexpr unsigned N = 1U << 11;
+
+  DeepChain deep_chain;
+  deep_chain.err = UNSUPPORT_ERROR;
+
+  Bool b = any<Bool>("b");
+  deep_chain.chain = b;
+  for (unsigned i = 0; i < N; i++)
+    deep_chain.chain = (i % 2 == 0) ?
+      (deep_chain.chain || !b) : (deep_chain.chain && b);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 1U << 17);
+
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, &attr, encode_deep_chain, &deep_chain));
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attr);
+
+  EXPECT_EQ(OK, deep_chain.err);
+
+  // encoded expressions are cached
+  deep_chain.solver.add(deep_chain.chain);
+  deep_chain.solver.add(!b);
+  EXPECT_EQ(unsat, deep_chain.solver.check());
+}
+
+TEST(SmtZ3Test, EncodeStats)
+{
+  Z3Solver s;
+
+  const Bv<int> x = any<Bv<int>>("x");
+  const Bv<int> y = any<Bv<int>>("y");
+  const Bool b = any<Bool>("b");
+
+  Terms<Bool> operand_terms(2);
+  operand_terms.push_back(x < y);
+  operand_terms.push_back(!b);
+
+  const Bool c(conjunction(std::move(operand_terms)));
+
+  EXPECT_EQ(OK, static_cast<SharedExpr>(c).encode(s));
+  std::stringstream out;
+  out << s.expr();
+  EXPECT_EQ("(and (bvslt x y) (not b))", out.str());
+
+  // arguments are counted again when their parent looks them up
+  EXPECT_EQ(6U, s.stats().constants);
+  EXPECT_EQ(2U, s.stats().unary_ops);
+  EXPECT_EQ(2U, s.stats().binary_ops);
+  EXPECT_EQ(2U, s.stats().inequalities);
+  EXPECT_EQ(1U, s.stats().nary_ops);
+  EXPECT_EQ(2U, s.stats().conjunctions);
+
+  s.add(c);
+  s.add(y < x || b);
+  EXPECT_EQ(unsat, s.check());
+}
+
+TEST(SmtZ3Test, IntSymbols)
+{
+  static constexpr char x_prefix[] = "x!";
+  static constexpr char y_prefix[] = "y!";
+
+  Z3Solver s;
+
+  const Bv<int> x = any<Bv<int>>(x_prefix, 1);
+  const Bv<int> y = any<Bv<int>>(y_prefix, 1);
+
+  // same prefix and counter as x
+  const Decl<Bv<int>> decl(x_prefix, 1);
+  const Bv<int> z = constant(decl);
+
+  s.push();
+  {
+    s.add(x != y);
+    EXPECT_EQ(sat, s.check());
+  }
+  s.pop();
+
+  s.push();
+  {
+    s.add(x != z);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  // a name that looks like x is a different constant, see UnsafeDecl
+  const Bv<int> w = any<Bv<int>>("x!1");
+
+  s.push();
+  {
+    s.add(x != w);
+    EXPECT_EQ(sat, s.check());
+  }
+  s.pop();
+
+  // symbols are interned globally, so they are the same in every solver
+  Z3Solver t;
+  EXPECT_EQ(OK, y.ref().encode(t));
+  EXPECT_EQ(OK, y.ref().encode(s));
+  const z3::symbol t_symbol = t.expr().decl().name();
+  const z3::symbol s_symbol = s.expr().decl().name();
+  ASSERT_EQ(Z3_INT_SYMBOL, t_symbol.kind());
+  EXPECT_EQ(s_symbol.to_int(), t_symbol.to_int());
+}
+
+TEST(SmtZ3Test, CheckStats)
+{
+  Z3Solver s;
+
+  const Bv<int> x = any<Bv<int>>("x");
+  const Bv<int> y = any<Bv<int>>("y");
+
+  s.add(x < y);
+  EXPECT_EQ(sat, s.check());
+
+  s.push();
+  {
+    s.add(!(x < y) && x + y == 3);
+    EXPECT_EQ(unsat, s.check());
+  }
+  s.pop();
+
+  Bools assumptions;
+  Bools unsat_core(1);
+  assumptions.push_back(y < x);
+  EXPECT_EQ(unsat, s.check_assumptions(assumptions, unsat_core).first);
+
+  const Solver::Stats& stats = s.stats();
+  // x < y and x + y are also counted when !(x < y) and == look them up
+  EXPECT_EQ(2U, stats.unary_opcodes[LNOT]);
+  EXPECT_EQ(2U, stats.binary_opcodes[ADD]);
+  EXPECT_EQ(1U, stats.binary_opcodes[LAND]);
+  EXPECT_EQ(0U, stats.binary_opcodes[MUL]);
+
+  EXPECT_EQ(1U, stats.sat_checks);
+  EXPECT_EQ(2U, stats.unsat_checks);
+  EXPECT_EQ(0U, stats.unknown_checks);
+
+  EXPECT_EQ(3U, stats.check_latencies.count());
+  EXPECT_LE(stats.check_latencies.min(), stats.check_latencies.quantile(0.5));
+
+  // assertions and assumptions at each check
+  EXPECT_EQ(3U, stats.check_formulas.count());
+  EXPECT_EQ(1U, stats.check_formulas.min());
+  EXPECT_EQ(2U, stats.check_formulas.max());
+
+  // x, y and x < y, then !(x < y), x + y, 3, == and &&, then only y < x
+  EXPECT_EQ(3U, stats.check_dag_nodes.count());
+  EXPECT_EQ(3U, stats.check_dag_nodes.min());
+  EXPECT_EQ(8U, stats.check_dag_nodes.max());
+  EXPECT_EQ(15U, stats.check_dag_nodes.sum());
+
+  std::stringstream out;
+  stats.write_json(out);
+  const std::string json = out.str();
+  EXPECT_EQ('{', json.front());
+  EXPECT_EQ('}', json.back());
+  EXPECT_NE(std::string::npos, json.find("\"binary_opcodes\":{\"lnot\":0,"));
+  EXPECT_NE(std::string::npos, json.find("\"checks\":{\"sat\":1,\"unsat\":2,\"unknown\":0,\"timeout\":0}"));
+  EXPECT_NE(std::string::npos, json.find("\"check_formulas\":{\"count\":3,\"sum\":5,"));
+  EXPECT_NE(std::string::npos, json.find("\"check_dag_nodes\":{\"count\":3,\"sum\":15,"));
+}
+
+TEST(SmtZ3Test, CheckAfterInterrupt)
+{
+  typedef Bv<uint64_t> T;
+
+  const T x = any<T>("x");
+  const T y = any<T>("y");
+  const T one = literal<T>(1);
+  const T max = literal<T>(UINT64_C(0xffffffff));
+
+  Z3Solver s;
+
+  // factor the product of two 31-bit primes by bit-blasting
+  s.push();
+  s.add(x * y == literal<T>(UINT64_C(2147483647) * UINT64_C(2147483629)));
+  s.add(one < x && x < max);
+  s.add(one < y && y < max);
+
+  std::thread thread([&s]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    s.interrupt();
+  });
+
+  EXPECT_EQ(unknown, s.check());
+  thread.join();
+  s.pop();
+
+  // the interrupt must not carry over to the next check
+  const Bool b = any<Bool>("b");
+  s.push();
+  s.add(b && !b);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  s.interrupt();
+  s.push();
+  s.add(b && !b);
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+}
+
+// factor the product of two 31-bit primes, which takes Z3 a long time
+static void add_factoring(Solver& s)
+{
+  typedef Bv<uint64_t> T;
+
+  const T x = any<T>("x");
+  const T y = any<T>("y");
+  const T one = literal<T>(1);
+  const T max = literal<T>(UINT64_C(0xffffffff));
+
+  s.add(x * y == literal<T>(UINT64_C(2147483647) * UINT64_C(2147483629)));
+  s.add(one < x && x < max);
+  s.add(one < y && y < max);
+}
+
+TEST(SmtZ3Test, Timeout)
+{
+  Z3Solver s;
+  add_factoring(s);
+
+  s.set_timeout(std::chrono::milliseconds(50));
+  EXPECT_EQ(unknown, s.check());
+  EXPECT_EQ(1U, s.stats().unknown_checks);
+  EXPECT_EQ(1U, s.stats().timeout_checks);
+
+  // easy checks are unaffected
+  s.push();
+  s.add(any<Bv<uint64_t>>("x") == literal<Bv<uint64_t>>(0));
+  EXPECT_EQ(unsat, s.check());
+  s.pop();
+
+  EXPECT_EQ(1U, s.stats().timeout_checks);
+}
+
+TEST(SmtZ3Test, CancellationToken)
+{
+  CancellationToken token;
+  Z3Solver s;
+  s.set_cancellation_token(&token);
+  add_factoring(s);
+
+  std::thread thread([&token]()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    token.cancel();
+  });
+
+  EXPECT_EQ(unknown, s.check());
+  thread.join();
+
+  // the backend is not called while the token is cancelled
+  EXPECT_TRUE(token.is_cancelled());
+  EXPECT_EQ(unknown, s.check());
+  EXPECT_EQ(2U, s.stats().unknown_checks);
+  EXPECT_EQ(0U, s.stats().timeout_checks);
+
+  token.reset();
+  s.reset();
+  s.add(any<Bool>("b"));
+  EXPECT_EQ(sat, s.check());
+}
+
+TEST(SmtZ3Test, CancelAsCheckStarts)
+{
+  CancellationToken token;
+  Z3Solver s;
+  s.set_cancellation_token(&token);
+  add_factoring(s);
+
+  // The interrupt often arrives before Z3 has started its check. There
+  // is no timeout because Z3 4.8 may ignore an interrupt that arrives
+  // while it starts the timer of a check, see Z3Solver::__interrupt().
+  for (unsigned i = 0; i < 16; i++)
+  {
+    token.reset();
+    std::thread thread([&token]() { token.cancel(); });
+    EXPECT_EQ(unknown, s.check());
+    thread.join();
+  }
+}
+
+TEST(SmtZ3Test, CheckAssumptionsWithPushPop)
+{
+  const Int x = any<Int>("x");
+  const Int y = any<Int>("y");
+  const Bool p = any<Bool>("p");
+
+  Z3Solver s;
+  s.add(x < y);
+
+  Bools assumptions;
+  assumptions.push_back(y < x);
+  assumptions.push_back(p);
+
+  Bools unsat_core;
+  unsat_core.terms.resize(2);
+  std::pair<CheckResult, Bools::SizeType> r =
+    s.check_assumptions(assumptions, unsat_core);
+  EXPECT_EQ(unsat, r.first);
+  EXPECT_EQ(1, r.second);
+  EXPECT_EQ(&assumptions.terms[0].ref(), &unsat_core.terms[1].ref());
+
+  // the activation literal of y < x is reused and p needs none
+  const unsigned z3_assertions_size = s.solver().assertions().size();
+  EXPECT_EQ(2U, z3_assertions_size);
+  EXPECT_EQ(unsat, s.check_assumptions(assumptions, unsat_core).first);
+  EXPECT_EQ(z3_assertions_size, s.solver().assertions().size());
+
+  s.push();
+  {
+    s.add(!p);
+    EXPECT_EQ(unsat, s.check_assumptions(assumptions, unsat_core).first);
+
+    Bools new_assumptions;
+    new_assumptions.push_back(x == literal<Int>(3));
+    EXPECT_EQ(sat, s.check_assumptions(new_assumptions, unsat_core).first);
+
+    // assumptions are not assertions
+    s.add(x == literal<Int>(4));
+    EXPECT_EQ(sat, s.check());
+    EXPECT_EQ(unsat, s.check_assumptions(new_assumptions, unsat_core).first);
+  }
+  s.pop();
+
+  // the implication of x == 3 has been popped and is added again
+  Bools other_assumptions;
+  other_assumptions.push_back(x == literal<Int>(3));
+  other_assumptions.push_back(y == literal<Int>(3));
+  r = s.check_assumptions(other_assumptions, unsat_core);
+  EXPECT_EQ(unsat, r.first);
+  EXPECT_EQ(2, r.second);
+
+  other_assumptions.pop_back();
+  EXPECT_EQ(sat, s.check_assumptions(other_assumptions, unsat_core).first);
+
+  s.reset();
+  s.add(!(x == literal<Int>(3)));
+  EXPECT_EQ(unsat, s.check_assumptions(other_assumptions, unsat_core).first);
+}